@@ -409,6 +409,33 @@ host-python()
     fi
 }
 
+# Build Node.js N-API addon (libzt.node) against a static host build, package into tarball
+#
+# ./build.sh host-node "release"
+#
+# Example output:
+#
+# libzt/dist/linux-x64-node-release
+# └── pkg
+#     └── libzt-1.4.0-alpha.0.tgz
+#
+host-node()
+{
+    check_submodules
+    ARTIFACT="node"
+    # Default to release
+    BUILD_TYPE=${1:-release}
+    host $BUILD_TYPE
+    HOST_LIB_DIR=$DEFAULT_HOST_BIN_OUTPUT_DIR-host-$BUILD_TYPE/lib
+    TARGET_BUILD_DIR=$DEFAULT_HOST_BIN_OUTPUT_DIR-$ARTIFACT-$BUILD_TYPE
+    PKG_OUTPUT_DIR=$TARGET_BUILD_DIR/pkg
+    mkdir -p $PKG_OUTPUT_DIR
+    # Requires node-gyp and a C++ toolchain
+    cd pkg/npm && ./build.sh pack $HOST_LIB_DIR && cp -f *.tgz $PKG_OUTPUT_DIR
+    echo -e "\nFinished package:\n"
+    echo $PKG_OUTPUT_DIR/*.tgz
+}
+
 # Build shared library with python wrapper symbols exported
 #host-python()
 #{
@@ -452,6 +479,8 @@ host-pinvoke()
 
     # Test C#
     if [[ $2 = *"test"* ]]; then
+        # Offline smoke test, needs no test network
+        LD_LIBRARY_PATH=$LIB_OUTPUT_DIR dotnet run --project test/csharp || exit 1
         if [[ -z "${alice_path}" ]]; then
             echo "Please set necessary environment variables for test"
             exit 0
@@ -459,7 +488,7 @@ host-pinvoke()
         # TODO: This should eventually be converted to a proper dotnet project
         # Build C# managed API library
         # -doc:$LIB_OUTPUT_DIR/ZeroTier.Sockets.xml
-        csc -target:library -out:$LIB_OUTPUT_DIR/ZeroTier.Sockets.dll src/bindings/csharp/*.cs
+        csc -target:library -unsafe -out:$LIB_OUTPUT_DIR/ZeroTier.Sockets.dll src/bindings/csharp/*.cs
         # Build selftest
         mkdir -p $BIN_OUTPUT_DIR
         csc -out:$BIN_OUTPUT_DIR/selftest.exe -reference:$LIB_OUTPUT_DIR/ZeroTier.Sockets.dll test/selftest.cs
@@ -648,7 +677,8 @@ format-code()
                             src/bindings/java/*.cxx   \
                             examples/csharp/*.cs      \
                             src/bindings/python/*.cxx \
-                            src/bindings/python/*.h
+                            src/bindings/python/*.h   \
+                            src/bindings/nodejs/*.cxx
             return 0
         else
             echo "Please install clang-format"
@@ -719,6 +749,8 @@ clean()
         \) -exec rm -rf {} +
 
     find . -type d -name "__pycache__" -exec rm -rf {} +
+    # Node.js pkg
+    (cd pkg/npm && ./build.sh clean)
     # Python pkg
     cd pkg/pypi && ./build.sh clean
 }
@@ -0,0 +1,1033 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Header-only C++20 coroutine layer over the libzt socket API.
+ *
+ * A `zt::scheduler` owns one `zts_poller` and runs every coroutine it is given on the thread
+ * that calls `run()`. Socket operations are attempted immediately and only suspend when they
+ * would block, in which case the scheduler resumes them once the poller reports readiness. No
+ * thread is ever blocked on an individual socket.
+ *
+ * Results follow the convention of the language bindings: a non-negative value on success and
+ * `-zts_errno` on failure (e.g. `-ZTS_ECONNRESET`).
+ *
+ * Example:
+ *
+ *     zt::task<void> echo(zt::socket s)
+ *     {
+ *         char buf[1024];
+ *         ssize_t n;
+ *         while ((n = co_await s.async_read(buf, sizeof(buf))) > 0) {
+ *             if (co_await s.async_write(buf, n) < 0) {
+ *                 break;
+ *             }
+ *         }
+ *     }
+ *
+ *     zt::task<void> serve(zt::scheduler& sched)
+ *     {
+ *         zt::acceptor a(sched);
+ *         if (a.listen(ZTS_AF_INET, "0.0.0.0", 8080) < 0) {
+ *             co_return;
+ *         }
+ *         for (;;) {
+ *             zt::socket s(sched);
+ *             if (co_await a.async_accept(s) == 0) {
+ *                 sched.spawn(echo(std::move(s)));
+ *             }
+ *         }
+ *     }
+ */
+
+#ifndef ZTS_COROUTINES_HPP
+#define ZTS_COROUTINES_HPP
+
+#if __cplusplus < 202002L && ! (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+#error "ZeroTierCoroutines.hpp requires C++20"
+#endif
+
+#include "ZeroTierSockets.h"
+
+#include <atomic>
+#include <coroutine>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace zt {
+
+class scheduler;
+
+template <typename T> class task;
+
+namespace detail {
+
+/** Result of the most recent failed libzt call in binding convention */
+inline int last_error()
+{
+    return -zts_errno;
+}
+
+inline bool would_block(int err)
+{
+    return err == -ZTS_EAGAIN || err == -ZTS_EWOULDBLOCK || err == -ZTS_EINPROGRESS;
+}
+
+/**
+ * A suspended socket operation. `perform()` is retried each time the socket is reported
+ * ready and returns false while the operation would still block.
+ */
+struct io_op {
+    scheduler* sched = nullptr;
+    int fd = -1;
+    bool is_write = false;
+    ssize_t result = 0;
+    std::coroutine_handle<> handle;
+
+    virtual ~io_op() = default;
+    virtual bool perform(short revents) = 0;
+};
+
+template <typename T> struct task_promise;
+
+struct final_awaiter {
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+    template <typename P> std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+    {
+        std::coroutine_handle<> next = h.promise().continuation;
+        return next ? next : std::noop_coroutine();
+    }
+    void await_resume() noexcept
+    {
+    }
+};
+
+struct task_promise_base {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+
+    std::suspend_always initial_suspend() noexcept
+    {
+        return {};
+    }
+    final_awaiter final_suspend() noexcept
+    {
+        return {};
+    }
+    void unhandled_exception()
+    {
+        exception = std::current_exception();
+    }
+};
+
+template <typename T> struct task_promise : task_promise_base {
+    T value {};
+
+    task<T> get_return_object();
+    void return_value(T v)
+    {
+        value = std::move(v);
+    }
+};
+
+template <> struct task_promise<void> : task_promise_base {
+    task<void> get_return_object();
+    void return_void()
+    {
+    }
+};
+
+/** Fire-and-forget coroutine that owns a spawned task and frees itself when it completes */
+struct detached {
+    struct promise_type {
+        scheduler* sched = nullptr;
+        detached get_return_object()
+        {
+            return { std::coroutine_handle<promise_type>::from_promise(*this) };
+        }
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept;
+        void return_void()
+        {
+        }
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+    };
+    std::coroutine_handle<promise_type> handle;
+};
+
+}   // namespace detail
+
+/**
+ * Lazily started coroutine returning `T`. Awaiting a task starts it and resumes the awaiter
+ * when it finishes. Exceptions thrown inside the task are rethrown to the awaiter.
+ */
+template <typename T = void> class [[nodiscard]] task {
+  public:
+    using promise_type = detail::task_promise<T>;
+
+    task() = default;
+    explicit task(std::coroutine_handle<promise_type> h) : _h(h)
+    {
+    }
+    task(task&& other) noexcept : _h(std::exchange(other._h, {}))
+    {
+    }
+    task& operator=(task&& other) noexcept
+    {
+        if (this != &other) {
+            if (_h) {
+                _h.destroy();
+            }
+            _h = std::exchange(other._h, {});
+        }
+        return *this;
+    }
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+    ~task()
+    {
+        if (_h) {
+            _h.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept
+    {
+        return ! _h || _h.done();
+    }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept
+    {
+        _h.promise().continuation = awaiter;
+        return _h;
+    }
+    T await_resume()
+    {
+        if (_h.promise().exception) {
+            std::rethrow_exception(_h.promise().exception);
+        }
+        if constexpr (! std::is_void_v<T>) {
+            return std::move(_h.promise().value);
+        }
+    }
+
+  private:
+    std::coroutine_handle<promise_type> _h;
+};
+
+namespace detail {
+
+template <typename T> task<T> task_promise<T>::get_return_object()
+{
+    return task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));
+}
+
+inline task<void> task_promise<void>::get_return_object()
+{
+    return task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));
+}
+
+}   // namespace detail
+
+/**
+ * Runs coroutines on a single thread, multiplexing every pending socket operation onto one
+ * `zts_poller`. The cost of a wait is proportional to the number of ready sockets rather than
+ * the number of open ones.
+ */
+class scheduler {
+  public:
+    scheduler() = default;
+    scheduler(const scheduler&) = delete;
+    scheduler& operator=(const scheduler&) = delete;
+    ~scheduler()
+    {
+        // Free tasks that are still suspended, which also closes the sockets they own
+        while (! _tasks.empty()) {
+            void* frame = *_tasks.begin();
+            _tasks.erase(_tasks.begin());
+            std::coroutine_handle<>::from_address(frame).destroy();
+        }
+        if (_pfd >= 0) {
+            zts_poller_free(_pfd);
+        }
+    }
+
+    /**
+     * @brief Create the underlying poller. The node must be running
+     *
+     * @return `ZTS_ERR_OK` if successful, otherwise an error from `zts_poller_new()`
+     */
+    int open()
+    {
+        if (_pfd >= 0) {
+            return ZTS_ERR_OK;
+        }
+        int pfd = zts_poller_new();
+        if (pfd < 0) {
+            return pfd;
+        }
+        _pfd = pfd;
+        return ZTS_ERR_OK;
+    }
+
+    /**
+     * @brief Start a task. It runs when `run()` is next called and is freed once complete
+     */
+    void spawn(task<void> t)
+    {
+        detail::detached d = run_detached(std::move(t));
+        d.handle.promise().sched = this;
+        _tasks.insert(d.handle.address());
+        post(d.handle);
+    }
+
+    /**
+     * @brief Queue a coroutine to be resumed by `run()`
+     */
+    void post(std::coroutine_handle<> h)
+    {
+        _ready.push_back(h);
+    }
+
+    /**
+     * @brief Run until every spawned task has finished or `stop()` is called
+     *
+     * @return `ZTS_ERR_OK`, or an error from `zts_poller_wait()`
+     */
+    int run()
+    {
+        _stopped.store(false);
+        while (! _stopped.load()) {
+            drain_ready();
+            if (_tasks.empty() || _stopped.load()) {
+                break;
+            }
+            int err = poll(-1);
+            if (err < 0) {
+                return err;
+            }
+        }
+        return ZTS_ERR_OK;
+    }
+
+    /**
+     * @brief Resume everything that is ready without blocking, for use inside an external loop
+     * that watches `native_handle()` with `zts_poller_get_os_fd()`
+     *
+     * @return `ZTS_ERR_OK`, or an error from `zts_poller_wait()`
+     */
+    int run_once()
+    {
+        drain_ready();
+        int err = poll(0);
+        drain_ready();
+        return err;
+    }
+
+    /**
+     * @brief Make `run()` return. May be called from any thread
+     */
+    void stop()
+    {
+        _stopped.store(true);
+        if (_pfd >= 0) {
+            zts_poller_wakeup(_pfd);
+        }
+    }
+
+    /** Poller descriptor */
+    int native_handle() const
+    {
+        return _pfd;
+    }
+
+    /** Suspend `op` until its socket is ready. Returns an error if it cannot be registered */
+    int arm(detail::io_op* op)
+    {
+        if (_pfd < 0) {
+            return -ZTS_EBADF;
+        }
+        slot& s = _slots[op->fd];
+        (op->is_write ? s.writer : s.reader) = op;
+        int err = update(op->fd, s);
+        if (err < 0) {
+            (op->is_write ? s.writer : s.reader) = nullptr;
+        }
+        return err;
+    }
+
+    /**
+     * Called when a socket is closed. Pending operations complete with `-ZTS_EBADF` on the next
+     * turn of the loop rather than being resumed from inside the caller.
+     */
+    void forget(int fd)
+    {
+        auto it = _slots.find(fd);
+        if (it == _slots.end()) {
+            return;
+        }
+        detail::io_op* ops[2] = { it->second.reader, it->second.writer };
+        _slots.erase(it);
+        for (detail::io_op* op : ops) {
+            if (op) {
+                op->result = -ZTS_EBADF;
+                post(op->handle);
+            }
+        }
+    }
+
+  private:
+    struct slot {
+        detail::io_op* reader = nullptr;
+        detail::io_op* writer = nullptr;
+        short interest = 0;
+    };
+
+    static constexpr int max_events = 256;
+
+    static detail::detached run_detached(task<void> t)
+    {
+        co_await t;
+    }
+
+    friend struct detail::detached::promise_type;
+
+    void task_finished(std::coroutine_handle<> h)
+    {
+        _tasks.erase(h.address());
+    }
+
+    int update(int fd, slot& s)
+    {
+        short events = (s.reader ? ZTS_POLLIN : 0) | (s.writer ? ZTS_POLLOUT : 0);
+        if (events == s.interest) {
+            return ZTS_ERR_OK;
+        }
+        int err = events ? zts_poller_set(_pfd, fd, events) : zts_poller_remove(_pfd, fd);
+        if (err < 0) {
+            return err;
+        }
+        s.interest = events;
+        return ZTS_ERR_OK;
+    }
+
+    void drain_ready()
+    {
+        // Resuming may queue more work, so swap rather than iterate in place
+        while (! _ready.empty()) {
+            _running.swap(_ready);
+            for (std::coroutine_handle<> h : _running) {
+                h.resume();
+            }
+            _running.clear();
+        }
+    }
+
+    int poll(int timeout_ms)
+    {
+        if (_pfd < 0) {
+            return -ZTS_EBADF;
+        }
+        int n = zts_poller_wait(_pfd, _events, max_events, timeout_ms);
+        if (n < 0) {
+            return n;
+        }
+        const short failed = ZTS_POLLERR | ZTS_POLLHUP | ZTS_POLLNVAL;
+        for (int i = 0; i < n; i++) {
+            int fd = _events[i].fd;
+            short revents = _events[i].revents;
+            auto it = _slots.find(fd);
+            if (it == _slots.end()) {
+                continue;
+            }
+            slot& s = it->second;
+            // Operations are only resumed once every event has been dispatched
+            detail::io_op* reader = (revents & (ZTS_POLLIN | failed)) ? s.reader : nullptr;
+            detail::io_op* writer = (revents & (ZTS_POLLOUT | failed)) ? s.writer : nullptr;
+            if (reader && reader->perform(revents)) {
+                s.reader = nullptr;
+                _ready.push_back(reader->handle);
+            }
+            if (writer && writer->perform(revents)) {
+                s.writer = nullptr;
+                _ready.push_back(writer->handle);
+            }
+            update(fd, s);
+        }
+        return ZTS_ERR_OK;
+    }
+
+    int _pfd = -1;
+    std::unordered_set<void*> _tasks;
+    std::atomic<bool> _stopped { false };
+    std::unordered_map<int, slot> _slots;
+    std::vector<std::coroutine_handle<>> _ready;
+    std::vector<std::coroutine_handle<>> _running;
+    zts_poller_event_t _events[max_events];
+};
+
+namespace detail {
+
+inline std::suspend_never detached::promise_type::final_suspend() noexcept
+{
+    sched->task_finished(std::coroutine_handle<promise_type>::from_promise(*this));
+    return {};
+}
+
+/**
+ * Awaitable wrapper shared by all socket operations: try once, suspend only if that would
+ * block, and report the result on resumption.
+ */
+template <typename Op> struct io_awaiter {
+    Op op;
+
+    bool await_ready()
+    {
+        return op.perform(0);
+    }
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+        op.handle = h;
+        int err = op.sched->arm(&op);
+        if (err < 0) {
+            op.result = err;
+            return false;
+        }
+        return true;
+    }
+    ssize_t await_resume() const noexcept
+    {
+        return op.result;
+    }
+};
+
+struct recv_op : io_op {
+    void* buf;
+    size_t len;
+    int flags;
+    struct zts_sockaddr_storage* from;
+    zts_socklen_t* fromlen;
+
+    bool perform(short) override
+    {
+        ssize_t n = from ? zts_bsd_recvfrom(fd, buf, len, flags, (struct zts_sockaddr*)from, fromlen)
+                         : zts_bsd_recv(fd, buf, len, flags);
+        result = n < 0 ? last_error() : n;
+        return ! would_block((int)result);
+    }
+};
+
+struct send_op : io_op {
+    const char* buf;
+    size_t len;
+    size_t sent = 0;
+    int flags;
+    const struct zts_sockaddr_storage* to;
+    zts_socklen_t tolen;
+    bool all;
+
+    bool perform(short) override
+    {
+        while (sent < len) {
+            ssize_t n = to ? zts_bsd_sendto(fd, buf + sent, len - sent, flags, (const struct zts_sockaddr*)to, tolen)
+                           : zts_bsd_send(fd, buf + sent, len - sent, flags);
+            if (n < 0) {
+                int err = last_error();
+                if (would_block(err)) {
+                    return false;
+                }
+                result = err;
+                return true;
+            }
+            sent += n;
+            if (! all) {
+                break;
+            }
+        }
+        result = (ssize_t)sent;
+        return true;
+    }
+};
+
+struct accept_op : io_op {
+    int accepted = -1;
+
+    bool perform(short) override
+    {
+        int newfd = zts_bsd_accept(fd, nullptr, nullptr);
+        if (newfd < 0) {
+            result = last_error();
+            return ! would_block((int)result);
+        }
+        int err = zts_set_blocking(newfd, 0);
+        if (err < 0) {
+            result = last_error();
+            zts_bsd_close(newfd);
+            return true;
+        }
+        accepted = newfd;
+        result = 0;
+        return true;
+    }
+};
+
+struct connect_op : io_op {
+    const struct zts_sockaddr_storage* addr;
+    zts_socklen_t addrlen;
+    int open_error = 0;
+    bool started = false;
+
+    bool perform(short) override
+    {
+        if (open_error < 0) {
+            result = open_error;
+            return true;
+        }
+        if (! started) {
+            started = true;
+            if (zts_bsd_connect(fd, (const struct zts_sockaddr*)addr, addrlen) == 0) {
+                result = 0;
+                return true;
+            }
+            result = last_error();
+            return ! would_block((int)result);
+        }
+        int err = zts_get_socket_error(fd);
+        result = err == 0 ? 0 : (err > 0 ? -err : err);
+        return true;
+    }
+};
+
+}   // namespace detail
+
+/**
+ * An IPv4 or IPv6 address and port
+ */
+class endpoint {
+  public:
+    endpoint()
+    {
+        memset(&_ss, 0, sizeof(_ss));
+    }
+
+    /**
+     * @brief Set from a human-readable IP string and port
+     *
+     * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_ARG` if the address is invalid
+     */
+    int assign(const char* ipstr, unsigned short port)
+    {
+        memset(&_ss, 0, sizeof(_ss));
+        _len = sizeof(_ss);
+        return zts_util_ipstr_to_saddr(ipstr, port, (struct zts_sockaddr*)&_ss, &_len);
+    }
+
+    /** IP address as a string, empty if unset */
+    std::string address() const
+    {
+        char ipstr[ZTS_INET6_ADDRSTRLEN] = { 0 };
+        unsigned short port = 0;
+        zts_util_ntop((struct zts_sockaddr*)&_ss, _len, ipstr, ZTS_INET6_ADDRSTRLEN, &port);
+        return ipstr;
+    }
+
+    unsigned short port() const
+    {
+        char ipstr[ZTS_INET6_ADDRSTRLEN];
+        unsigned short port = 0;
+        zts_util_ntop((struct zts_sockaddr*)&_ss, _len, ipstr, ZTS_INET6_ADDRSTRLEN, &port);
+        return port;
+    }
+
+    int family() const
+    {
+        return _ss.ss_family;
+    }
+
+    struct zts_sockaddr_storage* data()
+    {
+        return &_ss;
+    }
+
+    const struct zts_sockaddr_storage* data() const
+    {
+        return &_ss;
+    }
+
+    zts_socklen_t* size_ptr()
+    {
+        return &_len;
+    }
+
+    zts_socklen_t size() const
+    {
+        return _len;
+    }
+
+  private:
+    struct zts_sockaddr_storage _ss;
+    zts_socklen_t _len = sizeof(struct zts_sockaddr_storage);
+};
+
+/**
+ * Move-only owner of a non-blocking libzt socket bound to a scheduler. Closed on destruction.
+ */
+class basic_socket {
+  public:
+    explicit basic_socket(scheduler& sched) : _sched(&sched)
+    {
+    }
+    basic_socket(basic_socket&& other) noexcept : _sched(other._sched), _fd(std::exchange(other._fd, -1))
+    {
+    }
+    basic_socket& operator=(basic_socket&& other) noexcept
+    {
+        if (this != &other) {
+            close();
+            _sched = other._sched;
+            _fd = std::exchange(other._fd, -1);
+        }
+        return *this;
+    }
+    basic_socket(const basic_socket&) = delete;
+    basic_socket& operator=(const basic_socket&) = delete;
+    ~basic_socket()
+    {
+        close();
+    }
+
+    /** Socket file descriptor, `-1` if not open */
+    int native_handle() const
+    {
+        return _fd;
+    }
+
+    bool is_open() const
+    {
+        return _fd >= 0;
+    }
+
+    /**
+     * @brief Close the socket. Operations still waiting on it complete with `-ZTS_EBADF`
+     *
+     * @return `ZTS_ERR_OK` if successful, or an error from `zts_bsd_close()`
+     */
+    int close()
+    {
+        if (_fd < 0) {
+            return ZTS_ERR_OK;
+        }
+        _sched->forget(_fd);
+        int err = zts_bsd_close(_fd);
+        _fd = -1;
+        return err;
+    }
+
+    /**
+     * @brief Bind to a local address
+     *
+     * @return `0` if successful, `-zts_errno` otherwise
+     */
+    int bind(const char* ipstr, unsigned short port)
+    {
+        endpoint ep;
+        if (ep.assign(ipstr, port) != ZTS_ERR_OK) {
+            return -ZTS_EINVAL;
+        }
+        return zts_bsd_bind(_fd, (struct zts_sockaddr*)ep.data(), ep.size()) < 0 ? detail::last_error() : 0;
+    }
+
+    /** Local address */
+    endpoint local_endpoint() const
+    {
+        endpoint ep;
+        zts_bsd_getsockname(_fd, (struct zts_sockaddr*)ep.data(), ep.size_ptr());
+        return ep;
+    }
+
+  protected:
+    int open(int family, int type)
+    {
+        close();
+        int fd = zts_bsd_socket(family, type, 0);
+        if (fd < 0) {
+            return detail::last_error();
+        }
+        if (zts_set_blocking(fd, 0) < 0) {
+            int err = detail::last_error();
+            zts_bsd_close(fd);
+            return err;
+        }
+        _fd = fd;
+        return 0;
+    }
+
+    void adopt(int fd)
+    {
+        close();
+        _fd = fd;
+    }
+
+    scheduler* _sched;
+    int _fd = -1;
+
+    friend class acceptor;
+};
+
+/**
+ * A TCP connection
+ */
+class socket : public basic_socket {
+  public:
+    explicit socket(scheduler& sched) : basic_socket(sched)
+    {
+    }
+
+    /**
+     * @brief Create a TCP socket
+     *
+     * @return `0` if successful, `-zts_errno` otherwise
+     */
+    int open(int family)
+    {
+        return basic_socket::open(family, ZTS_SOCK_STREAM);
+    }
+
+    /**
+     * @brief Connect to a remote address, opening the socket first if needed
+     *
+     * @return Awaitable yielding `0` if connected, `-zts_errno` otherwise
+     */
+    auto async_connect(const endpoint& remote)
+    {
+        int err = _fd < 0 ? open(remote.family()) : 0;
+        detail::io_awaiter<detail::connect_op> a;
+        init(a.op, true);
+        a.op.addr = remote.data();
+        a.op.addrlen = remote.size();
+        a.op.open_error = err;
+        return a;
+    }
+
+    /**
+     * @brief Read up to `len` bytes
+     *
+     * @return Awaitable yielding the number of bytes read, `0` at end of stream, `-zts_errno` on error
+     */
+    auto async_read(void* buf, size_t len, int flags = 0)
+    {
+        detail::io_awaiter<detail::recv_op> a;
+        init(a.op, false);
+        a.op.buf = buf;
+        a.op.len = len;
+        a.op.flags = flags;
+        a.op.from = nullptr;
+        a.op.fromlen = nullptr;
+        return a;
+    }
+
+    /**
+     * @brief Write all `len` bytes, suspending as often as needed
+     *
+     * @return Awaitable yielding `len`, or `-zts_errno` on error
+     */
+    auto async_write(const void* buf, size_t len, int flags = 0)
+    {
+        return write(buf, len, flags, true);
+    }
+
+    /**
+     * @brief Write as many bytes as can be sent without further waiting, at least one
+     *
+     * @return Awaitable yielding the number of bytes written, or `-zts_errno` on error
+     */
+    auto async_write_some(const void* buf, size_t len, int flags = 0)
+    {
+        return write(buf, len, flags, false);
+    }
+
+    /**
+     * @brief Shut down one or both halves of the connection
+     *
+     * @return `0` if successful, `-zts_errno` otherwise
+     */
+    int shutdown(int how)
+    {
+        return zts_bsd_shutdown(_fd, how) < 0 ? detail::last_error() : 0;
+    }
+
+    int set_no_delay(bool enabled)
+    {
+        return zts_set_no_delay(_fd, enabled) < 0 ? detail::last_error() : 0;
+    }
+
+    /** Remote address */
+    endpoint remote_endpoint() const
+    {
+        endpoint ep;
+        zts_bsd_getpeername(_fd, (struct zts_sockaddr*)ep.data(), ep.size_ptr());
+        return ep;
+    }
+
+  private:
+    void init(detail::io_op& op, bool is_write)
+    {
+        op.sched = _sched;
+        op.fd = _fd;
+        op.is_write = is_write;
+    }
+
+    detail::io_awaiter<detail::send_op> write(const void* buf, size_t len, int flags, bool all)
+    {
+        detail::io_awaiter<detail::send_op> a;
+        init(a.op, true);
+        a.op.buf = (const char*)buf;
+        a.op.len = len;
+        a.op.flags = flags;
+        a.op.to = nullptr;
+        a.op.tolen = 0;
+        a.op.all = all;
+        return a;
+    }
+};
+
+/**
+ * Listens for and accepts TCP connections
+ */
+class acceptor : public basic_socket {
+  public:
+    explicit acceptor(scheduler& sched) : basic_socket(sched)
+    {
+    }
+
+    /**
+     * @brief Open, bind and listen
+     *
+     * @return `0` if successful, `-zts_errno` otherwise
+     */
+    int listen(int family, const char* ipstr, unsigned short port, int backlog = 128)
+    {
+        int err = open(family, ZTS_SOCK_STREAM);
+        if (err < 0) {
+            return err;
+        }
+        if ((err = bind(ipstr, port)) < 0) {
+            return err;
+        }
+        return zts_bsd_listen(_fd, backlog) < 0 ? detail::last_error() : 0;
+    }
+
+    /**
+     * @brief Accept the next connection into `peer`, replacing whatever it held
+     *
+     * @return Awaitable yielding `0` if a connection was accepted, `-zts_errno` otherwise
+     */
+    auto async_accept(socket& peer)
+    {
+        struct awaiter : detail::io_awaiter<detail::accept_op> {
+            socket* peer;
+            ssize_t await_resume()
+            {
+                if (op.result == 0) {
+                    peer->adopt(op.accepted);
+                }
+                return op.result;
+            }
+        };
+        awaiter a;
+        a.op.sched = _sched;
+        a.op.fd = _fd;
+        a.op.is_write = false;
+        a.peer = &peer;
+        return a;
+    }
+};
+
+/**
+ * A UDP socket
+ */
+class udp_socket : public basic_socket {
+  public:
+    explicit udp_socket(scheduler& sched) : basic_socket(sched)
+    {
+    }
+
+    /**
+     * @brief Create a UDP socket
+     *
+     * @return `0` if successful, `-zts_errno` otherwise
+     */
+    int open(int family)
+    {
+        return basic_socket::open(family, ZTS_SOCK_DGRAM);
+    }
+
+    /**
+     * @brief Receive one datagram
+     *
+     * @return Awaitable yielding the datagram size, or `-zts_errno` on error
+     */
+    auto async_receive_from(void* buf, size_t len, endpoint& from, int flags = 0)
+    {
+        detail::io_awaiter<detail::recv_op> a;
+        a.op.sched = _sched;
+        a.op.fd = _fd;
+        a.op.is_write = false;
+        a.op.buf = buf;
+        a.op.len = len;
+        a.op.flags = flags;
+        a.op.from = from.data();
+        *from.size_ptr() = sizeof(struct zts_sockaddr_storage);
+        a.op.fromlen = from.size_ptr();
+        return a;
+    }
+
+    /**
+     * @brief Send one datagram
+     *
+     * @return Awaitable yielding the number of bytes sent, or `-zts_errno` on error
+     */
+    auto async_send_to(const void* buf, size_t len, const endpoint& to, int flags = 0)
+    {
+        detail::io_awaiter<detail::send_op> a;
+        a.op.sched = _sched;
+        a.op.fd = _fd;
+        a.op.is_write = true;
+        a.op.buf = (const char*)buf;
+        a.op.len = len;
+        a.op.flags = flags;
+        a.op.to = to.data();
+        a.op.tolen = to.size();
+        a.op.all = false;
+        return a;
+    }
+};
+
+}   // namespace zt
+
+#endif   // ZTS_COROUTINES_HPP
@@ -163,6 +163,8 @@ typedef enum {
     ZTS_EVENT_PEER_PATH_DISCOVERED = 243,
     /** A known path to a peer is now considered dead */
     ZTS_EVENT_PEER_PATH_DEAD = 244,
+    /** The quality of a peer's paths changed noticeably, see `zts_init_set_path_monitoring()` */
+    ZTS_EVENT_PEER_PATH_QUALITY = 245,
 
     /** A new managed network route was added */
     ZTS_EVENT_ROUTE_ADDED = 250,
@@ -338,6 +340,12 @@ typedef enum {
  */
 #define ZTS_MAX_PEER_NETWORK_PATHS 16
 
+/**
+ * Change in RTT (in milliseconds) or probe loss needed to raise `ZTS_EVENT_PEER_PATH_QUALITY`
+ */
+#define ZTS_PATH_QUALITY_RTT_HYSTERESIS  10
+#define ZTS_PATH_QUALITY_LOSS_HYSTERESIS 0.05f
+
 /**
  * Maximum number of multicast groups a device / network interface can be
  * subscribed to at once
@@ -922,6 +930,118 @@ typedef struct {
     zts_path_t paths[ZTS_MAX_PEER_NETWORK_PATHS];
 } zts_peer_info_t;
 
+/**
+ * Measured quality of a physical path to a peer
+ */
+typedef struct {
+    /**
+     * Address of endpoint
+     */
+    struct zts_sockaddr_storage address;
+
+    /**
+     * Round-trip time last measured by ZeroTier in milliseconds or -1 if unknown
+     */
+    int rtt;
+
+    /**
+     * Smoothed variation between successive RTT measurements in milliseconds or -1 if unknown
+     */
+    int jitter;
+
+    /**
+     * Milliseconds since a packet was last received over this path or -1 for never
+     */
+    int64_t last_rx_age;
+
+    /**
+     * Bytes received and sent over this path while path monitoring is enabled
+     */
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+
+    /**
+     * Whether this is the path traffic to the peer is currently sent over
+     */
+    int preferred;
+} zts_path_quality_t;
+
+/**
+ * Path quality of a peer, see `zts_peer_get_quality()`
+ */
+typedef struct {
+    /**
+     * ZeroTier address (40 bits)
+     */
+    uint64_t peer_id;
+
+    /**
+     * Whether no direct path is known and traffic is relayed
+     */
+    int relayed;
+
+    /**
+     * Round-trip time of the last answered probe in milliseconds or -1 if none
+     */
+    int probe_rtt;
+
+    /**
+     * Smoothed fraction of probes left unanswered, from `0.0` to `1.0`, or -1 if the peer has
+     * never answered a probe
+     */
+    float probe_loss;
+
+    /**
+     * Number of paths (size of paths[])
+     */
+    unsigned int path_count;
+
+    /**
+     * Known network paths to peer
+     */
+    zts_path_quality_t paths[ZTS_MAX_PEER_NETWORK_PATHS];
+} zts_peer_quality_t;
+
+/**
+ * Point-in-time copy of a node's state, see `zts_snapshot_acquire()`
+ */
+typedef struct {
+    /**
+     * Increases each time the node publishes a new snapshot
+     */
+    uint64_t version;
+
+    /**
+     * ZeroTier address of the node
+     */
+    uint64_t node_id;
+
+    /**
+     * Whether the node was online
+     */
+    int online;
+
+    /**
+     * Number of joined networks (size of nets[])
+     */
+    unsigned int net_count;
+
+    /**
+     * Joined networks, with their assigned addresses, routes and multicast subscriptions
+     */
+    const zts_net_info_t* nets;
+
+    /**
+     * Number of known peers (size of peers[])
+     */
+    unsigned int peer_count;
+
+    /**
+     * Known peers and their paths
+     */
+    const zts_peer_info_t* peers;
+} zts_snapshot_t;
+
 #define ZTS_MAX_NUM_ROOTS          16
 #define ZTS_MAX_ENDPOINTS_PER_ROOT 32
 
@@ -994,6 +1114,10 @@ typedef struct {
      * Length of data message or structure
      */
     int len;
+    /**
+     * Path quality (`ZTS_EVENT_PEER_PATH_QUALITY` only)
+     */
+    zts_peer_quality_t* peer_quality;
 } zts_event_msg_t;
 
 //----------------------------------------------------------------------------//
@@ -1030,12 +1154,48 @@ PyObject* zts_py_recv(int fd, int len, int flags);
 
 int zts_py_send(int fd, PyObject* buf, int flags);
 
+int zts_py_recv_into(int fd, PyObject* buf, int len, int flags);
+
+PyObject* zts_py_recvfrom(int fd, int len, int flags);
+
+PyObject* zts_py_recvfrom_into(int fd, PyObject* buf, int len, int flags);
+
+int zts_py_sendall(int fd, PyObject* buf, int flags);
+
+int zts_py_sendto(int fd, PyObject* buf, int flags, int family, PyObject* addro);
+
 int zts_py_close(int fd);
 
 int zts_py_setblocking(int fd, int flag);
 
 int zts_py_getblocking(int fd);
 
+/**
+ * @brief Deliver events to Python through a queue instead of a director callback.
+ * Unlike `zts_init_set_event_handler()`, the callback thread never acquires the GIL.
+ * Must be called before `zts_node_start()`
+ *
+ * @return An OS file descriptor that is readable while events are pending (e.g. for
+ *     `asyncio` `add_reader()`), `ZTS_ERR_SERVICE` if the node is running, `ZTS_ERR_GENERAL`
+ *     if the descriptor could not be created
+ */
+int zts_py_init_event_queue();
+
+/**
+ * @brief Take the oldest event from the queue opened with `zts_py_init_event_queue()`
+ *
+ * @return Tuple of `(event_code, id)`, where `id` is the node, network or peer ID the event
+ *     concerns (or `0`), or `None` if no event is pending
+ */
+PyObject* zts_py_event_next();
+
+/**
+ * @brief Wait on a poller created with `zts_poller_new()` without holding the GIL
+ *
+ * @return List of `(fd, revents)` tuples, or an integer error code
+ */
+PyObject* zts_py_poller_wait(int pfd, int max_events, int timeout_ms);
+
 #endif   // ZTS_ENABLE_PYTHON
 
 //----------------------------------------------------------------------------//
@@ -1066,6 +1226,7 @@ int zts_py_getblocking(int fd);
 #define ZTS_CENRTAL_MAX_URL_LEN         128
 #define ZTS_CENTRAL_TOKEN_LEN           32
 #define ZTS_CENTRAL_RESP_BUF_DEFAULT_SZ (128 * 1024)
+#define ZTS_CENTRAL_DEFAULT_CONCURRENCY 16
 
 #define ZTS_HTTP_GET    0
 #define ZTS_HTTP_POST   1
@@ -1113,6 +1274,51 @@ ZTS_API int ZTCALL zts_central_init(const char* url_str, const char* token_str,
 
 ZTS_API void ZTCALL zts_central_cleanup();
 
+/**
+ * @brief Stream response bodies to a handler instead of copying them into the response buffer
+ * given to `zts_central_init()`. Responses of any size can then be consumed, such as the member
+ * list of a large network. The handler is called on the requesting thread with consecutive
+ * chunks of the body.
+ *
+ * @param handler Function receiving each chunk, returning `0` to continue or any other value
+ *     to abort the request. `NULL` to go back to the response buffer.
+ * @param arg Passed to the handler unchanged
+ * @return `ZTS_ERR_OK` if successful.
+ */
+ZTS_API int ZTCALL
+zts_central_set_stream_handler(int (*handler)(const char* data, unsigned int len, void* arg), void* arg);
+
+/**
+ * @brief Enable or disable caching of GET responses. While enabled, GET requests for a resource
+ * fetched before carry the `ETag` and `Last-Modified` validators the server sent with it. If the
+ * server answers `304 Not Modified` nothing is transferred, the cached body is delivered as if it
+ * had been, and the response code is `304`. Disabling the cache empties it.
+ *
+ * @param enabled `[1, 0]`, Whether responses are cached
+ * @return `ZTS_ERR_OK` if successful. `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_central_set_cache(int8_t enabled);
+
+/**
+ * @brief Get the number of cached GET requests answered with `304 Not Modified` (hits) and
+ * answered otherwise (misses).
+ *
+ * @param hits Set to the number of hits
+ * @param misses Set to the number of misses
+ * @return `ZTS_ERR_OK` if successful. `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_central_get_cache_stats(uint64_t* hits, uint64_t* misses);
+
+/**
+ * @brief Set how many requests of a batch may be in flight at once. Requests share
+ * connections to the server, which are multiplexed where the server supports HTTP/2.
+ * Default is `ZTS_CENTRAL_DEFAULT_CONCURRENCY`.
+ *
+ * @param max_requests Maximum number of concurrent requests
+ * @return `ZTS_ERR_OK` if successful. `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_central_set_concurrency(unsigned int max_requests);
+
 /**
  * @brief Copies the `JSON`-formatted string buffer from the last request into
  *        a user-provided buffer.
@@ -1202,6 +1408,27 @@ ZTS_API int ZTCALL zts_central_member_update(int* http_resp_code, uint64_t net_i
  */
 ZTS_API int ZTCALL zts_central_node_auth(int* http_resp_code, uint64_t net_id, uint64_t node_id, uint8_t is_authed);
 
+/**
+ * @brief Authorize or (De)authorize many nodes on a network. The member updates are sent
+ * concurrently over reused connections, see `zts_central_set_concurrency()`. Responses are
+ * not copied into the response buffer.
+ *
+ * @param http_resp_codes User-provided array of `count` entries. Set to the HTTP response code
+ *     of each update, or `0` if the update received no response.
+ * @param net_id Network ID
+ * @param node_ids Array of `count` node IDs
+ * @param count Number of nodes
+ * @param is_authed Boolean value for whether these nodes should be authorized
+ * @return Number of updates that succeeded, `ZTS_ERR_ARG` if invalid argument,
+ *     `ZTS_ERR_SERVICE` if the API is not initialized or not writable.
+ */
+ZTS_API int ZTCALL zts_central_node_auth_batch(
+    int* http_resp_codes,
+    uint64_t net_id,
+    const uint64_t* node_ids,
+    unsigned int count,
+    uint8_t is_authed);
+
 /**
  * @brief Get All Members of a Network.
  *
@@ -1213,6 +1440,112 @@ ZTS_API int ZTCALL zts_central_net_get_members(int* http_resp_code, uint64_t net
 
 #endif   // ZTS_DISABLE_CENTRAL_API
 
+//----------------------------------------------------------------------------//
+// Node Contexts                                                              //
+//----------------------------------------------------------------------------//
+
+/**
+ * A node instance. Several nodes can run in one process, one per context, but they share a single
+ * TCP/IP stack (see below). Every `zts_init_*`, `zts_node_*`, `zts_net_*` and other control
+ * function acts on the context selected by the calling thread, and a default context is used until
+ * another is selected. The `zts_ctx_*` functions below take the context explicitly instead. Each
+ * context has its own identity, networks, virtual interfaces, event handler and service thread.
+ *
+ * A socket belongs to the context it was created on (for an accepted socket, that of the
+ * listening socket) and can only be used while that context's node is running.
+ *
+ * `Limitation`: contexts are not isolated from one another at the IP layer. The virtual interfaces
+ * of all nodes are attached to the one stack, so its netif list, socket table, port space, memory
+ * pools and statistics are process-wide, and `zts_stats_get_all()`, `zts_dns_*` and
+ * `zts_bsd_select()`/`zts_bsd_poll()` are not scoped to a context. In particular:
+ *
+ * - A socket bound to the wildcard address receives traffic that arrives on the interfaces of
+ *   every node, and a listening socket accepts connections addressed to any node's addresses.
+ * - A port bound by one context cannot be bound by another on an overlapping address.
+ * - Routes are chosen by source address first, so a socket bound to an address of its own node
+ *   stays on that node even when networks of several nodes overlap, but an unbound socket is
+ *   routed by destination only and may leave through another node's interface.
+ *
+ * Bind sockets to an address of their own node where this matters, and run nodes in separate
+ * processes where they must not see each other's traffic.
+ */
+typedef struct zts_ctx zts_ctx_t;
+
+/**
+ * @brief Create a new node context. Select it with `zts_ctx_set()` before configuring and
+ *     starting its node.
+ *
+ * @return New context
+ */
+ZTS_API zts_ctx_t* ZTCALL zts_ctx_new();
+
+/**
+ * @brief Select the context on which control functions called from this thread operate. The
+ *     service and event threads of a node always use the node's own context.
+ *
+ * @param ctx Context, or `NULL` for the default context
+ * @return `ZTS_ERR_OK` if successful.
+ */
+ZTS_API int ZTCALL zts_ctx_set(zts_ctx_t* ctx);
+
+/**
+ * @brief Return the context selected by the calling thread
+ *
+ * @return Context
+ */
+ZTS_API zts_ctx_t* ZTCALL zts_ctx_get();
+
+/**
+ * @brief Free a context created by `zts_ctx_new()`. Its node must not have been started, or must
+ *     have been stopped or freed and its service thread finished. The stack is only shut down by
+ *     `zts_node_free()` on the last running node.
+ *
+ * @param ctx Context
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node is still running or winding
+ *     down, `ZTS_ERR_ARG` if invalid argument or the default context.
+ */
+ZTS_API int ZTCALL zts_ctx_free(zts_ctx_t* ctx);
+
+/**
+ * @brief The following functions are the same as those without the `ctx_` prefix, applied to
+ *     `ctx` rather than to the calling thread's context. They do not change the calling thread's
+ *     selection, and return `ZTS_ERR_ARG` if `ctx` is `NULL` (`0` for `zts_ctx_node_is_online()`).
+ */
+ZTS_API int ZTCALL zts_ctx_init_from_storage(zts_ctx_t* ctx, const char* path);
+ZTS_API int ZTCALL zts_ctx_init_from_memory(zts_ctx_t* ctx, const char* key, unsigned int len);
+ZTS_API int ZTCALL zts_ctx_init_set_port(zts_ctx_t* ctx, unsigned short port);
+ZTS_API int ZTCALL zts_ctx_init_set_caller_driven(zts_ctx_t* ctx, unsigned int enabled);
+#ifdef ZTS_C_API_ONLY
+ZTS_API int ZTCALL zts_ctx_init_set_event_handler(zts_ctx_t* ctx, void (*callback)(void*));
+#endif
+ZTS_API int ZTCALL zts_ctx_node_start(zts_ctx_t* ctx);
+ZTS_API int ZTCALL zts_ctx_node_is_online(zts_ctx_t* ctx);
+ZTS_API uint64_t ZTCALL zts_ctx_node_get_id(zts_ctx_t* ctx);
+ZTS_API int ZTCALL zts_ctx_node_stop(zts_ctx_t* ctx);
+ZTS_API int ZTCALL zts_ctx_node_free(zts_ctx_t* ctx);
+ZTS_API int ZTCALL zts_ctx_net_join(zts_ctx_t* ctx, uint64_t net_id);
+ZTS_API int ZTCALL zts_ctx_net_leave(zts_ctx_t* ctx, uint64_t net_id);
+ZTS_API int ZTCALL zts_ctx_net_transport_is_ready(zts_ctx_t* ctx, uint64_t net_id);
+ZTS_API int ZTCALL
+zts_ctx_addr_get(zts_ctx_t* ctx, uint64_t net_id, unsigned int family, struct zts_sockaddr_storage* addr);
+ZTS_API int ZTCALL
+zts_ctx_addr_get_str(zts_ctx_t* ctx, uint64_t net_id, unsigned int family, char* dst, unsigned int len);
+ZTS_API int ZTCALL zts_ctx_process(zts_ctx_t* ctx, int timeout_ms);
+ZTS_API int ZTCALL zts_ctx_next_deadline(zts_ctx_t* ctx);
+ZTS_API int ZTCALL zts_ctx_get_pollable_fds(zts_ctx_t* ctx, int* fds, unsigned int max);
+
+/**
+ * @brief Create a socket that belongs to `ctx`. Same as `zts_bsd_socket()` otherwise.
+ *
+ * @param ctx Context
+ * @param family `ZTS_AF_INET` or `ZTS_AF_INET6`
+ * @param type `ZTS_SOCK_STREAM` or `ZTS_SOCK_DGRAM`
+ * @param protocol Protocols supported on this socket
+ * @return Numbered file descriptor on success, `ZTS_ERR_SERVICE` if the node of `ctx` is not
+ *     running, `ZTS_ERR_ARG` if `ctx` is `NULL`. Sets `zts_errno`
+ */
+ZTS_API int ZTCALL zts_ctx_bsd_socket(zts_ctx_t* ctx, int family, int type, int protocol);
+
 //----------------------------------------------------------------------------//
 // Identity Management                                                        //
 //----------------------------------------------------------------------------//
@@ -1243,6 +1576,126 @@ ZTS_API int ZTCALL zts_id_new(char* key, unsigned int* key_buf_len);
  */
 ZTS_API int ZTCALL zts_id_pair_is_valid(const char* key, unsigned int len);
 
+/**
+ * @brief Generates several node identities at once, spreading the work over
+ *     multiple threads. Identity generation is CPU and memory bound, so more
+ *     threads than cores gives no benefit.
+ *
+ * Progress of batches in flight can be followed from another thread through
+ * `batch_total` and `batch_done` of `zts_id_get_stats()`.
+ *
+ * @param count Number of identities to generate
+ * @param threads Number of threads to use including the caller, `0` for one
+ *     per hardware thread
+ * @param keys User-provided destination buffer of `count * ZTS_ID_STR_BUF_LEN`
+ *     bytes. Identity `i` is written as a null-terminated string at offset
+ *     `i * ZTS_ID_STR_BUF_LEN`.
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_id_new_batch(unsigned int count, unsigned int threads, char* keys);
+
+/**
+ * @brief Verifies several key-pairs at once, spreading the work over multiple
+ *     threads. Each key-pair is checked as by `zts_id_pair_is_valid()`.
+ *
+ * @param keys Buffer of `count * ZTS_ID_STR_BUF_LEN` bytes laid out as by
+ *     `zts_id_new_batch()`
+ * @param count Number of key-pairs
+ * @param threads Number of threads to use including the caller, `0` for one
+ *     per hardware thread
+ * @param results User-provided array of `count` entries. Set to `1` for each
+ *     valid key-pair and `0` otherwise.
+ * @return Number of valid key-pairs, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL
+zts_id_pair_is_valid_batch(const char* keys, unsigned int count, unsigned int threads, int* results);
+
+/**
+ * @brief Starts background threads that keep a pool of identities generated
+ *     ahead of time. While the pool is running `zts_id_new()` takes an
+ *     identity from it and only generates one itself when the pool is empty.
+ *     Pooled identities are held in memory only and are wiped when the pool
+ *     is stopped.
+ *
+ * @param size Number of identities to keep available
+ * @param threads Number of background threads, `0` for one per hardware
+ *     thread
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the pool is
+ *     already running, `ZTS_ERR_ARG` if invalid argument, `ZTS_ERR_GENERAL` if
+ *     no thread could be started.
+ */
+ZTS_API int ZTCALL zts_id_pool_start(unsigned int size, unsigned int threads);
+
+/**
+ * @brief Stops the identity pool and discards the identities left in it.
+ *     Blocks until every background thread has finished the identity it is
+ *     generating.
+ *
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the pool is not
+ *     running.
+ */
+ZTS_API int ZTCALL zts_id_pool_stop();
+
+/**
+ * Identity generation and validation counters
+ */
+typedef struct {
+    /**
+     * Identities generated since the process started, by any means
+     */
+    uint64_t generated;
+
+    /**
+     * Time spent generating those identities in microseconds, summed over all
+     * threads. `generated * 1000000 / generate_us` is the throughput of one
+     * thread.
+     */
+    uint64_t generate_us;
+
+    /**
+     * Key-pairs validated since the process started
+     */
+    uint64_t validated;
+
+    /**
+     * Identities requested by `zts_id_new_batch()` calls still in progress
+     */
+    uint64_t batch_total;
+
+    /**
+     * Of `batch_total`, those already generated
+     */
+    uint64_t batch_done;
+
+    /**
+     * Calls to `zts_id_new()` served from the pool
+     */
+    uint64_t pool_hits;
+
+    /**
+     * Calls to `zts_id_new()` that found the running pool empty
+     */
+    uint64_t pool_misses;
+
+    /**
+     * Identities currently available in the pool
+     */
+    unsigned int pool_available;
+
+    /**
+     * Size the pool is kept at, `0` if it is not running
+     */
+    unsigned int pool_target;
+} zts_id_stats_t;
+
+/**
+ * @brief Gets identity generation and validation counters
+ *
+ * @param stats User-provided structure that will be populated
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_id_get_stats(zts_id_stats_t* stats);
+
 /**
  * @brief Instruct ZeroTier to look for node identity files at the given location. This is an
  * initialization function that can only be called before `zts_node_start()`.
@@ -1274,6 +1727,39 @@ ZTS_API int ZTCALL zts_init_from_storage(const char* path);
  */
 ZTS_API int ZTCALL zts_init_from_memory(const char* key, unsigned int len);
 
+/**
+ * @brief Instruct ZeroTier to start from a state blob written by `zts_state_export()`. This is an
+ * initialization function that can only be called before `zts_node_start()`.
+ *
+ * The blob supplies the identity, the root set, the configs of the networks the node was joined to
+ * and the peers it most recently talked to along with their last known physical paths. The node
+ * rejoins those networks with their previous configs and can send directly to those peers without
+ * first going through a root. Anything the blob does not contain is looked up in storage as usual.
+ *
+ * See also: `zts_init_from_memory()`
+ *
+ * @param state Buffer containing the blob
+ * @param len Length of `state` buffer
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument or the blob is malformed.
+ */
+ZTS_API int ZTCALL zts_init_from_snapshot(const void* state, unsigned int len);
+
+/**
+ * @brief Write the running node's identity, root set, network configs and most recently active
+ * peers into one blob for use with `zts_init_from_snapshot()`. The blob contains the node's secret
+ * key and must be protected accordingly. Network configs and peers are left out if
+ * `zts_init_allow_net_cache()` or `zts_init_allow_peer_cache()` disallowed caching them, and such
+ * records of an imported blob are then ignored.
+ *
+ * @param state User-provided destination buffer
+ * @param len Length of `state` buffer. Will be set to the length of the blob, also when the
+ *     buffer is too small.
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node is not running,
+ *     `ZTS_ERR_ARG` if invalid argument or the buffer is too small.
+ */
+ZTS_API int ZTCALL zts_state_export(void* state, unsigned int* len);
+
 /**
  * @brief Set the event handler function. This is an initialization function that can only be called
  * before `zts_node_start()`.
@@ -1354,6 +1840,35 @@ ZTS_API int ZTCALL zts_init_set_random_port_range(unsigned short start_port, uns
  */
 ZTS_API int ZTCALL zts_init_allow_secondary_port(unsigned int allowed);
 
+/**
+ * @brief Allow or disallow the operating system to pick the primary port when none was set with
+ * `zts_init_set_port()`. This is disabled by default, in which case random ports from the range
+ * set by `zts_init_set_random_port_range()` are tried until one is free. Letting the OS pick takes
+ * a single bind and cannot fail on a crowded host, but the port may fall outside that range. This
+ * is an initialization function that can only be called before `zts_node_start()`.
+ *
+ * @param allowed Whether the OS may pick the primary port
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_init_allow_os_port_selection(unsigned int allowed);
+
+/**
+ * @brief Enable path monitoring. While enabled bytes sent and received are counted per path and
+ * `ZTS_EVENT_PEER_PATH_QUALITY` is raised when a peer's path quality changes noticeably: its
+ * preferred path or number of paths changes, it becomes relayed or direct, its RTT moves by more
+ * than `ZTS_PATH_QUALITY_RTT_HYSTERESIS` ms and 20%, or its probe loss moves by more than
+ * `ZTS_PATH_QUALITY_LOSS_HYSTERESIS`. Optionally every peer is also probed at a fixed interval to
+ * measure RTT and loss end-to-end. Only peers running libzt answer probes. This is an
+ * initialization function that can only be called before `zts_node_start()`.
+ *
+ * @param enabled Whether to monitor paths
+ * @param probe_interval_ms Interval between probes of each peer, `0` to not probe
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_init_set_path_monitoring(unsigned int enabled, unsigned int probe_interval_ms);
+
 /**
  * @brief Allow or disallow the use of port-mapping. This is enabled by default. This is an
  * initialization function that can only be called before `zts_node_start()`.
@@ -1364,6 +1879,49 @@ ZTS_API int ZTCALL zts_init_allow_secondary_port(unsigned int allowed);
  */
 ZTS_API int ZTCALL zts_init_allow_port_mapping(unsigned int allowed);
 
+/**
+ * @brief Enable or disable caller-driven operation. This is disabled by default. When enabled
+ * `zts_node_start()` creates no background threads (no service, stack or callback thread) and
+ * all node, stack and event work is instead performed by the application calling
+ * `zts_process()`. This is an initialization function that can only be called before
+ * `zts_node_start()`.
+ *
+ * @param enabled Whether caller-driven operation is enabled
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem.
+ */
+ZTS_API int ZTCALL zts_init_set_caller_driven(unsigned int enabled);
+
+/**
+ * @brief Enable or disable virtual TCP segmentation offload. This is disabled by default. When
+ * enabled the TCP/IP stack builds TCP segments of up to 16 KB regardless of the network's MTU, and
+ * these are split into packets that fit the MTU only as they leave the stack, which saves
+ * per-segment work on bulk transfers. The stack never sends segments larger than the MSS a peer
+ * announces, and only a peer that also enables this option announces more than the network's
+ * MTU, so the gain is limited to connections between two such nodes. Other peers are sent
+ * ordinary segments of their own MSS. This is an initialization function that can only be called
+ * before `zts_node_start()`.
+ *
+ * @param enabled Whether virtual TSO is enabled
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem.
+ */
+ZTS_API int ZTCALL zts_init_set_tso(unsigned int enabled);
+
+/**
+ * @brief Enable or disable receive coalescing. This is disabled by default. When enabled
+ * consecutive in-order TCP segments of a connection that arrive together are merged into one
+ * before they enter the TCP/IP stack, so that the stack acknowledges them and wakes the
+ * application once. A segment with PSH or any flag other than ACK, or one that arrives out of
+ * order, is not merged and ends the merge. See `zts_stats_get_gro()`. This is an initialization function that can
+ * only be called before `zts_node_start()`.
+ *
+ * @param enabled Whether receive coalescing is enabled
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem.
+ */
+ZTS_API int ZTCALL zts_init_set_gro(unsigned int enabled);
+
 /**
  * @brief Enable or disable whether the node will cache network details
  * (enabled by default when `zts_init_from_storage()` is used.) Must be called before
@@ -1712,6 +2270,9 @@ ZTS_API int ZTCALL zts_node_get_port();
  * timers) will remain active in case future traffic processing is required.
  * To stop all activity and free all resources use `zts_free()` instead.
  *
+ * Returns once the node's service thread has exited, so `zts_node_start()`
+ * may be called again immediately, e.g. after changing the identity.
+ *
  * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
  *     experiences a problem.
  */
@@ -1719,18 +2280,69 @@ ZTS_API int ZTCALL zts_node_stop();
 
 /**
  * @brief Stop all background threads, bring down all transport services, free all
- *     resources. After calling this function an application restart will be
- *     required before the library can be used again. Callable only after the node
- *     has been started.
+ *     resources. Callable only after the node has been started.
  *
  * This should be called at the end of your program or when you do not
- * anticipate communicating over ZeroTier again.
+ * anticipate communicating over ZeroTier again. The node may still be
+ * configured and started again afterwards without restarting the application;
+ * the stack is brought back online by the next `zts_node_start()`.
  *
  * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
  *     experiences a problem.
  */
 ZTS_API int ZTCALL zts_node_free();
 
+//----------------------------------------------------------------------------//
+// Caller-driven operation                                                    //
+//----------------------------------------------------------------------------//
+
+/**
+ * @brief Perform all pending node, stack and event work on the calling thread. Only available
+ *     when the node was started with `zts_init_set_caller_driven(1)`.
+ *
+ * Waits for traffic on the node's underlying UDP sockets for at most `timeout_ms` milliseconds
+ * (never past the next internal deadline), processes it, runs due stack timers and delivers
+ * queued events to the event handler. Typically called in a loop, or whenever one of the
+ * descriptors returned by `zts_get_pollable_fds()` becomes readable or the time returned by
+ * `zts_next_deadline()` has elapsed.
+ *
+ * Because no other thread advances the stack, blocking socket calls must not be made from the
+ * thread driving this function; use non-blocking sockets and the poller instead.
+ * Only one thread may drive a node at a time. `zts_node_stop()` and `zts_node_free()` may be
+ * called from any thread: they wake a waiting `zts_process()` and return once it has finished.
+ *
+ * @param timeout_ms Maximum time to wait for traffic. `0` does not wait, a negative value
+ *     waits until the next internal deadline.
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node is not running in
+ *     caller-driven mode, has just terminated, or is already being driven by another thread.
+ */
+ZTS_API int ZTCALL zts_process(int timeout_ms);
+
+/**
+ * @brief Return the number of milliseconds until `zts_process()` must next be called, assuming
+ *     no traffic arrives in the meantime.
+ *
+ * @return Milliseconds (`0` if work is already pending), or `ZTS_ERR_SERVICE` if the node is
+ *     not running in caller-driven mode.
+ */
+ZTS_API int ZTCALL zts_next_deadline();
+
+/**
+ * @brief Copy the OS file descriptors of the node's underlying UDP sockets into `fds` so they
+ *     can be added to an application's own event loop. When any is readable `zts_process()`
+ *     should be called.
+ *
+ * Only the node's own bound UDP sockets are returned. The node binds them in its first
+ * `zts_process()` call and rebinds when local interfaces change, so the set should be re-fetched
+ * after each call to `zts_process()`. Not available on Windows.
+ *
+ * @param fds Array to receive descriptors
+ * @param max Capacity of `fds`
+ * @return Number of descriptors written, `ZTS_ERR_SERVICE` if the node is not running,
+ *     `ZTS_ERR_ARG` if invalid argument, `ZTS_ERR_GENERAL` if unsupported on this platform.
+ */
+ZTS_API int ZTCALL zts_get_pollable_fds(int* fds, unsigned int max);
+
 /**
  * @brief Orbit a given moon (user-defined root server)
  *
@@ -1853,12 +2465,32 @@ typedef struct {
  */
 ZTS_API int ZTCALL zts_stats_get_all(zts_stats_counter_t* dst);
 
+/**
+ * @brief Get the receive coalescing counters of the calling thread's node since it started, see
+ * `zts_init_set_gro()`. `segments / packets` is the average number of segments merged into each
+ * packet.
+ *
+ * @param segments Number of TCP segments with data that were considered for merging
+ * @param packets Number of packets these segments entered the stack as
+ *
+ * @return ZTS_ERR_OK on success. ZTS_ERR_ARG or ZTS_ERR_SERVICE on failure.
+ */
+ZTS_API int ZTCALL zts_stats_get_gro(uint64_t* segments, uint64_t* packets);
+
 //----------------------------------------------------------------------------//
 // Socket API                                                                 //
 //----------------------------------------------------------------------------//
 
+/*
+ * Sockets are full-duplex: one thread may block in a receive call while another
+ * sends on the same descriptor, and a third may close it. Threads blocked on a
+ * descriptor that is closed return with an error.
+ */
+
 /**
- * @brief Create a socket
+ * @brief Create a socket. It belongs to the calling thread's context (see `zts_ctx_new()`), whose
+ *     node must be running. The TCP/IP stack is shared by all contexts, see the limitation
+ *     described there.
  *
  * @param family `ZTS_AF_INET` or `ZTS_AF_INET6`
  * @param type `ZTS_SOCK_STREAM` or `ZTS_SOCK_DGRAM`
@@ -2087,7 +2719,7 @@ ZTS_API int ZTCALL zts_bsd_getsockname(int fd, struct zts_sockaddr* addr, zts_so
 ZTS_API int ZTCALL zts_bsd_getpeername(int fd, struct zts_sockaddr* addr, zts_socklen_t* addrlen);
 
 /**
- * @brief Close socket.
+ * @brief Close socket. Calls blocked on the socket in other threads return with an error.
  *
  * @param fd Socket file descriptor
  * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
@@ -2204,6 +2836,96 @@ struct zts_pollfd {
  */
 ZTS_API int ZTCALL zts_bsd_poll(struct zts_pollfd* fds, zts_nfds_t nfds, int timeout);
 
+//----------------------------------------------------------------------------//
+// Poller (scalable readiness notification)                                   //
+//----------------------------------------------------------------------------//
+
+/**
+ * Maximum number of pollers that may exist at the same time
+ */
+#define ZTS_MAX_POLLERS 64
+
+/**
+ * A readiness event reported by `zts_poller_wait()`
+ */
+typedef struct {
+    /** Socket file descriptor */
+    int fd;
+    /** Ready conditions (`ZTS_POLLIN`, `ZTS_POLLOUT`, `ZTS_POLLERR`) */
+    short revents;
+} zts_poller_event_t;
+
+/**
+ * @brief Create a new poller. A poller is similar to `epoll`: sockets are registered
+ * once and `zts_poller_wait()` only ever examines sockets that lwIP has reported activity on,
+ * so the cost of waiting does not grow with the number of registered sockets. Readiness is
+ * level-triggered.
+ *
+ * @return Poller descriptor if successful, `ZTS_ERR_SERVICE` if the node is not running,
+ * `ZTS_ERR_NO_RESULT` if `ZTS_MAX_POLLERS` pollers already exist.
+ */
+ZTS_API int ZTCALL zts_poller_new();
+
+/**
+ * @brief Destroy a poller. Any thread blocked in `zts_poller_wait()` on it will return.
+ *
+ * @param pfd Poller descriptor
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_poller_free(int pfd);
+
+/**
+ * @brief Register a socket with a poller, or update the events it is registered for
+ *
+ * @param pfd Poller descriptor
+ * @param fd Socket file descriptor
+ * @param events Conditions to monitor (`ZTS_POLLIN`, `ZTS_POLLOUT`). Errors are always reported
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node is not running,
+ * `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_poller_set(int pfd, int fd, short events);
+
+/**
+ * @brief Remove a socket from a poller. Closing a socket removes it from all pollers
+ *
+ * @param pfd Poller descriptor
+ * @param fd Socket file descriptor
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_poller_remove(int pfd, int fd);
+
+/**
+ * @brief Wait for registered sockets to become ready
+ *
+ * @param pfd Poller descriptor
+ * @param events Array receiving ready sockets
+ * @param max_events Capacity of `events`
+ * @param timeout_ms How long to block. `0` returns immediately, `-1` blocks indefinitely
+ * @return Number of events written to `events` (`0` on timeout or after `zts_poller_wakeup()`),
+ * `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_poller_wait(int pfd, zts_poller_event_t* events, int max_events, int timeout_ms);
+
+/**
+ * @brief Cause a current (or the next) `zts_poller_wait()` on this poller to return immediately
+ *
+ * @param pfd Poller descriptor
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_poller_wakeup(int pfd);
+
+/**
+ * @brief Return an operating system file descriptor that becomes readable whenever this poller
+ * has pending events or has been woken up. This allows a poller to be integrated into an external
+ * event loop (e.g. `epoll`, `kqueue`, libuv, asyncio). Call `zts_poller_wait()` with a zero
+ * timeout once it becomes readable; doing so also drains it.
+ *
+ * @param pfd Poller descriptor
+ * @return OS file descriptor if successful, `ZTS_ERR_ARG` if invalid argument,
+ * `ZTS_ERR_GENERAL` if unsupported on this platform.
+ */
+ZTS_API int ZTCALL zts_poller_get_os_fd(int pfd);
+
 /**
  * @brief Control a device
  *
@@ -2786,6 +3508,36 @@ ZTS_API int ZTCALL zts_set_ttl(int fd, int ttl);
  */
 ZTS_API int ZTCALL zts_get_ttl(int fd);
 
+/**
+ * @brief Join a multicast group (`IP_ADD_MEMBERSHIP` or `IPV6_JOIN_GROUP`)
+ *
+ * The stack reports the groups it joins to ZeroTier, which then replicates
+ * traffic sent to them on the network to this node.
+ *
+ * @param fd Socket file descriptor
+ * @param group_ipstr IPv4 or IPv6 multicast group address
+ * @param iface_ipstr Address of the interface to join the group on, of the
+ *     same family as `group_ipstr`. `NULL` for any (IPv4) or every (IPv6)
+ *     interface
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument,
+ *     `ZTS_ERR_NO_RESULT` if no IPv6 interface matches. Sets `zts_errno`
+ */
+ZTS_API int ZTCALL zts_add_membership(int fd, const char* group_ipstr, const char* iface_ipstr);
+
+/**
+ * @brief Leave a multicast group (`IP_DROP_MEMBERSHIP` or `IPV6_LEAVE_GROUP`)
+ *
+ * @param fd Socket file descriptor
+ * @param group_ipstr IPv4 or IPv6 multicast group address
+ * @param iface_ipstr Address of the interface the group was joined on, `NULL`
+ *     as in `zts_add_membership()`
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument,
+ *     `ZTS_ERR_NO_RESULT` if no IPv6 interface matches. Sets `zts_errno`
+ */
+ZTS_API int ZTCALL zts_drop_membership(int fd, const char* group_ipstr, const char* iface_ipstr);
+
 /**
  * @brief Change blocking behavior `O_NONBLOCK`
  *
@@ -2825,6 +3577,16 @@ ZTS_API int ZTCALL zts_set_keepalive(int fd, int enabled);
  */
 ZTS_API int ZTCALL zts_get_keepalive(int fd);
 
+/**
+ * @brief Return and clear the pending error on a socket (`SO_ERROR`). Typically used
+ * to learn the outcome of a non-blocking `zts_bsd_connect()` once the socket becomes writable
+ *
+ * @param fd Socket file descriptor
+ * @return `0` if no error is pending, a positive `zts_errno` value otherwise, `ZTS_ERR_SERVICE`
+ *     if the node experiences a problem, `ZTS_ERR_ARG` if invalid argument. Sets `zts_errno`
+ */
+ZTS_API int ZTCALL zts_get_socket_error(int fd);
+
 //----------------------------------------------------------------------------//
 // DNS                                                                        //
 //----------------------------------------------------------------------------//
@@ -2891,6 +3653,45 @@ ZTS_API int ZTCALL zts_dns_set_server(uint8_t index, const zts_ip_addr* addr);
  */
 ZTS_API const zts_ip_addr* ZTCALL zts_dns_get_server(uint8_t index);
 
+//----------------------------------------------------------------------------//
+// State Snapshots                                                            //
+//----------------------------------------------------------------------------//
+
+/**
+ * @brief Return the node's most recent state snapshot: all networks with their addresses,
+ *     routes and multicast subscriptions, and all peers with their paths.
+ *
+ * The node publishes a new snapshot whenever a network configuration, network status, the
+ * online state or the set of peers and their path counts changes. A snapshot is never modified
+ * once published, so it can be read without locks for as long as it is held. Acquiring one does
+ * not take any service or network lock and does not copy network configurations.
+ *
+ * @return Snapshot that must be passed to `zts_snapshot_release()`, or `NULL` if the node is not
+ *     running or has not published one yet.
+ */
+ZTS_API const zts_snapshot_t* ZTCALL zts_snapshot_acquire();
+
+/**
+ * @brief Release a snapshot returned by `zts_snapshot_acquire()`
+ *
+ * @param snapshot Snapshot
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_snapshot_release(const zts_snapshot_t* snapshot);
+
+/**
+ * @brief Get the measured quality of each known path to a peer. RTT, receive age, the
+ * preferred flag and relay status are always available. Byte counters and probe results
+ * require `zts_init_set_path_monitoring()`. Values are refreshed by the node's background
+ * processing, typically several times a second.
+ *
+ * @param peer_id Node ID of the peer
+ * @param quality User-provided structure that will be populated
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_NO_RESULT` if the peer is not known,
+ *     `ZTS_ERR_SERVICE` if the node is not running, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_peer_get_quality(uint64_t peer_id, zts_peer_quality_t* quality);
+
 //----------------------------------------------------------------------------//
 // Core query sub-API (Used for simplifying high-level language wrappers)     //
 //----------------------------------------------------------------------------//
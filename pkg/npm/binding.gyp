@@ -0,0 +1,29 @@
+{
+	"targets": [
+		{
+			"target_name": "libzt",
+			"sources": [
+				"src/NodeSockets.cxx"
+			],
+			"include_dirs": [
+				"include"
+			],
+			"defines": [
+				"NAPI_DISABLE_CPP_EXCEPTIONS"
+			],
+			"libraries": [
+				"<(module_root_dir)/lib/libzt.a"
+			],
+			"conditions": [
+				["OS=='linux'", {
+					"libraries": [ "-lpthread" ]
+				}],
+				["OS=='mac'", {
+					"xcode_settings": {
+						"MACOSX_DEPLOYMENT_TARGET": "10.13"
+					}
+				}]
+			]
+		}
+	]
+}
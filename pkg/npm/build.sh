@@ -0,0 +1,35 @@
+#!/bin/bash
+
+# Stage sources and a host build of libzt.a into the package, then build the addon
+ext()
+{
+	mkdir -p lib include src
+	cp -f ../../src/bindings/nodejs/libzt.js .
+	cp -f ../../src/bindings/nodejs/NodeSockets.cxx src/
+	cp -f ../../include/ZeroTierSockets.h include/
+	cp -f ../../LICENSE.txt LICENSE
+	cp -f $1/libzt.a lib/
+	npx node-gyp rebuild
+}
+
+# Build an installable tarball
+pack()
+{
+	ext $1
+	npm pack
+}
+
+# Run the offline smoke test against the built addon
+check()
+{
+	node ../../test/nodejs/smoke.js
+}
+
+clean()
+{
+	rm -rf build lib include src
+	rm -rf libzt.js LICENSE
+	rm -rf *.tgz
+}
+
+"$@"
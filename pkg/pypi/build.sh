@@ -16,6 +16,12 @@ ext()
 	$PYBIN setup.py build_clib --verbose build_ext -i --verbose
 }
 
+# Run the offline smoke test against the extension built by ext()
+check()
+{
+	PYTHONPATH=. $PYBIN native/test/python/smoke.py -v
+}
+
 # Build a wheel
 wheel()
 {
@@ -31,6 +37,7 @@ clean()
 	rm -rf libzt/sockets.py
 	rm -rf libzt/libzt.py
 	rm -rf libzt/node.py
+	rm -rf libzt/aio.py
 	rm -rf src ext build dist native
 	rm -rf libzt.egg-info
 	rm -rf LICENSE
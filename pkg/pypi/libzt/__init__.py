@@ -1,4 +1,5 @@
 from .libzt import *
 from .sockets import *
 from .node import *
+from . import aio
 from .version import __version__
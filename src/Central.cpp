@@ -19,9 +19,13 @@
 #include "Mutex.hpp"
 #include "OSUtils.hpp"
 
+#include <cctype>
 #include <cstdint>
 #include <cstring>
 #include <curl/curl.h>
+#include <map>
+#include <string>
+#include <vector>
 
 #define REQ_LEN 64
 
@@ -35,20 +39,63 @@ int _resp_buf_offset;
 static int8_t _access_modes;
 static int8_t _bIsVerbose;
 static int8_t _bInit;
+static unsigned int _max_concurrency = ZTS_CENTRAL_DEFAULT_CONCURRENCY;
+
+// Reused across single requests so that connections to the server are kept alive
+static CURL* _curl;
+// Connection cache shared by batch requests, which also lets them be multiplexed over HTTP/2
+static CURLM* _multi;
+
+// If set, response bodies are passed to this instead of being copied into the response buffer
+static int (*_stream_handler)(const char*, unsigned int, void*);
+static void* _stream_handler_arg;
+
+/**
+ * Last response to a GET of one URL along with the validators the server sent
+ * for it, replayed when the server answers a conditional request with 304
+ */
+struct central_cached_resp {
+    std::string etag;
+    std::string last_modified;
+    std::string body;
+};
+
+static int8_t _bCacheEnabled;
+// Keyed by request URL. Guarded by _request_m
+static std::map<std::string, central_cached_resp> _resp_cache;
+static uint64_t _cache_hits;
+static uint64_t _cache_misses;
+
+/**
+ * State of the request being performed on _curl
+ */
+struct central_resp_ctx {
+    // Copy of the body to be cached, NULL if the response is not cached
+    std::string* body;
+    central_cached_resp validators;
+};
 
 using namespace ZeroTier;
 
 Mutex _responseBuffer_m;
+// Serializes use of _curl and of _multi
+Mutex _request_m;
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-size_t on_data(void* buffer, size_t size, size_t nmemb, void* userp)
+/**
+ * Hand part of a response body to the user's stream handler, or append it to the
+ * response buffer. Returns 0 if it could not be accepted
+ */
+static size_t central_deliver(const void* buffer, size_t byte_count)
 {
-    DEBUG_INFO("buf=%p,size=%zu,nmemb=%zu,userp=%p", buffer, size, nmemb, userp);
-    int byte_count = (size * nmemb);
-    if (_resp_buf_offset + byte_count >= _resp_buf_len) {
+    if (_stream_handler) {
+        int rc = _stream_handler((const char*)buffer, (unsigned int)byte_count, _stream_handler_arg);
+        return rc == 0 ? byte_count : 0;
+    }
+    if (_resp_buf_offset + (int)byte_count >= _resp_buf_len) {
         DEBUG_INFO("Out of buffer space. Cannot store response from server");
         return 0;   // Signal to libcurl that our buffer is full (triggers a
                     // write error.)
@@ -58,6 +105,62 @@ size_t on_data(void* buffer, size_t size, size_t nmemb, void* userp)
     return byte_count;
 }
 
+size_t on_data(void* buffer, size_t size, size_t nmemb, void* userp)
+{
+    DEBUG_INFO("buf=%p,size=%zu,nmemb=%zu,userp=%p", buffer, size, nmemb, userp);
+    size_t byte_count = (size * nmemb);
+    central_resp_ctx* ctx = (central_resp_ctx*)userp;
+    if (ctx && ctx->body) {
+        ctx->body->append((const char*)buffer, byte_count);
+    }
+    return central_deliver(buffer, byte_count);
+}
+
+/**
+ * Pick up the validators needed to make later requests for the same URL conditional
+ */
+static size_t on_header(char* buffer, size_t size, size_t nitems, void* userp)
+{
+    size_t byte_count = size * nitems;
+    central_resp_ctx* ctx = (central_resp_ctx*)userp;
+    std::string h(buffer, byte_count);
+    std::string* dst = NULL;
+    size_t colon = h.find(':');
+    if (colon == std::string::npos) {
+        return byte_count;
+    }
+    std::string name = h.substr(0, colon);
+    for (size_t i = 0; i < name.length(); i++) {
+        name[i] = (char)tolower((unsigned char)name[i]);
+    }
+    if (name == "etag") {
+        dst = &ctx->validators.etag;
+    }
+    else if (name == "last-modified") {
+        dst = &ctx->validators.last_modified;
+    }
+    if (dst) {
+        size_t start = h.find_first_not_of(" \t", colon + 1);
+        size_t end = h.find_last_not_of(" \t\r\n");
+        *dst = (start == std::string::npos || end < start) ? std::string() : h.substr(start, end - start + 1);
+    }
+    return byte_count;
+}
+
+/**
+ * Response of one request of a batch. Only kept up to the size of the user's
+ * response buffer, and only for debugging
+ */
+static size_t on_batch_data(void* buffer, size_t size, size_t nmemb, void* userp)
+{
+    std::string* resp = (std::string*)userp;
+    size_t byte_count = size * nmemb;
+    if (resp->length() + byte_count < (size_t)_resp_buf_len) {
+        resp->append((const char*)buffer, byte_count);
+    }
+    return byte_count;
+}
+
 int zts_central_set_access_mode(int8_t modes)
 {
     if (! (modes & ZTS_CENTRAL_READ) && ! (modes & ZTS_CENTRAL_WRITE)) {
@@ -117,20 +220,66 @@ int zts_central_init(const char* url_str, const char* token_str, char* resp_buf,
     return ZTS_ERR_OK;
 }
 
+int zts_central_set_concurrency(unsigned int max_requests)
+{
+    if (max_requests == 0) {
+        return ZTS_ERR_ARG;
+    }
+    _max_concurrency = max_requests;
+    return ZTS_ERR_OK;
+}
+
+int zts_central_set_stream_handler(int (*handler)(const char* data, unsigned int len, void* arg), void* arg)
+{
+    Mutex::Lock _l(_request_m);
+    _stream_handler = handler;
+    _stream_handler_arg = arg;
+    return ZTS_ERR_OK;
+}
+
+int zts_central_set_cache(int8_t enabled)
+{
+    if (enabled != 1 && enabled != 0) {
+        return ZTS_ERR_ARG;
+    }
+    Mutex::Lock _l(_request_m);
+    _bCacheEnabled = enabled;
+    if (! enabled) {
+        _resp_cache.clear();
+    }
+    return ZTS_ERR_OK;
+}
+
+int zts_central_get_cache_stats(uint64_t* hits, uint64_t* misses)
+{
+    if (hits == NULL || misses == NULL) {
+        return ZTS_ERR_ARG;
+    }
+    Mutex::Lock _l(_request_m);
+    *hits = _cache_hits;
+    *misses = _cache_misses;
+    return ZTS_ERR_OK;
+}
+
 void zts_central_cleanup()
 {
+    {
+        Mutex::Lock _l(_request_m);
+        _resp_cache.clear();
+        if (_curl) {
+            curl_easy_cleanup(_curl);
+            _curl = NULL;
+        }
+        if (_multi) {
+            curl_multi_cleanup(_multi);
+            _multi = NULL;
+        }
+    }
     curl_global_cleanup();
 }
 
-int central_req(
-    int request_type,
-    char* central_str,
-    char* api_route_str,
-    char* token_str,
-    int* response_code,
-    char* post_data)
+static int central_check_access(int request_type)
 {
-    int err = ZTS_ERR_OK;
     if (! _bInit) {
         DEBUG_INFO("Error: Central API must be initialized first. Call "
                    "zts_central_init()");
@@ -145,6 +294,58 @@ int central_req(
                    "permission");
         return ZTS_ERR_SERVICE;
     }
+    return ZTS_ERR_OK;
+}
+
+static struct curl_slist* central_headers(const char* token_str)
+{
+    struct curl_slist* hs = NULL;
+    char auth_str[ZTS_CENTRAL_TOKEN_LEN + 32] = { 0 };   // + Authorization: Bearer
+    if (strnlen(token_str, ZTS_CENTRAL_TOKEN_LEN) == ZTS_CENTRAL_TOKEN_LEN) {
+        OSUtils::ztsnprintf(auth_str, ZTS_CENTRAL_TOKEN_LEN + 32, "Authorization: Bearer %s", token_str);
+    }
+    hs = curl_slist_append(hs, auth_str);
+    hs = curl_slist_append(hs, "Content-Type: application/json");
+    return hs;
+}
+
+static void central_setup_handle(
+    CURL* curl,
+    int request_type,
+    const char* req_url,
+    struct curl_slist* hs,
+    const char* post_data)
+{
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, hs);
+    curl_easy_setopt(curl, CURLOPT_URL, req_url);
+    // example.com is redirected, so we tell libcurl to follow redirection
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    if (_bIsVerbose) {
+        curl_easy_setopt(curl, CURLOPT_VERBOSE, 1);
+    }
+    if (request_type == ZTS_HTTP_POST) {
+        if (post_data) {
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, post_data);
+        }
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "POST");
+    }
+    if (request_type == ZTS_HTTP_DELETE) {
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
+    }
+}
+
+int central_req(
+    int request_type,
+    char* central_str,
+    char* api_route_str,
+    char* token_str,
+    int* response_code,
+    char* post_data)
+{
+    int err = ZTS_ERR_OK;
+    if ((err = central_check_access(request_type)) != ZTS_ERR_OK) {
+        return err;
+    }
     zts_central_clear_resp_buf();
     int central_strlen = strnlen(central_str, ZTS_CENRTAL_MAX_URL_LEN);
     int api_route_strlen = strnlen(api_route_str, ZTS_CENRTAL_MAX_URL_LEN);
@@ -160,30 +361,41 @@ int central_req(
     strncpy(req_url, central_str, ZTS_CENRTAL_MAX_URL_LEN);
     strncat(req_url, api_route_str, ZTS_CENRTAL_MAX_URL_LEN);
 
-    CURL* curl;
-    CURLcode res;
-    curl = curl_easy_init();
-    if (! curl) {
-        return ZTS_ERR_GENERAL;
+    Mutex::Lock _l(_request_m);
+    // Resetting keeps the handle's open connections and DNS cache
+    if (_curl) {
+        curl_easy_reset(_curl);
     }
-
-    struct curl_slist* hs = NULL;
-    char auth_str[ZTS_CENTRAL_TOKEN_LEN + 32] = { 0 };   // + Authorization: Bearer
-    if (token_strlen == ZTS_CENTRAL_TOKEN_LEN) {
-        OSUtils::ztsnprintf(auth_str, ZTS_CENTRAL_TOKEN_LEN + 32, "Authorization: Bearer %s", token_str);
+    else if (! (_curl = curl_easy_init())) {
+        return ZTS_ERR_GENERAL;
     }
+    CURL* curl = _curl;
+    CURLcode res;
 
-    hs = curl_slist_append(hs, auth_str);
-    hs = curl_slist_append(hs, "Content-Type: application/json");
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, hs);
-    curl_easy_setopt(curl, CURLOPT_URL, req_url);
-    // example.com is redirected, so we tell libcurl to follow redirection
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    if (_bIsVerbose) {
-        curl_easy_setopt(curl, CURLOPT_VERBOSE, 1);
+    struct curl_slist* hs = central_headers(token_str);
+    // With caching enabled GET requests are made conditional on the copy we hold
+    central_resp_ctx ctx;
+    std::string body;
+    std::map<std::string, central_cached_resp>::iterator cached = _resp_cache.end();
+    ctx.body = NULL;
+    if (_bCacheEnabled && request_type == ZTS_HTTP_GET) {
+        ctx.body = &body;
+        cached = _resp_cache.find(req_url);
+        if (cached != _resp_cache.end()) {
+            if (! cached->second.etag.empty()) {
+                hs = curl_slist_append(hs, ("If-None-Match: " + cached->second.etag).c_str());
+            }
+            if (! cached->second.last_modified.empty()) {
+                hs = curl_slist_append(hs, ("If-Modified-Since: " + cached->second.last_modified).c_str());
+            }
+        }
     }
+    central_setup_handle(curl, request_type, req_url, hs, post_data);
     // Tell curl to use our write function
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, on_data);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ctx);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, on_header);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &ctx);
 
     if (request_type == ZTS_HTTP_GET) {
         // Nothing
@@ -191,13 +403,6 @@ int central_req(
     }
     if (request_type == ZTS_HTTP_POST) {
         DEBUG_INFO("Request (POST) = %s", api_route_str);
-        if (post_data) {
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, post_data);
-        }
-        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "POST");
-    }
-    if (request_type == ZTS_HTTP_DELETE) {
-        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
     }
     // curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L); // Consider 400-500
     // series code as failures
@@ -212,15 +417,161 @@ int central_req(
         DEBUG_INFO("Req. took %f second(s). HTTP code (%ld)", elapsed_time, hrc);
         *response_code = hrc;
         // curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+        if (ctx.body) {
+            if (hrc == 304 && cached != _resp_cache.end()) {
+                // Unchanged, the body is replayed from the cache
+                _cache_hits++;
+                const std::string& b = cached->second.body;
+                if (! b.empty() && central_deliver(b.data(), b.length()) != b.length()) {
+                    err = ZTS_ERR_GENERAL;
+                }
+            }
+            else {
+                _cache_misses++;
+                if (hrc == 200 && (! ctx.validators.etag.empty() || ! ctx.validators.last_modified.empty())) {
+                    central_cached_resp& c = _resp_cache[req_url];
+                    c.etag = ctx.validators.etag;
+                    c.last_modified = ctx.validators.last_modified;
+                    c.body.swap(body);
+                }
+                else if (cached != _resp_cache.end()) {
+                    _resp_cache.erase(cached);
+                }
+            }
+        }
     }
     else {
         DEBUG_INFO("%s", curl_easy_strerror(res));
         err = ZTS_ERR_SERVICE;
     }
-    curl_easy_cleanup(curl);
+    curl_slist_free_all(hs);
     return err;
 }
 
+/**
+ * One request of a batch and the easy handle it runs on. Handles are reused
+ * for later requests once theirs completes
+ */
+struct central_batch_req {
+    CURL* curl;
+    unsigned int idx;
+    char url[ZTS_CENRTAL_MAX_URL_LEN];
+    std::string resp;
+};
+
+/**
+ * Perform many POST requests against the same server with at most _max_concurrency
+ * in flight. Response codes are written to resp_codes, 0 where the request failed
+ * without a response. Returns the number of requests answered with HTTP 200
+ */
+static int central_req_batch(const std::vector<std::string>& routes, const char* post_data, int* resp_codes)
+{
+    int err = ZTS_ERR_OK;
+    if ((err = central_check_access(ZTS_HTTP_POST)) != ZTS_ERR_OK) {
+        return err;
+    }
+    Mutex::Lock _l(_request_m);
+    if (! _multi) {
+        if (! (_multi = curl_multi_init())) {
+            return ZTS_ERR_GENERAL;
+        }
+#ifdef CURLPIPE_MULTIPLEX
+        curl_multi_setopt(_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+    }
+    curl_multi_setopt(_multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)_max_concurrency);
+    struct curl_slist* hs = central_headers(api_token);
+    size_t slots = routes.size() < _max_concurrency ? routes.size() : _max_concurrency;
+    std::vector<central_batch_req> reqs(slots);
+    size_t next = 0;
+    size_t active = 0;
+    int ok = 0;
+
+    for (size_t i = 0; i < slots; i++) {
+        reqs[i].curl = NULL;
+        reqs[i].idx = (unsigned int)-1;
+    }
+    for (;;) {
+        // Start pending requests on free slots
+        for (size_t i = 0; i < slots && next < routes.size(); i++) {
+            central_batch_req& r = reqs[i];
+            if (r.curl && r.idx != (unsigned int)-1) {
+                continue;
+            }
+            if (! r.curl && ! (r.curl = curl_easy_init())) {
+                break;
+            }
+            curl_easy_reset(r.curl);
+            r.idx = (unsigned int)next;
+            r.resp.clear();
+            OSUtils::ztsnprintf(r.url, sizeof(r.url), "%s%s", api_url, routes[next].c_str());
+            central_setup_handle(r.curl, ZTS_HTTP_POST, r.url, hs, post_data);
+            curl_easy_setopt(r.curl, CURLOPT_WRITEFUNCTION, on_batch_data);
+            curl_easy_setopt(r.curl, CURLOPT_WRITEDATA, &r.resp);
+            curl_easy_setopt(r.curl, CURLOPT_PRIVATE, &r);
+#ifdef CURLPIPE_MULTIPLEX
+            // Wait for an existing connection to multiplex on rather than open another
+            curl_easy_setopt(r.curl, CURLOPT_PIPEWAIT, 1L);
+#endif
+            resp_codes[next] = 0;
+            curl_multi_add_handle(_multi, r.curl);
+            next++;
+            active++;
+        }
+        if (active == 0) {
+            break;
+        }
+        int running = 0;
+        if (curl_multi_perform(_multi, &running) != CURLM_OK) {
+            err = ZTS_ERR_SERVICE;
+            break;
+        }
+        CURLMsg* msg;
+        int queued = 0;
+        while ((msg = curl_multi_info_read(_multi, &queued))) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            central_batch_req* r = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&r);
+            if (msg->data.result == CURLE_OK) {
+                long hrc = 0;
+                curl_easy_getinfo(r->curl, CURLINFO_RESPONSE_CODE, &hrc);
+                resp_codes[r->idx] = hrc;
+                if (hrc == 200) {
+                    ok++;
+                }
+                else {
+                    DEBUG_INFO("%s: HTTP code (%ld) %s", r->url, hrc, r->resp.c_str());
+                }
+            }
+            else {
+                DEBUG_INFO("%s: %s", r->url, curl_easy_strerror(msg->data.result));
+            }
+            curl_multi_remove_handle(_multi, r->curl);
+            r->idx = (unsigned int)-1;
+            active--;
+        }
+        if (running > 0 && curl_multi_wait(_multi, NULL, 0, 1000, NULL) != CURLM_OK) {
+            err = ZTS_ERR_SERVICE;
+            break;
+        }
+    }
+    for (size_t i = 0; i < slots; i++) {
+        if (reqs[i].curl) {
+            if (reqs[i].idx != (unsigned int)-1) {
+                curl_multi_remove_handle(_multi, reqs[i].curl);
+            }
+            curl_easy_cleanup(reqs[i].curl);
+        }
+    }
+    curl_slist_free_all(hs);
+    if (err == ZTS_ERR_OK && next < routes.size()) {
+        err = ZTS_ERR_GENERAL;
+    }
+    return err == ZTS_ERR_OK ? ok : err;
+}
+
 int zts_central_get_last_resp_buf(char* dest_buffer, int dest_buf_len)
 {
     if (dest_buf_len <= _resp_buf_offset) {
@@ -302,6 +653,33 @@ int zts_central_node_auth(int* resp_code, uint64_t net_id, uint64_t node_id, uin
     return zts_central_member_update(resp_code, net_id, node_id, config_data);
 }
 
+int zts_central_node_auth_batch(
+    int* resp_codes,
+    uint64_t net_id,
+    const uint64_t* node_ids,
+    unsigned int count,
+    uint8_t is_authed)
+{
+    if (resp_codes == NULL || net_id == 0 || node_ids == NULL || count == 0) {
+        return ZTS_ERR_ARG;
+    }
+    if (is_authed != 0 && is_authed != 1) {
+        return ZTS_ERR_ARG;
+    }
+    std::vector<std::string> routes(count);
+    char req[REQ_LEN] = { 0 };
+    for (unsigned int i = 0; i < count; i++) {
+        if (node_ids[i] == 0) {
+            return ZTS_ERR_ARG;
+        }
+        OSUtils::ztsnprintf(req, REQ_LEN, "/api/network/%llx/member/%llx", net_id, node_ids[i]);
+        routes[i] = req;
+    }
+    const char* config_data = (is_authed == ZTS_CENTRAL_NODE_AUTH_TRUE) ? "{\"config\": {\"authorized\": true} }"
+                                                                         : "{\"config\": {\"authorized\": false} }";
+    return central_req_batch(routes, config_data, resp_codes);
+}
+
 int zts_central_net_get_members(int* resp_code, uint64_t net_id)
 {
     char req[REQ_LEN] = { 0 };
@@ -20,6 +20,7 @@
 #include "Events.hpp"
 #include "NodeService.hpp"
 #include "Signals.hpp"
+#include "OSUtils.hpp"
 #include "VirtualTap.hpp"
 
 #include <string.h>
@@ -37,22 +38,71 @@ WSADATA wsaData;
 
 namespace ZeroTier {
 
-#ifdef ZTS_ENABLE_PYTHON
-#endif
-#ifdef ZTS_ENABLE_PINVOKE
-extern void (*_userEventCallback)(void*);
-#endif
-#ifdef ZTS_C_API_ONLY
-extern void (*_userEventCallback)(void*);
-#endif
 extern uint8_t allowNetworkCaching;
 extern uint8_t allowPeerCaching;
 
-NodeService* zts_service;
-Events* zts_events;
+// Used by threads that have not selected a context, and by applications that never create one
+static zts_ctx _defaultCtx;
+static thread_local zts_ctx* _currentCtx = NULL;
+// Selects a context for the duration of one call made on it explicitly
+class CtxScope {
+  public:
+    CtxScope(zts_ctx* ctx) : _prev(_currentCtx)
+    {
+        _currentCtx = ctx;
+    }
+    ~CtxScope()
+    {
+        _currentCtx = _prev;
+    }
+
+  private:
+    zts_ctx* _prev;
+};
+
+// Run a control function on an explicitly given context
+#define CTX_CALL(ctx, call)                                                                                            \
+    if (! ctx) {                                                                                                       \
+        return ZTS_ERR_ARG;                                                                                            \
+    }                                                                                                                  \
+    CtxScope _cs(ctx);                                                                                                 \
+    return call;
+
+// Context whose zts_process() the calling thread is inside, e.g. in an event handler it delivered
+static thread_local zts_ctx* _processingCtx = NULL;
 
 extern Mutex events_m;
-Mutex service_m;
+
+zts_ctx* zts_current_ctx()
+{
+    return _currentCtx ? _currentCtx : &_defaultCtx;
+}
+
+// Wait for one of a context's threads to exit. Caller must not hold the context's lock
+static void _joinThread(zts_ctx* ctx, Thread& thread, bool& joinable)
+{
+    Thread t;
+    bool j;
+    {
+        Mutex::Lock _ls(ctx->service_lock);
+        t = thread;
+        j = joinable;
+        joinable = false;
+    }
+    if (j) {
+        Thread::join(t);
+    }
+}
+
+// Stop a context's callback thread once queued events are delivered, and wait for it
+static void _joinCallbackThread(zts_ctx* ctx)
+{
+    if (! ctx->events) {
+        return;
+    }
+    ctx->events->clrState(ZTS_STATE_CALLBACKS_RUNNING);
+    _joinThread(ctx, ctx->callbackThread, ctx->callbackThreadJoinable);
+}
 
 int init_subsystems()
 {
@@ -60,7 +110,7 @@ int init_subsystems()
      * A separate thread is used for callbacks so that if the user fails to
      * return control it won't affect the core service's operations. */
     if (! zts_events) {
-        zts_events = new Events();
+        zts_events = new Events(zts_current_ctx());
     }
     if (zts_events->getState(ZTS_STATE_FREE_CALLED)) {
         return ZTS_ERR_SERVICE;
@@ -74,14 +124,192 @@ int init_subsystems()
 #endif
         zts_service = new NodeService();
         zts_service->setUserEventSystem(zts_events);
+        zts_service->setSnapshotPublisher(&zts_current_ctx()->snapshots);
     }
     return ZTS_ERR_OK;
 }
 
+// Delete a service whose main loop has ended. Caller holds service_m
+static void _releaseService()
+{
+    delete zts_service;
+    zts_service = (NodeService*)0;
+    zts_current_ctx()->started = false;
+}
+
+// ZeroTier NodeService background thread
+void zts_run_service(zts_ctx* ctx)
+{
+    _currentCtx = ctx;
+#if defined(__APPLE__)
+    // pthread_setname_np(ZTS_SERVICE_THREAD_NAME);
+#endif
+    try {
+        zts_service->run();
+        // Begin shutdown. zts_node_stop() and zts_node_free() join this thread before touching
+        // the events, so no further locking is needed
+        service_m.lock();
+        zts_events->clrState(ZTS_STATE_NODE_RUNNING);
+        _releaseService();
+        service_m.unlock();
+        if (zts_events) {
+            zts_events->disable();
+        }
+    }
+    catch (...) {
+    }
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+zts_ctx_t* zts_ctx_new()
+{
+    return new zts_ctx();
+}
+
+int zts_ctx_set(zts_ctx_t* ctx)
+{
+    _currentCtx = ctx;
+    return ZTS_ERR_OK;
+}
+
+zts_ctx_t* zts_ctx_get()
+{
+    return zts_current_ctx();
+}
+
+int zts_ctx_free(zts_ctx_t* ctx)
+{
+    if (! ctx || ctx == &_defaultCtx) {
+        return ZTS_ERR_ARG;
+    }
+    {
+        Mutex::Lock _ls(ctx->service_lock);
+        // A started service is deleted by its own thread once it has wound down
+        if (ctx->started) {
+            return ZTS_ERR_SERVICE;
+        }
+    }
+    _joinThread(ctx, ctx->serviceThread, ctx->serviceThreadJoinable);
+    _joinCallbackThread(ctx);
+    {
+        Mutex::Lock _ls(ctx->service_lock);
+        delete ctx->service;
+        ctx->service = (NodeService*)0;
+        delete ctx->events;
+        ctx->events = (Events*)0;
+    }
+    zts_sockets_forget_ctx(ctx);
+    if (_currentCtx == ctx) {
+        _currentCtx = NULL;
+    }
+    delete ctx;
+    return ZTS_ERR_OK;
+}
+
+int zts_ctx_init_from_storage(zts_ctx_t* ctx, const char* path)
+{
+    CTX_CALL(ctx, zts_init_from_storage(path));
+}
+
+int zts_ctx_init_from_memory(zts_ctx_t* ctx, const char* key, unsigned int len)
+{
+    CTX_CALL(ctx, zts_init_from_memory(key, len));
+}
+
+int zts_ctx_init_set_port(zts_ctx_t* ctx, unsigned short port)
+{
+    CTX_CALL(ctx, zts_init_set_port(port));
+}
+
+int zts_ctx_init_set_caller_driven(zts_ctx_t* ctx, unsigned int enabled)
+{
+    CTX_CALL(ctx, zts_init_set_caller_driven(enabled));
+}
+
+#ifdef ZTS_C_API_ONLY
+int zts_ctx_init_set_event_handler(zts_ctx_t* ctx, void (*callback)(void*))
+{
+    CTX_CALL(ctx, zts_init_set_event_handler(callback));
+}
+#endif
+
+int zts_ctx_node_start(zts_ctx_t* ctx)
+{
+    CTX_CALL(ctx, zts_node_start());
+}
+
+int zts_ctx_node_is_online(zts_ctx_t* ctx)
+{
+    if (! ctx) {
+        return 0;
+    }
+    CtxScope _cs(ctx);
+    return zts_node_is_online();
+}
+
+uint64_t zts_ctx_node_get_id(zts_ctx_t* ctx)
+{
+    CTX_CALL(ctx, zts_node_get_id());
+}
+
+int zts_ctx_node_stop(zts_ctx_t* ctx)
+{
+    CTX_CALL(ctx, zts_node_stop());
+}
+
+int zts_ctx_node_free(zts_ctx_t* ctx)
+{
+    CTX_CALL(ctx, zts_node_free());
+}
+
+int zts_ctx_net_join(zts_ctx_t* ctx, uint64_t net_id)
+{
+    CTX_CALL(ctx, zts_net_join(net_id));
+}
+
+int zts_ctx_net_leave(zts_ctx_t* ctx, uint64_t net_id)
+{
+    CTX_CALL(ctx, zts_net_leave(net_id));
+}
+
+int zts_ctx_net_transport_is_ready(zts_ctx_t* ctx, uint64_t net_id)
+{
+    CTX_CALL(ctx, zts_net_transport_is_ready(net_id));
+}
+
+int zts_ctx_addr_get(zts_ctx_t* ctx, uint64_t net_id, unsigned int family, struct zts_sockaddr_storage* addr)
+{
+    CTX_CALL(ctx, zts_addr_get(net_id, family, addr));
+}
+
+int zts_ctx_addr_get_str(zts_ctx_t* ctx, uint64_t net_id, unsigned int family, char* dst, unsigned int len)
+{
+    CTX_CALL(ctx, zts_addr_get_str(net_id, family, dst, len));
+}
+
+int zts_ctx_process(zts_ctx_t* ctx, int timeout_ms)
+{
+    CTX_CALL(ctx, zts_process(timeout_ms));
+}
+
+int zts_ctx_next_deadline(zts_ctx_t* ctx)
+{
+    CTX_CALL(ctx, zts_next_deadline());
+}
+
+int zts_ctx_get_pollable_fds(zts_ctx_t* ctx, int* fds, unsigned int max)
+{
+    CTX_CALL(ctx, zts_get_pollable_fds(fds, max));
+}
+
+int zts_ctx_bsd_socket(zts_ctx_t* ctx, int family, int type, int protocol)
+{
+    CTX_CALL(ctx, zts_bsd_socket(family, type, protocol));
+}
+
 int zts_init_from_storage(const char* path)
 {
     ACQUIRE_SERVICE_OFFLINE();
@@ -95,6 +323,18 @@ int zts_init_from_memory(const char* keypair, unsigned int len)
     return zts_service->setIdentity(keypair, len);
 }
 
+int zts_init_from_snapshot(const void* state, unsigned int len)
+{
+    ACQUIRE_SERVICE_OFFLINE();
+    return zts_service->importState(state, len);
+}
+
+int zts_state_export(void* state, unsigned int* len)
+{
+    ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
+    return zts_service->exportState(state, len);
+}
+
 #ifdef ZTS_ENABLE_PYTHON
 int zts_init_set_event_handler(PythonDirectorCallbackClass* callback)
 #endif
@@ -115,12 +355,38 @@ int zts_init_set_event_handler(PythonDirectorCallbackClass* callback)
     if (! callback) {
         return ZTS_ERR_ARG;
     }
+#ifdef ZTS_ENABLE_PYTHON
     _userEventCallback = callback;
+#else
+    zts_events->setCallback(callback);
+#endif
 #endif
     zts_service->enableEvents();
     return ZTS_ERR_OK;
 }
 
+#ifdef ZTS_ENABLE_PYTHON
+int zts_py_init_event_queue()
+{
+    ACQUIRE_SERVICE_OFFLINE();
+    int fd = zts_events->openPythonQueue();
+    if (fd >= 0) {
+        zts_service->enableEvents();
+    }
+    return fd;
+}
+
+PyObject* zts_py_event_next()
+{
+    unsigned int event_code = 0;
+    uint64_t id = 0;
+    if (! zts_events || ! zts_events->popPythonEvent(&event_code, &id)) {
+        Py_RETURN_NONE;
+    }
+    return Py_BuildValue("(IK)", event_code, (unsigned long long)id);
+}
+#endif
+
 int zts_init_blacklist_if(const char* prefix, unsigned int len)
 {
     ACQUIRE_SERVICE_OFFLINE();
@@ -153,12 +419,42 @@ int zts_init_allow_secondary_port(unsigned int allowed)
     return zts_service->allowSecondaryPort(allowed);
 }
 
+int zts_init_allow_os_port_selection(unsigned int allowed)
+{
+    ACQUIRE_SERVICE_OFFLINE();
+    return zts_service->allowOsPortSelection(allowed);
+}
+
+int zts_init_set_path_monitoring(unsigned int enabled, unsigned int probe_interval_ms)
+{
+    ACQUIRE_SERVICE_OFFLINE();
+    return zts_service->setPathMonitoring(enabled, probe_interval_ms);
+}
+
 int zts_init_allow_port_mapping(unsigned int allowed)
 {
     ACQUIRE_SERVICE_OFFLINE();
     return zts_service->allowPortMapping(allowed);
 }
 
+int zts_init_set_caller_driven(unsigned int enabled)
+{
+    ACQUIRE_SERVICE_OFFLINE();
+    return zts_service->setCallerDriven(enabled);
+}
+
+int zts_init_set_tso(unsigned int enabled)
+{
+    ACQUIRE_SERVICE_OFFLINE();
+    return zts_service->setTso(enabled);
+}
+
+int zts_init_set_gro(unsigned int enabled)
+{
+    ACQUIRE_SERVICE_OFFLINE();
+    return zts_service->setGro(enabled);
+}
+
 int zts_init_allow_peer_cache(unsigned int allowed)
 {
     ACQUIRE_SERVICE_OFFLINE();
@@ -242,38 +538,6 @@ uint64_t zts_net_compute_adhoc_id(unsigned short start_port, unsigned short end_
     return strtoull(net_id_str, NULL, 16);
 }
 
-int zts_id_new(char* key, unsigned int* dst_len)
-{
-    if (key == NULL || *dst_len != ZT_IDENTITY_STRING_BUFFER_LENGTH) {
-        return ZTS_ERR_ARG;
-    }
-    Identity id;
-    id.generate();
-    char idtmp[1024] = { 0 };
-    std::string idser = id.toString(true, idtmp);
-    unsigned int key_pair_len = idser.length();
-    if (key_pair_len > *dst_len) {
-        return ZTS_ERR_ARG;
-    }
-    memcpy(key, idser.c_str(), key_pair_len);
-    *dst_len = key_pair_len;
-    return ZTS_ERR_OK;
-}
-
-int zts_id_pair_is_valid(const char* key, unsigned int len)
-{
-    if (key == NULL || len != ZT_IDENTITY_STRING_BUFFER_LENGTH) {
-        return false;
-    }
-    Identity id;
-    if ((strnlen(key, len) > 32) && (key[10] == ':')) {
-        if (id.fromString(key)) {
-            return id.locallyValidate();
-        }
-    }
-    return false;
-}
-
 int zts_node_get_id_pair(char* key, unsigned int* key_dst_len)
 {
     ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
@@ -284,24 +548,6 @@ int zts_node_get_id_pair(char* key, unsigned int* key_dst_len)
     return *key_dst_len > 0 ? ZTS_ERR_OK : ZTS_ERR_GENERAL;
 }
 
-#if defined(__WINDOWS__)
-DWORD WINAPI cbRun(LPVOID arg)
-#else
-void* cbRun(void* arg)
-#endif
-{
-    ZTS_UNUSED_ARG(arg);
-#if defined(__APPLE__)
-    // pthread_setname_np(ZTS_EVENT_CALLBACK_THREAD_NAME);
-#endif
-    zts_events->run();
-    //#if ZTS_ENABLE_JAVA
-    //    _java_detach_from_thread();
-    // pthread_exit(0);
-    //#endif
-    return NULL;
-}
-
 int zts_addr_is_assigned(uint64_t net_id, unsigned int family)
 {
     ACQUIRE_SERVICE(0);
@@ -351,6 +597,20 @@ int zts_addr_get_all(uint64_t net_id, struct zts_sockaddr_storage* addr, unsigne
     return zts_service->getAllAssignedAddr(net_id, addr, count);
 }
 
+const zts_snapshot_t* zts_snapshot_acquire()
+{
+    return zts_current_ctx()->snapshots.acquire();
+}
+
+int zts_snapshot_release(const zts_snapshot_t* snapshot)
+{
+    if (! snapshot) {
+        return ZTS_ERR_ARG;
+    }
+    SnapshotPublisher::release(snapshot);
+    return ZTS_ERR_OK;
+}
+
 int zts_core_lock_obtain()
 {
     ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
@@ -396,6 +656,15 @@ int zts_core_query_route(
     return zts_service->getRouteAtIdx(net_id, idx, target, via, len, flags, metric);
 }
 
+int zts_peer_get_quality(uint64_t peer_id, zts_peer_quality_t* quality)
+{
+    if (! quality) {
+        return ZTS_ERR_ARG;
+    }
+    ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
+    return zts_service->getPeerQuality(peer_id, quality);
+}
+
 int zts_core_query_path_count(uint64_t peer_id)
 {
     ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
@@ -498,78 +767,73 @@ int zts_route_is_assigned(uint64_t net_id, unsigned int family)
     return zts_service->networkHasRoute(net_id, family);
 }
 
-// Start a ZeroTier NodeService background thread
-#if defined(__WINDOWS__)
-DWORD WINAPI _runNodeService(LPVOID arg)
-#else
-void* _runNodeService(void* arg)
-#endif
+// Join a callback thread that stopped after delivering ZTS_EVENT_STACK_DOWN. A handler it is still
+// running may call functions that need service_m, so the caller must not hold it
+static void _joinStoppedCallbackThread(zts_ctx* ctx)
 {
-    ZTS_UNUSED_ARG(arg);
-#if defined(__APPLE__)
-    // pthread_setname_np(ZTS_SERVICE_THREAD_NAME);
-#endif
-    try {
-        zts_service->run();
-        // Begin shutdown
-        service_m.lock();
-        zts_events->clrState(ZTS_STATE_NODE_RUNNING);
-        delete zts_service;
-        zts_service = (NodeService*)0;
-        service_m.unlock();
-        events_m.lock();
-        zts_util_delay(ZTS_CALLBACK_PROCESSING_INTERVAL * 2);
-        if (zts_events) {
-            zts_events->disable();
-        }
-        events_m.unlock();
+    bool stopped;
+    {
+        Mutex::Lock _ls(ctx->service_lock);
+        stopped = ctx->callbackThreadJoinable && ctx->events && ! ctx->events->getState(ZTS_STATE_CALLBACKS_RUNNING)
+                  && ! ctx->events->onCallbackThread();
     }
-    catch (...) {
+    if (stopped) {
+        _joinThread(ctx, ctx->callbackThread, ctx->callbackThreadJoinable);
     }
-#ifndef __WINDOWS__
-    pthread_exit(0);
-#endif
-    return NULL;
 }
 
 int zts_node_start()
 {
+    _joinStoppedCallbackThread(zts_current_ctx());
     ACQUIRE_SERVICE_OFFLINE();
+    if (zts_current_ctx()->started) {
+        // The previous service is still winding down
+        return ZTS_ERR_SERVICE;
+    }
+    if (zts_events->hasCallback()) {
+        // Events were disabled when a previous node stopped
+        zts_events->enable();
+    }
+    if (zts_service->isCallerDriven()) {
+        // No threads, all work is done in zts_process()
+        zts_lwip_driver_init_caller_driven();
+        if (zts_events->hasCallback()) {
+            zts_events->setState(ZTS_STATE_CALLBACKS_RUNNING);
+        }
+        if (zts_service->startCallerDriven() != ZTS_ERR_OK) {
+            return ZTS_ERR_SERVICE;
+        }
+        zts_current_ctx()->started = true;
+        zts_events->setState(ZTS_STATE_NODE_RUNNING);
+        return ZTS_ERR_OK;
+    }
     // Start TCP/IP stack
     zts_lwip_driver_init();
-    // Start callback thread
-    int res = ZTS_ERR_OK;
+    zts_ctx* ctx = zts_current_ctx();
+    // Start callback thread, unless one survives from before a zts_node_stop() or this is called
+    // from a handler on one that delivered ZTS_EVENT_STACK_DOWN. Either keeps delivering events
     if (zts_events->hasCallback()) {
-#if defined(__WINDOWS__)
-        HANDLE callbackThread = CreateThread(NULL, 0, cbRun, NULL, 0, NULL);
-        // TODO: Check success
-#else
-        pthread_t cbThread;
-        if ((res = pthread_create(&cbThread, NULL, cbRun, NULL)) != 0) {}
-#endif
-#if defined(__linux__)
-        // pthread_setname_np(cbThread, ZTS_EVENT_CALLBACK_THREAD_NAME);
-#endif
-        if (res != ZTS_ERR_OK) {
-            zts_events->clrState(ZTS_STATE_CALLBACKS_RUNNING);
-            zts_events->clrCallback();
-        }
         zts_events->setState(ZTS_STATE_CALLBACKS_RUNNING);
+        if (! ctx->callbackThreadJoinable) {
+            try {
+                ctx->callbackThread = Thread::start(zts_events);
+                ctx->callbackThreadJoinable = true;
+            }
+            catch (...) {
+                zts_events->clrState(ZTS_STATE_CALLBACKS_RUNNING);
+                zts_events->clrCallback();
+            }
+        }
     }
     // Start ZeroTier service
-#if defined(__WINDOWS__)
-    HANDLE serviceThread = CreateThread(NULL, 0, _runNodeService, (void*)NULL, 0, NULL);
-    // TODO: Check success
-#else
-    pthread_t service_thread;
-    if ((res = pthread_create(&service_thread, NULL, _runNodeService, (void*)NULL)) != 0) {}
-#endif
-#if defined(__linux__)
-    // pthread_setname_np(service_thread, ZTS_SERVICE_THREAD_NAME);
-#endif
-    if (res != ZTS_ERR_OK) {
-        zts_events->clrState(ZTS_STATE_NODE_RUNNING);
+    try {
+        ctx->serviceThread = Thread::start(ctx);
     }
+    catch (...) {
+        return ZTS_ERR_SERVICE;
+    }
+    ctx->started = true;
+    ctx->serviceThreadJoinable = true;
     zts_events->setState(ZTS_STATE_NODE_RUNNING);
     return ZTS_ERR_OK;
 }
@@ -592,11 +856,42 @@ int zts_node_get_port()
     return zts_service->getPrimaryPort();
 }
 
+// In caller-driven mode nothing else will run the service's final iteration. Caller holds service_m
+static void _finishCallerDrivenService()
+{
+    if (! zts_service->isCallerDriven()) {
+        return;
+    }
+    zts_ctx* ctx = zts_current_ctx();
+    if (_processingCtx == ctx) {
+        // Called from an event handler, which zts_process() runs while holding events_m. That call
+        // finishes and releases the service once the handler returns
+        return;
+    }
+    // terminate() woke any zts_process() waiting on the service. That call sees the service has
+    // stopped, finishes and releases it
+    while (ctx->processing) {
+        ctx->processDone.wait(service_m);
+    }
+    if (! zts_service) {
+        return;
+    }
+    zts_service->process(0);
+    _releaseService();
+    zts_events->process();
+}
+
 int zts_node_stop()
 {
-    ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
-    zts_events->clrState(ZTS_STATE_NODE_RUNNING);
-    zts_service->terminate();
+    {
+        ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
+        zts_events->clrState(ZTS_STATE_NODE_RUNNING);
+        zts_service->terminate();
+        _finishCallerDrivenService();
+    }
+    // Once joined the service is gone and zts_node_start() can be called again
+    zts_ctx* ctx = zts_current_ctx();
+    _joinThread(ctx, ctx->serviceThread, ctx->serviceThreadJoinable);
 #if defined(__WINDOWS__)
     WSACleanup();
 #endif
@@ -605,19 +900,130 @@ int zts_node_stop()
 
 int zts_node_free()
 {
-    ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
-    zts_events->setState(ZTS_STATE_FREE_CALLED);
-    zts_events->clrState(ZTS_STATE_NODE_RUNNING);
-    zts_service->terminate();
+    bool lastNode;
+    {
+        ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
+        zts_events->setState(ZTS_STATE_FREE_CALLED);
+        zts_events->clrState(ZTS_STATE_NODE_RUNNING);
+        // The stack is shared, so it only goes down with the last node. Its event is queued while
+        // events are still enabled, terminate() disables them
+        lastNode = Events::runningNodes() == 0;
+        if (lastNode) {
+            zts_events->enqueue(ZTS_EVENT_STACK_DOWN, NULL);
+        }
+        zts_service->terminate();
+        _finishCallerDrivenService();
+    }
+    zts_ctx* ctx = zts_current_ctx();
+    _joinThread(ctx, ctx->serviceThread, ctx->serviceThreadJoinable);
 #if defined(__WINDOWS__)
     WSACleanup();
 #endif
-    zts_lwip_driver_shutdown();
+    if (lastNode && Events::runningNodes() == 0) {
+        zts_lwip_driver_shutdown();
+    }
+    if (zts_events->onCallbackThread() || _processingCtx == ctx) {
+        // Called from an event handler. The thread exits once the handler returns, and its events
+        // object is reused by the next node started on this context. A handler run by zts_process()
+        // returns into that call, which still uses the events object
+        zts_events->clrState(ZTS_STATE_CALLBACKS_RUNNING | ZTS_STATE_FREE_CALLED);
+        return ZTS_ERR_OK;
+    }
+    _joinCallbackThread(ctx);
+    Mutex::Lock _ls(service_m);
     delete zts_events;
     zts_events = (Events*)0;
     return ZTS_ERR_OK;
 }
 
+// Milliseconds until the caller-driven service next needs zts_process(). Caller holds service_m
+static unsigned long _callerDrivenTimeout()
+{
+    if (! zts_service->isRunning() || zts_events->pending()) {
+        return 0;
+    }
+    int64_t delay = zts_service->nextDeadline() - OSUtils::now();
+    unsigned long timeout = (delay > 0) ? (unsigned long)delay : 0;
+    unsigned long stack_timeout = zts_lwip_driver_next_timeout();
+    if (stack_timeout < timeout) {
+        timeout = stack_timeout;
+    }
+    return timeout;
+}
+
+int zts_process(int timeout_ms)
+{
+    zts_ctx* ctx = zts_current_ctx();
+    NodeService* service;
+    Events* events;
+    unsigned long timeout;
+    {
+        Mutex::Lock _ls(service_m);
+        if (! zts_service || ! zts_service->isCallerDriven()) {
+            return ZTS_ERR_SERVICE;
+        }
+        if (ctx->processing) {
+            // Only one thread drives a node
+            return ZTS_ERR_SERVICE;
+        }
+        service = zts_service;
+        events = zts_events;
+        zts_lwip_driver_process();
+        timeout = _callerDrivenTimeout();
+        ctx->processing = true;
+    }
+    if (timeout_ms >= 0 && (unsigned long)timeout_ms < timeout) {
+        timeout = (unsigned long)timeout_ms;
+    }
+    // service_m is not held while waiting so other threads can still use control functions.
+    // zts_node_stop() and zts_node_free() wake the wait and leave the service to this call
+    zts_ctx* outerCtx = _processingCtx;
+    _processingCtx = ctx;
+    bool running = service->process(timeout);
+    zts_lwip_driver_process();
+    if (running) {
+        events->process();
+        if (! service->isRunning()) {
+            // A handler stopped or freed the node and left its final iteration to this call
+            running = service->process(0);
+        }
+    }
+    if (! running) {
+        // The node terminated itself or was stopped
+        {
+            Mutex::Lock _ls(service_m);
+            events->clrState(ZTS_STATE_NODE_RUNNING);
+            _releaseService();
+        }
+        events->process();
+        events->disable();
+    }
+    _processingCtx = outerCtx;
+    Mutex::Lock _ls(service_m);
+    ctx->processing = false;
+    ctx->processDone.notify_all();
+    return running ? ZTS_ERR_OK : ZTS_ERR_SERVICE;
+}
+
+int zts_next_deadline()
+{
+    Mutex::Lock _ls(service_m);
+    if (! zts_service || ! zts_service->isCallerDriven()) {
+        return ZTS_ERR_SERVICE;
+    }
+    unsigned long timeout = _callerDrivenTimeout();
+    return (timeout > 0x7fffffffUL) ? 0x7fffffff : (int)timeout;
+}
+
+int zts_get_pollable_fds(int* fds, unsigned int max)
+{
+    ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
+    if (! fds) {
+        return ZTS_ERR_ARG;
+    }
+    return zts_service->getPollableFds(fds, max);
+}
+
 int zts_moon_orbit(uint64_t moon_roots_id, uint64_t moon_seed)
 {
     ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
@@ -715,6 +1121,15 @@ int zts_stats_get_all(zts_stats_counter_t* dst)
 #undef lws
 }
 
+int zts_stats_get_gro(uint64_t* segments, uint64_t* packets)
+{
+    if (! segments || ! packets) {
+        return ZTS_ERR_ARG;
+    }
+    ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
+    return zts_service->getGroStats(segments, packets);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,12 +23,23 @@
 #include "NodeService.hpp"
 #include "concurrentqueue.h"
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #ifdef ZTS_ENABLE_JAVA
 #include <jni.h>
 #endif
 
 #ifdef ZTS_ENABLE_PYTHON
 #include "Python.h"
+
+#include <deque>
+#include <utility>
+#if ! defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 PythonDirectorCallbackClass* _userEventCallback = NULL;
 void PythonDirectorCallbackClass::on_zerotier_event(zts_event_msg_t* msg)
 {
@@ -53,46 +64,145 @@ jobject javaCbObjRef = NULL;
 jmethodID javaCbMethodId = NULL;
 #endif
 
-extern NodeService* zts_service;
-
 // Global state variable shared between Socket, Control, Event and
 // NodeService logic.
 volatile uint8_t service_state = 0;
 int last_state_check;
 
-#define RESET_FLAGS() service_state = 0;
-#define SET_FLAGS(f)  service_state |= f;
-#define CLR_FLAGS(f)  service_state &= ~f;
-#define GET_FLAGS(f)  ((service_state & f) > 0)
+// Flags that describe the shared stack rather than one node
+#define ZTS_STATE_PROCESS_WIDE (ZTS_STATE_STACK_RUNNING | ZTS_STATE_NET_SERVICE_RUNNING)
+
+// Guards state flags and the number of running nodes
+static Mutex _state_m;
+static int _runningNodes = 0;
 
 // Lock to guard access to callback function pointers.
 Mutex events_m;
 
-#ifdef ZTS_ENABLE_PINVOKE
-void (*_userEventCallback)(void*);
+class EventQueue : public moodycamel::ConcurrentQueue<zts_event_msg_t*> {
+  public:
+    // Wakes the callback thread when an event is queued or callbacks are stopped
+    std::mutex wake_m;
+    std::condition_variable wake;
+    std::thread::id runner;
+
+    void notify()
+    {
+        // Taking the lock orders this with the waiter's check of its condition
+        {
+            std::lock_guard<std::mutex> _l(wake_m);
+        }
+        wake.notify_all();
+    }
+};
+
+#ifdef ZTS_ENABLE_PYTHON
+// Events waiting to be collected by Python code (e.g. an asyncio loop) that
+// does not want the callback thread to acquire the GIL. Readiness is signalled
+// through a pipe so that the queue can be watched by an OS event loop.
+#define ZTS_PY_EVENT_QUEUE_MAX 1024
+Mutex _pyEventQueue_m;
+std::deque<std::pair<unsigned int, uint64_t> > _pyEventQueue;
+int _pyEventPipe[2] = { -1, -1 };
+
+static void pushPythonEvent(zts_event_msg_t* msg)
+{
+    Mutex::Lock _l(_pyEventQueue_m);
+    if (_pyEventPipe[0] < 0 || _pyEventQueue.size() >= ZTS_PY_EVENT_QUEUE_MAX) {
+        return;
+    }
+    uint64_t id = 0;
+    if (ZTS_NODE_EVENT(msg->event_code)) {
+        id = msg->node ? msg->node->node_id : 0;
+    }
+    if (ZTS_NETWORK_EVENT(msg->event_code)) {
+        id = msg->network ? msg->network->net_id : 0;
+    }
+    if (ZTS_PEER_EVENT(msg->event_code)) {
+        id = msg->peer ? msg->peer->peer_id : 0;
+    }
+    if (msg->event_code == ZTS_EVENT_PEER_PATH_QUALITY) {
+        id = msg->peer_quality ? msg->peer_quality->peer_id : 0;
+    }
+    _pyEventQueue.push_back(std::make_pair(msg->event_code, id));
+#if ! defined(_WIN32)
+    if (_pyEventQueue.size() == 1) {
+        char c = 0;
+        if (::write(_pyEventPipe[1], &c, 1) < 0) {}
+    }
 #endif
-#ifdef ZTS_C_API_ONLY
-void (*_userEventCallback)(void*);
+}
+#endif   // ZTS_ENABLE_PYTHON
+
+Events::Events(zts_ctx* ctx)
+    : _ctx(ctx)
+    , _enabled(false)
+    , _state(0)
+    , _queue(new EventQueue())
+#if defined(ZTS_ENABLE_PINVOKE) || defined(ZTS_C_API_ONLY)
+    , _userCallback(NULL)
 #endif
+{
+}
 
-moodycamel::ConcurrentQueue<zts_event_msg_t*> _callbackMsgQueue;
+Events::~Events()
+{
+    updateState(0, ZTS_STATE_NODE_RUNNING);
+    zts_event_msg_t* msg;
+    while (_queue->try_dequeue(msg)) {
+        destroy(msg);
+    }
+    delete _queue;
+}
 
 void Events::run()
 {
-    while (getState(ZTS_STATE_CALLBACKS_RUNNING) || _callbackMsgQueue.size_approx() > 0) {
-        zts_event_msg_t* msg;
-        size_t sz = _callbackMsgQueue.size_approx();
-        for (size_t j = 0; j < sz; j++) {
-            if (_callbackMsgQueue.try_dequeue(msg)) {
-                events_m.lock();
-                sendToUser(msg);
-                events_m.unlock();
-            }
+    {
+        std::lock_guard<std::mutex> _l(_queue->wake_m);
+        _queue->runner = std::this_thread::get_id();
+    }
+    while (getState(ZTS_STATE_CALLBACKS_RUNNING) || pending()) {
+        process();
+        std::unique_lock<std::mutex> _l(_queue->wake_m);
+        _queue->wake.wait(_l, [this] { return pending() || ! getState(ZTS_STATE_CALLBACKS_RUNNING); });
+    }
+    std::lock_guard<std::mutex> _l(_queue->wake_m);
+    _queue->runner = std::thread::id();
+}
+
+void Events::threadMain() throw()
+{
+    zts_ctx_set(_ctx);
+#if defined(__APPLE__)
+    // pthread_setname_np(ZTS_EVENT_CALLBACK_THREAD_NAME);
+#endif
+    run();
+}
+
+bool Events::onCallbackThread()
+{
+    std::lock_guard<std::mutex> _l(_queue->wake_m);
+    return _queue->runner == std::this_thread::get_id();
+}
+
+void Events::process()
+{
+    zts_event_msg_t* msg;
+    size_t sz = _queue->size_approx();
+    for (size_t j = 0; j < sz; j++) {
+        if (_queue->try_dequeue(msg)) {
+            events_m.lock();
+            sendToUser(msg);
+            events_m.unlock();
         }
-        zts_util_delay(ZTS_CALLBACK_PROCESSING_INTERVAL);
     }
 }
 
+bool Events::pending()
+{
+    return _queue->size_approx() > 0;
+}
+
 void Events::enqueue(unsigned int event_code, const void* arg, int len)
 {
     if (! _enabled) {
@@ -124,6 +234,10 @@ void Events::enqueue(unsigned int event_code, const void* arg, int len)
         msg->peer = (zts_peer_info_t*)arg;
         msg->len = sizeof(zts_peer_info_t);
     }
+    if (event_code == ZTS_EVENT_PEER_PATH_QUALITY) {
+        msg->peer_quality = (zts_peer_quality_t*)arg;
+        msg->len = sizeof(zts_peer_quality_t);
+    }
     if (ZTS_ADDR_EVENT(event_code)) {
         msg->addr = (zts_addr_info_t*)arg;
         msg->len = sizeof(zts_addr_info_t);
@@ -132,14 +246,15 @@ void Events::enqueue(unsigned int event_code, const void* arg, int len)
         msg->cache = (void*)arg;
         msg->len = len;
     }
-    if (msg && _callbackMsgQueue.size_approx() > 1024) {
+    if (msg && _queue->size_approx() > 1024) {
         /* Rate-limit number of events. This value should only grow if the
         user application isn't returning from the event handler in a timely manner.
         For most applications it should hover around 1 to 2 */
         destroy(msg);
     }
     else {
-        _callbackMsgQueue.enqueue(msg);
+        _queue->enqueue(msg);
+        _queue->notify();
     }
 }
 
@@ -166,6 +281,9 @@ void Events::destroy(zts_event_msg_t* msg)
     if (msg->addr) {
         delete msg->addr;
     }
+    if (msg->peer_quality) {
+        delete msg->peer_quality;
+    }
     delete msg;
     msg = NULL;
 }
@@ -174,9 +292,12 @@ void Events::sendToUser(zts_event_msg_t* msg)
 {
     bool bShouldStopCallbackThread = (msg->event_code == ZTS_EVENT_STACK_DOWN);
 #ifdef ZTS_ENABLE_PYTHON
-    PyGILState_STATE state = PyGILState_Ensure();
-    _userEventCallback->on_zerotier_event(msg);
-    PyGILState_Release(state);
+    if (_userEventCallback) {
+        PyGILState_STATE state = PyGILState_Ensure();
+        _userEventCallback->on_zerotier_event(msg);
+        PyGILState_Release(state);
+    }
+    pushPythonEvent(msg);
 #endif
 #ifdef ZTS_ENABLE_JAVA
     if (javaCbMethodId) {
@@ -197,17 +318,15 @@ void Events::sendToUser(zts_event_msg_t* msg)
         if (ZTS_PEER_EVENT(msg->event_code)) {
             id = msg->peer ? msg->peer->peer_id : 0;
         }
+        if (msg->event_code == ZTS_EVENT_PEER_PATH_QUALITY) {
+            id = msg->peer_quality ? msg->peer_quality->peer_id : 0;
+        }
         env->CallVoidMethod(javaCbObjRef, javaCbMethodId, id, msg->event_code);
     }
 #endif   // ZTS_ENABLE_JAVA
-#ifdef ZTS_ENABLE_PINVOKE
-    if (_userEventCallback) {
-        _userEventCallback(msg);
-    }
-#endif
-#ifdef ZTS_C_API_ONLY
-    if (_userEventCallback) {
-        _userEventCallback(msg);
+#if defined(ZTS_ENABLE_PINVOKE) || defined(ZTS_C_API_ONLY)
+    if (_userCallback) {
+        _userCallback(msg);
     }
 #endif
     destroy(msg);
@@ -225,14 +344,67 @@ void Events::setJavaCallback(jobject objRef, jmethodID methodId)
     javaCbMethodId = methodId;
 }
 #endif
+
+#if defined(ZTS_ENABLE_PINVOKE) || defined(ZTS_C_API_ONLY)
+void Events::setCallback(void (*callback)(void*))
+{
+    events_m.lock();
+    _userCallback = callback;
+    events_m.unlock();
+}
+#endif
+
+#ifdef ZTS_ENABLE_PYTHON
+int Events::openPythonQueue()
+{
+#if defined(_WIN32)
+    return ZTS_ERR_GENERAL;
+#else
+    Mutex::Lock _l(_pyEventQueue_m);
+    if (_pyEventPipe[0] >= 0) {
+        return _pyEventPipe[0];
+    }
+    if (::pipe(_pyEventPipe) != 0) {
+        _pyEventPipe[0] = _pyEventPipe[1] = -1;
+        return ZTS_ERR_GENERAL;
+    }
+    ::fcntl(_pyEventPipe[0], F_SETFL, ::fcntl(_pyEventPipe[0], F_GETFL) | O_NONBLOCK);
+    ::fcntl(_pyEventPipe[1], F_SETFL, ::fcntl(_pyEventPipe[1], F_GETFL) | O_NONBLOCK);
+    return _pyEventPipe[0];
+#endif
+}
+
+bool Events::popPythonEvent(unsigned int* event_code, uint64_t* id)
+{
+    Mutex::Lock _l(_pyEventQueue_m);
+    if (_pyEventQueue.empty()) {
+        return false;
+    }
+    *event_code = _pyEventQueue.front().first;
+    *id = _pyEventQueue.front().second;
+    _pyEventQueue.pop_front();
+#if ! defined(_WIN32)
+    if (_pyEventQueue.empty()) {
+        // Drain so the descriptor stops reporting readable until the next push
+        char drain[64];
+        while (::read(_pyEventPipe[0], drain, sizeof(drain)) > 0) {
+        }
+    }
+#endif
+    return true;
+}
+#endif   // ZTS_ENABLE_PYTHON
+
 bool Events::hasCallback()
 {
     events_m.lock();
     bool retval = false;
 #ifdef ZTS_ENABLE_JAVA
     retval = (jvm && javaCbObjRef && javaCbMethodId);
+#elif defined(ZTS_ENABLE_PYTHON)
+    retval = _userEventCallback || _pyEventPipe[0] >= 0;
 #else
-    retval = _userEventCallback;
+    retval = _userCallback;
 #endif
     events_m.unlock();
     return retval;
@@ -244,8 +416,10 @@ void Events::clrCallback()
 #ifdef ZTS_ENABLE_JAVA
     javaCbObjRef = NULL;
     javaCbMethodId = NULL;
-#else
+#elif defined(ZTS_ENABLE_PYTHON)
     _userEventCallback = NULL;
+#else
+    _userCallback = NULL;
 #endif
     events_m.unlock();
 }
@@ -255,19 +429,50 @@ int Events::canPerformServiceOperation()
     return zts_service && zts_service->isRunning() && ! getState(ZTS_STATE_FREE_CALLED);
 }
 
-void Events::setState(uint8_t newFlags)
+static bool isRunningNode(uint8_t state)
 {
-    if ((newFlags ^ service_state) & ZTS_STATE_NET_SERVICE_RUNNING) {
-        return;   // No effect. Not allowed to set this flag manually
-    }
-    SET_FLAGS(newFlags);
-    if (GET_FLAGS(ZTS_STATE_NODE_RUNNING) && GET_FLAGS(ZTS_STATE_STACK_RUNNING)
-        && ! (GET_FLAGS(ZTS_STATE_FREE_CALLED))) {
-        SET_FLAGS(ZTS_STATE_NET_SERVICE_RUNNING);
+    return (state & ZTS_STATE_NODE_RUNNING) && ! (state & ZTS_STATE_FREE_CALLED);
+}
+
+// Transport is available while the stack and at least one node are running. Caller holds _state_m
+static void updateTransportState()
+{
+    if ((service_state & ZTS_STATE_STACK_RUNNING) && _runningNodes > 0) {
+        service_state |= ZTS_STATE_NET_SERVICE_RUNNING;
     }
     else {
-        CLR_FLAGS(ZTS_STATE_NET_SERVICE_RUNNING);
+        service_state &= ~ZTS_STATE_NET_SERVICE_RUNNING;
+    }
+}
+
+void Events::updateState(uint8_t setFlags, uint8_t clrFlags)
+{
+    Mutex::Lock _l(_state_m);
+    bool wasRunning = isRunningNode(_state);
+    _state = (_state | (setFlags & ~ZTS_STATE_PROCESS_WIDE)) & ~(clrFlags & ~ZTS_STATE_PROCESS_WIDE);
+    if (setFlags & ZTS_STATE_STACK_RUNNING) {
+        service_state |= ZTS_STATE_STACK_RUNNING;
+    }
+    if (clrFlags & ZTS_STATE_STACK_RUNNING) {
+        service_state &= ~ZTS_STATE_STACK_RUNNING;
+    }
+    bool running = isRunningNode(_state);
+    if (running != wasRunning) {
+        _runningNodes += running ? 1 : -1;
+    }
+    _ctx->nodeRunning = running;
+    updateTransportState();
+    if (clrFlags & ZTS_STATE_CALLBACKS_RUNNING) {
+        _queue->notify();
+    }
+}
+
+void Events::setState(uint8_t newFlags)
+{
+    if (newFlags & ZTS_STATE_NET_SERVICE_RUNNING) {
+        return;   // No effect. Not allowed to set this flag manually
     }
+    updateState(newFlags, 0);
 }
 
 void Events::clrState(uint8_t newFlags)
@@ -275,19 +480,35 @@ void Events::clrState(uint8_t newFlags)
     if (newFlags & ZTS_STATE_NET_SERVICE_RUNNING) {
         return;   // No effect. Not allowed to set this flag manually
     }
-    CLR_FLAGS(newFlags);
-    if (GET_FLAGS(ZTS_STATE_NODE_RUNNING) && GET_FLAGS(ZTS_STATE_STACK_RUNNING)
-        && ! (GET_FLAGS(ZTS_STATE_FREE_CALLED))) {
-        SET_FLAGS(ZTS_STATE_NET_SERVICE_RUNNING);
+    updateState(0, newFlags);
+}
+
+bool Events::getState(uint8_t testFlags)
+{
+    return testFlags & ((service_state & ZTS_STATE_PROCESS_WIDE) | _state);
+}
+
+void Events::setStackRunning(bool running)
+{
+    Mutex::Lock _l(_state_m);
+    if (running) {
+        service_state |= ZTS_STATE_STACK_RUNNING;
     }
     else {
-        CLR_FLAGS(ZTS_STATE_NET_SERVICE_RUNNING);
+        service_state &= ~ZTS_STATE_STACK_RUNNING;
     }
+    updateTransportState();
 }
 
-bool Events::getState(uint8_t testFlags)
+bool Events::stackIsRunning()
+{
+    return service_state & ZTS_STATE_STACK_RUNNING;
+}
+
+int Events::runningNodes()
 {
-    return testFlags & service_state;
+    Mutex::Lock _l(_state_m);
+    return _runningNodes;
 }
 
 void Events::enable()
@@ -20,8 +20,13 @@
 #ifndef ZTS_USER_EVENTS_HPP
 #define ZTS_USER_EVENTS_HPP
 
+#include "Mutex.hpp"
+#include "Snapshot.hpp"
+#include "Thread.hpp"
 #include "ZeroTierSockets.h"
 
+#include <condition_variable>
+
 #ifdef __WINDOWS__
 #include <BaseTsd.h>
 #endif
@@ -60,8 +65,75 @@
         return ZTS_ERR_SERVICE;                                                                                        \
     }
 
+namespace ZeroTier {
+class NodeService;
+class Events;
+
+/**
+ * Run a context's service until it terminates, then release it
+ */
+void zts_run_service(zts_ctx* ctx);
+}   // namespace ZeroTier
+
+/**
+ * One node instance: its service, event queue and the lock guarding them. The TCP/IP stack is
+ * shared by all contexts in the process.
+ */
+struct zts_ctx {
+    ZeroTier::NodeService* service;
+    ZeroTier::Events* events;
+    ZeroTier::Mutex service_lock;
+    // zts_node_start() has been called and the service has not yet been deleted
+    bool started;
+    // The node is running, so sockets created on this context may be used. Kept by its Events
+    volatile bool nodeRunning;
+    // A thread is inside zts_process() without holding service_lock. The service is not deleted
+    // until it is done, which is signalled on processDone
+    bool processing;
+    std::condition_variable_any processDone;
+    // Threads are joined by zts_node_stop(), zts_node_free() and zts_ctx_free()
+    ZeroTier::Thread serviceThread;
+    bool serviceThreadJoinable;
+    ZeroTier::Thread callbackThread;
+    bool callbackThreadJoinable;
+    // Outlives each service so snapshots can be acquired without taking service_lock
+    ZeroTier::SnapshotPublisher snapshots;
+
+    zts_ctx()
+        : service(NULL)
+        , events(NULL)
+        , started(false)
+        , nodeRunning(false)
+        , processing(false)
+        , serviceThreadJoinable(false)
+        , callbackThreadJoinable(false)
+    {
+    }
+
+    void threadMain() throw()
+    {
+        ZeroTier::zts_run_service(this);
+    }
+};
+
 namespace ZeroTier {
 
+/**
+ * Return the context selected by the calling thread, or the default context
+ */
+zts_ctx* zts_current_ctx();
+
+/**
+ * Detach the sockets created on a context that is about to be freed, so that later calls on
+ * them fail instead of reading the freed context
+ */
+void zts_sockets_forget_ctx(zts_ctx* ctx);
+
+// Control functions act on the calling thread's context
+#define zts_service (ZeroTier::zts_current_ctx()->service)
+#define zts_events  (ZeroTier::zts_current_ctx()->events)
+#define service_m   (ZeroTier::zts_current_ctx()->service_lock)
+
 #ifdef ZTS_ENABLE_JAVA
 #include <jni.h>
 // References to JNI objects and VM kept for future callbacks
@@ -76,6 +148,8 @@ extern jmethodID _userCallbackMethodRef;
 #define ZTS_STATE_CALLBACKS_RUNNING   0x08
 #define ZTS_STATE_FREE_CALLED         0x10
 
+// Process-wide flags: ZTS_STATE_STACK_RUNNING and ZTS_STATE_NET_SERVICE_RUNNING. The remaining
+// flags belong to each Events instance
 extern volatile uint8_t service_state;
 extern int last_state_check;
 
@@ -85,24 +159,49 @@ inline int transport_ok()
     return last_state_check;
 }
 
-/**
- * How often callback messages are assembled and/or sent
- */
-#define ZTS_CALLBACK_PROCESSING_INTERVAL 25
+class EventQueue;
 
 class Events {
+    zts_ctx* _ctx;
     bool _enabled;
+    volatile uint8_t _state;
+    EventQueue* _queue;
+#if defined(ZTS_ENABLE_PINVOKE) || defined(ZTS_C_API_ONLY)
+    void (*_userCallback)(void*);
+#endif
+
+    void updateState(uint8_t setFlags, uint8_t clrFlags);
 
   public:
-    Events() : _enabled(false)
-    {
-    }
+    Events(zts_ctx* ctx);
+
+    ~Events();
 
     /**
-     * Perform one iteration of callback processing
+     * Deliver events to the user until callbacks are stopped
      */
     void run();
 
+    /**
+     * Callback thread entry point. Selects this instance's context and calls run()
+     */
+    void threadMain() throw();
+
+    /**
+     * Return whether the caller is the thread delivering events, e.g. from within a handler
+     */
+    bool onCallbackThread();
+
+    /**
+     * Perform one iteration of callback processing
+     */
+    void process();
+
+    /**
+     * Return whether events are waiting to be delivered
+     */
+    bool pending();
+
     /**
      * Enable callback event processing
      */
@@ -132,6 +231,26 @@ class Events {
     void setJavaCallback(jobject objRef, jmethodID methodId);
 #endif
 
+#ifdef ZTS_ENABLE_PYTHON
+    /**
+     * Open the queue from which Python code collects events without a director
+     * callback. Returns an OS descriptor that is readable while events are pending
+     */
+    int openPythonQueue();
+
+    /**
+     * Take the oldest event from the Python queue, return false if it is empty
+     */
+    bool popPythonEvent(unsigned int* event_code, uint64_t* id);
+#endif
+
+#if defined(ZTS_ENABLE_PINVOKE) || defined(ZTS_C_API_ONLY)
+    /**
+     * Set the function to which this instance delivers events
+     */
+    void setCallback(void (*callback)(void*));
+#endif
+
     /**
      * Return whether a callback method has been set
      */
@@ -161,6 +280,21 @@ class Events {
      * Get internal state flags
      */
     bool getState(uint8_t testFlags);
+
+    /**
+     * Set or clear ZTS_STATE_STACK_RUNNING. Usable from stack threads, which have no context
+     */
+    static void setStackRunning(bool running);
+
+    /**
+     * Return whether the shared TCP/IP stack is running
+     */
+    static bool stackIsRunning();
+
+    /**
+     * Return the number of running nodes in the process
+     */
+    static int runningNodes();
 };
 
 }   // namespace ZeroTier
@@ -0,0 +1,361 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Identity generation and validation
+ *
+ * Generating an identity runs a memory-hard proof-of-work that takes a
+ * noticeable fraction of a second. Batches are spread over several threads,
+ * and an optional pool keeps identities generated in the background so that
+ * they can be handed out without waiting.
+ */
+
+#include "Identity.hpp"
+#include "Thread.hpp"
+#include "ZeroTierSockets.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+namespace ZeroTier {
+
+static std::atomic<uint64_t> _generated(0);
+static std::atomic<uint64_t> _generateUs(0);
+static std::atomic<uint64_t> _validated(0);
+static std::atomic<uint64_t> _batchTotal(0);
+static std::atomic<uint64_t> _batchDone(0);
+static std::atomic<uint64_t> _poolHits(0);
+static std::atomic<uint64_t> _poolMisses(0);
+
+/**
+ * Generate one identity and write its key-pair string to dst, which must hold
+ * ZTS_ID_STR_BUF_LEN bytes. Returns the length of the string
+ */
+static unsigned int zts_id_generate(char* dst)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Identity id;
+    id.generate();
+    char idtmp[ZT_IDENTITY_STRING_BUFFER_LENGTH] = { 0 };
+    id.toString(true, idtmp);
+    unsigned int len = (unsigned int)strnlen(idtmp, ZT_IDENTITY_STRING_BUFFER_LENGTH - 1);
+    memcpy(dst, idtmp, len);
+    dst[len] = 0;
+    memset(idtmp, 0, sizeof(idtmp));
+    _generateUs += (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    _generated++;
+    return len;
+}
+
+static bool zts_id_validate(const char* key, unsigned int len)
+{
+    _validated++;
+    Identity id;
+    if ((strnlen(key, len) > 32) && (key[10] == ':')) {
+        if (id.fromString(key)) {
+            return id.locallyValidate();
+        }
+    }
+    return false;
+}
+
+static unsigned int zts_id_thread_count(unsigned int threads, unsigned int count)
+{
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+    return threads < count ? threads : count;
+}
+
+/**
+ * Work shared by the threads of one batch. Each thread claims the next unclaimed
+ * slot until none are left
+ */
+struct IdentityBatch {
+    unsigned int count;
+    std::atomic<unsigned int> next;
+    // Generation
+    char* keys;
+    // Validation
+    const char* pairs;
+    int* results;
+
+    IdentityBatch(unsigned int count) : count(count), next(0), keys(NULL), pairs(NULL), results(NULL)
+    {
+    }
+
+    void threadMain() throw()
+    {
+        unsigned int i;
+        while ((i = next++) < count) {
+            if (keys) {
+                zts_id_generate(keys + ((size_t)i * ZTS_ID_STR_BUF_LEN));
+                _batchDone++;
+            }
+            else {
+                results[i] = zts_id_validate(pairs + ((size_t)i * ZTS_ID_STR_BUF_LEN), ZTS_ID_STR_BUF_LEN);
+            }
+        }
+    }
+
+    /**
+     * Run the batch on the calling thread and threads - 1 others
+     */
+    void run(unsigned int threads)
+    {
+        std::vector<Thread> workers;
+        for (unsigned int t = 1; t < threads; t++) {
+            try {
+                workers.push_back(Thread::start(this));
+            }
+            catch (...) {
+                // Whatever could be started, including this thread, still completes the batch
+                break;
+            }
+        }
+        threadMain();
+        for (size_t t = 0; t < workers.size(); t++) {
+            Thread::join(workers[t]);
+        }
+    }
+};
+
+struct IdentityPoolEntry {
+    char key[ZTS_ID_STR_BUF_LEN];
+};
+
+/**
+ * Identities generated ahead of time. Workers top it up to its target size and
+ * then sleep until an identity is taken
+ */
+struct IdentityPool {
+    std::mutex m;
+    std::condition_variable cv;
+    std::vector<IdentityPoolEntry> entries;
+    std::vector<Thread> workers;
+    unsigned int target;
+    // Identities currently being generated for the pool
+    unsigned int inflight;
+    bool running;
+
+    IdentityPool() : target(0), inflight(0), running(false)
+    {
+    }
+
+    void threadMain() throw()
+    {
+        IdentityPoolEntry e;
+        std::unique_lock<std::mutex> l(m);
+        for (;;) {
+            while (running && entries.size() + inflight >= target) {
+                cv.wait(l);
+            }
+            if (! running) {
+                break;
+            }
+            inflight++;
+            l.unlock();
+            zts_id_generate(e.key);
+            l.lock();
+            inflight--;
+            if (running) {
+                entries.push_back(e);
+            }
+        }
+        memset(e.key, 0, sizeof(e.key));
+    }
+
+    // Called with m held
+    void wipe()
+    {
+        for (size_t i = 0; i < entries.size(); i++) {
+            memset(entries[i].key, 0, sizeof(entries[i].key));
+        }
+        entries.clear();
+    }
+};
+
+static IdentityPool _pool;
+// Serializes zts_id_pool_start() and zts_id_pool_stop()
+static std::mutex _pool_ctl_m;
+
+/**
+ * Copy an identity out of the pool into dst. Returns false if the pool is empty
+ */
+static bool zts_id_pool_take(char* dst)
+{
+    std::lock_guard<std::mutex> _l(_pool.m);
+    if (_pool.entries.empty()) {
+        if (_pool.running) {
+            _poolMisses++;
+        }
+        return false;
+    }
+    IdentityPoolEntry& e = _pool.entries.back();
+    memcpy(dst, e.key, sizeof(e.key));
+    memset(e.key, 0, sizeof(e.key));
+    _pool.entries.pop_back();
+    _poolHits++;
+    _pool.cv.notify_one();
+    return true;
+}
+
+}   // namespace ZeroTier
+
+using namespace ZeroTier;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int zts_id_new(char* key, unsigned int* dst_len)
+{
+    if (key == NULL || dst_len == NULL || *dst_len != ZT_IDENTITY_STRING_BUFFER_LENGTH) {
+        return ZTS_ERR_ARG;
+    }
+    char idtmp[ZTS_ID_STR_BUF_LEN];
+    if (! zts_id_pool_take(idtmp)) {
+        zts_id_generate(idtmp);
+    }
+    unsigned int key_pair_len = (unsigned int)strnlen(idtmp, sizeof(idtmp));
+    memcpy(key, idtmp, key_pair_len);
+    memset(idtmp, 0, sizeof(idtmp));
+    *dst_len = key_pair_len;
+    return ZTS_ERR_OK;
+}
+
+int zts_id_new_batch(unsigned int count, unsigned int threads, char* keys)
+{
+    if (keys == NULL || count == 0) {
+        return ZTS_ERR_ARG;
+    }
+    IdentityBatch batch(count);
+    batch.keys = keys;
+    _batchTotal += count;
+    batch.run(zts_id_thread_count(threads, count));
+    _batchTotal -= count;
+    _batchDone -= count;
+    return ZTS_ERR_OK;
+}
+
+int zts_id_pair_is_valid(const char* key, unsigned int len)
+{
+    if (key == NULL || len != ZT_IDENTITY_STRING_BUFFER_LENGTH) {
+        return false;
+    }
+    return zts_id_validate(key, len);
+}
+
+int zts_id_pair_is_valid_batch(const char* keys, unsigned int count, unsigned int threads, int* results)
+{
+    if (keys == NULL || results == NULL || count == 0) {
+        return ZTS_ERR_ARG;
+    }
+    IdentityBatch batch(count);
+    batch.pairs = keys;
+    batch.results = results;
+    batch.run(zts_id_thread_count(threads, count));
+    int valid = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        valid += results[i] ? 1 : 0;
+    }
+    return valid;
+}
+
+int zts_id_pool_start(unsigned int size, unsigned int threads)
+{
+    if (size == 0) {
+        return ZTS_ERR_ARG;
+    }
+    std::lock_guard<std::mutex> _lc(_pool_ctl_m);
+    if (! _pool.workers.empty()) {
+        return ZTS_ERR_SERVICE;
+    }
+    threads = zts_id_thread_count(threads, size);
+    {
+        std::lock_guard<std::mutex> _l(_pool.m);
+        _pool.target = size;
+        _pool.running = true;
+    }
+    for (unsigned int t = 0; t < threads; t++) {
+        try {
+            _pool.workers.push_back(Thread::start(&_pool));
+        }
+        catch (...) {
+            break;
+        }
+    }
+    if (_pool.workers.empty()) {
+        std::lock_guard<std::mutex> _l(_pool.m);
+        _pool.running = false;
+        return ZTS_ERR_GENERAL;
+    }
+    return ZTS_ERR_OK;
+}
+
+int zts_id_pool_stop()
+{
+    std::lock_guard<std::mutex> _lc(_pool_ctl_m);
+    if (_pool.workers.empty()) {
+        return ZTS_ERR_SERVICE;
+    }
+    {
+        std::lock_guard<std::mutex> _l(_pool.m);
+        _pool.running = false;
+        _pool.cv.notify_all();
+    }
+    // Workers finish the identity they are generating before they exit
+    for (size_t t = 0; t < _pool.workers.size(); t++) {
+        Thread::join(_pool.workers[t]);
+    }
+    _pool.workers.clear();
+    std::lock_guard<std::mutex> _l(_pool.m);
+    _pool.wipe();
+    _pool.target = 0;
+    return ZTS_ERR_OK;
+}
+
+int zts_id_get_stats(zts_id_stats_t* stats)
+{
+    if (stats == NULL) {
+        return ZTS_ERR_ARG;
+    }
+    memset(stats, 0, sizeof(zts_id_stats_t));
+    stats->generated = _generated;
+    stats->generate_us = _generateUs;
+    stats->validated = _validated;
+    stats->batch_total = _batchTotal;
+    stats->batch_done = _batchDone;
+    stats->pool_hits = _poolHits;
+    stats->pool_misses = _poolMisses;
+    std::lock_guard<std::mutex> _l(_pool.m);
+    stats->pool_available = (unsigned int)_pool.entries.size();
+    stats->pool_target = _pool.target;
+    return ZTS_ERR_OK;
+}
+
+#ifdef __cplusplus
+}   // extern "C"
+#endif
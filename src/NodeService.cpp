@@ -24,9 +24,14 @@
 #include "InetAddress.hpp"
 #include "Mutex.hpp"
 #include "Node.hpp"
+#include "Snapshot.hpp"
 #include "Utilities.hpp"
 #include "VirtualTap.hpp"
 
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+
 #if defined(__WINDOWS__)
 #include <ShlObj.h>
 #include <WinSock2.h>
@@ -182,6 +187,19 @@ NodeService::NodeService()
     , _portMapper((PortMapper*)0)
 #endif
     , _allowSecondaryPort(true)
+    , _allowOsPortSelection(false)
+    , _pathMonitoring(false)
+    , _pathProbeInterval(0)
+    , _lastPathProbe(0)
+    , _pathProbeSeq(0)
+    , _auxPortsPending(false)
+    , _auxPortCandidate(0)
+    , _auxPortTrials(0)
+    , _callerDriven(false)
+    , _tso(false)
+    , _gro(false)
+    , _groSegments(0)
+    , _groPackets(0)
     , _allowNetworkCaching(true)
     , _allowPeerCaching(true)
     , _allowIdentityCaching(true)
@@ -191,6 +209,8 @@ NodeService::NodeService()
     , _eventsEnabled(false)
     , _homePath("")
     , _events(NULL)
+    , _snapshots(NULL)
+    , _snapshotStale(true)
 {
 }
 
@@ -206,152 +226,9 @@ NodeService::ReasonForTermination NodeService::run()
 {
     _run = true;
     try {
-        // Create home path (if necessary)
-        // By default, _homePath is empty and nothing is written to storage
-        if (_homePath.length() > 0) {
-            std::vector<std::string> hpsp(OSUtils::split(_homePath.c_str(), ZT_PATH_SEPARATOR_S, "", ""));
-            std::string ptmp;
-            if (_homePath[0] == ZT_PATH_SEPARATOR) {
-                ptmp.push_back(ZT_PATH_SEPARATOR);
-            }
-            for (std::vector<std::string>::iterator pi(hpsp.begin()); pi != hpsp.end(); ++pi) {
-                if (ptmp.length() > 0) {
-                    ptmp.push_back(ZT_PATH_SEPARATOR);
-                }
-                ptmp.append(*pi);
-                if ((*pi != ".") && (*pi != "..")) {
-                    if (OSUtils::mkdir(ptmp) == false) {
-                        Mutex::Lock _l(_termReason_m);
-                        _termReason = ONE_UNRECOVERABLE_ERROR;
-                        _fatalErrorMessage = "home path could not be created";
-                        return _termReason;
-                    }
-                }
-            }
-        }
-
-        // Set callbacks for ZT Node
-        {
-            struct ZT_Node_Callbacks cb;
-            cb.version = 0;
-            cb.stateGetFunction = SnodeStateGetFunction;
-            cb.statePutFunction = SnodeStatePutFunction;
-            cb.wirePacketSendFunction = SnodeWirePacketSendFunction;
-            cb.virtualNetworkFrameFunction = SnodeVirtualNetworkFrameFunction;
-            cb.virtualNetworkConfigFunction = SnodeVirtualNetworkConfigFunction;
-            cb.eventCallback = SnodeEventCallback;
-            cb.pathCheckFunction = SnodePathCheckFunction;
-            cb.pathLookupFunction = SnodePathLookupFunction;
-            _node = new Node(this, (void*)0, &cb, OSUtils::now());
-        }
-
-        unsigned int minPort = (_randomPortRangeStart ? _randomPortRangeStart : 20000);
-        unsigned int maxPort = (_randomPortRangeEnd ? _randomPortRangeEnd : 45500);
-
-        // Make sure we can use the primary port, and hunt for one if
-        // configured to do so
-        const int portTrials = (_primaryPort == 0) ? 256 : 1;   // if port is 0, pick random
-        for (int k = 0; k < portTrials; ++k) {
-            if (_primaryPort == 0) {
-                unsigned int randp = 0;
-                Utils::getSecureRandom(&randp, sizeof(randp));
-                _primaryPort = (randp % (maxPort - minPort + 1)) + minPort;
-            }
-            if (_trialBind(_primaryPort)) {
-                _ports[0] = _primaryPort;
-                break;
-            }
-            else {
-                _primaryPort = 0;
-            }
-        }
-        if (_ports[0] == 0) {
-            Mutex::Lock _l(_termReason_m);
-            _termReason = ONE_UNRECOVERABLE_ERROR;
-            _fatalErrorMessage = "cannot bind to local control interface port";
-            return _termReason;
-        }
-
-        // Attempt to bind to a secondary port chosen from our ZeroTier
-        // address. This exists because there are buggy NATs out there that
-        // fail if more than one device behind the same NAT tries to use the
-        // same internal private address port number. Buggy NATs are a
-        // running theme.
-        if (_allowSecondaryPort) {
-            //_ports[1] = (_secondaryPort == 0) ? minPort + ((unsigned int)_node->address() % maxPort) : _secondaryPort;
-            _ports[1] = (_secondaryPort == 0) ? (((unsigned int)_node->address() % (maxPort - minPort + 1)) + minPort)
-                                              : _secondaryPort;
-            for (int i = 0;; ++i) {
-                if (i > 1000) {
-                    _ports[1] = 0;
-                    break;
-                }
-                else if (++_ports[1] >= maxPort) {
-                    _ports[1] = minPort;
-                }
-                if (_trialBind(_ports[1])) {
-                    _secondaryPort = _ports[1];
-                    break;
-                }
-            }
-        }
-#ifdef ZT_USE_MINIUPNPC
-        if (_allowPortMapping) {
-            // If we're running uPnP/NAT-PMP, bind a *third* port for that.
-            // We can't use the other two ports for that because some NATs
-            // do really funky stuff with ports that are explicitly mapped
-            // that breaks things.
-            maxPort = (_randomPortRangeEnd ? _randomPortRangeEnd : 65536);
-
-            if (_ports[1]) {
-                _ports[2] = (_tertiaryPort == 0) ? _ports[1] : _tertiaryPort;
-                for (int i = 0;; ++i) {
-                    if (i > 1000) {
-                        _ports[2] = 0;
-                        break;
-                    }
-                    else if (++_ports[2] >= maxPort) {
-                        _ports[2] = minPort;
-                    }
-                    if (_trialBind(_ports[2])) {
-                        _tertiaryPort = _ports[2];
-                        break;
-                    }
-                }
-                if (_ports[2]) {
-                    char uniqueName[64] = { 0 };
-                    OSUtils::ztsnprintf(
-                        uniqueName,
-                        sizeof(uniqueName),
-                        "ZeroTier/%.10llx@%u",
-                        _node->address(),
-                        _ports[2]);
-                    _portMapper = new PortMapper(_ports[2], uniqueName);
-                }
-            }
-        }
-#endif
-        // Join existing networks in networks.d
-        if (_allowNetworkCaching) {
-            std::vector<std::string> networksDotD(
-                OSUtils::listDirectory((_homePath + ZT_PATH_SEPARATOR_S "networks.d").c_str()));
-            for (std::vector<std::string>::iterator f(networksDotD.begin()); f != networksDotD.end(); ++f) {
-                std::size_t dot = f->find_last_of('.');
-                if ((dot == 16) && (f->substr(16) == ".conf")) {
-                    _node->join(Utils::hexStrToU64(f->substr(0, dot).c_str()), (void*)0, (void*)0);
-                }
-            }
+        if (! start()) {
+            return reasonForTermination();
         }
-        // Main I/O loop
-        _nextBackgroundTaskDeadline = 0;
-        int64_t clockShouldBe = OSUtils::now();
-        _lastRestart = clockShouldBe;
-        int64_t lastTapMulticastGroupCheck = 0;
-        int64_t lastBindRefresh = 0;
-        int64_t lastCleanedPeersDb = 0;
-        int64_t lastLocalInterfaceAddressCheck =
-            (clockShouldBe - ZT_LOCAL_INTERFACE_CHECK_INTERVAL) + 15000;   // do this in 15s to give portmapper time to
-                                                                           // configure and other things time to settle
         for (;;) {
             _run_m.lock();
             if (! _run) {
@@ -364,124 +241,299 @@ NodeService::ReasonForTermination NodeService::run()
             else {
                 _run_m.unlock();
             }
-
             const int64_t now = OSUtils::now();
+            const int64_t dl = processBackgroundTasks(now);
+            const unsigned long delay = (dl > now) ? (unsigned long)(dl - now) : 100;
+            _clockShouldBe = now + (uint64_t)delay;
+            _phy.poll(delay);
+        }
+    }
+    catch (std::exception& e) {
+        setFatalError(std::string("unexpected exception in main thread: ") + e.what());
+    }
+    catch (...) {
+        setFatalError("unexpected exception in main thread: unknown exception");
+    }
+    finish();
+    return reasonForTermination();
+}
 
-            // Attempt to detect sleep/wake events by detecting delay
-            // overruns
-            bool restarted = false;
-            if ((now > clockShouldBe) && ((now - clockShouldBe) > 10000)) {
-                _lastRestart = now;
-                restarted = true;
-            }
-
-            // Refresh bindings in case device's interfaces have changed,
-            // and also sync routes to update any shadow routes (e.g. shadow
-            // default)
-            if (((now - lastBindRefresh) >= ZT_BINDER_REFRESH_PERIOD) || (restarted)) {
-                lastBindRefresh = now;
-                unsigned int p[3] = { 0 };
-                unsigned int pc = 0;
-                for (int i = 0; i < 3; ++i) {
-                    if (_ports[i]) {
-                        p[pc++] = _ports[i];
-                    }
-                }
-                _binder.refresh(_phy, p, pc, explicitBind, *this);
-            }
-
-            // Generate callback messages for user application
-            generateSyntheticEvents();
-
-            // Run background task processor in core if it's time to do so
-            int64_t dl = _nextBackgroundTaskDeadline;
-            if (dl <= now) {
-                _node->processBackgroundTasks((void*)0, now, &_nextBackgroundTaskDeadline);
-                dl = _nextBackgroundTaskDeadline;
-            }
-
-            // Sync multicast group memberships
-            if ((now - lastTapMulticastGroupCheck) >= ZT_TAP_CHECK_MULTICAST_INTERVAL) {
-                lastTapMulticastGroupCheck = now;
-                std::vector<std::pair<uint64_t, std::pair<std::vector<MulticastGroup>, std::vector<MulticastGroup> > > >
-                    mgChanges;
-                {
-                    Mutex::Lock _l(_nets_m);
-                    mgChanges.reserve(_nets.size() + 1);
-                    for (std::map<uint64_t, NetworkState>::const_iterator n(_nets.begin()); n != _nets.end(); ++n) {
-                        if (n->second.tap) {
-                            mgChanges.push_back(std::pair<
-                                                uint64_t,
-                                                std::pair<std::vector<MulticastGroup>, std::vector<MulticastGroup> > >(
-                                n->first,
-                                std::pair<std::vector<MulticastGroup>, std::vector<MulticastGroup> >()));
-                            n->second.tap->scanMulticastGroups(
-                                mgChanges.back().second.first,
-                                mgChanges.back().second.second);
-                        }
-                    }
-                }
-                for (std::vector<
-                         std::pair<uint64_t, std::pair<std::vector<MulticastGroup>, std::vector<MulticastGroup> > > >::
-                         iterator c(mgChanges.begin());
-                     c != mgChanges.end();
-                     ++c) {
-                    auto mgpair = c->second;
-                    for (std::vector<MulticastGroup>::iterator m(mgpair.first.begin()); m != mgpair.first.end(); ++m) {
-                        _node->multicastSubscribe((void*)0, c->first, m->mac().toInt(), m->adi());
-                    }
-                    for (std::vector<MulticastGroup>::iterator m(mgpair.second.begin()); m != mgpair.second.end();
-                         ++m) {
-                        _node->multicastUnsubscribe(c->first, m->mac().toInt(), m->adi());
-                    }
+bool NodeService::start()
+{
+    // Create home path (if necessary)
+    // By default, _homePath is empty and nothing is written to storage
+    if (_homePath.length() > 0) {
+        std::vector<std::string> hpsp(OSUtils::split(_homePath.c_str(), ZT_PATH_SEPARATOR_S, "", ""));
+        std::string ptmp;
+        if (_homePath[0] == ZT_PATH_SEPARATOR) {
+            ptmp.push_back(ZT_PATH_SEPARATOR);
+        }
+        for (std::vector<std::string>::iterator pi(hpsp.begin()); pi != hpsp.end(); ++pi) {
+            if (ptmp.length() > 0) {
+                ptmp.push_back(ZT_PATH_SEPARATOR);
+            }
+            ptmp.append(*pi);
+            if ((*pi != ".") && (*pi != "..")) {
+                if (OSUtils::mkdir(ptmp) == false) {
+                    setFatalError("home path could not be created");
+                    return false;
                 }
             }
+        }
+    }
 
-            // Sync information about physical network interfaces
-            if ((now - lastLocalInterfaceAddressCheck) >= ZT_LOCAL_INTERFACE_CHECK_INTERVAL) {
-                lastLocalInterfaceAddressCheck = now;
+    // Set callbacks for ZT Node
+    {
+        struct ZT_Node_Callbacks cb;
+        cb.version = 0;
+        cb.stateGetFunction = SnodeStateGetFunction;
+        cb.statePutFunction = SnodeStatePutFunction;
+        cb.wirePacketSendFunction = SnodeWirePacketSendFunction;
+        cb.virtualNetworkFrameFunction = SnodeVirtualNetworkFrameFunction;
+        cb.virtualNetworkConfigFunction = SnodeVirtualNetworkConfigFunction;
+        cb.eventCallback = SnodeEventCallback;
+        cb.pathCheckFunction = SnodePathCheckFunction;
+        cb.pathLookupFunction = SnodePathLookupFunction;
+        _node = new Node(this, (void*)0, &cb, OSUtils::now());
+    }
+
+    unsigned int minPort = (_randomPortRangeStart ? _randomPortRangeStart : 20000);
+    unsigned int maxPort = (_randomPortRangeEnd ? _randomPortRangeEnd : 45500);
+
+    // Make sure we can use the primary port. If none was configured let the OS
+    // pick a free one when allowed, otherwise hunt for one in the random range
+    if (_primaryPort == 0 && _allowOsPortSelection) {
+        _primaryPort = _osSelectPort();
+        if (_primaryPort && ! _trialBind(_primaryPort)) {
+            _primaryPort = 0;
+        }
+        if (_primaryPort) {
+            _ports[0] = _primaryPort;
+        }
+    }
+    const int portTrials = (_primaryPort == 0) ? 256 : 1;   // if port is 0, pick random
+    for (int k = 0; k < portTrials && _ports[0] == 0; ++k) {
+        if (_primaryPort == 0) {
+            unsigned int randp = 0;
+            Utils::getSecureRandom(&randp, sizeof(randp));
+            _primaryPort = (randp % (maxPort - minPort + 1)) + minPort;
+        }
+        if (_trialBind(_primaryPort)) {
+            _ports[0] = _primaryPort;
+            break;
+        }
+        else {
+            _primaryPort = 0;
+        }
+    }
+    if (_ports[0] == 0) {
+        setFatalError("cannot bind to local control interface port");
+        return false;
+    }
 
-                _node->clearLocalInterfaceAddresses();
+    // The secondary and port-mapping ports are hunted for by the background
+    // task processor so that the node can come online on the primary port first
+    _ports[1] = 0;
+    _ports[2] = 0;
+    _auxPortCandidate = 0;
+    _auxPortTrials = 0;
+    _auxPortsPending = _allowSecondaryPort;
+
+    // Join existing networks in networks.d and in an imported state blob
+    std::vector<uint64_t> joinIds;
+    if (_allowNetworkCaching) {
+        std::vector<std::string> networksDotD(
+            OSUtils::listDirectory((_homePath + ZT_PATH_SEPARATOR_S "networks.d").c_str()));
+        for (std::vector<std::string>::iterator f(networksDotD.begin()); f != networksDotD.end(); ++f) {
+            std::size_t dot = f->find_last_of('.');
+            if ((dot == 16) && (f->substr(16) == ".conf")) {
+                joinIds.push_back(Utils::hexStrToU64(f->substr(0, dot).c_str()));
+            }
+        }
+    }
+    if (_allowNetworkCaching) {
+        Mutex::Lock _ls(_store_m);
+        for (std::map<uint64_t, CachedStateObject>::iterator c(_cachedNetworks.begin()); c != _cachedNetworks.end();
+             ++c) {
+            if (std::find(joinIds.begin(), joinIds.end(), c->first) == joinIds.end()) {
+                joinIds.push_back(c->first);
+            }
+        }
+    }
+    for (size_t i = 0; i < joinIds.size(); i++) {
+        _node->join(joinIds[i], (void*)0, (void*)0);
+    }
+    // State for the main I/O loop
+    _nextBackgroundTaskDeadline = 0;
+    _clockShouldBe = OSUtils::now();
+    _lastRestart = _clockShouldBe;
+    _lastTapMulticastGroupCheck = 0;
+    _lastBindRefresh = 0;
+    _lastCleanedPeersDb = 0;
+    _lastLocalInterfaceAddressCheck =
+        (_clockShouldBe - ZT_LOCAL_INTERFACE_CHECK_INTERVAL) + 15000;   // do this in 15s to give portmapper time to
+                                                                        // configure and other things time to settle
+    return true;
+}
 
-#ifdef ZT_USE_MINIUPNPC
-                if (_portMapper) {
-                    std::vector<InetAddress> mappedAddresses(_portMapper->get());
-                    for (std::vector<InetAddress>::const_iterator ext(mappedAddresses.begin());
-                         ext != mappedAddresses.end();
-                         ++ext)
-                        _node->addLocalInterfaceAddress(reinterpret_cast<const struct sockaddr_storage*>(&(*ext)));
-                }
-#endif
+int64_t NodeService::processBackgroundTasks(int64_t now)
+{
+    // Attempt to detect sleep/wake events by detecting delay
+    // overruns
+    bool restarted = false;
+    if ((now > _clockShouldBe) && ((now - _clockShouldBe) > 10000)) {
+        _lastRestart = now;
+        restarted = true;
+    }
 
-                std::vector<InetAddress> boundAddrs(_binder.allBoundLocalInterfaceAddresses());
-                for (std::vector<InetAddress>::const_iterator i(boundAddrs.begin()); i != boundAddrs.end(); ++i)
-                    _node->addLocalInterfaceAddress(reinterpret_cast<const struct sockaddr_storage*>(&(*i)));
+    // The packets received since the last call form one batch, hand over
+    // whatever receive coalescing still holds
+    if (_gro) {
+        Mutex::Lock _l(_nets_m);
+        for (std::map<uint64_t, NetworkState>::iterator n(_nets.begin()); n != _nets.end(); ++n) {
+            if (n->second.tap) {
+                n->second.tap->flushRx();
             }
+        }
+    }
 
-            // Clean peers.d periodically
-            if ((now - lastCleanedPeersDb) >= 3600000) {
-                lastCleanedPeersDb = now;
-                OSUtils::cleanDirectory(
-                    (_homePath + ZT_PATH_SEPARATOR_S "peers.d").c_str(),
-                    now - 2592000000LL);   // delete older than 30 days
+    // Acquire the secondary and port-mapping ports a few candidates at a time,
+    // once the node is online or has had a while to get there
+    if (_auxPortsPending && (_nodeIsOnline || (now - _lastRestart) >= ZTS_AUX_PORT_DELAY)) {
+        if (acquireAuxiliaryPorts()) {
+            _auxPortsPending = false;
+            _lastBindRefresh = 0;
+        }
+    }
+
+    // Refresh bindings in case device's interfaces have changed,
+    // and also sync routes to update any shadow routes (e.g. shadow
+    // default)
+    if (((now - _lastBindRefresh) >= ZT_BINDER_REFRESH_PERIOD) || (restarted)) {
+        _lastBindRefresh = now;
+        unsigned int p[3] = { 0 };
+        unsigned int pc = 0;
+        for (int i = 0; i < 3; ++i) {
+            if (_ports[i]) {
+                p[pc++] = _ports[i];
             }
+        }
+        _binder.refresh(_phy, p, pc, explicitBind, *this);
+        if (_callerDriven) {
+            refreshPollableFds();
+        }
+    }
 
-            const unsigned long delay = (dl > now) ? (unsigned long)(dl - now) : 100;
-            clockShouldBe = now + (uint64_t)delay;
-            _phy.poll(delay);
+    // Generate callback messages for user application
+    generateSyntheticEvents();
+    publishSnapshot();
+    processPathProbes(now);
+
+    // Run background task processor in core if it's time to do so
+    int64_t dl = _nextBackgroundTaskDeadline;
+    if (dl <= now) {
+        _node->processBackgroundTasks((void*)0, now, &_nextBackgroundTaskDeadline);
+        dl = _nextBackgroundTaskDeadline;
+    }
+
+    // Sync multicast group memberships, right away if the stack joined or left a group
+    bool mgChanged = false;
+    {
+        Mutex::Lock _l(_nets_m);
+        for (std::map<uint64_t, NetworkState>::const_iterator n(_nets.begin()); n != _nets.end(); ++n) {
+            if (n->second.tap && n->second.tap->multicastGroupsChanged()) {
+                mgChanged = true;
+                break;
+            }
         }
     }
-    catch (std::exception& e) {
-        Mutex::Lock _l(_termReason_m);
-        _termReason = ONE_UNRECOVERABLE_ERROR;
-        _fatalErrorMessage = std::string("unexpected exception in main thread: ") + e.what();
+    if (mgChanged || (now - _lastTapMulticastGroupCheck) >= ZT_TAP_CHECK_MULTICAST_INTERVAL) {
+        _lastTapMulticastGroupCheck = now;
+        std::vector<std::pair<uint64_t, std::pair<std::vector<MulticastGroup>, std::vector<MulticastGroup> > > >
+            mgChanges;
+        {
+            Mutex::Lock _l(_nets_m);
+            mgChanges.reserve(_nets.size() + 1);
+            for (std::map<uint64_t, NetworkState>::const_iterator n(_nets.begin()); n != _nets.end(); ++n) {
+                if (n->second.tap) {
+                    mgChanges.push_back(std::pair<
+                                        uint64_t,
+                                        std::pair<std::vector<MulticastGroup>, std::vector<MulticastGroup> > >(
+                        n->first,
+                        std::pair<std::vector<MulticastGroup>, std::vector<MulticastGroup> >()));
+                    n->second.tap->scanMulticastGroups(
+                        mgChanges.back().second.first,
+                        mgChanges.back().second.second);
+                }
+            }
+        }
+        for (std::vector<
+                 std::pair<uint64_t, std::pair<std::vector<MulticastGroup>, std::vector<MulticastGroup> > > >::
+                 iterator c(mgChanges.begin());
+             c != mgChanges.end();
+             ++c) {
+            auto mgpair = c->second;
+            for (std::vector<MulticastGroup>::iterator m(mgpair.first.begin()); m != mgpair.first.end(); ++m) {
+                _node->multicastSubscribe((void*)0, c->first, m->mac().toInt(), m->adi());
+            }
+            for (std::vector<MulticastGroup>::iterator m(mgpair.second.begin()); m != mgpair.second.end();
+                 ++m) {
+                _node->multicastUnsubscribe(c->first, m->mac().toInt(), m->adi());
+            }
+            if (mgpair.first.empty() && mgpair.second.empty()) {
+                continue;
+            }
+            // Subscriptions are not announced as config updates, so refresh the copy that
+            // zts_core_query_mc() reads
+            ZT_VirtualNetworkConfig* nc = _node->networkConfig(c->first);
+            if (nc) {
+                Mutex::Lock _l(_nets_m);
+                std::map<uint64_t, NetworkState>::iterator n(_nets.find(c->first));
+                if (n != _nets.end()) {
+                    n->second.config.multicastSubscriptionCount = nc->multicastSubscriptionCount;
+                    memcpy(
+                        n->second.config.multicastSubscriptions,
+                        nc->multicastSubscriptions,
+                        sizeof(nc->multicastSubscriptions));
+                }
+                _node->freeQueryResult((void*)nc);
+            }
+        }
     }
-    catch (...) {
-        Mutex::Lock _l(_termReason_m);
-        _termReason = ONE_UNRECOVERABLE_ERROR;
-        _fatalErrorMessage = "unexpected exception in main thread: unknown exception";
+
+    // Sync information about physical network interfaces
+    if ((now - _lastLocalInterfaceAddressCheck) >= ZT_LOCAL_INTERFACE_CHECK_INTERVAL) {
+        _lastLocalInterfaceAddressCheck = now;
+
+        _node->clearLocalInterfaceAddresses();
+
+#ifdef ZT_USE_MINIUPNPC
+        if (_portMapper) {
+            std::vector<InetAddress> mappedAddresses(_portMapper->get());
+            for (std::vector<InetAddress>::const_iterator ext(mappedAddresses.begin());
+                 ext != mappedAddresses.end();
+                 ++ext)
+                _node->addLocalInterfaceAddress(reinterpret_cast<const struct sockaddr_storage*>(&(*ext)));
+        }
+#endif
+
+        std::vector<InetAddress> boundAddrs(_binder.allBoundLocalInterfaceAddresses());
+        for (std::vector<InetAddress>::const_iterator i(boundAddrs.begin()); i != boundAddrs.end(); ++i)
+            _node->addLocalInterfaceAddress(reinterpret_cast<const struct sockaddr_storage*>(&(*i)));
     }
 
+    // Clean peers.d periodically
+    if ((now - _lastCleanedPeersDb) >= 3600000) {
+        _lastCleanedPeersDb = now;
+        OSUtils::cleanDirectory(
+            (_homePath + ZT_PATH_SEPARATOR_S "peers.d").c_str(),
+            now - 2592000000LL);   // delete older than 30 days
+    }
+    return dl;
+}
+
+void NodeService::finish()
+{
     {
         Mutex::Lock _l(_nets_m);
         for (std::map<uint64_t, NetworkState>::iterator n(_nets.begin()); n != _nets.end(); ++n) {
@@ -489,6 +541,9 @@ NodeService::ReasonForTermination NodeService::run()
         }
         _nets.clear();
     }
+    if (_snapshots) {
+        _snapshots->clear();
+    }
 
     switch (_termReason) {
         case ONE_NORMAL_TERMINATION:
@@ -502,7 +557,113 @@ NodeService::ReasonForTermination NodeService::run()
     }
     delete _node;
     _node = (Node*)0;
-    return _termReason;
+}
+
+int NodeService::startCallerDriven()
+{
+    _run = true;
+    try {
+        if (start()) {
+            _clockShouldBe = OSUtils::now();
+            return ZTS_ERR_OK;
+        }
+    }
+    catch (std::exception& e) {
+        setFatalError(std::string("unexpected exception in main thread: ") + e.what());
+        finish();
+    }
+    catch (...) {
+        setFatalError("unexpected exception in main thread: unknown exception");
+        finish();
+    }
+    _run = false;
+    return ZTS_ERR_SERVICE;
+}
+
+bool NodeService::process(unsigned long timeout_ms)
+{
+    try {
+        if (isRunning()) {
+            _phy.poll(timeout_ms);
+            const int64_t now = OSUtils::now();
+            processBackgroundTasks(now);
+            _clockShouldBe = nextDeadline();
+            if (isRunning()) {
+                return true;
+            }
+        }
+        _termReason_m.lock();
+        _termReason = ONE_NORMAL_TERMINATION;
+        _termReason_m.unlock();
+    }
+    catch (std::exception& e) {
+        setFatalError(std::string("unexpected exception in main thread: ") + e.what());
+    }
+    catch (...) {
+        setFatalError("unexpected exception in main thread: unknown exception");
+    }
+    finish();
+    return false;
+}
+
+int64_t NodeService::nextDeadline() const
+{
+    int64_t dl = _nextBackgroundTaskDeadline;
+    dl = std::min(dl, _lastBindRefresh + ZT_BINDER_REFRESH_PERIOD);
+    dl = std::min(dl, _lastTapMulticastGroupCheck + ZT_TAP_CHECK_MULTICAST_INTERVAL);
+    dl = std::min(dl, _lastLocalInterfaceAddressCheck + ZT_LOCAL_INTERFACE_CHECK_INTERVAL);
+    return dl;
+}
+
+int NodeService::getPollableFds(int* fds, unsigned int max)
+{
+#if defined(__WINDOWS__)
+    ZTS_UNUSED_ARG(fds);
+    ZTS_UNUSED_ARG(max);
+    return ZTS_ERR_GENERAL;
+#else
+    Mutex::Lock _l(_pollableFds_m);
+    unsigned int count = 0;
+    for (; count < max && count < _pollableFds.size(); count++) {
+        fds[count] = _pollableFds[count];
+    }
+    return (int)count;
+#endif
+}
+
+void NodeService::refreshPollableFds()
+{
+#if ! defined(__WINDOWS__)
+    std::vector<InetAddress> bound(_binder.allBoundLocalInterfaceAddresses());
+    std::vector<int> fds;
+    // Phy waits with select(), so all of its descriptors are below FD_SETSIZE
+    for (int fd = 0; fd < FD_SETSIZE && ! bound.empty(); fd++) {
+        struct sockaddr_storage ss;
+        socklen_t len = sizeof(ss);
+        int type = 0;
+        socklen_t type_len = sizeof(type);
+        if (::getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &type_len) != 0 || type != SOCK_DGRAM
+            || ::getsockname(fd, reinterpret_cast<struct sockaddr*>(&ss), &len) != 0) {
+            continue;
+        }
+        const InetAddress addr(ss);
+        for (std::vector<InetAddress>::const_iterator b(bound.begin()); b != bound.end(); ++b) {
+            if (addr.ipsEqual(*b) && addr.port() == b->port()) {
+                fds.push_back(fd);
+                break;
+            }
+        }
+    }
+    Mutex::Lock _l(_pollableFds_m);
+    _pollableFds.swap(fds);
+#endif
+}
+
+void NodeService::setFatalError(const std::string& msg)
+{
+    Mutex::Lock _l(_termReason_m);
+    _termReason = ONE_UNRECOVERABLE_ERROR;
+    _fatalErrorMessage = msg;
 }
 
 NodeService::ReasonForTermination NodeService::reasonForTermination() const
@@ -531,6 +692,11 @@ void NodeService::terminate()
     _allowRootSetCaching = true;
     memset(_publicIdStr, 0, ZT_IDENTITY_STRING_BUFFER_LENGTH);
     memset(_secretIdStr, 0, ZT_IDENTITY_STRING_BUFFER_LENGTH);
+    {
+        Mutex::Lock _ls(_store_m);
+        _cachedNetworks.clear();
+        _cachedPeers.clear();
+    }
     _interfacePrefixBlacklist.clear();
     _events->disable();
     _phy.whack();
@@ -609,6 +775,9 @@ void NodeService::phyOnDatagram(
     ZTS_UNUSED_ARG(localAddr);
     if ((len >= 16) && (reinterpret_cast<const InetAddress*>(from)->ipScope() == InetAddress::IP_SCOPE_GLOBAL))
         _lastDirectReceiveFromGlobal = OSUtils::now();
+    if (_pathMonitoring) {
+        countPathBytes(*reinterpret_cast<const InetAddress*>(from), (unsigned int)len, 0);
+    }
     const ZT_ResultCode rc = _node->processWirePacket(
         (void*)0,
         OSUtils::now(),
@@ -636,6 +805,7 @@ int NodeService::nodeVirtualNetworkConfigFunction(
 {
     Mutex::Lock _l(_nets_m);
     NetworkState& n = _nets[net_id];
+    _snapshotStale = true;
 
     switch (op) {
         case ZT_VIRTUAL_NETWORK_CONFIG_OPERATION_UP:
@@ -650,6 +820,8 @@ int NodeService::nodeVirtualNetworkConfigFunction(
                     (void*)this);
                 *nuptr = (void*)&n;
                 n.tap->setUserEventSystem(_events);
+                n.tap->_tso = _tso;
+                n.tap->_gro = _gro;
             }
             // After setting up tap, fall through to CONFIG_UPDATE since we
             // also want to do this...
@@ -672,6 +844,7 @@ int NodeService::nodeVirtualNetworkConfigFunction(
             sendEventToUser(ZTS_EVENT_NETWORK_DOWN, (void*)&n);
             if (n.tap) {   // sanity check
                 *nuptr = (void*)0;
+                zts_lwip_gro_stats(n.tap, &_groSegments, &_groPackets);
                 delete n.tap;
                 _nets.erase(net_id);
                 if (_allowNetworkCaching) {
@@ -697,11 +870,24 @@ int NodeService::nodeVirtualNetworkConfigFunction(
 
 void NodeService::nodeEventCallback(enum ZT_Event event, const void* metaData)
 {
-    ZTS_UNUSED_ARG(metaData);
+    if (event == ZT_EVENT_USER_MESSAGE) {
+        const ZT_UserMessage* um = reinterpret_cast<const ZT_UserMessage*>(metaData);
+        if (um->typeId == ZTS_PATH_PROBE_REQUEST && um->length <= 64) {
+            // The core must not be re-entered from its own callback, answer on the next pass
+            Mutex::Lock _l(_pendingProbeReplies_m);
+            _pendingProbeReplies.push_back(
+                std::pair<uint64_t, std::string>(um->origin, std::string((const char*)um->data, um->length)));
+        }
+        if (um->typeId == ZTS_PATH_PROBE_REPLY) {
+            onPathProbeReply(um->origin, um->data, um->length, OSUtils::now());
+        }
+        return;
+    }
 
     int event_code = 0;
     _nodeIsOnline = (event == ZT_EVENT_ONLINE) ? true : false;
     _nodeId = _node ? _node->address() : 0x0;
+    _snapshotStale = true;
 
     switch (event) {
         case ZT_EVENT_UP:
@@ -772,33 +958,8 @@ void NodeService::sendEventToUser(unsigned int zt_event_code, const void* obj, u
         case ZTS_EVENT_NETWORK_READY_IP4:
         case ZTS_EVENT_NETWORK_READY_IP6:
         case ZTS_EVENT_NETWORK_OK: {
-            NetworkState* ns = (NetworkState*)obj;
             zts_net_info_t* nd = new zts_net_info_t();
-            nd->net_id = ns->config.nwid;
-            nd->mac = ns->config.mac;
-            strncpy(nd->name, ns->config.name, sizeof(ns->config.name));
-            nd->status = (zts_network_status_t)ns->config.status;
-            nd->type = (zts_net_info_type_t)ns->config.type;
-            nd->mtu = ns->config.mtu;
-            nd->dhcp = ns->config.dhcp;
-            nd->bridge = ns->config.bridge;
-            nd->broadcast_enabled = ns->config.broadcastEnabled;
-            nd->port_error = ns->config.portError;
-            nd->netconf_rev = ns->config.netconfRevision;
-            // Copy and convert address structures
-            nd->assigned_addr_count = ns->config.assignedAddressCount;
-            for (unsigned int i = 0; i < ns->config.assignedAddressCount; i++) {
-                native_ss_to_zts_ss(&(nd->assigned_addrs[i]), &(ns->config.assignedAddresses[i]));
-            }
-            nd->route_count = ns->config.routeCount;
-            for (unsigned int i = 0; i < ns->config.routeCount; i++) {
-                native_ss_to_zts_ss(&(nd->routes[i].target), &(ns->config.routes[i].target));
-                native_ss_to_zts_ss(&(nd->routes[i].via), &(ns->config.routes[i].via));
-                nd->routes[i].flags = ns->config.routes[i].flags;
-                nd->routes[i].metric = ns->config.routes[i].metric;
-            }
-            nd->multicast_sub_count = ns->config.multicastSubscriptionCount;
-            memcpy(nd->multicast_subs, &(ns->config.multicastSubscriptions), sizeof(ns->config.multicastSubscriptions));
+            prepare_network_details_msg(*(const NetworkState*)obj, nd);
             objptr = (void*)nd;
             break;
         }
@@ -835,14 +996,16 @@ void NodeService::sendEventToUser(unsigned int zt_event_code, const void* obj, u
         case ZTS_EVENT_PEER_PATH_DISCOVERED:
         case ZTS_EVENT_PEER_PATH_DEAD: {
             zts_peer_info_t* pd = new zts_peer_info_t();
-            ZT_Peer* peer = (ZT_Peer*)obj;
-            memcpy(pd, peer, sizeof(zts_peer_info_t));
-            for (unsigned int j = 0; j < peer->pathCount; j++) {
-                native_ss_to_zts_ss(&(pd->paths[j].address), &(peer->paths[j].address));
-            }
+            prepare_peer_details_msg((const ZT_Peer*)obj, pd);
             objptr = (void*)pd;
             break;
         }
+        case ZTS_EVENT_PEER_PATH_QUALITY: {
+            zts_peer_quality_t* pq = new zts_peer_quality_t();
+            memcpy(pq, obj, sizeof(zts_peer_quality_t));
+            objptr = (void*)pq;
+            break;
+        }
         default:
             break;
     }
@@ -854,6 +1017,45 @@ void NodeService::sendEventToUser(unsigned int zt_event_code, const void* obj, u
     }
 }
 
+void NodeService::prepare_network_details_msg(const NetworkState& n, zts_net_info_t* nd)
+{
+    nd->net_id = n.config.nwid;
+    nd->mac = n.config.mac;
+    strncpy(nd->name, n.config.name, sizeof(n.config.name));
+    nd->status = (zts_network_status_t)n.config.status;
+    nd->type = (zts_net_info_type_t)n.config.type;
+    nd->mtu = n.config.mtu;
+    nd->dhcp = n.config.dhcp;
+    nd->bridge = n.config.bridge;
+    nd->broadcast_enabled = n.config.broadcastEnabled;
+    nd->port_error = n.config.portError;
+    nd->netconf_rev = n.config.netconfRevision;
+    // Copy and convert address structures
+    nd->assigned_addr_count = n.config.assignedAddressCount;
+    for (unsigned int i = 0; i < n.config.assignedAddressCount; i++) {
+        native_ss_to_zts_ss(&(nd->assigned_addrs[i]), &(n.config.assignedAddresses[i]));
+    }
+    nd->route_count = n.config.routeCount;
+    for (unsigned int i = 0; i < n.config.routeCount; i++) {
+        native_ss_to_zts_ss(&(nd->routes[i].target), &(n.config.routes[i].target));
+        native_ss_to_zts_ss(&(nd->routes[i].via), &(n.config.routes[i].via));
+        nd->routes[i].flags = n.config.routes[i].flags;
+        nd->routes[i].metric = n.config.routes[i].metric;
+    }
+    nd->multicast_sub_count = n.config.multicastSubscriptionCount;
+    memcpy(nd->multicast_subs, &(n.config.multicastSubscriptions), sizeof(n.config.multicastSubscriptions));
+}
+
+void NodeService::prepare_peer_details_msg(const ZT_Peer* peer, zts_peer_info_t* pd)
+{
+    memcpy(pd, peer, sizeof(zts_peer_info_t));
+    for (unsigned int j = 0; j < peer->pathCount; j++) {
+        native_ss_to_zts_ss(&(pd->paths[j].address), &(peer->paths[j].address));
+        // Points into the core's query result, which is freed right after
+        pd->paths[j].ifname = NULL;
+    }
+}
+
 void NodeService::generateSyntheticEvents()
 {
     // Force the ordering of callback messages, these messages are
@@ -864,13 +1066,14 @@ void NodeService::generateSyntheticEvents()
     // Generate messages to be dequeued by the callback message thread
     Mutex::Lock _l(_nets_m);
     for (std::map<uint64_t, NetworkState>::iterator n(_nets.begin()); n != _nets.end(); ++n) {
-        auto netState = n->second;
+        const NetworkState& netState = n->second;
         int mostRecentStatus = netState.config.status;
         VirtualTap* tap = netState.tap;
         // uint64_t net_id = n->first;
         if (netState.tap->_networkStatus == mostRecentStatus) {
             continue;   // No state change
         }
+        _snapshotStale = true;
         switch (mostRecentStatus) {
             case ZT_NETWORK_STATUS_NOT_FOUND:
                 sendEventToUser(ZTS_EVENT_NETWORK_NOT_FOUND, (void*)&netState);
@@ -901,7 +1104,12 @@ void NodeService::generateSyntheticEvents()
     }
     ZT_PeerList* pl = _node->peers();
     if (pl) {
+        bool peersChanged = (pl->peerCount != _snapshotPeers.size());
         for (unsigned long i = 0; i < pl->peerCount; ++i) {
+            std::map<uint64_t, unsigned int>::const_iterator known(peerCache.find(pl->peers[i].address));
+            if (known == peerCache.end() || known->second != pl->peers[i].pathCount) {
+                peersChanged = true;
+            }
             if (! peerCache.count(pl->peers[i].address)) {
                 // New peer, add status
                 if (pl->peers[i].pathCount > 0) {
@@ -928,10 +1136,258 @@ void NodeService::generateSyntheticEvents()
             // Update our cache with most recently observed path count
             peerCache[pl->peers[i].address] = pl->peers[i].pathCount;
         }
+        updatePeerQuality(pl, OSUtils::now());
+        if (peersChanged) {
+            _snapshotPeers.resize(pl->peerCount);
+            for (unsigned long i = 0; i < pl->peerCount; ++i) {
+                prepare_peer_details_msg(&(pl->peers[i]), &_snapshotPeers[i]);
+            }
+            _snapshotStale = true;
+        }
     }
     _node->freeQueryResult((void*)pl);
 }
 
+void NodeService::countPathBytes(const InetAddress& addr, unsigned int in, unsigned int out)
+{
+    Mutex::Lock _l(_pathBytes_m);
+    std::pair<uint64_t, uint64_t>& b = _pathBytes[addr];
+    b.first += in;
+    b.second += out;
+}
+
+void NodeService::updatePeerQuality(const ZT_PeerList* pl, int64_t now)
+{
+    Mutex::Lock _l(_peerQuality_m);
+    for (std::map<uint64_t, PeerQuality>::iterator q(_peerQuality.begin()); q != _peerQuality.end(); ++q) {
+        q->second.seen = false;
+    }
+    for (unsigned long i = 0; i < pl->peerCount; ++i) {
+        const ZT_Peer& peer = pl->peers[i];
+        bool isNew = ! _peerQuality.count(peer.address);
+        PeerQuality& pq = _peerQuality[peer.address];
+        if (isNew) {
+            memset(&pq.current, 0, sizeof(pq.current));
+            pq.current.peer_id = peer.address;
+            pq.current.probe_rtt = -1;
+            pq.current.probe_loss = -1.0f;
+            pq.everPublished = false;
+            pq.probeSeq = 0;
+            pq.probeOutstanding = false;
+            pq.everAnswered = false;
+            for (unsigned int j = 0; j < ZTS_MAX_PEER_NETWORK_PATHS; j++) {
+                pq.jitter[j] = -1.0f;
+            }
+        }
+        pq.seen = true;
+        pq.isLeaf = (peer.role == ZT_PEER_ROLE_LEAF);
+        zts_peer_quality_t& c = pq.current;
+        InetAddress prevAddrs[ZTS_MAX_PEER_NETWORK_PATHS];
+        float prevJitter[ZTS_MAX_PEER_NETWORK_PATHS];
+        int prevRtt[ZTS_MAX_PEER_NETWORK_PATHS];
+        unsigned int prevCount = c.path_count;
+        for (unsigned int j = 0; j < prevCount; j++) {
+            prevAddrs[j] = pq.pathAddrs[j];
+            prevJitter[j] = pq.jitter[j];
+            prevRtt[j] = c.paths[j].rtt;
+        }
+        c.path_count = peer.pathCount < ZTS_MAX_PEER_NETWORK_PATHS ? peer.pathCount : ZTS_MAX_PEER_NETWORK_PATHS;
+        c.relayed = (c.path_count == 0);
+        for (unsigned int j = 0; j < c.path_count; j++) {
+            const ZT_PeerPhysicalPath& pp = peer.paths[j];
+            zts_path_quality_t& p = c.paths[j];
+            InetAddress addr(pp.address);
+            pq.pathAddrs[j] = addr;
+            native_ss_to_zts_ss(&p.address, &pp.address);
+            p.rtt = (pp.latency >= 0) ? (int)pp.latency : -1;
+            p.last_rx_age = pp.lastReceive ? (now - (int64_t)pp.lastReceive) : -1;
+            p.preferred = pp.preferred;
+            // Jitter follows the path across reordering, and only moves when a new RTT is measured
+            pq.jitter[j] = -1.0f;
+            for (unsigned int k = 0; k < prevCount; k++) {
+                if (prevAddrs[k] == addr) {
+                    pq.jitter[j] = prevJitter[k];
+                    if (p.rtt >= 0 && prevRtt[k] >= 0 && p.rtt != prevRtt[k]) {
+                        float d = (float)abs(p.rtt - prevRtt[k]);
+                        pq.jitter[j] = (pq.jitter[j] < 0)
+                                           ? d
+                                           : pq.jitter[j] + ((d - pq.jitter[j]) * ZTS_PATH_QUALITY_SMOOTHING);
+                    }
+                    break;
+                }
+            }
+            p.jitter = (pq.jitter[j] < 0) ? -1 : (int)pq.jitter[j];
+            p.bytes_in = p.bytes_out = 0;
+            if (_pathMonitoring) {
+                Mutex::Lock _lb(_pathBytes_m);
+                std::map<InetAddress, std::pair<uint64_t, uint64_t> >::const_iterator b(_pathBytes.find(addr));
+                if (b != _pathBytes.end()) {
+                    p.bytes_in = b->second.first;
+                    p.bytes_out = b->second.second;
+                }
+            }
+        }
+        if (_pathMonitoring) {
+            // Report only changes that clear the hysteresis since the last report
+            const zts_peer_quality_t& last = pq.published;
+            int rtt = -1, lastRtt = -1;
+            const zts_sockaddr_storage* pref = NULL;
+            const zts_sockaddr_storage* lastPref = NULL;
+            for (unsigned int j = 0; j < c.path_count; j++) {
+                if (c.paths[j].preferred) {
+                    rtt = c.paths[j].rtt;
+                    pref = &c.paths[j].address;
+                }
+            }
+            for (unsigned int j = 0; pq.everPublished && j < last.path_count; j++) {
+                if (last.paths[j].preferred) {
+                    lastRtt = last.paths[j].rtt;
+                    lastPref = &last.paths[j].address;
+                }
+            }
+            int rttDelta = abs(rtt - lastRtt);
+            bool changed = ! pq.everPublished || c.relayed != last.relayed || c.path_count != last.path_count
+                           || (pref == NULL) != (lastPref == NULL)
+                           || (pref && memcmp(pref, lastPref, sizeof(*pref)) != 0)
+                           || ((rtt < 0) != (lastRtt < 0))
+                           || (rttDelta > ZTS_PATH_QUALITY_RTT_HYSTERESIS && rttDelta * 5 > lastRtt)
+                           || fabs(c.probe_loss - last.probe_loss) > ZTS_PATH_QUALITY_LOSS_HYSTERESIS;
+            if (changed) {
+                memcpy(&pq.published, &c, sizeof(c));
+                pq.everPublished = true;
+                sendEventToUser(ZTS_EVENT_PEER_PATH_QUALITY, (void*)&c);
+            }
+        }
+    }
+    for (std::map<uint64_t, PeerQuality>::iterator q(_peerQuality.begin()); q != _peerQuality.end();) {
+        if (! q->second.seen) {
+            _peerQuality.erase(q++);
+        }
+        else {
+            ++q;
+        }
+    }
+    if (_pathMonitoring) {
+        // Forget counters of addresses that are no longer a path to any peer
+        Mutex::Lock _lb(_pathBytes_m);
+        if (_pathBytes.size() > (_peerQuality.size() * ZTS_MAX_PEER_NETWORK_PATHS) + 64) {
+            std::map<InetAddress, std::pair<uint64_t, uint64_t> > live;
+            for (std::map<uint64_t, PeerQuality>::iterator q(_peerQuality.begin()); q != _peerQuality.end(); ++q) {
+                for (unsigned int j = 0; j < q->second.current.path_count; j++) {
+                    std::map<InetAddress, std::pair<uint64_t, uint64_t> >::iterator b(
+                        _pathBytes.find(q->second.pathAddrs[j]));
+                    if (b != _pathBytes.end()) {
+                        live.insert(*b);
+                    }
+                }
+            }
+            _pathBytes.swap(live);
+        }
+    }
+}
+
+void NodeService::processPathProbes(int64_t now)
+{
+    std::vector<std::pair<uint64_t, std::string> > replies;
+    {
+        Mutex::Lock _l(_pendingProbeReplies_m);
+        replies.swap(_pendingProbeReplies);
+    }
+    for (size_t i = 0; i < replies.size(); i++) {
+        _node->sendUserMessage(
+            (void*)0,
+            replies[i].first,
+            ZTS_PATH_PROBE_REPLY,
+            replies[i].second.data(),
+            (unsigned int)replies[i].second.length());
+    }
+    if (! _pathMonitoring || ! _pathProbeInterval || (now - _lastPathProbe) < (int64_t)_pathProbeInterval) {
+        return;
+    }
+    _lastPathProbe = now;
+    // Probe payload: sequence number and send time, echoed back unchanged
+    std::vector<std::pair<uint64_t, std::string> > probes;
+    {
+        Mutex::Lock _l(_peerQuality_m);
+        for (std::map<uint64_t, PeerQuality>::iterator q(_peerQuality.begin()); q != _peerQuality.end(); ++q) {
+            PeerQuality& pq = q->second;
+            if (! pq.isLeaf) {
+                continue;
+            }
+            if (pq.probeOutstanding && pq.everAnswered) {
+                // The previous probe went unanswered for a whole interval
+                pq.current.probe_loss += (1.0f - pq.current.probe_loss) * ZTS_PATH_QUALITY_SMOOTHING;
+            }
+            pq.probeSeq = ++_pathProbeSeq;
+            pq.probeOutstanding = true;
+            char payload[16];
+            for (int b = 0; b < 8; b++) {
+                payload[b] = (char)(pq.probeSeq >> (56 - (8 * b)));
+                payload[8 + b] = (char)((uint64_t)now >> (56 - (8 * b)));
+            }
+            probes.push_back(std::pair<uint64_t, std::string>(q->first, std::string(payload, sizeof(payload))));
+        }
+    }
+    for (size_t i = 0; i < probes.size(); i++) {
+        _node->sendUserMessage(
+            (void*)0,
+            probes[i].first,
+            ZTS_PATH_PROBE_REQUEST,
+            probes[i].second.data(),
+            (unsigned int)probes[i].second.length());
+    }
+}
+
+void NodeService::onPathProbeReply(uint64_t peerId, const void* data, unsigned int len, int64_t now)
+{
+    if (len != 16) {
+        return;
+    }
+    const unsigned char* b = (const unsigned char*)data;
+    uint64_t seq = 0;
+    uint64_t sentAt = 0;
+    for (int i = 0; i < 8; i++) {
+        seq = (seq << 8) | b[i];
+        sentAt = (sentAt << 8) | b[8 + i];
+    }
+    Mutex::Lock _l(_peerQuality_m);
+    std::map<uint64_t, PeerQuality>::iterator q(_peerQuality.find(peerId));
+    if (q == _peerQuality.end() || ! q->second.probeOutstanding || q->second.probeSeq != seq) {
+        return;
+    }
+    PeerQuality& pq = q->second;
+    pq.probeOutstanding = false;
+    pq.current.probe_rtt = (int)(now - (int64_t)sentAt);
+    if (! pq.everAnswered) {
+        pq.everAnswered = true;
+        pq.current.probe_loss = 0.0f;
+    }
+    else {
+        pq.current.probe_loss -= pq.current.probe_loss * ZTS_PATH_QUALITY_SMOOTHING;
+    }
+}
+
+void NodeService::publishSnapshot()
+{
+    if (! _snapshots || ! _snapshotStale) {
+        return;
+    }
+    _snapshotStale = false;
+    std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+    {
+        Mutex::Lock _l(_nets_m);
+        snapshot->nets.resize(_nets.size());
+        unsigned int i = 0;
+        for (std::map<uint64_t, NetworkState>::const_iterator n(_nets.begin()); n != _nets.end(); ++n) {
+            prepare_network_details_msg(n->second, &snapshot->nets[i++]);
+        }
+    }
+    snapshot->peers = _snapshotPeers;
+    snapshot->view.node_id = _nodeId;
+    snapshot->view.online = _nodeIsOnline;
+    _snapshots->publish(snapshot);
+}
+
 int NodeService::join(uint64_t net_id)
 {
     if (! net_id) {
@@ -970,7 +1426,7 @@ bool NodeService::networkIsReady(uint64_t net_id) const
     if (n == _nets.end()) {
         return false;
     }
-    auto netState = n->second;
+    const NetworkState& netState = n->second;
     return netState.config.assignedAddressCount > 0;
 }
 
@@ -1012,7 +1468,7 @@ int NodeService::getAddrAtIdx(uint64_t net_id, unsigned int idx, char* dst, unsi
     if (n == _nets.end()) {
         return 0;
     }
-    auto netState = n->second;
+    const NetworkState& netState = n->second;
     if (idx >= netState.config.assignedAddressCount) {
         return ZTS_ERR_ARG;
     }
@@ -1045,7 +1501,7 @@ int NodeService::getRouteAtIdx(
     if (n == _nets.end()) {
         return 0;
     }
-    auto netState = n->second;
+    const NetworkState& netState = n->second;
     if (idx >= netState.config.routeCount) {
         return ZTS_ERR_ARG;
     }
@@ -1085,7 +1541,7 @@ int NodeService::getMulticastSubAtIdx(uint64_t net_id, unsigned int idx, uint64_
     if (n == _nets.end()) {
         return 0;
     }
-    auto netState = n->second;
+    const NetworkState& netState = n->second;
     if (idx >= netState.config.multicastSubscriptionCount) {
         return ZTS_ERR_ARG;
     }
@@ -1109,7 +1565,7 @@ int NodeService::getFirstAssignedAddr(uint64_t net_id, unsigned int family, stru
     if (n == _nets.end()) {
         return ZTS_ERR_NO_RESULT;
     }
-    auto netState = n->second;
+    const NetworkState& netState = n->second;
     if (netState.config.assignedAddressCount == 0) {
         return ZTS_ERR_NO_RESULT;
     }
@@ -1139,7 +1595,7 @@ int NodeService::getAllAssignedAddr(uint64_t net_id, struct zts_sockaddr_storage
         return ZTS_ERR_NO_RESULT;
     }
     memset(addr, 0, sizeof(struct zts_sockaddr_storage) * ZTS_MAX_ASSIGNED_ADDRESSES);
-    auto netState = n->second;
+    const NetworkState& netState = n->second;
     if (netState.config.assignedAddressCount == 0) {
         return ZTS_ERR_NO_RESULT;
     }
@@ -1166,7 +1622,7 @@ int NodeService::networkHasRoute(uint64_t net_id, unsigned int family)
     if (n == _nets.end()) {
         return ZTS_ERR_NO_RESULT;
     }
-    auto netState = n->second;
+    const NetworkState& netState = n->second;
     for (unsigned int i = 0; i < netState.config.routeCount; i++) {
         struct sockaddr* sa = (struct sockaddr*)&(netState.config.routes[i].target);
         if (sa->sa_family == AF_INET && family == ZTS_AF_INET) {
@@ -1262,6 +1718,11 @@ void NodeService::nodeStatePutFunction(
 
     Mutex::Lock _ls(_store_m);
 
+    if ((type == ZT_STATE_OBJECT_NETWORK_CONFIG && _allowNetworkCaching)
+        || (type == ZT_STATE_OBJECT_PEER && _allowPeerCaching)) {
+        cacheStateObject(type, id[0], data, len);
+    }
+
     switch (type) {
         case ZT_STATE_OBJECT_IDENTITY_PUBLIC:
             sendEventToUser(ZTS_EVENT_STORE_IDENTITY_PUBLIC, data, len);
@@ -1286,7 +1747,10 @@ void NodeService::nodeStatePutFunction(
             break;
         case ZT_STATE_OBJECT_PLANET:
             sendEventToUser(ZTS_EVENT_STORE_PLANET, data, len);
-            memcpy(_rootsData, data, len);
+            if (len <= ZTS_STORE_DATA_LEN) {
+                memcpy(_rootsData, data, len);
+                _rootsDataLen = len;
+            }
             if (_homePath.length() > 0 && _allowRootSetCaching) {
                 OSUtils::ztsnprintf(p, sizeof(p), "%s" ZT_PATH_SEPARATOR_S "roots", _homePath.c_str());
             }
@@ -1408,6 +1872,9 @@ int NodeService::nodeStateGetFunction(
             OSUtils::ztsnprintf(p, sizeof(p), "%s" ZT_PATH_SEPARATOR_S "roots", _homePath.c_str());
             break;
         case ZT_STATE_OBJECT_NETWORK_CONFIG:
+            if (_allowNetworkCaching && (keylen = getCachedStateObject(_cachedNetworks, id[0], data, maxlen)) > 0) {
+                return keylen;
+            }
             OSUtils::ztsnprintf(
                 p,
                 sizeof(p),
@@ -1416,6 +1883,9 @@ int NodeService::nodeStateGetFunction(
                 (unsigned long long)id[0]);
             break;
         case ZT_STATE_OBJECT_PEER:
+            if (_allowPeerCaching && (keylen = getCachedStateObject(_cachedPeers, id[0], data, maxlen)) > 0) {
+                return keylen;
+            }
             OSUtils::ztsnprintf(
                 p,
                 sizeof(p),
@@ -1448,6 +1918,10 @@ int NodeService::nodeWirePacketSendFunction(
     // working we can instantly "fail forward" to it and stop using TCP
     // proxy fallback, which is slow.
 
+    if (_pathMonitoring) {
+        countPathBytes(*reinterpret_cast<const InetAddress*>(addr), 0, len);
+    }
+
     if ((localSocket != -1) && (localSocket != 0) && (_binder.isUdpSocketValid((PhySocket*)((uintptr_t)localSocket)))) {
         if ((ttl) && (addr->ss_family == AF_INET))
             _phy.setIp4UdpTtl((PhySocket*)((uintptr_t)localSocket), ttl);
@@ -1695,6 +2169,105 @@ int NodeService::_trialBind(unsigned int port)
     return false;
 }
 
+unsigned int NodeService::_osSelectPort()
+{
+    struct sockaddr_in in4;
+    socklen_t len = sizeof(in4);
+    unsigned int port = 0;
+    memset(&in4, 0, sizeof(in4));
+    in4.sin_family = AF_INET;
+#if defined(__WINDOWS__)
+    SOCKET s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCKET) {
+        return 0;
+    }
+#else
+    int s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s < 0) {
+        return 0;
+    }
+#endif
+    if (::bind(s, reinterpret_cast<const struct sockaddr*>(&in4), sizeof(in4)) == 0
+        && ::getsockname(s, reinterpret_cast<struct sockaddr*>(&in4), &len) == 0) {
+        port = Utils::ntoh((uint16_t)in4.sin_port);
+    }
+#if defined(__WINDOWS__)
+    ::closesocket(s);
+#else
+    ::close(s);
+#endif
+    return port;
+}
+
+bool NodeService::acquireAuxiliaryPorts()
+{
+    unsigned int minPort = (_randomPortRangeStart ? _randomPortRangeStart : 20000);
+    unsigned int maxPort = (_randomPortRangeEnd ? _randomPortRangeEnd : 45500);
+
+    // Attempt to bind to a secondary port chosen from our ZeroTier
+    // address. This exists because there are buggy NATs out there that
+    // fail if more than one device behind the same NAT tries to use the
+    // same internal private address port number. Buggy NATs are a
+    // running theme.
+    if (_ports[1] == 0 && _auxPortTrials <= ZTS_AUX_PORT_MAX_TRIALS) {
+        if (_auxPortCandidate == 0) {
+            _auxPortCandidate = (_secondaryPort == 0)
+                                    ? (((unsigned int)_node->address() % (maxPort - minPort + 1)) + minPort)
+                                    : _secondaryPort;
+        }
+        for (int k = 0; k < ZTS_AUX_PORT_TRIALS_PER_TASK; ++k) {
+            if (++_auxPortTrials > ZTS_AUX_PORT_MAX_TRIALS) {
+                break;
+            }
+            if (++_auxPortCandidate >= maxPort) {
+                _auxPortCandidate = minPort;
+            }
+            if (_trialBind(_auxPortCandidate)) {
+                _ports[1] = _secondaryPort = _auxPortCandidate;
+                break;
+            }
+        }
+        if (_ports[1] == 0 && _auxPortTrials <= ZTS_AUX_PORT_MAX_TRIALS) {
+            return false;
+        }
+        _auxPortCandidate = 0;
+        _auxPortTrials = 0;
+    }
+#ifdef ZT_USE_MINIUPNPC
+    if (_allowPortMapping && _ports[1] && ! _ports[2] && _auxPortTrials <= ZTS_AUX_PORT_MAX_TRIALS) {
+        // If we're running uPnP/NAT-PMP, bind a *third* port for that.
+        // We can't use the other two ports for that because some NATs
+        // do really funky stuff with ports that are explicitly mapped
+        // that breaks things.
+        maxPort = (_randomPortRangeEnd ? _randomPortRangeEnd : 65536);
+        if (_auxPortCandidate == 0) {
+            _auxPortCandidate = (_tertiaryPort == 0) ? _ports[1] : _tertiaryPort;
+        }
+        for (int k = 0; k < ZTS_AUX_PORT_TRIALS_PER_TASK; ++k) {
+            if (++_auxPortTrials > ZTS_AUX_PORT_MAX_TRIALS) {
+                break;
+            }
+            if (++_auxPortCandidate >= maxPort) {
+                _auxPortCandidate = minPort;
+            }
+            if (_trialBind(_auxPortCandidate)) {
+                _ports[2] = _tertiaryPort = _auxPortCandidate;
+                break;
+            }
+        }
+        if (_ports[2] == 0 && _auxPortTrials <= ZTS_AUX_PORT_MAX_TRIALS) {
+            return false;
+        }
+        if (_ports[2] && ! _portMapper) {
+            char uniqueName[64] = { 0 };
+            OSUtils::ztsnprintf(uniqueName, sizeof(uniqueName), "ZeroTier/%.10llx@%u", _node->address(), _ports[2]);
+            _portMapper = new PortMapper(_ports[2], uniqueName);
+        }
+    }
+#endif
+    return true;
+}
+
 int NodeService::isRunning() const
 {
     return _run;
@@ -1754,6 +2327,21 @@ int NodeService::allowPortMapping(unsigned int allowed)
     return ZTS_ERR_OK;
 }
 
+int NodeService::setCallerDriven(unsigned int enabled)
+{
+    Mutex::Lock _lr(_run_m);
+    if (_run) {
+        return ZTS_ERR_SERVICE;
+    }
+    _callerDriven = enabled;
+    return ZTS_ERR_OK;
+}
+
+bool NodeService::isCallerDriven() const
+{
+    return _callerDriven;
+}
+
 int NodeService::allowSecondaryPort(unsigned int allowed)
 {
     Mutex::Lock _lr(_run_m);
@@ -1764,6 +2352,26 @@ int NodeService::allowSecondaryPort(unsigned int allowed)
     return ZTS_ERR_OK;
 }
 
+int NodeService::allowOsPortSelection(unsigned int allowed)
+{
+    Mutex::Lock _lr(_run_m);
+    if (_run) {
+        return ZTS_ERR_SERVICE;
+    }
+    _allowOsPortSelection = allowed;
+    return ZTS_ERR_OK;
+}
+
+int NodeService::setSnapshotPublisher(SnapshotPublisher* snapshots)
+{
+    Mutex::Lock _lr(_run_m);
+    if (_run) {
+        return ZTS_ERR_SERVICE;
+    }
+    _snapshots = snapshots;
+    return ZTS_ERR_OK;
+}
+
 int NodeService::setUserEventSystem(Events* events)
 {
     Mutex::Lock _lr(_run_m);
@@ -1799,6 +2407,282 @@ int NodeService::setRoots(const void* rootsData, unsigned int len)
     return ZTS_ERR_OK;
 }
 
+void NodeService::cacheStateObject(enum ZT_StateObjectType type, uint64_t id, const void* data, unsigned int len)
+{
+    std::map<uint64_t, CachedStateObject>& cache = (type == ZT_STATE_OBJECT_PEER) ? _cachedPeers : _cachedNetworks;
+    if (! data) {
+        cache.erase(id);
+        return;
+    }
+    CachedStateObject& c = cache[id];
+    c.lastPut = OSUtils::now();
+    c.data.assign((const char*)data, len);
+    if (type == ZT_STATE_OBJECT_PEER && _cachedPeers.size() > ZTS_STATE_CACHE_MAX_PEERS) {
+        std::map<uint64_t, CachedStateObject>::iterator oldest = _cachedPeers.begin();
+        for (std::map<uint64_t, CachedStateObject>::iterator p(_cachedPeers.begin()); p != _cachedPeers.end(); ++p) {
+            if (p->second.lastPut < oldest->second.lastPut) {
+                oldest = p;
+            }
+        }
+        _cachedPeers.erase(oldest);
+    }
+}
+
+unsigned int NodeService::getCachedStateObject(
+    const std::map<uint64_t, CachedStateObject>& cache,
+    uint64_t id,
+    void* data,
+    unsigned int maxlen)
+{
+    Mutex::Lock _ls(_store_m);
+    std::map<uint64_t, CachedStateObject>::const_iterator c(cache.find(id));
+    if (c == cache.end() || c->second.data.empty() || c->second.data.length() > maxlen) {
+        return 0;
+    }
+    memcpy(data, c->second.data.data(), c->second.data.length());
+    return (unsigned int)c->second.data.length();
+}
+
+/*
+ * State blob layout, all integers big-endian:
+ *
+ *   "ZTS" version(1) count(4) then count records of
+ *   type(1) id(8) lastPut(8) len(4) data(len)
+ *
+ * The type is a ZT_StateObjectType. The identity record holds the secret
+ * key-pair string, the others hold objects exactly as the core stored them.
+ */
+#define ZTS_STATE_BLOB_VERSION     1
+#define ZTS_STATE_BLOB_HEADER_LEN  8
+#define ZTS_STATE_BLOB_RECORD_LEN  21
+
+static void _appendStateRecord(
+    std::string& b,
+    unsigned int type,
+    uint64_t id,
+    int64_t ts,
+    const char* data,
+    unsigned int len)
+{
+    char h[ZTS_STATE_BLOB_RECORD_LEN];
+    h[0] = (char)type;
+    for (int i = 0; i < 8; i++) {
+        h[1 + i] = (char)(id >> (56 - (8 * i)));
+        h[9 + i] = (char)((uint64_t)ts >> (56 - (8 * i)));
+    }
+    for (int i = 0; i < 4; i++) {
+        h[17 + i] = (char)(len >> (24 - (8 * i)));
+    }
+    b.append(h, sizeof(h));
+    b.append(data, len);
+}
+
+static uint64_t _readStateInt(const unsigned char* p, unsigned int bytes)
+{
+    uint64_t v = 0;
+    for (unsigned int i = 0; i < bytes; i++) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static bool _newerCachedObject(const std::pair<uint64_t, int64_t>& a, const std::pair<uint64_t, int64_t>& b)
+{
+    return a.second > b.second;
+}
+
+int NodeService::exportState(void* buf, unsigned int* len)
+{
+    if (! buf || ! len) {
+        return ZTS_ERR_ARG;
+    }
+    if (! _node) {
+        return ZTS_ERR_SERVICE;
+    }
+    char id[ZT_IDENTITY_STRING_BUFFER_LENGTH] = { 0 };
+    _node->identity().toString(true, id);
+    std::string b("ZTS");
+    b.push_back((char)ZTS_STATE_BLOB_VERSION);
+    b.append(4, 0);
+    unsigned int count = 0;
+    _appendStateRecord(b, ZT_STATE_OBJECT_IDENTITY_SECRET, 0, 0, id, strlen(id));
+    count++;
+    memset(id, 0, sizeof(id));
+    {
+        Mutex::Lock _ls(_store_m);
+        if (_rootsDataLen > 0) {
+            _appendStateRecord(b, ZT_STATE_OBJECT_PLANET, 0, 0, _rootsData, _rootsDataLen);
+            count++;
+        }
+        // Network configs and peers are left out unless the application allows caching them
+        for (std::map<uint64_t, CachedStateObject>::iterator c(_cachedNetworks.begin());
+             _allowNetworkCaching && c != _cachedNetworks.end();
+             ++c) {
+            _appendStateRecord(
+                b,
+                ZT_STATE_OBJECT_NETWORK_CONFIG,
+                c->first,
+                c->second.lastPut,
+                c->second.data.data(),
+                c->second.data.length());
+            count++;
+        }
+        // Only the peers most recently stored by the core, which saves them as they are heard from
+        std::vector<std::pair<uint64_t, int64_t> > recent;
+        for (std::map<uint64_t, CachedStateObject>::iterator c(_cachedPeers.begin());
+             _allowPeerCaching && c != _cachedPeers.end();
+             ++c) {
+            recent.push_back(std::pair<uint64_t, int64_t>(c->first, c->second.lastPut));
+        }
+        std::sort(recent.begin(), recent.end(), _newerCachedObject);
+        for (size_t i = 0; i < recent.size() && i < ZTS_STATE_EXPORT_MAX_PEERS; i++) {
+            const CachedStateObject& c = _cachedPeers[recent[i].first];
+            _appendStateRecord(b, ZT_STATE_OBJECT_PEER, recent[i].first, c.lastPut, c.data.data(), c.data.length());
+            count++;
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        b[4 + i] = (char)(count >> (24 - (8 * i)));
+    }
+    int err = ZTS_ERR_OK;
+    if (b.length() > *len) {
+        err = ZTS_ERR_ARG;
+    }
+    else {
+        memcpy(buf, b.data(), b.length());
+    }
+    *len = (unsigned int)b.length();
+    std::fill(b.begin(), b.end(), 0);
+    return err;
+}
+
+int NodeService::importState(const void* buf, unsigned int len)
+{
+    const unsigned char* b = (const unsigned char*)buf;
+    if (! b || len < ZTS_STATE_BLOB_HEADER_LEN || memcmp(b, "ZTS", 3) != 0 || b[3] != ZTS_STATE_BLOB_VERSION) {
+        return ZTS_ERR_ARG;
+    }
+    Mutex::Lock _lr(_run_m);
+    if (_run) {
+        return ZTS_ERR_SERVICE;
+    }
+    // Check every record before applying any of them
+    unsigned int count = (unsigned int)_readStateInt(b + 4, 4);
+    const unsigned char* p = b + ZTS_STATE_BLOB_HEADER_LEN;
+    const unsigned char* end = b + len;
+    const unsigned char* idStr = NULL;
+    unsigned int idLen = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        if ((size_t)(end - p) < ZTS_STATE_BLOB_RECORD_LEN) {
+            return ZTS_ERR_ARG;
+        }
+        unsigned int olen = (unsigned int)_readStateInt(p + 17, 4);
+        if ((size_t)(end - p) - ZTS_STATE_BLOB_RECORD_LEN < olen) {
+            return ZTS_ERR_ARG;
+        }
+        if (p[0] == ZT_STATE_OBJECT_IDENTITY_SECRET) {
+            idStr = p + ZTS_STATE_BLOB_RECORD_LEN;
+            idLen = olen;
+        }
+        else if (p[0] == ZT_STATE_OBJECT_PLANET && olen > ZTS_STORE_DATA_LEN) {
+            return ZTS_ERR_ARG;
+        }
+        p += ZTS_STATE_BLOB_RECORD_LEN + olen;
+    }
+    if (! idStr || idLen == 0 || idLen >= ZT_IDENTITY_STRING_BUFFER_LENGTH) {
+        return ZTS_ERR_ARG;
+    }
+    char idtmp[ZT_IDENTITY_STRING_BUFFER_LENGTH] = { 0 };
+    memcpy(idtmp, idStr, idLen);
+    Identity id;
+    if (! id.fromString(idtmp) || ! id.hasPrivate() || ! id.locallyValidate()) {
+        memset(idtmp, 0, sizeof(idtmp));
+        return ZTS_ERR_ARG;
+    }
+    Mutex::Lock _ls(_store_m);
+    memcpy(_secretIdStr, idtmp, sizeof(idtmp));
+    memset(idtmp, 0, sizeof(idtmp));
+    _cachedNetworks.clear();
+    _cachedPeers.clear();
+    p = b + ZTS_STATE_BLOB_HEADER_LEN;
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned int olen = (unsigned int)_readStateInt(p + 17, 4);
+        const char* data = (const char*)(p + ZTS_STATE_BLOB_RECORD_LEN);
+        if (p[0] == ZT_STATE_OBJECT_PLANET) {
+            memcpy(_rootsData, data, olen);
+            _rootsDataLen = olen;
+            _userDefinedWorld = true;
+        }
+        else if (p[0] == ZT_STATE_OBJECT_NETWORK_CONFIG || p[0] == ZT_STATE_OBJECT_PEER) {
+            std::map<uint64_t, CachedStateObject>& cache =
+                (p[0] == ZT_STATE_OBJECT_PEER) ? _cachedPeers : _cachedNetworks;
+            CachedStateObject& c = cache[_readStateInt(p + 1, 8)];
+            c.lastPut = (int64_t)_readStateInt(p + 9, 8);
+            c.data.assign(data, olen);
+        }
+        p += ZTS_STATE_BLOB_RECORD_LEN + olen;
+    }
+    return ZTS_ERR_OK;
+}
+
+int NodeService::setPathMonitoring(unsigned int enabled, unsigned int probeInterval)
+{
+    Mutex::Lock _lr(_run_m);
+    if (_run) {
+        return ZTS_ERR_SERVICE;
+    }
+    _pathMonitoring = enabled;
+    _pathProbeInterval = probeInterval;
+    return ZTS_ERR_OK;
+}
+
+int NodeService::getPeerQuality(uint64_t peerId, zts_peer_quality_t* quality)
+{
+    if (! quality) {
+        return ZTS_ERR_ARG;
+    }
+    Mutex::Lock _l(_peerQuality_m);
+    std::map<uint64_t, PeerQuality>::const_iterator q(_peerQuality.find(peerId));
+    if (q == _peerQuality.end()) {
+        return ZTS_ERR_NO_RESULT;
+    }
+    memcpy(quality, &q->second.current, sizeof(zts_peer_quality_t));
+    return ZTS_ERR_OK;
+}
+
+int NodeService::setTso(unsigned int enabled)
+{
+    Mutex::Lock _lr(_run_m);
+    if (_run) {
+        return ZTS_ERR_SERVICE;
+    }
+    _tso = enabled;
+    return ZTS_ERR_OK;
+}
+
+int NodeService::setGro(unsigned int enabled)
+{
+    Mutex::Lock _lr(_run_m);
+    if (_run) {
+        return ZTS_ERR_SERVICE;
+    }
+    _gro = enabled;
+    return ZTS_ERR_OK;
+}
+
+int NodeService::getGroStats(uint64_t* segments, uint64_t* packets)
+{
+    Mutex::Lock _ln(_nets_m);
+    *segments = _groSegments;
+    *packets = _groPackets;
+    for (std::map<uint64_t, NetworkState>::const_iterator n(_nets.begin()); n != _nets.end(); ++n) {
+        if (n->second.tap) {
+            zts_lwip_gro_stats(n->second.tap, segments, packets);
+        }
+    }
+    return ZTS_ERR_OK;
+}
+
 int NodeService::addInterfacePrefixToBlacklist(const char* prefix, unsigned int len)
 {
     if (! prefix || len == 0 || len > 15) {
@@ -1847,7 +2731,7 @@ int NodeService::getNetworkName(uint64_t net_id, char* dst, unsigned int len) co
     if (n == _nets.end()) {
         return ZTS_ERR_NO_RESULT;
     }
-    auto netState = n->second;
+    const NetworkState& netState = n->second;
     strncpy(dst, netState.config.name, ZTS_MAX_NETWORK_SHORT_NAME_LENGTH);
     return ZTS_ERR_OK;
 }
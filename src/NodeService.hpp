@@ -23,12 +23,14 @@
 #define ZTS_UNUSED_ARG(x) (void)x
 
 #include "Binder.hpp"
+#include "InetAddress.hpp"
 #include "Mutex.hpp"
 #include "Node.hpp"
 #include "Phy.hpp"
 #include "PortMapper.hpp"
 #include "ZeroTierSockets.h"
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -42,6 +44,20 @@
 #define ZT_TAP_CHECK_MULTICAST_INTERVAL 5000
 // How often to check for local interface addresses
 #define ZT_LOCAL_INTERFACE_CHECK_INTERVAL 60000
+// How long after starting the secondary and port-mapping ports are acquired if the node is not yet online
+#define ZTS_AUX_PORT_DELAY 5000
+// Candidate secondary or port-mapping ports tried per background task, and in total for each
+#define ZTS_AUX_PORT_TRIALS_PER_TASK 32
+#define ZTS_AUX_PORT_MAX_TRIALS      1000
+// Most recently stored peers included in an exported state blob
+#define ZTS_STATE_EXPORT_MAX_PEERS 128
+// Peers kept in memory for export before the least recently stored are dropped
+#define ZTS_STATE_CACHE_MAX_PEERS 1024
+// ZeroTier user message types of path probes and their answers
+#define ZTS_PATH_PROBE_REQUEST 0x7a74737072620001ULL
+#define ZTS_PATH_PROBE_REPLY   0x7a74737072620002ULL
+// Weight of each new sample in smoothed jitter and probe loss
+#define ZTS_PATH_QUALITY_SMOOTHING 0.125f
 
 #ifdef __WINDOWS__
 #include <Windows.h>
@@ -53,6 +69,7 @@ struct InetAddress;
 class VirtualTap;
 class MAC;
 class Events;
+class SnapshotPublisher;
 
 /**
  * ZeroTier node service
@@ -167,6 +184,15 @@ class NodeService {
     // Deadline for the next background task service function
     volatile int64_t _nextBackgroundTaskDeadline;
 
+    // When the main loop expects to run next, used to detect sleep/wake
+    int64_t _clockShouldBe;
+
+    // Last time each of the periodic main loop tasks ran
+    int64_t _lastTapMulticastGroupCheck;
+    int64_t _lastBindRefresh;
+    int64_t _lastCleanedPeersDb;
+    int64_t _lastLocalInterfaceAddressCheck;
+
     // Configured networks
     struct NetworkState {
         NetworkState() : tap((VirtualTap*)0)
@@ -207,6 +233,64 @@ class NodeService {
 #endif
     bool _allowSecondaryPort;
 
+    /** Whether the OS may pick the primary port when none was set */
+    bool _allowOsPortSelection;
+
+    /** Path telemetry of each known peer */
+    struct PeerQuality {
+        zts_peer_quality_t current;
+        // Last state reported through ZTS_EVENT_PEER_PATH_QUALITY
+        zts_peer_quality_t published;
+        bool everPublished;
+        InetAddress pathAddrs[ZTS_MAX_PEER_NETWORK_PATHS];
+        float jitter[ZTS_MAX_PEER_NETWORK_PATHS];
+        bool isLeaf;
+        bool seen;
+        // Probe awaiting an answer
+        uint64_t probeSeq;
+        bool probeOutstanding;
+        bool everAnswered;
+    };
+    std::map<uint64_t, PeerQuality> _peerQuality;
+    Mutex _peerQuality_m;
+
+    /** Bytes received from and sent to each remote physical address while monitoring */
+    std::map<InetAddress, std::pair<uint64_t, uint64_t> > _pathBytes;
+    Mutex _pathBytes_m;
+    bool _pathMonitoring;
+    unsigned int _pathProbeInterval;
+    int64_t _lastPathProbe;
+    uint64_t _pathProbeSeq;
+
+    /** Probe requests received from peers, answered outside of the core's callbacks */
+    std::vector<std::pair<uint64_t, std::string> > _pendingProbeReplies;
+    Mutex _pendingProbeReplies_m;
+
+    /** Progress of the background hunt for the secondary and port-mapping ports */
+    bool _auxPortsPending;
+    unsigned int _auxPortCandidate;
+    unsigned int _auxPortTrials;
+
+    /** Whether the application drives the service with process() instead of run() */
+    bool _callerDriven;
+
+    /** Whether taps are created with virtual TSO */
+    bool _tso;
+
+    /** Whether taps are created with receive coalescing */
+    bool _gro;
+
+    /** Receive coalescing counters of the taps of networks already left, guarded by _nets_m */
+    uint64_t _groSegments;
+    uint64_t _groPackets;
+
+    /**
+     * Descriptors of the UDP sockets the binder holds, in caller-driven mode. Rebuilt after each
+     * binder refresh so a reactor polls them before any traffic has arrived
+     */
+    std::vector<int> _pollableFds;
+    Mutex _pollableFds_m;
+
     uint8_t _allowNetworkCaching;
     uint8_t _allowPeerCaching;
     uint8_t _allowIdentityCaching;
@@ -219,6 +303,25 @@ class NodeService {
     char _rootsData[ZTS_STORE_DATA_LEN] = { 0 };
     int _rootsDataLen = 0;
 
+    /** A state object as last stored by the core or loaded from an imported blob */
+    struct CachedStateObject {
+        int64_t lastPut;
+        std::string data;
+    };
+    /** Network configs and peers kept in memory for export and warm start. Guarded by _store_m */
+    std::map<uint64_t, CachedStateObject> _cachedNetworks;
+    std::map<uint64_t, CachedStateObject> _cachedPeers;
+
+    /** Record or forget a network config or peer stored by the core. Caller holds _store_m */
+    void cacheStateObject(enum ZT_StateObjectType type, uint64_t id, const void* data, unsigned int len);
+
+    /** Copy a cached object into data, returns its length or 0 if it is not cached */
+    unsigned int getCachedStateObject(
+        const std::map<uint64_t, CachedStateObject>& cache,
+        uint64_t id,
+        void* data,
+        unsigned int maxlen);
+
     /** Whether the node has successfully come online */
     bool _nodeIsOnline;
 
@@ -231,12 +334,53 @@ class NodeService {
     /** System to ingest events from this class and emit them to the user */
     Events* _events;
 
+    /** Where state snapshots for the user are published */
+    SnapshotPublisher* _snapshots;
+
+    /** Whether state has changed since the last snapshot was published */
+    volatile bool _snapshotStale;
+
+    /** Peers as of the last change in the peer set or their path counts */
+    std::vector<zts_peer_info_t> _snapshotPeers;
+
     NodeService();
     ~NodeService();
 
     /** Main service loop */
     ReasonForTermination run();
 
+    /** Create the node and bind its ports. Returns false if the service cannot run */
+    bool start();
+
+    /** Perform any periodic work that is due. Returns the core's next background task deadline */
+    int64_t processBackgroundTasks(int64_t now);
+
+    /** Tear down networks and the node once the main loop has ended */
+    void finish();
+
+    /** Start the service without a main loop thread, see process() */
+    int startCallerDriven();
+
+    /**
+     * Wait up to `timeout_ms` for wire I/O and handle it, then perform any periodic work that is
+     * due. Returns false (after tearing down) once the service has stopped.
+     */
+    bool process(unsigned long timeout_ms);
+
+    /** Time (ms since epoch) by which process() should next be called */
+    int64_t nextDeadline() const;
+
+    /** Copy the OS descriptors of the bound UDP sockets ZeroTier receives on. Returns the count */
+    int getPollableFds(int* fds, unsigned int max);
+
+    /**
+     * Find the descriptors of the UDP sockets the binder holds. Binder does not expose its
+     * sockets, so they are matched by the local addresses it reports as bound
+     */
+    void refreshPollableFds();
+
+    void setFatalError(const std::string& msg);
+
     ReasonForTermination reasonForTermination() const;
 
     std::string fatalErrorMessage() const;
@@ -263,10 +407,15 @@ class NodeService {
 
     void nodeEventCallback(enum ZT_Event event, const void* metaData);
 
-    zts_net_info_t* prepare_network_details_msg(const NetworkState& n);
+    void prepare_network_details_msg(const NetworkState& n, zts_net_info_t* nd);
+
+    void prepare_peer_details_msg(const ZT_Peer* peer, zts_peer_info_t* pd);
 
     void generateSyntheticEvents();
 
+    /** Publish a new state snapshot if anything has changed since the last one */
+    void publishSnapshot();
+
     void sendEventToUser(unsigned int zt_event_code, const void* obj, unsigned int len = 0);
 
     /** Join a network */
@@ -364,6 +513,24 @@ class NodeService {
 
     int _trialBind(unsigned int port);
 
+    /** Bind to port 0 and return the port the OS assigned, or 0 */
+    unsigned int _osSelectPort();
+
+    /** Try a few more secondary and port-mapping port candidates, returns true once done */
+    bool acquireAuxiliaryPorts();
+
+    /** Refresh the telemetry of peers from the core's peer list and raise quality events */
+    void updatePeerQuality(const ZT_PeerList* pl, int64_t now);
+
+    /** Answer received probes and send due ones */
+    void processPathProbes(int64_t now);
+
+    /** Account for a probe answer from a peer */
+    void onPathProbeReply(uint64_t peerId, const void* data, unsigned int len, int64_t now);
+
+    /** Count wire bytes against a path while monitoring */
+    void countPathBytes(const InetAddress& addr, unsigned int in, unsigned int out);
+
     /** Return whether the NodeService is running */
     int isRunning() const;
 
@@ -388,14 +555,47 @@ class NodeService {
     /** Allow or disallow backup port */
     int allowSecondaryPort(unsigned int allowed);
 
+    /** Allow or disallow letting the OS pick the primary port */
+    int allowOsPortSelection(unsigned int allowed);
+
+    /** Have the application drive the service instead of internal threads */
+    int setCallerDriven(unsigned int enabled);
+
+    /** Return whether the application drives the service */
+    bool isCallerDriven() const;
+
     /** Set the event system instance used to convey messages to the user */
     int setUserEventSystem(Events* events);
 
+    /** Set where state snapshots are published for the user */
+    int setSnapshotPublisher(SnapshotPublisher* snapshots);
+
     void enableEvents();
 
     /** Set the roots definition */
     int setRoots(const void* data, unsigned int len);
 
+    /** Write identity, roots, network configs and recent peers into one blob */
+    int exportState(void* buf, unsigned int* len);
+
+    /** Load a blob written by exportState() to be used when the node starts */
+    int importState(const void* buf, unsigned int len);
+
+    /** Enable path monitoring and optionally probing */
+    int setPathMonitoring(unsigned int enabled, unsigned int probeInterval);
+
+    /** Get the path telemetry of a peer */
+    int getPeerQuality(uint64_t peerId, zts_peer_quality_t* quality);
+
+    /** Enable virtual TSO on the netifs of networks joined from now on */
+    int setTso(unsigned int enabled);
+
+    /** Enable receive coalescing on the netifs of networks joined from now on */
+    int setGro(unsigned int enabled);
+
+    /** Get the receive coalescing counters of all networks this node has joined since it started */
+    int getGroStats(uint64_t* segments, uint64_t* packets);
+
     /** Add Interface prefix to blacklist (prevents ZeroTier from using that interface) */
     int addInterfacePrefixToBlacklist(const char* prefix, unsigned int len);
 
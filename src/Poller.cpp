@@ -0,0 +1,416 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Scalable socket readiness notification
+ *
+ * lwIP reports every change in a socket's state through the callback stored in
+ * its netconn. Sockets registered with a poller have that callback wrapped so
+ * that, after lwIP has updated its own bookkeeping, the socket is queued on
+ * each interested poller. A wait therefore only inspects sockets that have
+ * actually seen activity instead of scanning every registered descriptor.
+ */
+
+#include "lwip/sockets.h"
+
+#include "Events.hpp"
+#include "ZeroTierSockets.h"
+#include "lwip/priv/sockets_priv.h"
+#include "lwip/tcpip.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string.h>
+#include <vector>
+
+#if ! defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace ZeroTier {
+
+struct zts_poller {
+    std::condition_variable cv;
+    // Events each descriptor is registered for, 0 if not registered
+    short interest[ZTS_FD_SETSIZE];
+    // Whether a descriptor is currently in the ready queue
+    bool queued[ZTS_FD_SETSIZE];
+    std::vector<int> ready;
+    bool woken;
+    int waiters;
+    int signal_pipe[2];
+    bool signalled;
+};
+
+// Guards all poller state
+static std::mutex pollers_m;
+static zts_poller* _pollers[ZTS_MAX_POLLERS];
+// Pollers each descriptor is registered with
+static std::vector<int> _fd_pollers[ZTS_FD_SETSIZE];
+// lwIP's own socket event callback, wrapped by zts_poller_event_callback
+static netconn_callback _lwip_event_callback = NULL;
+
+static bool zts_poller_valid_fd(int fd)
+{
+    return fd >= LWIP_SOCKET_OFFSET && fd < LWIP_SOCKET_OFFSET + ZTS_FD_SETSIZE;
+}
+
+/**
+ * Current readiness of a socket as tracked by lwIP's socket layer
+ */
+static short zts_poller_readiness(int fd)
+{
+    struct lwip_sock* sock = lwip_socket_dbg_get_socket(fd);
+    if (! sock || ! sock->conn) {
+        return ZTS_POLLNVAL;
+    }
+    short revents = 0;
+    SYS_ARCH_DECL_PROTECT(lev);
+    SYS_ARCH_PROTECT(lev);
+    if (sock->lastdata.pbuf != NULL || sock->rcvevent > 0) {
+        revents |= ZTS_POLLIN;
+    }
+    if (sock->sendevent != 0) {
+        revents |= ZTS_POLLOUT;
+    }
+    if (sock->errevent != 0) {
+        revents |= ZTS_POLLERR;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+    return revents;
+}
+
+/**
+ * Wake anyone waiting on the poller, whether in zts_poller_wait() or in an
+ * external event loop watching its OS descriptor. Caller holds pollers_m.
+ */
+static void zts_poller_signal(zts_poller* p)
+{
+    if (p->waiters > 0) {
+        p->cv.notify_all();
+    }
+#if ! defined(_WIN32)
+    if (! p->signalled && p->signal_pipe[1] >= 0) {
+        p->signalled = true;
+        char c = 0;
+        if (::write(p->signal_pipe[1], &c, 1) < 0) {
+            p->signalled = false;
+        }
+    }
+#endif
+}
+
+/**
+ * Queue a descriptor on a poller if it is ready for something the poller is
+ * interested in. Caller holds pollers_m.
+ */
+static void zts_poller_check(zts_poller* p, int fd, short revents)
+{
+    short interest = p->interest[fd - LWIP_SOCKET_OFFSET];
+    if (! interest || p->queued[fd - LWIP_SOCKET_OFFSET]) {
+        return;
+    }
+    if (revents & (interest | ZTS_POLLERR | ZTS_POLLNVAL)) {
+        p->queued[fd - LWIP_SOCKET_OFFSET] = true;
+        p->ready.push_back(fd);
+        zts_poller_signal(p);
+    }
+}
+
+static void zts_poller_event_callback(struct netconn* conn, enum netconn_evt evt, u16_t len)
+{
+    // Let lwIP update the socket's own counters first
+    if (_lwip_event_callback) {
+        _lwip_event_callback(conn, evt, len);
+    }
+    if (! conn || conn->socket < 0) {
+        return;
+    }
+    int fd = conn->socket + LWIP_SOCKET_OFFSET;
+    if (! zts_poller_valid_fd(fd)) {
+        return;
+    }
+    std::lock_guard<std::mutex> _l(pollers_m);
+    std::vector<int>& registered = _fd_pollers[fd - LWIP_SOCKET_OFFSET];
+    if (registered.empty()) {
+        return;
+    }
+    short revents = zts_poller_readiness(fd);
+    for (size_t i = 0; i < registered.size(); i++) {
+        zts_poller_check(_pollers[registered[i]], fd, revents);
+    }
+}
+
+/**
+ * Route the socket's netconn events through zts_poller_event_callback
+ */
+static int zts_poller_hook_socket(int fd)
+{
+    int err = ZTS_ERR_ARG;
+    LOCK_TCPIP_CORE();
+    struct lwip_sock* sock = lwip_socket_dbg_get_socket(fd);
+    if (sock && sock->conn) {
+        if (sock->conn->callback != zts_poller_event_callback) {
+            _lwip_event_callback = sock->conn->callback;
+            sock->conn->callback = zts_poller_event_callback;
+        }
+        err = ZTS_ERR_OK;
+    }
+    UNLOCK_TCPIP_CORE();
+    return err;
+}
+
+static void zts_poller_unregister(int pfd, int fd)
+{
+    zts_poller* p = _pollers[pfd];
+    p->interest[fd - LWIP_SOCKET_OFFSET] = 0;
+    std::vector<int>& registered = _fd_pollers[fd - LWIP_SOCKET_OFFSET];
+    for (size_t i = 0; i < registered.size(); i++) {
+        if (registered[i] == pfd) {
+            registered.erase(registered.begin() + i);
+            break;
+        }
+    }
+}
+
+/**
+ * Remove a socket from every poller. Called when the socket is closed since
+ * lwIP will reuse its descriptor.
+ */
+void zts_poller_forget(int fd)
+{
+    if (! zts_poller_valid_fd(fd)) {
+        return;
+    }
+    std::lock_guard<std::mutex> _l(pollers_m);
+    std::vector<int> registered;
+    registered.swap(_fd_pollers[fd - LWIP_SOCKET_OFFSET]);
+    for (size_t i = 0; i < registered.size(); i++) {
+        _pollers[registered[i]]->interest[fd - LWIP_SOCKET_OFFSET] = 0;
+    }
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int zts_poller_new()
+{
+    if (! transport_ok()) {
+        return ZTS_ERR_SERVICE;
+    }
+    std::lock_guard<std::mutex> _l(pollers_m);
+    for (int pfd = 0; pfd < ZTS_MAX_POLLERS; pfd++) {
+        if (_pollers[pfd]) {
+            continue;
+        }
+        zts_poller* p = new zts_poller();
+        memset(p->interest, 0, sizeof(p->interest));
+        memset(p->queued, 0, sizeof(p->queued));
+        p->woken = false;
+        p->waiters = 0;
+        p->signalled = false;
+        p->signal_pipe[0] = p->signal_pipe[1] = -1;
+#if ! defined(_WIN32)
+        if (::pipe(p->signal_pipe) == 0) {
+            ::fcntl(p->signal_pipe[0], F_SETFL, ::fcntl(p->signal_pipe[0], F_GETFL) | O_NONBLOCK);
+            ::fcntl(p->signal_pipe[1], F_SETFL, ::fcntl(p->signal_pipe[1], F_GETFL) | O_NONBLOCK);
+        }
+#endif
+        _pollers[pfd] = p;
+        return pfd;
+    }
+    return ZTS_ERR_NO_RESULT;
+}
+
+int zts_poller_free(int pfd)
+{
+    zts_poller* p = NULL;
+    {
+        std::lock_guard<std::mutex> _l(pollers_m);
+        if (pfd < 0 || pfd >= ZTS_MAX_POLLERS || ! _pollers[pfd]) {
+            return ZTS_ERR_ARG;
+        }
+        p = _pollers[pfd];
+        for (int fd = LWIP_SOCKET_OFFSET; fd < LWIP_SOCKET_OFFSET + ZTS_FD_SETSIZE; fd++) {
+            if (p->interest[fd - LWIP_SOCKET_OFFSET]) {
+                zts_poller_unregister(pfd, fd);
+            }
+        }
+        _pollers[pfd] = NULL;
+        p->woken = true;
+        p->cv.notify_all();
+    }
+    // Let any waiters observe that the poller is gone before freeing it
+    std::unique_lock<std::mutex> _l(pollers_m);
+    p->cv.wait(_l, [p] { return p->waiters == 0; });
+#if ! defined(_WIN32)
+    if (p->signal_pipe[0] >= 0) {
+        ::close(p->signal_pipe[0]);
+        ::close(p->signal_pipe[1]);
+    }
+#endif
+    delete p;
+    return ZTS_ERR_OK;
+}
+
+int zts_poller_set(int pfd, int fd, short events)
+{
+    if (! transport_ok()) {
+        return ZTS_ERR_SERVICE;
+    }
+    if (pfd < 0 || pfd >= ZTS_MAX_POLLERS || ! zts_poller_valid_fd(fd)) {
+        return ZTS_ERR_ARG;
+    }
+    events &= (ZTS_POLLIN | ZTS_POLLOUT);
+    if (! events) {
+        return zts_poller_remove(pfd, fd);
+    }
+    // Must not hold pollers_m here since lwIP may call back into us while we wait for the core lock
+    int err;
+    if ((err = zts_poller_hook_socket(fd)) != ZTS_ERR_OK) {
+        return err;
+    }
+    std::lock_guard<std::mutex> _l(pollers_m);
+    zts_poller* p = _pollers[pfd];
+    if (! p) {
+        return ZTS_ERR_ARG;
+    }
+    if (! p->interest[fd - LWIP_SOCKET_OFFSET]) {
+        _fd_pollers[fd - LWIP_SOCKET_OFFSET].push_back(pfd);
+    }
+    p->interest[fd - LWIP_SOCKET_OFFSET] = events;
+    // The socket may already be ready, in which case no further event would arrive
+    zts_poller_check(p, fd, zts_poller_readiness(fd));
+    return ZTS_ERR_OK;
+}
+
+int zts_poller_remove(int pfd, int fd)
+{
+    if (pfd < 0 || pfd >= ZTS_MAX_POLLERS || ! zts_poller_valid_fd(fd)) {
+        return ZTS_ERR_ARG;
+    }
+    std::lock_guard<std::mutex> _l(pollers_m);
+    if (! _pollers[pfd]) {
+        return ZTS_ERR_ARG;
+    }
+    zts_poller_unregister(pfd, fd);
+    return ZTS_ERR_OK;
+}
+
+int zts_poller_wait(int pfd, zts_poller_event_t* events, int max_events, int timeout_ms)
+{
+    if (pfd < 0 || pfd >= ZTS_MAX_POLLERS || ! events || max_events <= 0) {
+        return ZTS_ERR_ARG;
+    }
+    std::unique_lock<std::mutex> _l(pollers_m);
+    zts_poller* p = _pollers[pfd];
+    if (! p) {
+        return ZTS_ERR_ARG;
+    }
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms > 0 ? timeout_ms : 0);
+    int n = 0;
+    while (true) {
+#if ! defined(_WIN32)
+        if (p->signalled) {
+            char drain[64];
+            while (::read(p->signal_pipe[0], drain, sizeof(drain)) > 0) {
+            }
+            p->signalled = false;
+        }
+#endif
+        // Level-triggered: descriptors that are still ready stay queued, others are dropped
+        std::vector<int> still_ready;
+        size_t i = 0;
+        for (; i < p->ready.size() && n < max_events; i++) {
+            int fd = p->ready[i];
+            short interest = p->interest[fd - LWIP_SOCKET_OFFSET];
+            short revents = interest ? (zts_poller_readiness(fd) & (interest | ZTS_POLLERR | ZTS_POLLNVAL)) : 0;
+            if (revents) {
+                events[n].fd = fd;
+                events[n].revents = revents;
+                n++;
+                still_ready.push_back(fd);
+            }
+            else {
+                p->queued[fd - LWIP_SOCKET_OFFSET] = false;
+            }
+        }
+        // Unexamined descriptors go first next time so that no socket is starved
+        still_ready.insert(still_ready.begin(), p->ready.begin() + i, p->ready.end());
+        p->ready.swap(still_ready);
+        if (n > 0 || p->woken || timeout_ms == 0 || _pollers[pfd] != p) {
+            break;
+        }
+        p->waiters++;
+        if (timeout_ms < 0) {
+            p->cv.wait(_l);
+        }
+        else if (p->cv.wait_until(_l, deadline) == std::cv_status::timeout) {
+            timeout_ms = 0;   // One final pass over anything that arrived
+        }
+        p->waiters--;
+        if (_pollers[pfd] != p) {
+            p->cv.notify_all();   // zts_poller_free() may be waiting on us
+            return 0;
+        }
+    }
+    p->woken = false;
+    if (! p->ready.empty()) {
+        zts_poller_signal(p);   // Keep external event loops level-triggered as well
+    }
+    return n;
+}
+
+int zts_poller_wakeup(int pfd)
+{
+    if (pfd < 0 || pfd >= ZTS_MAX_POLLERS) {
+        return ZTS_ERR_ARG;
+    }
+    std::lock_guard<std::mutex> _l(pollers_m);
+    zts_poller* p = _pollers[pfd];
+    if (! p) {
+        return ZTS_ERR_ARG;
+    }
+    p->woken = true;
+    p->cv.notify_all();
+    zts_poller_signal(p);
+    return ZTS_ERR_OK;
+}
+
+int zts_poller_get_os_fd(int pfd)
+{
+    if (pfd < 0 || pfd >= ZTS_MAX_POLLERS) {
+        return ZTS_ERR_ARG;
+    }
+    std::lock_guard<std::mutex> _l(pollers_m);
+    zts_poller* p = _pollers[pfd];
+    if (! p) {
+        return ZTS_ERR_ARG;
+    }
+    if (p->signal_pipe[0] < 0) {
+        return ZTS_ERR_GENERAL;
+    }
+    return p->signal_pipe[0];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+}   // namespace ZeroTier
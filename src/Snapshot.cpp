@@ -0,0 +1,68 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Immutable snapshots of node, network and peer state
+ */
+
+#include "Snapshot.hpp"
+
+#include <atomic>
+
+namespace ZeroTier {
+
+// What acquire() hands out. The view must stay the first member, release() relies on it
+struct SnapshotRef {
+    zts_snapshot_t view;
+    std::shared_ptr<const Snapshot> snapshot;
+};
+
+SnapshotPublisher::SnapshotPublisher() : _version(0)
+{
+}
+
+void SnapshotPublisher::publish(const std::shared_ptr<Snapshot>& snapshot)
+{
+    snapshot->view.version = ++_version;
+    snapshot->view.net_count = (unsigned int)snapshot->nets.size();
+    snapshot->view.nets = snapshot->nets.empty() ? NULL : &snapshot->nets[0];
+    snapshot->view.peer_count = (unsigned int)snapshot->peers.size();
+    snapshot->view.peers = snapshot->peers.empty() ? NULL : &snapshot->peers[0];
+    std::atomic_store(&_current, snapshot);
+}
+
+void SnapshotPublisher::clear()
+{
+    std::atomic_store(&_current, std::shared_ptr<Snapshot>());
+}
+
+const zts_snapshot_t* SnapshotPublisher::acquire()
+{
+    std::shared_ptr<Snapshot> current = std::atomic_load(&_current);
+    if (! current) {
+        return NULL;
+    }
+    SnapshotRef* ref = new SnapshotRef();
+    ref->view = current->view;
+    ref->snapshot = current;
+    return &ref->view;
+}
+
+void SnapshotPublisher::release(const zts_snapshot_t* view)
+{
+    delete reinterpret_cast<const SnapshotRef*>(view);
+}
+
+}   // namespace ZeroTier
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Immutable snapshots of node, network and peer state
+ */
+
+#ifndef ZTS_SNAPSHOT_HPP
+#define ZTS_SNAPSHOT_HPP
+
+#include "ZeroTierSockets.h"
+
+#include <memory>
+#include <vector>
+
+namespace ZeroTier {
+
+/**
+ * Copy of a node's state. Never modified once published
+ */
+struct Snapshot {
+    zts_snapshot_t view;
+    std::vector<zts_net_info_t> nets;
+    std::vector<zts_peer_info_t> peers;
+};
+
+/**
+ * Holds the most recently published snapshot of one node. The service replaces it wholesale and
+ * applications keep whichever one they acquired for as long as they like, so neither side takes
+ * a service or network lock.
+ */
+class SnapshotPublisher {
+  public:
+    SnapshotPublisher();
+
+    /**
+     * Make a snapshot current. Called only by the node's service
+     */
+    void publish(const std::shared_ptr<Snapshot>& snapshot);
+
+    /**
+     * Drop the current snapshot, e.g. when the node stops
+     */
+    void clear();
+
+    /**
+     * Return a reference to the current snapshot, or NULL if there is none
+     */
+    const zts_snapshot_t* acquire();
+
+    /**
+     * Release a reference returned by acquire()
+     */
+    static void release(const zts_snapshot_t* view);
+
+  private:
+    std::shared_ptr<Snapshot> _current;
+    uint64_t _version;
+};
+
+}   // namespace ZeroTier
+
+#endif   // _H
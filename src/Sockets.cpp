@@ -21,28 +21,182 @@
 
 #include "Events.hpp"
 #include "ZeroTierSockets.h"
+#include "lwip/api.h"
 #include "lwip/dns.h"
 #include "lwip/netdb.h"
+#include "lwip/netif.h"
+#include "lwip/tcpip.h"
+
+#include <atomic>
+#include <vector>
 
 int zts_errno;
 
 namespace ZeroTier {
 
+void zts_poller_forget(int fd);
+
+#if LWIP_NETCONN_SEM_PER_THREAD
+/**
+ * Blocking socket calls wait on a semaphore owned by the calling thread rather
+ * than one owned by the socket, which is what allows a reader and a writer to
+ * block on the same socket at once. The unix port creates the semaphore on
+ * first use but other ports need it created up front. It is freed when the
+ * thread exits.
+ */
+struct NetconnThreadSem {
+    NetconnThreadSem()
+    {
+        netconn_thread_init();
+    }
+    ~NetconnThreadSem()
+    {
+        netconn_thread_cleanup();
+    }
+};
+#endif
+
+/**
+ * Check that sockets can be used, and prepare the calling thread to use them
+ */
+static inline int socket_ok()
+{
+#if LWIP_NETCONN_SEM_PER_THREAD
+    static thread_local NetconnThreadSem sem;
+    (void)sem;
+#endif
+    return transport_ok();
+}
+
+// Context each socket was created on, indexed by descriptor
+static std::atomic<zts_ctx*> _socketCtx[MEMP_NUM_NETCONN];
+// Stands in for the context of sockets whose context has been freed. Its node never runs
+static zts_ctx _freedCtx;
+
+static zts_ctx* socket_ctx(int fd)
+{
+    int i = fd - LWIP_SOCKET_OFFSET;
+    if (i < 0 || i >= MEMP_NUM_NETCONN) {
+        return NULL;
+    }
+    return _socketCtx[i].load();
+}
+
+static void set_socket_ctx(int fd, zts_ctx* ctx)
+{
+    int i = fd - LWIP_SOCKET_OFFSET;
+    if (i >= 0 && i < MEMP_NUM_NETCONN) {
+        _socketCtx[i].store(ctx);
+    }
+}
+
+/**
+ * Check that a socket can be used. Besides the shared stack, the node of the context the socket
+ * was created on must be running, so stopping one node does not leave its sockets usable through
+ * another
+ */
+static inline int socket_ctx_ok(int fd)
+{
+    if (! socket_ok()) {
+        return 0;
+    }
+    zts_ctx* ctx = socket_ctx(fd);
+    return ! ctx || ctx->nodeRunning;
+}
+
+void zts_sockets_forget_ctx(zts_ctx* ctx)
+{
+    for (int i = 0; i < MEMP_NUM_NETCONN; i++) {
+        zts_ctx* expected = ctx;
+        _socketCtx[i].compare_exchange_strong(expected, &_freedCtx);
+    }
+}
+
+/**
+ * Join or leave a multicast group. IPv4 memberships name the interface by its
+ * address, IPv6 memberships by its index, so for IPv6 the membership is applied
+ * to each netif holding iface_ipstr, or to every netif if it is NULL
+ */
+static int zts_multicast_membership(int fd, const char* group_ipstr, const char* iface_ipstr, bool join)
+{
+    if (! group_ipstr) {
+        return ZTS_ERR_ARG;
+    }
+    int family = zts_util_get_ip_family(group_ipstr);
+    if (iface_ipstr && zts_util_get_ip_family(iface_ipstr) != family) {
+        return ZTS_ERR_ARG;
+    }
+    if (family == ZTS_AF_INET) {
+        struct ip_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        if (lwip_inet_pton(AF_INET, group_ipstr, &mreq.imr_multiaddr) != 1) {
+            return ZTS_ERR_ARG;
+        }
+        if (iface_ipstr && lwip_inet_pton(AF_INET, iface_ipstr, &mreq.imr_interface) != 1) {
+            return ZTS_ERR_ARG;
+        }
+        int optname = join ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP;
+        return zts_bsd_setsockopt(fd, IPPROTO_IP, optname, &mreq, sizeof(mreq));
+    }
+    if (family == ZTS_AF_INET6) {
+        struct ipv6_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        ip6_addr_t iface;
+        if (lwip_inet_pton(AF_INET6, group_ipstr, &mreq.ipv6mr_multiaddr) != 1) {
+            return ZTS_ERR_ARG;
+        }
+        if (iface_ipstr && ! ip6addr_aton(iface_ipstr, &iface)) {
+            return ZTS_ERR_ARG;
+        }
+        std::vector<unsigned int> indices;
+        LOCK_TCPIP_CORE();
+        struct netif* n;
+        NETIF_FOREACH(n)
+        {
+            if (! (n->flags & NETIF_FLAG_MLD6)) {
+                continue;
+            }
+            if (iface_ipstr && netif_get_ip6_addr_match(n, &iface) < 0) {
+                continue;
+            }
+            indices.push_back(netif_get_index(n));
+        }
+        UNLOCK_TCPIP_CORE();
+        if (indices.empty()) {
+            return ZTS_ERR_NO_RESULT;
+        }
+        // Succeed if the membership could be applied to at least one netif
+        int err = ZTS_ERR_SOCKET;
+        int optname = join ? IPV6_JOIN_GROUP : IPV6_LEAVE_GROUP;
+        for (size_t i = 0; i < indices.size(); i++) {
+            mreq.ipv6mr_interface = indices[i];
+            if (zts_bsd_setsockopt(fd, IPPROTO_IPV6, optname, &mreq, sizeof(mreq)) == ZTS_ERR_OK) {
+                err = ZTS_ERR_OK;
+            }
+        }
+        return err;
+    }
+    return ZTS_ERR_ARG;
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 int zts_bsd_socket(const int socket_family, const int socket_type, const int protocol)
 {
-    if (! transport_ok()) {
+    zts_ctx* ctx = zts_current_ctx();
+    if (! socket_ok() || ! ctx->nodeRunning) {
         return ZTS_ERR_SERVICE;
     }
-    return lwip_socket(socket_family, socket_type, protocol);
+    int fd = lwip_socket(socket_family, socket_type, protocol);
+    set_socket_ctx(fd, ctx);
+    return fd;
 }
 
 int zts_bsd_connect(int fd, const struct zts_sockaddr* addr, zts_socklen_t addrlen)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (! addr) {
@@ -57,7 +211,7 @@ int zts_bsd_connect(int fd, const struct zts_sockaddr* addr, zts_socklen_t addrl
 
 int zts_bsd_bind(int fd, const struct zts_sockaddr* addr, zts_socklen_t addrlen)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (! addr) {
@@ -71,7 +225,7 @@ int zts_bsd_bind(int fd, const struct zts_sockaddr* addr, zts_socklen_t addrlen)
 
 int zts_bsd_listen(int fd, int backlog)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     return lwip_listen(fd, backlog);
@@ -79,15 +233,17 @@ int zts_bsd_listen(int fd, int backlog)
 
 int zts_bsd_accept(int fd, struct zts_sockaddr* addr, zts_socklen_t* addrlen)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
-    return lwip_accept(fd, (sockaddr*)addr, (socklen_t*)addrlen);
+    int acc_fd = lwip_accept(fd, (sockaddr*)addr, (socklen_t*)addrlen);
+    set_socket_ctx(acc_fd, socket_ctx(fd));
+    return acc_fd;
 }
 
 int zts_bsd_setsockopt(int fd, int level, int optname, const void* optval, zts_socklen_t optlen)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     return lwip_setsockopt(fd, level, optname, optval, optlen);
@@ -95,7 +251,7 @@ int zts_bsd_setsockopt(int fd, int level, int optname, const void* optval, zts_s
 
 int zts_bsd_getsockopt(int fd, int level, int optname, void* optval, zts_socklen_t* optlen)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     return lwip_getsockopt(fd, level, optname, optval, (socklen_t*)optlen);
@@ -103,7 +259,7 @@ int zts_bsd_getsockopt(int fd, int level, int optname, void* optval, zts_socklen
 
 int zts_bsd_getsockname(int fd, struct zts_sockaddr* addr, zts_socklen_t* addrlen)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (! addr) {
@@ -117,7 +273,7 @@ int zts_bsd_getsockname(int fd, struct zts_sockaddr* addr, zts_socklen_t* addrle
 
 int zts_bsd_getpeername(int fd, struct zts_sockaddr* addr, zts_socklen_t* addrlen)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (! addr) {
@@ -131,9 +287,12 @@ int zts_bsd_getpeername(int fd, struct zts_sockaddr* addr, zts_socklen_t* addrle
 
 int zts_bsd_close(int fd)
 {
-    if (! transport_ok()) {
+    // A socket can still be closed after its own node has stopped
+    if (! socket_ok()) {
         return ZTS_ERR_SERVICE;
     }
+    set_socket_ctx(fd, NULL);
+    zts_poller_forget(fd);
     return lwip_close(fd);
 }
 
@@ -144,7 +303,7 @@ int zts_bsd_select(
     zts_fd_set* exceptfds,
     struct zts_timeval* timeout)
 {
-    if (! transport_ok()) {
+    if (! socket_ok()) {
         return ZTS_ERR_SERVICE;
     }
     return lwip_select(nfds, (fd_set*)readfds, (fd_set*)writefds, (fd_set*)exceptfds, (timeval*)timeout);
@@ -152,7 +311,7 @@ int zts_bsd_select(
 
 int zts_bsd_fcntl(int fd, int cmd, int flags)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     return lwip_fcntl(fd, cmd, flags);
@@ -160,7 +319,7 @@ int zts_bsd_fcntl(int fd, int cmd, int flags)
 
 int zts_bsd_poll(struct zts_pollfd* fds, nfds_t nfds, int timeout)
 {
-    if (! transport_ok()) {
+    if (! socket_ok()) {
         return ZTS_ERR_SERVICE;
     }
     return lwip_poll((pollfd*)fds, nfds, timeout);
@@ -168,7 +327,7 @@ int zts_bsd_poll(struct zts_pollfd* fds, nfds_t nfds, int timeout)
 
 int zts_bsd_ioctl(int fd, unsigned long request, void* argp)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (! argp) {
@@ -179,7 +338,7 @@ int zts_bsd_ioctl(int fd, unsigned long request, void* argp)
 
 ssize_t zts_bsd_send(int fd, const void* buf, size_t len, int flags)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (! buf) {
@@ -191,7 +350,7 @@ ssize_t zts_bsd_send(int fd, const void* buf, size_t len, int flags)
 ssize_t
 zts_bsd_sendto(int fd, const void* buf, size_t len, int flags, const struct zts_sockaddr* addr, zts_socklen_t addrlen)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (! addr || ! buf) {
@@ -205,7 +364,7 @@ zts_bsd_sendto(int fd, const void* buf, size_t len, int flags, const struct zts_
 
 ssize_t zts_bsd_sendmsg(int fd, const struct zts_msghdr* msg, int flags)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     return lwip_sendmsg(fd, (const struct msghdr*)msg, flags);
@@ -213,7 +372,7 @@ ssize_t zts_bsd_sendmsg(int fd, const struct zts_msghdr* msg, int flags)
 
 ssize_t zts_bsd_recv(int fd, void* buf, size_t len, int flags)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (! buf) {
@@ -224,7 +383,7 @@ ssize_t zts_bsd_recv(int fd, void* buf, size_t len, int flags)
 
 ssize_t zts_bsd_recvfrom(int fd, void* buf, size_t len, int flags, struct zts_sockaddr* addr, zts_socklen_t* addrlen)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (! buf) {
@@ -235,7 +394,7 @@ ssize_t zts_bsd_recvfrom(int fd, void* buf, size_t len, int flags, struct zts_so
 
 ssize_t zts_bsd_recvmsg(int fd, struct zts_msghdr* msg, int flags)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (! msg) {
@@ -246,7 +405,7 @@ ssize_t zts_bsd_recvmsg(int fd, struct zts_msghdr* msg, int flags)
 
 ssize_t zts_bsd_read(int fd, void* buf, size_t len)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (! buf) {
@@ -257,7 +416,7 @@ ssize_t zts_bsd_read(int fd, void* buf, size_t len)
 
 ssize_t zts_bsd_readv(int fd, const struct zts_iovec* iov, int iovcnt)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     return lwip_readv(fd, (iovec*)iov, iovcnt);
@@ -265,7 +424,7 @@ ssize_t zts_bsd_readv(int fd, const struct zts_iovec* iov, int iovcnt)
 
 ssize_t zts_bsd_write(int fd, const void* buf, size_t len)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (! buf) {
@@ -276,7 +435,7 @@ ssize_t zts_bsd_write(int fd, const void* buf, size_t len)
 
 ssize_t zts_bsd_writev(int fd, const struct zts_iovec* iov, int iovcnt)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     return lwip_writev(fd, (iovec*)iov, iovcnt);
@@ -284,7 +443,7 @@ ssize_t zts_bsd_writev(int fd, const struct zts_iovec* iov, int iovcnt)
 
 int zts_bsd_shutdown(int fd, int how)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     return lwip_shutdown(fd, how);
@@ -292,7 +451,7 @@ int zts_bsd_shutdown(int fd, int how)
 
 struct zts_hostent* zts_bsd_gethostbyname(const char* name)
 {
-    if (! transport_ok()) {
+    if (! socket_ok()) {
         return NULL;
     }
     if (! name) {
@@ -303,7 +462,7 @@ struct zts_hostent* zts_bsd_gethostbyname(const char* name)
 
 int zts_dns_set_server(uint8_t index, const zts_ip_addr* addr)
 {
-    if (! transport_ok()) {
+    if (! socket_ok()) {
         return ZTS_ERR_SERVICE;
     }
     if (index >= DNS_MAX_SERVERS) {
@@ -318,7 +477,7 @@ int zts_dns_set_server(uint8_t index, const zts_ip_addr* addr)
 
 const zts_ip_addr* zts_dns_get_server(uint8_t index)
 {
-    if (! transport_ok()) {
+    if (! socket_ok()) {
         return NULL;
     }
     if (index >= DNS_MAX_SERVERS) {
@@ -389,7 +548,7 @@ int zts_socket(int family, int type, int protocol)
 
 int zts_connect(int fd, const char* ipstr, unsigned short port, int timeout_ms)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (timeout_ms < 0) {
@@ -428,7 +587,7 @@ int zts_connect(int fd, const char* ipstr, unsigned short port, int timeout_ms)
 
 int zts_bind(int fd, const char* ipstr, unsigned short port)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     zts_socklen_t addrlen = 0;
@@ -451,7 +610,7 @@ int zts_listen(int fd, int backlog)
 
 int zts_accept(int fd, char* remote_addr, int len, unsigned short* port)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (len != ZTS_INET6_ADDRSTRLEN) {
@@ -510,7 +669,7 @@ int zts_close(int fd)
 
 int zts_getpeername(int fd, char* remote_addr_str, int len, unsigned short* port)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (len != ZTS_INET6_ADDRSTRLEN) {
@@ -528,7 +687,7 @@ int zts_getpeername(int fd, char* remote_addr_str, int len, unsigned short* port
 
 int zts_getsockname(int fd, char* local_addr_str, int len, unsigned short* port)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (len != ZTS_INET6_ADDRSTRLEN) {
@@ -608,7 +767,7 @@ int zts_udp_client(const char* remote_ipstr)
 
 int zts_set_no_delay(int fd, int enabled)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (enabled != 0 && enabled != 1) {
@@ -619,7 +778,7 @@ int zts_set_no_delay(int fd, int enabled)
 
 int zts_get_no_delay(int fd)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     int err, optval = 0;
@@ -632,7 +791,7 @@ int zts_get_no_delay(int fd)
 
 int zts_set_linger(int fd, int enabled, int value)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (enabled != 0 && enabled != 1) {
@@ -649,7 +808,7 @@ int zts_set_linger(int fd, int enabled, int value)
 
 int zts_get_linger_enabled(int fd)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     struct zts_linger linger;
@@ -663,7 +822,7 @@ int zts_get_linger_enabled(int fd)
 
 int zts_get_linger_value(int fd)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     struct zts_linger linger;
@@ -677,7 +836,7 @@ int zts_get_linger_value(int fd)
 
 int zts_get_pending_data_size(int fd)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     int bytes_available = 0;
@@ -690,7 +849,7 @@ int zts_get_pending_data_size(int fd)
 
 int zts_set_reuse_addr(int fd, int enabled)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (enabled != 0 && enabled != 1) {
@@ -701,7 +860,7 @@ int zts_set_reuse_addr(int fd, int enabled)
 
 int zts_get_reuse_addr(int fd)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     int err, optval = 0;
@@ -714,7 +873,7 @@ int zts_get_reuse_addr(int fd)
 
 int zts_set_recv_timeout(int fd, int seconds, int microseconds)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (seconds < 0 || microseconds < 0) {
@@ -728,7 +887,7 @@ int zts_set_recv_timeout(int fd, int seconds, int microseconds)
 
 int zts_get_recv_timeout(int fd)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     struct timeval tv;
@@ -742,7 +901,7 @@ int zts_get_recv_timeout(int fd)
 
 int zts_set_send_timeout(int fd, int seconds, int microseconds)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (seconds < 0 || microseconds < 0) {
@@ -756,7 +915,7 @@ int zts_set_send_timeout(int fd, int seconds, int microseconds)
 
 int zts_get_send_timeout(int fd)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     struct zts_timeval tv;
@@ -770,7 +929,7 @@ int zts_get_send_timeout(int fd)
 
 int zts_set_send_buf_size(int fd, int size)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (size < 0) {
@@ -781,7 +940,7 @@ int zts_set_send_buf_size(int fd, int size)
 
 int zts_get_send_buf_size(int fd)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     int err, optval = 0;
@@ -794,7 +953,7 @@ int zts_get_send_buf_size(int fd)
 
 int zts_set_recv_buf_size(int fd, int size)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (size < 0) {
@@ -805,7 +964,7 @@ int zts_set_recv_buf_size(int fd, int size)
 
 int zts_get_recv_buf_size(int fd)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     int err, optval = 0;
@@ -818,7 +977,7 @@ int zts_get_recv_buf_size(int fd)
 
 int zts_set_ttl(int fd, int ttl)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (ttl < 0 || ttl > 255) {
@@ -829,7 +988,7 @@ int zts_set_ttl(int fd, int ttl)
 
 int zts_get_ttl(int fd)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     int err, ttl = 0;
@@ -840,9 +999,25 @@ int zts_get_ttl(int fd)
     return ttl;
 }
 
+int zts_add_membership(int fd, const char* group_ipstr, const char* iface_ipstr)
+{
+    if (! socket_ctx_ok(fd)) {
+        return ZTS_ERR_SERVICE;
+    }
+    return zts_multicast_membership(fd, group_ipstr, iface_ipstr, true);
+}
+
+int zts_drop_membership(int fd, const char* group_ipstr, const char* iface_ipstr)
+{
+    if (! socket_ctx_ok(fd)) {
+        return ZTS_ERR_SERVICE;
+    }
+    return zts_multicast_membership(fd, group_ipstr, iface_ipstr, false);
+}
+
 int zts_set_blocking(int fd, int enabled)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (enabled != 0 && enabled != 1) {
@@ -860,7 +1035,7 @@ int zts_set_blocking(int fd, int enabled)
 
 int zts_get_blocking(int fd)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     int flags = zts_bsd_fcntl(fd, ZTS_F_GETFL, 0);
@@ -872,7 +1047,7 @@ int zts_get_blocking(int fd)
 
 int zts_set_keepalive(int fd, int enabled)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     if (enabled != 0 && enabled != 1) {
@@ -884,7 +1059,7 @@ int zts_set_keepalive(int fd, int enabled)
 
 int zts_get_keepalive(int fd)
 {
-    if (! transport_ok()) {
+    if (! socket_ctx_ok(fd)) {
         return ZTS_ERR_SERVICE;
     }
     int err, optval = 0;
@@ -895,6 +1070,19 @@ int zts_get_keepalive(int fd)
     return optval != 0;
 }
 
+int zts_get_socket_error(int fd)
+{
+    if (! socket_ctx_ok(fd)) {
+        return ZTS_ERR_SERVICE;
+    }
+    int err, optval = 0;
+    zts_socklen_t optlen = sizeof(optval);
+    if ((err = zts_bsd_getsockopt(fd, ZTS_SOL_SOCKET, ZTS_SO_ERROR, (void*)&optval, &optlen)) < 0) {
+        return err;
+    }
+    return optval;
+}
+
 int zts_util_ntop(struct zts_sockaddr* addr, zts_socklen_t addrlen, char* dst_str, int len, unsigned short* port)
 {
     if (! addr || addrlen < sizeof(struct zts_sockaddr_in) || addrlen > sizeof(struct zts_sockaddr_storage) || ! dst_str
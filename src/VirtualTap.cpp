@@ -24,9 +24,15 @@
 #include "OSUtils.hpp"
 #include "lwip/etharp.h"
 #include "lwip/ethip6.h"
+#include "lwip/init.h"
 #include "lwip/netif.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/ip6.h"
+#include "lwip/prot/tcp.h"
 #include "lwip/sys.h"
 #include "lwip/tcpip.h"
+#include "lwip/timeouts.h"
+#include "lwip_hooks.h"
 #include "netif/ethernet.h"
 
 #ifdef LWIP_STATS
@@ -36,6 +42,8 @@
 #include "Events.hpp"
 #include "VirtualTap.hpp"
 
+#include <atomic>
+
 #if defined(__WINDOWS__)
 #include "Synchapi.h"
 
@@ -43,12 +51,9 @@
 #endif
 
 #define ZTS_TAP_THREAD_POLLING_INTERVAL 50
-#define LWIP_DRIVER_LOOP_INTERVAL       100
 
 namespace ZeroTier {
 
-extern Events* zts_events;
-
 /**
  * Virtual tap device. ZeroTier will create one per joined network. It will
  * then be destroyed upon leaving the network.
@@ -82,11 +87,15 @@ VirtualTap::VirtualTap(
     , _phy(this, false, true)
 {
     OSUtils::ztsnprintf(vtap_full_name, VTAP_NAME_LEN, "libzt-vtap-%llx", _net_id);
+    // When the application drives the stack there are no threads of our own
+    _threaded = ! zts_lwip_is_caller_driven();
 #ifndef __WINDOWS__
     ::pipe(_shutdownSignalPipe);
 #endif
     // Start virtual tap thread and stack I/O loops
-    _thread = Thread::start(this);
+    if (_threaded) {
+        _thread = Thread::start(this);
+    }
 }
 
 VirtualTap::~VirtualTap()
@@ -100,7 +109,12 @@ VirtualTap::~VirtualTap()
     netif4 = NULL;
     zts_lwip_remove_netif(netif6);
     netif6 = NULL;
-    Thread::join(_thread);
+    // Frames still held are for netifs that no longer exist
+    zts_lwip_gro_flush(this);
+    delete[] _groFlows;
+    if (_threaded) {
+        Thread::join(_thread);
+    }
 #ifndef __WINDOWS__
     ::close(_shutdownSignalPipe[0]);
     ::close(_shutdownSignalPipe[1]);
@@ -212,13 +226,21 @@ void VirtualTap::put(const MAC& from, const MAC& to, unsigned int etherType, con
 void VirtualTap::scanMulticastGroups(std::vector<MulticastGroup>& added, std::vector<MulticastGroup>& removed)
 {
     std::vector<MulticastGroup> newGroups;
-    Mutex::Lock _l(_multicastGroups_m);
-    // TODO: get multicast subscriptions
+    // addIp() takes the core lock while holding _ips_m, so ips() must not be called with
+    // _multicastGroups_m held
     std::vector<InetAddress> allIps(ips());
+    Mutex::Lock _l(_multicastGroups_m);
+    _multicastGroupsChanged = false;
     for (std::vector<InetAddress>::iterator ip(allIps.begin()); ip != allIps.end(); ++ip)
         newGroups.push_back(MulticastGroup::deriveMulticastGroupForAddressResolution(*ip));
+    // Groups joined by the stack through IGMP/MLD, for itself or for sockets
+    for (std::map<MulticastGroup, unsigned int>::iterator g(_stackMulticastGroups.begin());
+         g != _stackMulticastGroups.end();
+         ++g)
+        newGroups.push_back(g->first);
 
     std::sort(newGroups.begin(), newGroups.end());
+    newGroups.erase(std::unique(newGroups.begin(), newGroups.end()), newGroups.end());
 
     for (std::vector<MulticastGroup>::iterator m(newGroups.begin()); m != newGroups.end(); ++m) {
         if (! std::binary_search(_multicastGroups.begin(), _multicastGroups.end(), *m))
@@ -231,9 +253,37 @@ void VirtualTap::scanMulticastGroups(std::vector<MulticastGroup>& added, std::ve
     _multicastGroups.swap(newGroups);
 }
 
+void VirtualTap::updateMulticastGroup(const MulticastGroup& mg, bool subscribe)
+{
+    Mutex::Lock _l(_multicastGroups_m);
+    if (subscribe) {
+        _stackMulticastGroups[mg]++;
+    }
+    else {
+        std::map<MulticastGroup, unsigned int>::iterator g(_stackMulticastGroups.find(mg));
+        if (g == _stackMulticastGroups.end()) {
+            return;
+        }
+        if (--g->second == 0) {
+            _stackMulticastGroups.erase(g);
+        }
+    }
+    _multicastGroupsChanged = true;
+}
+
 void VirtualTap::setMtu(unsigned int mtu)
 {
     _mtu = mtu;
+    // With TSO the netifs keep LWIP_TSO_MTU and frames are split to the new MTU on their way out
+    if (! _tso) {
+        zts_lwip_set_mtu(netif4, mtu);
+        zts_lwip_set_mtu(netif6, mtu);
+    }
+}
+
+void VirtualTap::flushRx()
+{
+    zts_lwip_gro_flush(this);
 }
 
 void VirtualTap::threadMain() throw()
@@ -272,8 +322,10 @@ void VirtualTap::threadMain() throw()
 // Netif driver code for lwIP network stack                                   //
 //----------------------------------------------------------------------------//
 
-bool _has_exited = false;
+// lwIP has been initialized. It cannot be deinitialized, so its thread and state are kept
+// across shutdowns and reused by the next init
 bool _has_started = false;
+bool _caller_driven = false;
 
 // Used to generate enumerated lwIP interface names
 int netifCount = 0;
@@ -286,75 +338,100 @@ static void zts_tcpip_init_done(void* arg)
 {
     sys_sem_t* sem;
     sem = (sys_sem_t*)arg;
-    zts_events->setState(ZTS_STATE_STACK_RUNNING);
-    _has_started = true;
     // zts_events->enqueue(ZTS_EVENT_STACK_UP, NULL);
     sys_sem_signal(sem);
 }
 
-static void zts_main_lwip_driver_loop(void* arg)
+bool zts_lwip_is_up()
 {
-#if defined(__linux__)
-    // pthread_setname_np(pthread_self(), ZTS_LWIP_THREAD_NAME);
+    Mutex::Lock _l(lwip_state_m);
+    return Events::stackIsRunning();
+}
+
+void zts_lwip_driver_init()
+{
+    Mutex::Lock _l(lwip_state_m);
+    if (Events::stackIsRunning()) {
+        return;
+    }
+    if (! _has_started) {
+#if defined(__WINDOWS__)
+        sys_init();   // Required for win32 init of critical sections
 #endif
-#if defined(__APPLE__)
-    // pthread_setname_np(ZTS_LWIP_THREAD_NAME);
+        sys_sem_t sem;
+        if (sys_sem_new(&sem, 0) != ERR_OK) {
+            return;
+        }
+        tcpip_init(zts_tcpip_init_done, &sem);
+        sys_sem_wait(&sem);
+        sys_sem_free(&sem);
+        _has_started = true;
+    }
+    Events::setStackRunning(true);
+}
+
+// Caller-driven mode runs lwIP without its tcpip thread, so nothing may post to the thread's
+// mailbox: API calls and input must run under the core lock, and no tcpip_callback() users may
+// be compiled in. Timers are run by zts_lwip_driver_process()
+#if ! LWIP_TCPIP_CORE_LOCKING || ! LWIP_TCPIP_CORE_LOCKING_INPUT || PBUF_POOL_FREE_OOSEQ                              \
+    || (LWIP_NETIF_LOOPBACK && LWIP_NETIF_LOOPBACK_MULTITHREADING)
+#error "Caller-driven mode requires an lwIP configuration that never calls tcpip_callback()"
 #endif
-    sys_sem_t sem;
-    LWIP_UNUSED_ARG(arg);
-    if (sys_sem_new(&sem, 0) != ERR_OK) {
-        // DEBUG_ERROR("failed to create semaphore");
+
+void zts_lwip_driver_init_caller_driven()
+{
+    Mutex::Lock _l(lwip_state_m);
+    if (Events::stackIsRunning()) {
+        return;
     }
-    tcpip_init(zts_tcpip_init_done, &sem);
-    sys_sem_wait(&sem);
-    // Main loop
-    while (zts_events->getState(ZTS_STATE_STACK_RUNNING)) {
-        zts_util_delay(LWIP_DRIVER_LOOP_INTERVAL);
+    if (! _has_started) {
+        // What tcpip_init() does, minus the thread. With core locking, API calls and input run
+        // in the calling thread, and zts_lwip_driver_process() stands in for the timer loop.
+        lwip_init();
+        sys_mutex_new(&lock_tcpip_core);
+        _caller_driven = true;
+        _has_started = true;
     }
-    _has_exited = true;
-    zts_events->enqueue(ZTS_EVENT_STACK_DOWN, NULL);
+    Events::setStackRunning(true);
 }
 
-bool zts_lwip_is_up()
+bool zts_lwip_is_caller_driven()
 {
-    Mutex::Lock _l(lwip_state_m);
-    return zts_events->getState(ZTS_STATE_STACK_RUNNING);
+    return _caller_driven;
 }
 
-void zts_lwip_driver_init()
+unsigned int zts_lwip_driver_process()
 {
-    if (zts_lwip_is_up()) {
-        return;
+    if (! _caller_driven || ! zts_lwip_is_up()) {
+        return SYS_TIMEOUTS_SLEEPTIME_INFINITE;
     }
-    if (_has_exited) {
-        return;
+    LOCK_TCPIP_CORE();
+    sys_check_timeouts();
+    u32_t sleeptime = sys_timeouts_sleeptime();
+    UNLOCK_TCPIP_CORE();
+    return sleeptime;
+}
+
+unsigned int zts_lwip_driver_next_timeout()
+{
+    if (! _caller_driven || ! zts_lwip_is_up()) {
+        return SYS_TIMEOUTS_SLEEPTIME_INFINITE;
     }
-    Mutex::Lock _l(lwip_state_m);
-#if defined(__WINDOWS__)
-    sys_init();   // Required for win32 init of critical sections
-#endif
-    sys_thread_new(
-        ZTS_LWIP_THREAD_NAME,
-        zts_main_lwip_driver_loop,
-        NULL,
-        DEFAULT_THREAD_STACKSIZE,
-        DEFAULT_THREAD_PRIO);
+    LOCK_TCPIP_CORE();
+    u32_t sleeptime = sys_timeouts_sleeptime();
+    UNLOCK_TCPIP_CORE();
+    return sleeptime;
 }
 
 void zts_lwip_driver_shutdown()
 {
-    if (_has_exited) {
-        return;
-    }
     Mutex::Lock _l(lwip_state_m);
-    // Set flag to stop sending frames into the core
-    zts_events->clrState(ZTS_STATE_STACK_RUNNING);
-    // Wait until the main lwIP thread has exited
-    if (_has_started) {
-        while (! _has_exited) {
-            zts_util_delay(LWIP_DRIVER_LOOP_INTERVAL);
-        }
+    if (! Events::stackIsRunning()) {
+        return;
     }
+    // Stop sending frames into the core. The stack thread keeps running for the next init.
+    // zts_node_free() queues ZTS_EVENT_STACK_DOWN to the context shutting it down
+    Events::setStackRunning(false);
 }
 
 void zts_lwip_remove_netif(void* netif)
@@ -370,32 +447,280 @@ void zts_lwip_remove_netif(void* netif)
     UNLOCK_TCPIP_CORE();
 }
 
+void zts_lwip_set_mtu(void* netif, unsigned int mtu)
+{
+    if (! netif) {
+        return;
+    }
+    struct netif* n = (struct netif*)netif;
+    LOCK_TCPIP_CORE();
+    n->mtu = (u16_t)std::min(LWIP_MTU, (int)mtu);
+#if LWIP_IPV6 && LWIP_ND6_ALLOW_RA_UPDATES
+    n->mtu6 = n->mtu;
+#endif
+    UNLOCK_TCPIP_CORE();
+}
+
+/*
+ * Virtual TSO. Netifs of a tap with _tso set have an MTU of LWIP_TSO_MTU and
+ * generate no TCP checksums, so lwIP hands over TCP segments of up to that size
+ * and builds far fewer of them. They are split here into segments that fit the
+ * network's MTU, each with a copy of the headers, its own sequence number and a
+ * checksum. Other packets that exceed the network's MTU are fragmented here
+ * instead of by lwIP. Called with the core lock held.
+ *
+ * SYNs pass unchanged in both directions. lwIP sends no segment larger than the
+ * MSS of the peer's SYN, so super-segments only form towards a peer that
+ * announces more than the network's MTU, which is another node with virtual TSO:
+ * its SYNs carry the TCP_MSS derived from LWIP_TSO_MTU. Any other peer derives
+ * its MSS from its own MTU and gets segments of that size from lwIP.
+ */
+
+#define ZTS_TSO_MAX_HEADERS (SIZEOF_ETH_HDR + 60 + 60)
+
+static inline uint16_t zts_tso_get16(const uint8_t* b)
+{
+    return (uint16_t)((b[0] << 8) | b[1]);
+}
+
+static inline uint32_t zts_tso_get32(const uint8_t* b)
+{
+    return ((uint32_t)zts_tso_get16(b) << 16) | zts_tso_get16(b + 2);
+}
+
+static inline void zts_tso_put16(uint8_t* b, uint16_t v)
+{
+    b[0] = (uint8_t)(v >> 8);
+    b[1] = (uint8_t)v;
+}
+
+static inline void zts_tso_put32(uint8_t* b, uint32_t v)
+{
+    zts_tso_put16(b, (uint16_t)(v >> 16));
+    zts_tso_put16(b + 2, (uint16_t)v);
+}
+
+static uint32_t zts_tso_chksum_add(uint32_t acc, const uint8_t* b, unsigned int len)
+{
+    for (; len > 1; b += 2, len -= 2) {
+        acc += zts_tso_get16(b);
+    }
+    if (len) {
+        acc += (uint32_t)b[0] << 8;
+    }
+    return acc;
+}
+
+static uint16_t zts_tso_chksum_fold(uint32_t acc)
+{
+    while (acc >> 16) {
+        acc = (acc & 0xffff) + (acc >> 16);
+    }
+    return (uint16_t)~acc;
+}
+
+/**
+ * Set the TCP checksum of a packet whose IP header starts at ip and whose TCP
+ * header and payload are tcpTotal bytes long
+ */
+static void zts_tso_set_tcp_chksum(uint8_t* ip, bool v4, unsigned int ipLen, unsigned int tcpTotal)
+{
+    uint8_t* th = ip + ipLen;
+    uint32_t acc = v4 ? zts_tso_chksum_add(0, ip + 12, 8) : zts_tso_chksum_add(0, ip + 8, 32);
+    acc += IP_PROTO_TCP + tcpTotal;
+    zts_tso_put16(th + 16, 0);
+    zts_tso_put16(th + 16, zts_tso_chksum_fold(zts_tso_chksum_add(acc, th, tcpTotal)));
+}
+
+static err_t zts_tso_segment(
+    VirtualTap* tap,
+    struct pbuf* p,
+    const uint8_t* hdr,
+    unsigned int ipLen,
+    unsigned int tcpLen,
+    unsigned int payload)
+{
+    const struct eth_hdr* ethhdr = (const struct eth_hdr*)hdr;
+    const bool v4 = (zts_tso_get16(hdr + 12) == ETHTYPE_IP);
+    const unsigned int hl = ipLen + tcpLen;
+    const uint8_t* tcphdr = hdr + SIZEOF_ETH_HDR + ipLen;
+    if (tap->_mtu <= hl) {
+        return ERR_BUF;
+    }
+    const unsigned int mss = tap->_mtu - hl;
+    const uint32_t seq = zts_tso_get32(tcphdr + 4);
+    const uint16_t id = v4 ? zts_tso_get16(hdr + SIZEOF_ETH_HDR + 4) : 0;
+    MAC from(ethhdr->src.addr, 6);
+    MAC to(ethhdr->dest.addr, 6);
+    uint8_t seg[ZT_MAX_MTU + 32];
+    unsigned int off = 0;
+    for (uint16_t i = 0; i == 0 || off < payload; i++) {
+        unsigned int chunk = std::min(mss, payload - off);
+        memcpy(seg, hdr + SIZEOF_ETH_HDR, hl);
+        pbuf_copy_partial(p, seg + hl, (u16_t)chunk, (u16_t)(SIZEOF_ETH_HDR + hl + off));
+        uint8_t* th = seg + ipLen;
+        zts_tso_put32(th + 4, seq + off);
+        // CWR belongs to the first segment, FIN and PSH to the last
+        if (off) {
+            th[13] &= ~TCP_CWR;
+        }
+        if (off + chunk < payload) {
+            th[13] &= ~(TCP_FIN | TCP_PSH);
+        }
+        if (v4) {
+            zts_tso_put16(seg + 2, (uint16_t)(hl + chunk));
+            zts_tso_put16(seg + 4, (uint16_t)(id + i));
+            zts_tso_put16(seg + 10, 0);
+            zts_tso_put16(seg + 10, zts_tso_chksum_fold(zts_tso_chksum_add(0, seg, ipLen)));
+        }
+        else {
+            zts_tso_put16(seg + 4, (uint16_t)(tcpLen + chunk));
+        }
+        zts_tso_set_tcp_chksum(seg, v4, ipLen, tcpLen + chunk);
+        tap->_handler(tap->_arg, NULL, tap->_net_id, from, to, zts_tso_get16(hdr + 12), 0, seg, hl + chunk);
+        off += chunk;
+    }
+    return ERR_OK;
+}
+
+static err_t zts_tso_frag4(VirtualTap* tap, struct pbuf* p, const uint8_t* hdr, unsigned int ihl, unsigned int totLen)
+{
+    const struct eth_hdr* ethhdr = (const struct eth_hdr*)hdr;
+    const uint16_t ofs = zts_tso_get16(hdr + SIZEOF_ETH_HDR + 6);
+    if ((ofs & IP_DF) || tap->_mtu < ihl + 8) {
+        return ERR_BUF;
+    }
+    const unsigned int nfb = (tap->_mtu - ihl) & ~7U;
+    const unsigned int data = totLen - ihl;
+    const unsigned int base = (ofs & IP_OFFMASK) * 8;
+    MAC from(ethhdr->src.addr, 6);
+    MAC to(ethhdr->dest.addr, 6);
+    uint8_t frag[ZT_MAX_MTU + 32];
+    for (unsigned int off = 0; off < data; off += nfb) {
+        unsigned int chunk = std::min(nfb, data - off);
+        bool last = (off + chunk == data) && ! (ofs & IP_MF);
+        memcpy(frag, hdr + SIZEOF_ETH_HDR, ihl);
+        pbuf_copy_partial(p, frag + ihl, (u16_t)chunk, (u16_t)(SIZEOF_ETH_HDR + ihl + off));
+        zts_tso_put16(frag + 2, (uint16_t)(ihl + chunk));
+        zts_tso_put16(frag + 6, (uint16_t)(((base + off) / 8) | (last ? 0 : IP_MF)));
+        zts_tso_put16(frag + 10, 0);
+        zts_tso_put16(frag + 10, zts_tso_chksum_fold(zts_tso_chksum_add(0, frag, ihl)));
+        tap->_handler(tap->_arg, NULL, tap->_net_id, from, to, ETHTYPE_IP, 0, frag, ihl + chunk);
+    }
+    return ERR_OK;
+}
+
+static err_t zts_tso_frag6(VirtualTap* tap, struct pbuf* p, const uint8_t* hdr, unsigned int payloadLen)
+{
+    static uint32_t ident = 0;
+    const struct eth_hdr* ethhdr = (const struct eth_hdr*)hdr;
+    if (tap->_mtu < IP6_HLEN + IP6_FRAG_HLEN + 8) {
+        return ERR_BUF;
+    }
+    const unsigned int nfb = (tap->_mtu - IP6_HLEN - IP6_FRAG_HLEN) & ~7U;
+    const uint32_t id = ++ident;
+    MAC from(ethhdr->src.addr, 6);
+    MAC to(ethhdr->dest.addr, 6);
+    uint8_t frag[ZT_MAX_MTU + 32];
+    for (unsigned int off = 0; off < payloadLen; off += nfb) {
+        unsigned int chunk = std::min(nfb, payloadLen - off);
+        bool last = (off + chunk == payloadLen);
+        memcpy(frag, hdr + SIZEOF_ETH_HDR, IP6_HLEN);
+        frag[6] = IP6_NEXTH_FRAGMENT;
+        zts_tso_put16(frag + 4, (uint16_t)(IP6_FRAG_HLEN + chunk));
+        uint8_t* fh = frag + IP6_HLEN;
+        fh[0] = hdr[SIZEOF_ETH_HDR + 6];
+        fh[1] = 0;
+        zts_tso_put16(fh + 2, (uint16_t)(off | (last ? 0 : IP6_FRAG_MORE_FLAG)));
+        zts_tso_put32(fh + 4, id);
+        pbuf_copy_partial(p, fh + IP6_FRAG_HLEN, (u16_t)chunk, (u16_t)(SIZEOF_ETH_HDR + IP6_HLEN + off));
+        tap->_handler(tap->_arg, NULL, tap->_net_id, from, to, ETHTYPE_IPV6, 0, frag, IP6_HLEN + IP6_FRAG_HLEN + chunk);
+    }
+    return ERR_OK;
+}
+
+/**
+ * Send a frame of a TSO netif. Returns false if it needs no special treatment
+ */
+static bool zts_tso_tx(VirtualTap* tap, struct pbuf* p, err_t* err)
+{
+    uint8_t hdr[ZTS_TSO_MAX_HEADERS];
+    unsigned int hlen = pbuf_copy_partial(p, hdr, std::min((u16_t)sizeof(hdr), p->tot_len), 0);
+    if (hlen < SIZEOF_ETH_HDR) {
+        return false;
+    }
+    const uint8_t* ip = hdr + SIZEOF_ETH_HDR;
+    const uint16_t type = zts_tso_get16(hdr + 12);
+    hlen -= SIZEOF_ETH_HDR;
+    unsigned int ipLen, pktLen, proto;
+    switch (type) {
+        case ETHTYPE_IP:
+            if (hlen < IP_HLEN) {
+                return false;
+            }
+            ipLen = (ip[0] & 0x0f) * 4;
+            pktLen = zts_tso_get16(ip + 2);
+            proto = ip[9];
+            break;
+        case ETHTYPE_IPV6:
+            if (hlen < IP6_HLEN) {
+                return false;
+            }
+            ipLen = IP6_HLEN;
+            pktLen = IP6_HLEN + zts_tso_get16(ip + 4);
+            proto = ip[6];
+            break;
+        default:
+            return false;
+    }
+    if (ipLen > hlen || pktLen < ipLen || SIZEOF_ETH_HDR + pktLen > p->tot_len) {
+        return false;
+    }
+    if (proto == IP_PROTO_TCP && hlen >= ipLen + TCP_HLEN) {
+        unsigned int tcpLen = (ip[ipLen + 12] >> 4) * 4;
+        if (tcpLen >= TCP_HLEN && hlen >= ipLen + tcpLen && pktLen >= ipLen + tcpLen) {
+            *err = zts_tso_segment(tap, p, hdr, ipLen, tcpLen, pktLen - ipLen - tcpLen);
+            return true;
+        }
+    }
+    if (pktLen <= tap->_mtu) {
+        return false;
+    }
+    *err = (type == ETHTYPE_IPV6) ? zts_tso_frag6(tap, p, hdr, pktLen - IP6_HLEN)
+                                  : zts_tso_frag4(tap, p, hdr, ipLen, pktLen);
+    return true;
+}
+
 signed char zts_lwip_eth_tx(struct netif* n, struct pbuf* p)
 {
     if (! n) {
         return ERR_IF;
     }
-    struct pbuf* q;
-    char buf[ZT_MAX_MTU + 32] = { 0 };
-    char* bufptr;
-    int totalLength = 0;
-
     VirtualTap* tap = (VirtualTap*)n->state;
-    bufptr = buf;
-    for (q = p; q != NULL; q = q->next) {
-        memcpy(bufptr, q->payload, q->len);
-        bufptr += q->len;
-        totalLength += q->len;
+    err_t err;
+    if (tap->_tso && zts_tso_tx(tap, p, &err)) {
+        return err;
+    }
+    char buf[ZT_MAX_MTU + 32];
+    if (p->tot_len < sizeof(struct eth_hdr) || p->tot_len > sizeof(buf)) {
+        return ERR_BUF;
     }
+    // A frame held in a single pbuf is passed on in place, only chains are flattened
+    char* frame = (char*)p->payload;
+    if (p->len != p->tot_len) {
+        pbuf_copy_partial(p, buf, p->tot_len, 0);
+        frame = buf;
+    }
+    int totalLength = p->tot_len;
     struct eth_hdr* ethhdr;
-    ethhdr = (struct eth_hdr*)buf;
+    ethhdr = (struct eth_hdr*)frame;
 
     MAC src_mac;
     MAC dest_mac;
     src_mac.setTo(ethhdr->src.addr, 6);
     dest_mac.setTo(ethhdr->dest.addr, 6);
 
-    char* data = buf + sizeof(struct eth_hdr);
+    char* data = frame + sizeof(struct eth_hdr);
     int len = totalLength - sizeof(struct eth_hdr);
     int proto = Utils::ntoh((uint16_t)ethhdr->type);
     tap->_handler(tap->_arg, NULL, tap->_net_id, src_mac, dest_mac, proto, 0, data, len);
@@ -403,6 +728,184 @@ signed char zts_lwip_eth_tx(struct netif* n, struct pbuf* p)
     return ERR_OK;
 }
 
+/*
+ * Receive coalescing (virtual GRO). With _gro set, consecutive in-order TCP
+ * segments of the same flow that arrive in one batch are chained into a single
+ * packet before they enter lwIP, which then does one PCB lookup, one ACK and
+ * one wakeup of the application for all of them. A segment that carries PSH or
+ * any flag other than ACK, arrives out of order, or differs in its ACK, window
+ * or options is never merged: what its flow holds is passed on first, then the
+ * segment itself. Everything held is passed on when the batch ends.
+ * The merged packet keeps the checksums of its first segment, so such netifs
+ * do not check IP and TCP checksums (ZeroTier authenticates every frame).
+ */
+
+#define ZTS_GRO_MAX_FLOWS 8
+
+struct GroFlow {
+    struct pbuf* head;
+    struct netif* netif;
+    // Addresses and ports
+    uint8_t key[36];
+    unsigned int keyLen;
+    unsigned int ipLen;
+    unsigned int tcpLen;
+    uint32_t nextSeq;
+};
+
+static void zts_gro_input(struct netif* n, struct pbuf* p)
+{
+    if (n->input(p, n) != ERR_OK) {
+        pbuf_free(p);
+    }
+}
+
+static void zts_gro_flush_flow(VirtualTap* tap, GroFlow* flow)
+{
+    struct pbuf* p = flow->head;
+    flow->head = NULL;
+    tap->_groPackets++;
+    if (flow->netif == tap->netif4 || flow->netif == tap->netif6) {
+        zts_gro_input(flow->netif, p);
+    }
+    else {
+        pbuf_free(p);
+    }
+}
+
+void zts_lwip_gro_flush(VirtualTap* tap)
+{
+    if (! tap->_groFlows) {
+        return;
+    }
+    for (int i = 0; i < ZTS_GRO_MAX_FLOWS; i++) {
+        if (tap->_groFlows[i].head) {
+            zts_gro_flush_flow(tap, &tap->_groFlows[i]);
+        }
+    }
+}
+
+void zts_lwip_gro_stats(VirtualTap* tap, uint64_t* segments, uint64_t* packets)
+{
+    *segments += tap->_groSegments;
+    *packets += tap->_groPackets;
+}
+
+/**
+ * Offer a received frame for coalescing. Returns true if the frame was taken,
+ * otherwise it must be passed to the stack right away
+ */
+static bool zts_gro_receive(VirtualTap* tap, struct netif* n, struct pbuf* p)
+{
+    // Frames from zts_lwip_eth_rx() are always held in a single pbuf
+    const uint8_t* f = (const uint8_t*)p->payload;
+    const unsigned int len = p->len;
+    if (len < SIZEOF_ETH_HDR + IP_HLEN) {
+        return false;
+    }
+    const uint8_t* ip = f + SIZEOF_ETH_HDR;
+    const uint16_t type = zts_tso_get16(f + 12);
+    unsigned int ipLen, pktLen;
+    uint8_t key[36];
+    unsigned int keyLen;
+    if (type == ETHTYPE_IP) {
+        ipLen = (ip[0] & 0x0f) * 4;
+        pktLen = zts_tso_get16(ip + 2);
+        if (ip[9] != IP_PROTO_TCP || (zts_tso_get16(ip + 6) & (IP_MF | IP_OFFMASK))) {
+            return false;
+        }
+        memcpy(key, ip + 12, 8);
+        keyLen = 8;
+    }
+    else if (type == ETHTYPE_IPV6 && len >= SIZEOF_ETH_HDR + IP6_HLEN) {
+        ipLen = IP6_HLEN;
+        pktLen = IP6_HLEN + zts_tso_get16(ip + 4);
+        if (ip[6] != IP_PROTO_TCP) {
+            return false;
+        }
+        memcpy(key, ip + 8, 32);
+        keyLen = 32;
+    }
+    else {
+        return false;
+    }
+    if (ipLen < IP_HLEN || SIZEOF_ETH_HDR + pktLen > len || pktLen < ipLen + TCP_HLEN) {
+        return false;
+    }
+    const uint8_t* th = ip + ipLen;
+    const unsigned int tcpLen = (th[12] >> 4) * 4;
+    if (tcpLen < TCP_HLEN || pktLen < ipLen + tcpLen) {
+        return false;
+    }
+    memcpy(key + keyLen, th, 4);
+    keyLen += 4;
+    const unsigned int payload = pktLen - ipLen - tcpLen;
+    const uint8_t flags = th[13];
+    const uint32_t seq = zts_tso_get32(th + 4);
+
+    if (! tap->_groFlows) {
+        tap->_groFlows = new GroFlow[ZTS_GRO_MAX_FLOWS];
+        memset(tap->_groFlows, 0, sizeof(GroFlow) * ZTS_GRO_MAX_FLOWS);
+    }
+    GroFlow* flow = NULL;
+    GroFlow* slot = NULL;
+    for (int i = 0; i < ZTS_GRO_MAX_FLOWS; i++) {
+        GroFlow* fl = &tap->_groFlows[i];
+        if (! fl->head) {
+            slot = slot ? slot : fl;
+        }
+        else if (fl->netif == n && fl->keyLen == keyLen && ! memcmp(fl->key, key, keyLen)) {
+            flow = fl;
+            break;
+        }
+    }
+    const bool mergeable = payload && ! (flags & ~TCP_ACK);
+    if (mergeable) {
+        tap->_groSegments++;
+    }
+    if (flow) {
+        uint8_t* hip = (uint8_t*)flow->head->payload + SIZEOF_ETH_HDR;
+        uint8_t* hth = hip + flow->ipLen;
+        // Same ACK, window and options, and contiguous with what is held
+        if (mergeable && seq == flow->nextSeq && tcpLen == flow->tcpLen && ipLen == flow->ipLen
+            && ! memcmp(hth + 8, th + 8, 4) && ! memcmp(hth + 14, th + 14, 2)
+            && ! memcmp(hth + TCP_HLEN, th + TCP_HLEN, tcpLen - TCP_HLEN)
+            && flow->head->tot_len + payload <= 0xffff) {
+            pbuf_realloc(p, (u16_t)(SIZEOF_ETH_HDR + pktLen));
+            pbuf_remove_header(p, SIZEOF_ETH_HDR + ipLen + tcpLen);
+            pbuf_cat(flow->head, p);
+            flow->nextSeq += payload;
+            uint16_t merged = (uint16_t)(flow->head->tot_len - SIZEOF_ETH_HDR);
+            if (type == ETHTYPE_IP) {
+                zts_tso_put16(hip + 2, merged);
+            }
+            else {
+                zts_tso_put16(hip + 4, (uint16_t)(merged - IP6_HLEN));
+            }
+            return true;
+        }
+        // Whatever is held goes first to keep the flow in order
+        zts_gro_flush_flow(tap, flow);
+        slot = flow;
+    }
+    if (! mergeable) {
+        return false;
+    }
+    if (! slot) {
+        slot = &tap->_groFlows[0];
+        zts_gro_flush_flow(tap, slot);
+    }
+    pbuf_realloc(p, (u16_t)(SIZEOF_ETH_HDR + pktLen));
+    slot->head = p;
+    slot->netif = n;
+    memcpy(slot->key, key, keyLen);
+    slot->keyLen = keyLen;
+    slot->ipLen = ipLen;
+    slot->tcpLen = tcpLen;
+    slot->nextSeq = seq + payload;
+    return true;
+}
+
 void zts_lwip_eth_rx(
     VirtualTap* tap,
     const MAC& from,
@@ -414,7 +917,7 @@ void zts_lwip_eth_rx(
 #ifdef LWIP_STATS
     stats_display();
 #endif
-    if (! zts_events->getState(ZTS_STATE_STACK_RUNNING)) {
+    if (! Events::stackIsRunning()) {
         return;
     }
     struct pbuf *p, *q;
@@ -450,24 +953,21 @@ void zts_lwip_eth_rx(
         dataptr += q->len;
     }
     // Feed packet into stack
-    int err;
-
+    struct netif* n = NULL;
     if (Utils::ntoh(ethhdr.type) == 0x800 || Utils::ntoh(ethhdr.type) == 0x806) {
-        if (tap->netif4) {
-            if ((err = ((struct netif*)tap->netif4)->input(p, (struct netif*)tap->netif4)) != ERR_OK) {
-                // DEBUG_ERROR("packet input error (%d)", err);
-                pbuf_free(p);
-            }
-        }
+        n = (struct netif*)tap->netif4;
     }
     if (Utils::ntoh(ethhdr.type) == 0x86DD) {
-        if (tap->netif6) {
-            if ((err = ((struct netif*)tap->netif6)->input(p, (struct netif*)tap->netif6)) != ERR_OK) {
-                // DEBUG_ERROR("packet input error (%d)", err);
-                pbuf_free(p);
-            }
-        }
+        n = (struct netif*)tap->netif6;
+    }
+    if (! n) {
+        pbuf_free(p);
+        return;
+    }
+    if (tap->_gro && zts_gro_receive(tap, n, p)) {
+        return;
     }
+    zts_gro_input(n, p);
 }
 
 bool zts_lwip_is_netif_up(void* n)
@@ -481,6 +981,64 @@ bool zts_lwip_is_netif_up(void* n)
     return result;
 }
 
+static void zts_netif_init_offloads(struct netif* n, VirtualTap* tap)
+{
+    u16_t chksum = NETIF_CHECKSUM_ENABLE_ALL;
+    if (tap->_tso) {
+        // TCP checksums are computed per segment by zts_lwip_eth_tx()
+        n->mtu = LWIP_TSO_MTU;
+        chksum &= ~NETIF_CHECKSUM_GEN_TCP;
+    }
+    else {
+        n->mtu = std::min(LWIP_MTU, (int)tap->_mtu);
+    }
+    if (tap->_gro) {
+        chksum &= ~(NETIF_CHECKSUM_CHECK_IP | NETIF_CHECKSUM_CHECK_TCP);
+    }
+    NETIF_SET_CHECKSUM_CTRL(n, chksum);
+}
+
+#if LWIP_IGMP
+static err_t zts_igmp_mac_filter(struct netif* n, const ip4_addr_t* group, enum netif_mac_filter_action action)
+{
+    // The low 23 bits of an IPv4 group are mapped onto 01:00:5e:00:00:00 (RFC 1112)
+    MAC mac(0x01, 0x00, 0x5e, ip4_addr2(group) & 0x7f, ip4_addr3(group), ip4_addr4(group));
+    ((VirtualTap*)n->state)->updateMulticastGroup(MulticastGroup(mac, 0), action == NETIF_ADD_MAC_FILTER);
+    return ERR_OK;
+}
+#endif
+
+#if LWIP_IPV6_MLD
+static err_t zts_mld_mac_filter(struct netif* n, const ip6_addr_t* group, enum netif_mac_filter_action action)
+{
+    // The low 32 bits of an IPv6 group are mapped onto 33:33:00:00:00:00 (RFC 2464)
+    const u8_t* b = (const u8_t*)group->addr + 12;
+    MAC mac(0x33, 0x33, b[0], b[1], b[2], b[3]);
+    ((VirtualTap*)n->state)->updateMulticastGroup(MulticastGroup(mac, 0), action == NETIF_ADD_MAC_FILTER);
+    return ERR_OK;
+}
+#endif
+
+/**
+ * Report the groups that lwIP joins on this netif to ZeroTier. The filters
+ * must be in place before netif_add() starts IGMP and MLD. Each netif carries
+ * one address family and only takes part in that family's protocol, so a group
+ * joined on any interface is not also joined on the other netif of the tap
+ */
+static void zts_netif_init_multicast(struct netif* n, bool v4)
+{
+#if LWIP_IGMP
+    if (v4) {
+        netif_set_igmp_mac_filter(n, zts_igmp_mac_filter);
+    }
+#endif
+#if LWIP_IPV6_MLD
+    if (! v4) {
+        netif_set_mld_mac_filter(n, zts_mld_mac_filter);
+    }
+#endif
+}
+
 static err_t zts_netif_init4(struct netif* n)
 {
     if (! n || ! n->state) {
@@ -493,9 +1051,10 @@ static err_t zts_netif_init4(struct netif* n)
     n->name[1] = 'a' + netifCount;
     n->linkoutput = zts_lwip_eth_tx;
     n->output = etharp_output;
-    n->mtu = std::min(LWIP_MTU, (int)tap->_mtu);
-    n->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET | NETIF_FLAG_IGMP | NETIF_FLAG_MLD6
-               | NETIF_FLAG_LINK_UP | NETIF_FLAG_UP;
+    zts_netif_init_offloads(n, tap);
+    zts_netif_init_multicast(n, true);
+    n->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET | NETIF_FLAG_IGMP | NETIF_FLAG_LINK_UP
+               | NETIF_FLAG_UP;
     n->hwaddr_len = sizeof(n->hwaddr);
     tap->_mac.copyTo(n->hwaddr, n->hwaddr_len);
     return ERR_OK;
@@ -515,9 +1074,10 @@ static err_t zts_netif_init6(struct netif* n)
     n->name[1] = 'a' + netifCount;
     n->linkoutput = zts_lwip_eth_tx;
     n->output_ip6 = ethip6_output;
-    n->mtu = std::min(LWIP_MTU, (int)tap->_mtu);
-    n->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET | NETIF_FLAG_IGMP | NETIF_FLAG_MLD6
-               | NETIF_FLAG_LINK_UP | NETIF_FLAG_UP;
+    zts_netif_init_offloads(n, tap);
+    zts_netif_init_multicast(n, false);
+    n->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET | NETIF_FLAG_MLD6 | NETIF_FLAG_LINK_UP
+               | NETIF_FLAG_UP;
     return ERR_OK;
 }
 
@@ -622,3 +1182,42 @@ void zts_lwip_remove_address_from_netif(void* tapref, const InetAddress& ip)
 }
 
 }   // namespace ZeroTier
+
+struct netif* zts_lwip_route4_src(const ip4_addr_t* src, const ip4_addr_t* dest)
+{
+    // Called without a source by ip4_route()
+    if (! src || ip4_addr_isany(src)) {
+        return NULL;
+    }
+    struct netif* n;
+    NETIF_FOREACH(n)
+    {
+        if (netif_is_up(n) && netif_is_link_up(n) && ip4_addr_cmp(src, netif_ip4_addr(n))
+            && ip4_addr_netcmp(dest, netif_ip4_addr(n), netif_ip4_netmask(n))) {
+            return n;
+        }
+    }
+    return NULL;
+}
+
+struct netif* zts_lwip_route6_src(const ip6_addr_t* src, const ip6_addr_t* dest)
+{
+    if (! src || ip6_addr_isany(src)) {
+        return NULL;
+    }
+    struct netif* n;
+    NETIF_FOREACH(n)
+    {
+        if (! netif_is_up(n) || ! netif_is_link_up(n)) {
+            continue;
+        }
+        for (int i = 0; i < LWIP_IPV6_NUM_ADDRESSES; i++) {
+            const ip6_addr_t* a = netif_ip6_addr(n, i);
+            if (ip6_addr_isvalid(netif_ip6_addr_state(n, i)) && ip6_addr_cmp_zoneless(src, a)
+                && ip6_addr_netcmp_zoneless(dest, a)) {
+                return n;
+            }
+        }
+    }
+    return NULL;
+}
@@ -27,9 +27,13 @@
 
 #include "Events.hpp"
 #include "MAC.hpp"
+#include "MulticastGroup.hpp"
 #include "Phy.hpp"
 #include "Thread.hpp"
 
+#include <atomic>
+#include <map>
+
 namespace ZeroTier {
 
 /* Forward declarations */
@@ -38,6 +42,7 @@ class MAC;
 class MulticastGroup;
 class Events;
 struct InetAddress;
+struct GroFlow;
 
 /**
  * Virtual tap device. ZeroTier will create one per joined network. It will
@@ -117,10 +122,29 @@ class VirtualTap {
     void scanMulticastGroups(std::vector<MulticastGroup>& added, std::vector<MulticastGroup>& removed);
 
     /**
-     * Set MTU
+     * Count a join (or leave) of a multicast group by the stack, called by lwIP's
+     * IGMP and MLD MAC filters
+     */
+    void updateMulticastGroup(const MulticastGroup& mg, bool subscribe);
+
+    /**
+     * Whether the stack joined or left a group since the last scanMulticastGroups()
+     */
+    bool multicastGroupsChanged() const
+    {
+        return _multicastGroupsChanged;
+    }
+
+    /**
+     * Set MTU, also applied to the netifs already added to the stack
      */
     void setMtu(unsigned int mtu);
 
+    /**
+     * Pass received frames held for coalescing on to the stack
+     */
+    void flushRx();
+
     /**
      * Calls main network stack loops
      */
@@ -163,14 +187,28 @@ class VirtualTap {
     volatile bool _run;
     MAC _mac;
     unsigned int _mtu;
+    // Let lwIP build TCP segments larger than the MTU, split by zts_lwip_eth_tx()
+    bool _tso = false;
+    // Merge received TCP segments before they enter lwIP, see zts_lwip_eth_rx()
+    bool _gro = false;
+    GroFlow* _groFlows = NULL;
+    // Segments considered for merging and the packets they entered lwIP as
+    std::atomic<uint64_t> _groSegments { 0 };
+    std::atomic<uint64_t> _groPackets { 0 };
     uint64_t _net_id;
     Phy<VirtualTap*> _phy;
 
     Thread _thread;
+    bool _threaded;
 
     int _shutdownSignalPipe[2] = { 0 };
 
     std::vector<MulticastGroup> _multicastGroups;
+    // Groups joined by the stack, with the number of joins that map onto each MAC
+    std::map<MulticastGroup, unsigned int> _stackMulticastGroups;
+    volatile bool _multicastGroupsChanged = false;
+    // Lock order: _ips_m, then the core lock, then _multicastGroups_m, which the IGMP/MLD filters
+    // take under the core lock. Nothing else may be locked while holding it
     Mutex _multicastGroups_m;
 
     void phyOnTcpConnect(PhySocket* sock, void** uptr, bool success)
@@ -235,13 +273,39 @@ bool zts_lwip_is_up();
 void zts_lwip_driver_init();
 
 /**
- * @brief Shutdown the stack as completely as possible (not officially
- * supported by lwIP)
+ * @brief Initialize the network stack without starting any threads. The caller
+ * is then responsible for calling `zts_lwip_driver_process()`.
+ *
+ * @usage Used instead of `zts_lwip_driver_init()` when the application drives
+ * the library with `zts_process()`
+ */
+void zts_lwip_driver_init_caller_driven();
+
+/**
+ * @brief Returns whether the stack was initialized without threads
+ */
+bool zts_lwip_is_caller_driven();
+
+/**
+ * @brief Run any stack timers that are due.
+ *
+ * @return Milliseconds until the next timer is due
+ */
+unsigned int zts_lwip_driver_process();
+
+/**
+ * @brief Return milliseconds until the next stack timer is due, without running any
+ */
+unsigned int zts_lwip_driver_next_timeout();
+
+/**
+ * @brief Shutdown the stack as completely as lwIP allows
  *
  * @usage This is to be called after it is determined that no further
- * network activity will take place. The tcpip thread will be stopped, all
- * interfaces will be brought down and all resources will be deallocated. A
- * full application restart will be required to bring the stack back online.
+ * network activity will take place. Frames stop being fed into the core and
+ * the interfaces are removed by their taps. lwIP cannot be deinitialized, so
+ * its thread and memory pools are kept and a later `zts_lwip_driver_init()`
+ * brings the stack back online without restarting the application.
  */
 void zts_lwip_driver_shutdown();
 
@@ -250,6 +314,11 @@ void zts_lwip_driver_shutdown();
  */
 void zts_lwip_remove_netif(void* netif);
 
+/**
+ * @brief Set the MTU of a netif. Only connections opened afterwards use the new MSS.
+ */
+void zts_lwip_set_mtu(void* netif, unsigned int mtu);
+
 /**
  * @brief Starts DHCP timers
  */
@@ -306,6 +375,20 @@ void zts_lwip_eth_rx(
     const void* data,
     unsigned int len);
 
+/**
+ * @brief Pass all frames a tap holds for receive coalescing on to the stack.
+ *
+ * @usage Called at the end of each batch of received packets, on the thread
+ * that calls zts_lwip_eth_rx()
+ */
+void zts_lwip_gro_flush(VirtualTap* tap);
+
+/**
+ * @brief Add the number of TCP segments a tap considered for receive
+ * coalescing and the number of packets they were delivered to the stack as
+ */
+void zts_lwip_gro_stats(VirtualTap* tap, uint64_t* segments, uint64_t* packets);
+
 }   // namespace ZeroTier
 
 #endif   // _H
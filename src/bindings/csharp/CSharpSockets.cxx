@@ -1408,6 +1408,82 @@ SWIGEXPORT int SWIGSTDCALL CSharp_zts_bsd_poll(void* jarg1, unsigned int jarg2,
     return jresult;
 }
 
+SWIGEXPORT int SWIGSTDCALL CSharp_zts_poller_new()
+{
+    int jresult;
+    int result;
+    result = (int)zts_poller_new();
+    jresult = result;
+    return jresult;
+}
+
+SWIGEXPORT int SWIGSTDCALL CSharp_zts_poller_free(int jarg1)
+{
+    int jresult;
+    int arg1;
+    int result;
+    arg1 = (int)jarg1;
+    result = (int)zts_poller_free(arg1);
+    jresult = result;
+    return jresult;
+}
+
+SWIGEXPORT int SWIGSTDCALL CSharp_zts_poller_set(int jarg1, int jarg2, short jarg3)
+{
+    int jresult;
+    int arg1;
+    int arg2;
+    short arg3;
+    int result;
+    arg1 = (int)jarg1;
+    arg2 = (int)jarg2;
+    arg3 = (short)jarg3;
+    result = (int)zts_poller_set(arg1, arg2, arg3);
+    jresult = result;
+    return jresult;
+}
+
+SWIGEXPORT int SWIGSTDCALL CSharp_zts_poller_remove(int jarg1, int jarg2)
+{
+    int jresult;
+    int arg1;
+    int arg2;
+    int result;
+    arg1 = (int)jarg1;
+    arg2 = (int)jarg2;
+    result = (int)zts_poller_remove(arg1, arg2);
+    jresult = result;
+    return jresult;
+}
+
+SWIGEXPORT int SWIGSTDCALL CSharp_zts_poller_wait(int jarg1, void* jarg2, int jarg3, int jarg4)
+{
+    int jresult;
+    int arg1;
+    zts_poller_event_t* arg2 = (zts_poller_event_t*)0;
+    int arg3;
+    int arg4;
+    int result;
+    arg1 = (int)jarg1;
+    arg2 = (zts_poller_event_t*)jarg2;
+    arg3 = (int)jarg3;
+    arg4 = (int)jarg4;
+    result = (int)zts_poller_wait(arg1, arg2, arg3, arg4);
+    jresult = result;
+    return jresult;
+}
+
+SWIGEXPORT int SWIGSTDCALL CSharp_zts_poller_wakeup(int jarg1)
+{
+    int jresult;
+    int arg1;
+    int result;
+    arg1 = (int)jarg1;
+    result = (int)zts_poller_wakeup(arg1);
+    jresult = result;
+    return jresult;
+}
+
 SWIGEXPORT int SWIGSTDCALL CSharp_zts_bsd_ioctl(int jarg1, unsigned long jarg2, void* jarg3)
 {
     int jresult;
@@ -1831,6 +1907,17 @@ SWIGEXPORT int SWIGSTDCALL CSharp_zts_get_keepalive(int jarg1)
     return jresult;
 }
 
+SWIGEXPORT int SWIGSTDCALL CSharp_zts_get_socket_error(int jarg1)
+{
+    int jresult;
+    int arg1;
+    int result;
+    arg1 = (int)jarg1;
+    result = (int)zts_get_socket_error(arg1);
+    jresult = result;
+    return jresult;
+}
+
 SWIGEXPORT void* SWIGSTDCALL CSharp_zts_bsd_gethostbyname(char* jarg1)
 {
     void* jresult;
@@ -26,4 +26,23 @@ namespace ZeroTier.Core
         public int Code { get; set; }
         public string Name { get; set; }
     }
+
+    /// <summary>
+    /// Event details passed by reference to a ZeroTierRawEventCallback. Reading an event
+    /// this way allocates nothing, which matters when peers and paths churn.
+    /// </summary>
+    public struct EventData {
+        /// <summary>Event code, see Constants.EVENT_*</summary>
+        public int Code;
+        /// <summary>Node, network or peer ID the event concerns, 0 if none</summary>
+        public ulong Id;
+        /// <summary>Network status for network events, see Constants.NETWORK_STATUS_*</summary>
+        public int NetworkStatus;
+        /// <summary>Latency (ms) for peer events</summary>
+        public int PeerLatency;
+        /// <summary>Role for peer events, see Constants.PEER_ROLE_*</summary>
+        public int PeerRole;
+        /// <summary>Up-to-date state of the network for network and address events, otherwise null</summary>
+        public NetworkInfo Network;
+    }
 }
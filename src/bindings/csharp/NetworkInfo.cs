@@ -30,6 +30,8 @@ namespace ZeroTier.Core
         public bool Bridge;
         public bool BroadcastEnabled;
         internal bool transportReady;   // Synthetic value
+        internal bool _hasConfig;
+        internal ulong _netconfRev;   // Revision of the config last applied to this object
 
         public bool IsPrivate
         {
@@ -63,5 +65,10 @@ namespace ZeroTier.Core
                 return _routes.Values;
             }
         }
+
+        internal void UpdateTransportReady()
+        {
+            transportReady = ! _routes.IsEmpty && ! _addrs.IsEmpty;
+        }
     }
 }
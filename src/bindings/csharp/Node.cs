@@ -28,6 +28,9 @@ namespace ZeroTier.Core
 {
     public delegate void ZeroTierManagedEventCallback(ZeroTier.Core.Event nodeEvent);
 
+    /// <summary>Event callback that receives events without any per-event allocation</summary>
+    public delegate void ZeroTierRawEventCallback(ref ZeroTier.Core.EventData eventData);
+
     public class Node {
         static ulong _id = 0x0;
         static ushort _secondaryPort;
@@ -41,8 +44,14 @@ namespace ZeroTier.Core
         ushort _primaryPort;
 
         static ZeroTierManagedEventCallback _managedCallback;
+        static ZeroTierRawEventCallback _rawCallback;
         CSharpCallbackWithStruct _unmanagedCallback;
 
+        // Scratch space reused by every network update
+        IntPtr _targetBuffer = IntPtr.Zero;
+        IntPtr _viaBuffer = IntPtr.Zero;
+        HashSet<string> _seenRoutes = new HashSet<string>();
+
         ConcurrentDictionary<ulong, ZeroTier.Core.NetworkInfo> _networks =
             new ConcurrentDictionary<ulong, NetworkInfo>();
         ConcurrentDictionary<ulong, ZeroTier.Core.PeerInfo> _peers = new ConcurrentDictionary<ulong, PeerInfo>();
@@ -80,19 +89,48 @@ namespace ZeroTier.Core
             return res;
         }
 
+        int RegisterUnmanagedCallback()
+        {
+            if (_unmanagedCallback != null) {
+                return Constants.ERR_OK;
+            }
+            // Keep a reference to the exact delegate handed to native code so that it is not collected
+            CSharpCallbackWithStruct callback = OnZeroTierEvent;
+            int res = zts_init_set_event_handler(callback);
+            if (res == Constants.ERR_OK) {
+                _unmanagedCallback = callback;
+            }
+            return res;
+        }
+
         public int InitSetEventHandler(ZeroTierManagedEventCallback managedCallback)
         {
             if (managedCallback == null) {
                 throw new ArgumentNullException("managedCallback");
             }
             int res = Constants.ERR_OK;
-            if ((res = zts_init_set_event_handler(OnZeroTierEvent)) == Constants.ERR_OK) {
-                _unmanagedCallback = OnZeroTierEvent;
+            if ((res = RegisterUnmanagedCallback()) == Constants.ERR_OK) {
                 _managedCallback = new ZeroTierManagedEventCallback(managedCallback);
             }
             return res;
         }
 
+        /// <summary>
+        /// Receive events as EventData structs. Unlike InitSetEventHandler() no Event object or
+        /// name string is created per event. May be combined with InitSetEventHandler().
+        /// </summary>
+        public int InitSetRawEventHandler(ZeroTierRawEventCallback rawCallback)
+        {
+            if (rawCallback == null) {
+                throw new ArgumentNullException("rawCallback");
+            }
+            int res = Constants.ERR_OK;
+            if ((res = RegisterUnmanagedCallback()) == Constants.ERR_OK) {
+                _rawCallback = rawCallback;
+            }
+            return res;
+        }
+
         public int InitSetPort(UInt16 port)
         {
             int res = Constants.ERR_OK;
@@ -136,308 +174,332 @@ namespace ZeroTier.Core
             return zts_init_allow_peer_cache(Convert.ToByte(allowed));
         }
 
-        void OnZeroTierEvent(IntPtr msgPtr)
+        unsafe void OnZeroTierEvent(IntPtr msgPtr)
+        {
+            // Every structure below is blittable and read in place rather than copied with Marshal.PtrToStructure
+            zts_event_msg_t* msg = (zts_event_msg_t*)msgPtr;
+            EventData data = new EventData();
+            data.Code = msg->event_code;
+
+            if (msg->node != IntPtr.Zero) {
+                zts_node_info_t* details = (zts_node_info_t*)msg->node;
+                _id = details->node_id;
+                _primaryPort = details->primary_port;
+                _secondaryPort = details->secondary_port;
+                _tertiaryPort = details->tertiary_port;
+                _versionMajor = details->ver_major;
+                _versionMinor = details->ver_minor;
+                _versionRev = details->ver_rev;
+                _isOnline = Convert.ToBoolean(zts_node_is_online());
+                data.Id = details->node_id;
+            }
+            if (msg->network != IntPtr.Zero) {
+                zts_net_info_t* net_info = (zts_net_info_t*)msg->network;
+                data.Id = net_info->net_id;
+                data.NetworkStatus = net_info->status;
+                // Update network info as long as we aren't tearing down the network
+                if (msg->event_code != Constants.EVENT_NETWORK_DOWN) {
+                    data.Network = UpdateNetwork(net_info);
+                }
+            }
+            if (msg->peer != IntPtr.Zero) {
+                zts_peer_info_t* peer_info = (zts_peer_info_t*)msg->peer;
+                data.Id = peer_info->address;
+                data.PeerLatency = peer_info->latency;
+                data.PeerRole = peer_info->role;
+            }
+            if (msg->addr != IntPtr.Zero) {
+                zts_addr_info_t* addr_info = (zts_addr_info_t*)msg->addr;
+                data.Id = addr_info->net_id;
+                data.Network = UpdateAddress(msg->event_code, addr_info);
+            }
+
+            ZeroTierRawEventCallback rawCallback = _rawCallback;
+            if (rawCallback != null) {
+                rawCallback(ref data);
+            }
+            ZeroTierManagedEventCallback managedCallback = _managedCallback;
+            if (managedCallback != null) {
+                ZeroTier.Core.Event newEvent = CreateEvent(msg, ref data);
+                // Pass the converted Event to the managed callback (visible to user)
+                if (newEvent != null) {
+                    managedCallback(newEvent);
+                }
+            }
+        }
+
+        NetworkInfo GetOrAddNetwork(ulong networkId)
+        {
+            NetworkInfo ni;
+            if (! _networks.TryGetValue(networkId, out ni)) {
+                ni = _networks.GetOrAdd(networkId, new NetworkInfo());
+                ni.Id = networkId;
+            }
+            return ni;
+        }
+
+        unsafe NetworkInfo UpdateNetwork(zts_net_info_t* net_info)
+        {
+            ulong networkId = net_info->net_id;
+            NetworkInfo ni = GetOrAddNetwork(networkId);
+            ni.Status = net_info->status;
+
+            // Everything else is derived from the network config, so only revisit it when that changes
+            if (ni._hasConfig && ni._netconfRev == net_info->netconf_rev) {
+                return ni;
+            }
+            ni._hasConfig = true;
+            ni._netconfRev = net_info->netconf_rev;
+            ni.MACAddress = net_info->mac;
+            int nameLen = 0;
+            while (nameLen < 128 && net_info->name[nameLen] != 0) {
+                nameLen++;
+            }
+            byte[] name = new byte[nameLen];
+            for (int i = 0; i < nameLen; i++) {
+                name[i] = net_info->name[i];
+            }
+            ni.Name = System.Text.Encoding.UTF8.GetString(name, 0, nameLen);
+            ni.Type = net_info->type;
+            ni.MTU = net_info->mtu;
+            ni.DHCP = net_info->dhcp;
+            ni.Bridge = Convert.ToBoolean(net_info->bridge);
+            ni.BroadcastEnabled = Convert.ToBoolean(net_info->broadcast_enabled);
+
+            // Reconcile managed routes in place. Assigned addresses arrive as
+            // EVENT_ADDR_* deltas and are handled by UpdateAddress()
+
+            if (_targetBuffer == IntPtr.Zero) {
+                _targetBuffer = Marshal.AllocHGlobal(ZeroTier.Constants.INET6_ADDRSTRLEN);
+                _viaBuffer = Marshal.AllocHGlobal(ZeroTier.Constants.INET6_ADDRSTRLEN);
+            }
+            _seenRoutes.Clear();
+            ushort flags = 0, metric = 0;
+
+            zts_core_lock_obtain();
+            int route_count = zts_core_query_route_count(networkId);
+            for (int idx = 0; idx < route_count; idx++) {
+                zts_core_query_route(
+                    networkId,
+                    idx,
+                    _targetBuffer,
+                    _viaBuffer,
+                    ZeroTier.Constants.INET6_ADDRSTRLEN,
+                    ref flags,
+                    ref metric);
+                string targetStr = Marshal.PtrToStringAnsi(_targetBuffer);
+                string viaStr = Marshal.PtrToStringAnsi(_viaBuffer);
+                _seenRoutes.Add(targetStr);
+                RouteInfo existing;
+                if (ni._routes.TryGetValue(targetStr, out existing) && existing._flags == flags
+                    && existing._metric == metric && existing._via != null && existing._via.ToString() == viaStr) {
+                    continue;
+                }
+                try {
+                    ni._routes[targetStr] = new RouteInfo(IPAddress.Parse(targetStr), IPAddress.Parse(viaStr), flags, metric);
+                }
+                catch {
+                    Console.WriteLine("error while parsing route");
+                }
+            }
+            zts_core_lock_release();
+
+            foreach (string key in ni._routes.Keys) {
+                if (! _seenRoutes.Contains(key)) {
+                    ni._routes.TryRemove(key, out _);
+                }
+            }
+            ni.UpdateTransportReady();
+            return ni;
+        }
+
+        unsafe NetworkInfo UpdateAddress(int eventCode, zts_addr_info_t* addr_info)
+        {
+            NetworkInfo ni = GetOrAddNetwork(addr_info->net_id);
+            IPAddress addr = SockaddrToIPAddress(addr_info->addr);
+            if (addr == null) {
+                return ni;
+            }
+            if (eventCode == Constants.EVENT_ADDR_ADDED_IP4 || eventCode == Constants.EVENT_ADDR_ADDED_IP6) {
+                ni._addrs[addr.ToString()] = addr;
+            }
+            if (eventCode == Constants.EVENT_ADDR_REMOVED_IP4 || eventCode == Constants.EVENT_ADDR_REMOVED_IP6) {
+                ni._addrs.TryRemove(addr.ToString(), out _);
+            }
+            ni.UpdateTransportReady();
+            return ni;
+        }
+
+        /// <summary>Convert a zts_sockaddr_storage to an IPAddress, or null if the family is unknown</summary>
+        static unsafe IPAddress SockaddrToIPAddress(byte* ss)
+        {
+            byte[] bytes;
+            int offset;
+            if (ss[1] == Constants.AF_INET) {
+                bytes = new byte[4];
+                offset = 4;   // sin_len, sin_family, sin_port
+            }
+            else if (ss[1] == Constants.AF_INET6) {
+                bytes = new byte[16];
+                offset = 8;   // sin6_len, sin6_family, sin6_port, sin6_flowinfo
+            }
+            else {
+                return null;
+            }
+            for (int i = 0; i < bytes.Length; i++) {
+                bytes[i] = ss[offset + i];
+            }
+            return new IPAddress(bytes);
+        }
+
+        unsafe ZeroTier.Core.Event CreateEvent(zts_event_msg_t* msg, ref EventData data)
         {
-            zts_event_msg_t msg = (zts_event_msg_t)Marshal.PtrToStructure(msgPtr, typeof(zts_event_msg_t));
             ZeroTier.Core.Event newEvent = null;
 
             // Node
 
-            if (msg.node != IntPtr.Zero) {
-                zts_node_info_t details = (zts_node_info_t)Marshal.PtrToStructure(msg.node, typeof(zts_node_info_t));
+            if (msg->node != IntPtr.Zero) {
                 newEvent = new ZeroTier.Core.Event();
-                newEvent.Code = msg.event_code;
-                _id = details.node_id;
-                _primaryPort = details.primary_port;
-                _secondaryPort = details.secondary_port;
-                _tertiaryPort = details.tertiary_port;
-                _versionMajor = details.ver_major;
-                _versionMinor = details.ver_minor;
-                _versionRev = details.ver_rev;
-                _isOnline = Convert.ToBoolean(zts_node_is_online());
+                newEvent.Code = msg->event_code;
 
-                if (msg.event_code == Constants.EVENT_NODE_UP) {
+                if (msg->event_code == Constants.EVENT_NODE_UP) {
                     newEvent.Name = "EVENT_NODE_UP";
                 }
-                if (msg.event_code == Constants.EVENT_NODE_ONLINE) {
+                if (msg->event_code == Constants.EVENT_NODE_ONLINE) {
                     newEvent.Name = "EVENT_NODE_ONLINE";
                 }
-                if (msg.event_code == Constants.EVENT_NODE_OFFLINE) {
+                if (msg->event_code == Constants.EVENT_NODE_OFFLINE) {
                     newEvent.Name = "EVENT_NODE_OFFLINE";
                 }
-                if (msg.event_code == Constants.EVENT_NODE_DOWN) {
+                if (msg->event_code == Constants.EVENT_NODE_DOWN) {
                     newEvent.Name = "EVENT_NODE_DOWN";
                 }
-                if (msg.event_code == Constants.ZTS_EVENT_NODE_FATAL_ERROR) {
+                if (msg->event_code == Constants.ZTS_EVENT_NODE_FATAL_ERROR) {
                     newEvent.Name = "EVENT_NODE_FATAL_ERROR";
                 }
             }
 
             // Network
 
-            if (msg.network != IntPtr.Zero) {
-                zts_net_info_t net_info = (zts_net_info_t)Marshal.PtrToStructure(msg.network, typeof(zts_net_info_t));
+            if (msg->network != IntPtr.Zero) {
                 newEvent = new ZeroTier.Core.Event();
-                newEvent.Code = msg.event_code;
+                newEvent.Code = msg->event_code;
+                newEvent.NetworkInfo = data.Network;
+                string netIdStr = data.Id.ToString("x16");
 
-                // Update network info as long as we aren't tearing down the network
-                if (msg.event_code != Constants.EVENT_NETWORK_DOWN) {
-                    ulong networkId = net_info.net_id;
-                    NetworkInfo ni = _networks.GetOrAdd(networkId, new NetworkInfo());
-
-                    newEvent.NetworkInfo = ni;
-                    newEvent.NetworkInfo.Id = net_info.net_id;
-                    newEvent.NetworkInfo.MACAddress = net_info.mac;
-                    newEvent.NetworkInfo.Name = System.Text.Encoding.UTF8.GetString(net_info.name);
-                    newEvent.NetworkInfo.Status = net_info.status;
-                    newEvent.NetworkInfo.Type = net_info.type;
-                    newEvent.NetworkInfo.MTU = net_info.mtu;
-                    newEvent.NetworkInfo.DHCP = net_info.dhcp;
-                    newEvent.NetworkInfo.Bridge = Convert.ToBoolean(net_info.bridge);
-                    newEvent.NetworkInfo.BroadcastEnabled = Convert.ToBoolean(net_info.broadcast_enabled);
-
-                    zts_core_lock_obtain();
-
-                    // Get assigned addresses
-
-                    ConcurrentDictionary<string, IPAddress> newAddrsDict =
-                        new ConcurrentDictionary<string, IPAddress>();
-                    IntPtr addrBuffer = Marshal.AllocHGlobal(ZeroTier.Constants.INET6_ADDRSTRLEN);
-                    int addr_count = zts_core_query_addr_count(networkId);
-
-                    for (int idx = 0; idx < addr_count; idx++) {
-                        zts_core_query_addr(networkId, idx, addrBuffer, ZeroTier.Constants.INET6_ADDRSTRLEN);
-                        // Convert buffer to managed string
-                        string str = Marshal.PtrToStringAnsi(addrBuffer);
-                        IPAddress addr = IPAddress.Parse(str);
-                        newAddrsDict[addr.ToString()] = addr;
-                    }
-
-                    // Update addresses in NetworkInfo object
-
-                    // TODO: This update block works but could use a re-think, I think.
-                    // Step 1. Remove addresses not present in new concurrent dict.
-                    if (! ni._addrs.IsEmpty) {
-                        foreach (string key in ni._addrs.Keys) {
-                            if (! newAddrsDict.Keys.Contains(key)) {
-                                ni._addrs.TryRemove(key, out _);
-                            }
-                        }
-                    }
-                    else {
-                        ni._addrs = newAddrsDict;
-                    }
-                    // Step 2. Add addresses not present in existing concurrent dict.
-                    foreach (string key in newAddrsDict.Keys) {
-                        if (! ni._addrs.Keys.Contains(key)) {
-                            ni._addrs[key] = newAddrsDict[key];
-                        }
-                    }
-
-                    Marshal.FreeHGlobal(addrBuffer);
-                    addrBuffer = IntPtr.Zero;
-
-                    // Get managed routes
-
-                    ConcurrentDictionary<string, RouteInfo> newRoutesDict =
-                        new ConcurrentDictionary<string, RouteInfo>();
-                    IntPtr targetBuffer = Marshal.AllocHGlobal(ZeroTier.Constants.INET6_ADDRSTRLEN);
-                    IntPtr viaBuffer = Marshal.AllocHGlobal(ZeroTier.Constants.INET6_ADDRSTRLEN);
-
-                    int route_count = zts_core_query_route_count(networkId);
-
-                    ushort flags = 0, metric = 0;
-
-                    for (int idx = 0; idx < route_count; idx++) {
-                        zts_core_query_route(
-                            networkId,
-                            idx,
-                            targetBuffer,
-                            viaBuffer,
-                            ZeroTier.Constants.INET6_ADDRSTRLEN,
-                            ref flags,
-                            ref metric);
-
-                        // Convert buffer to managed string
-
-                        try {
-                            string targetStr = Marshal.PtrToStringAnsi(targetBuffer);
-                            IPAddress targetAddr = IPAddress.Parse(targetStr);
-                            string viaStr = Marshal.PtrToStringAnsi(viaBuffer);
-                            IPAddress viaAddr = IPAddress.Parse(viaStr);
-                            RouteInfo route = new RouteInfo(targetAddr, viaAddr, flags, metric);
-                            // Add to NetworkInfo object
-                            newRoutesDict[targetStr] = route;
-                        }
-                        catch {
-                            Console.WriteLine("error while parsing route");
-                        }
-                    }
-
-                    // TODO: This update block works but could use a re-think, I think.
-                    // Step 1. Remove routes not present in new concurrent dict.
-                    if (! ni._routes.IsEmpty) {
-                        foreach (string key in ni._routes.Keys) {
-                            if (! newRoutesDict.Keys.Contains(key)) {
-                                ni._routes.TryRemove(key, out _);
-                            }
-                        }
-                    }
-                    else {
-                        ni._routes = newRoutesDict;
-                    }
-                    // Step 2. Add routes not present in existing concurrent dict.
-                    foreach (string key in newRoutesDict.Keys) {
-                        if (! ni._routes.Keys.Contains(key)) {
-                            ni._routes[key] = newRoutesDict[key];
-                        }
-                    }
-
-                    Marshal.FreeHGlobal(targetBuffer);
-                    Marshal.FreeHGlobal(viaBuffer);
-                    targetBuffer = IntPtr.Zero;
-                    viaBuffer = IntPtr.Zero;
-
-                    // Get multicast subscriptions
-
-                    zts_core_lock_release();
-
-                    // Update synthetic "readiness" value
-                    ni.transportReady = (route_count > 0) && (addr_count > 0) ? true : false;
-                }   // EVENT_NETWORK_DOWN
-
-                if (msg.event_code == Constants.EVENT_NETWORK_NOT_FOUND) {
-                    newEvent.Name = "EVENT_NETWORK_NOT_FOUND " + net_info.net_id.ToString("x16");
-                }
-                if (msg.event_code == Constants.EVENT_NETWORK_REQ_CONFIG) {
-                    newEvent.Name = "EVENT_NETWORK_REQ_CONFIG " + net_info.net_id.ToString("x16");
+                if (msg->event_code == Constants.EVENT_NETWORK_NOT_FOUND) {
+                    newEvent.Name = "EVENT_NETWORK_NOT_FOUND " + netIdStr;
                 }
-                if (msg.event_code == Constants.EVENT_NETWORK_ACCESS_DENIED) {
-                    newEvent.Name = "EVENT_NETWORK_ACCESS_DENIED " + net_info.net_id.ToString("x16");
+                if (msg->event_code == Constants.EVENT_NETWORK_REQ_CONFIG) {
+                    newEvent.Name = "EVENT_NETWORK_REQ_CONFIG " + netIdStr;
                 }
-                if (msg.event_code == Constants.EVENT_NETWORK_READY_IP4) {
-                    newEvent.Name = "EVENT_NETWORK_READY_IP4 " + net_info.net_id.ToString("x16");
+                if (msg->event_code == Constants.EVENT_NETWORK_ACCESS_DENIED) {
+                    newEvent.Name = "EVENT_NETWORK_ACCESS_DENIED " + netIdStr;
                 }
-                if (msg.event_code == Constants.EVENT_NETWORK_READY_IP6) {
-                    newEvent.Name = "EVENT_NETWORK_READY_IP6 " + net_info.net_id.ToString("x16");
+                if (msg->event_code == Constants.EVENT_NETWORK_READY_IP4) {
+                    newEvent.Name = "EVENT_NETWORK_READY_IP4 " + netIdStr;
                 }
-                if (msg.event_code == Constants.EVENT_NETWORK_DOWN) {
-                    newEvent.Name = "EVENT_NETWORK_DOWN " + net_info.net_id.ToString("x16");
+                if (msg->event_code == Constants.EVENT_NETWORK_READY_IP6) {
+                    newEvent.Name = "EVENT_NETWORK_READY_IP6 " + netIdStr;
                 }
-                if (msg.event_code == Constants.EVENT_NETWORK_CLIENT_TOO_OLD) {
-                    newEvent.Name = "EVENT_NETWORK_CLIENT_TOO_OLD " + net_info.net_id.ToString("x16");
+                if (msg->event_code == Constants.EVENT_NETWORK_DOWN) {
+                    newEvent.Name = "EVENT_NETWORK_DOWN " + netIdStr;
                 }
-                if (msg.event_code == Constants.EVENT_NETWORK_REQ_CONFIG) {
-                    newEvent.Name = "EVENT_NETWORK_REQ_CONFIG " + net_info.net_id.ToString("x16");
+                if (msg->event_code == Constants.EVENT_NETWORK_CLIENT_TOO_OLD) {
+                    newEvent.Name = "EVENT_NETWORK_CLIENT_TOO_OLD " + netIdStr;
                 }
-                if (msg.event_code == Constants.EVENT_NETWORK_OK) {
-                    newEvent.Name = "EVENT_NETWORK_OK " + net_info.net_id.ToString("x16");
+                if (msg->event_code == Constants.EVENT_NETWORK_OK) {
+                    newEvent.Name = "EVENT_NETWORK_OK " + netIdStr;
                 }
-                if (msg.event_code == Constants.EVENT_NETWORK_ACCESS_DENIED) {
-                    newEvent.Name = "EVENT_NETWORK_ACCESS_DENIED " + net_info.net_id.ToString("x16");
+                if (msg->event_code == Constants.EVENT_NETWORK_READY_IP4_IP6) {
+                    newEvent.Name = "EVENT_NETWORK_READY_IP4_IP6 " + netIdStr;
                 }
-                if (msg.event_code == Constants.EVENT_NETWORK_READY_IP4_IP6) {
-                    newEvent.Name = "EVENT_NETWORK_READY_IP4_IP6 " + net_info.net_id.ToString("x16");
-                }
-                if (msg.event_code == Constants.EVENT_NETWORK_UPDATE) {
-                    newEvent.Name = "EVENT_NETWORK_UPDATE " + net_info.net_id.ToString("x16");
+                if (msg->event_code == Constants.EVENT_NETWORK_UPDATE) {
+                    newEvent.Name = "EVENT_NETWORK_UPDATE " + netIdStr;
                 }
             }
 
             // Route
 
-            if (msg.route != IntPtr.Zero) {
-                zts_route_info_t route_info =
-                    (zts_route_info_t)Marshal.PtrToStructure(msg.route, typeof(zts_route_info_t));
+            if (msg->route != IntPtr.Zero) {
                 newEvent = new ZeroTier.Core.Event();
-                newEvent.Code = msg.event_code;
-                // newEvent.RouteInfo = default;   // new RouteInfo();
+                newEvent.Code = msg->event_code;
 
-                if (msg.event_code == Constants.EVENT_ROUTE_ADDED) {
+                if (msg->event_code == Constants.EVENT_ROUTE_ADDED) {
                     newEvent.Name = "EVENT_ROUTE_ADDED";
                 }
-                if (msg.event_code == Constants.EVENT_ROUTE_REMOVED) {
+                if (msg->event_code == Constants.EVENT_ROUTE_REMOVED) {
                     newEvent.Name = "EVENT_ROUTE_REMOVED";
                 }
             }
 
             // Peer
 
-            if (msg.peer != IntPtr.Zero) {
-                zts_peer_info_t peer_info = (zts_peer_info_t)Marshal.PtrToStructure(msg.peer, typeof(zts_peer_info_t));
+            if (msg->peer != IntPtr.Zero) {
                 newEvent = new ZeroTier.Core.Event();
-                newEvent.Code = msg.event_code;
-                // newEvent.PeerInfo = default;   // new PeerInfo();
+                newEvent.Code = msg->event_code;
 
-                if (peer_info.role == Constants.PEER_ROLE_PLANET) {
+                if (data.PeerRole == Constants.PEER_ROLE_PLANET) {
                     newEvent.Name = "PEER_ROLE_PLANET";
                 }
-                if (msg.event_code == Constants.EVENT_PEER_DIRECT) {
+                if (msg->event_code == Constants.EVENT_PEER_DIRECT) {
                     newEvent.Name = "EVENT_PEER_DIRECT";
                 }
-                if (msg.event_code == Constants.EVENT_PEER_RELAY) {
+                if (msg->event_code == Constants.EVENT_PEER_RELAY) {
                     newEvent.Name = "EVENT_PEER_RELAY";
                 }
-                // newEvent = new ZeroTier.Core.Event(msg.event_code,"EVENT_PEER_UNREACHABLE");
-                if (msg.event_code == Constants.EVENT_PEER_PATH_DISCOVERED) {
+                if (msg->event_code == Constants.EVENT_PEER_PATH_DISCOVERED) {
                     newEvent.Name = "EVENT_PEER_PATH_DISCOVERED";
                 }
-                if (msg.event_code == Constants.EVENT_PEER_PATH_DEAD) {
+                if (msg->event_code == Constants.EVENT_PEER_PATH_DEAD) {
                     newEvent.Name = "EVENT_PEER_PATH_DEAD";
                 }
             }
 
             // Address
 
-            if (msg.addr != IntPtr.Zero) {
-                zts_addr_info_t unmanagedDetails =
-                    (zts_addr_info_t)Marshal.PtrToStructure(msg.addr, typeof(zts_addr_info_t));
+            if (msg->addr != IntPtr.Zero) {
                 newEvent = new ZeroTier.Core.Event();
-                newEvent.Code = msg.event_code;
-                // newEvent.AddressInfo = default;   // new AddressInfo();
+                newEvent.Code = msg->event_code;
+                newEvent.NetworkInfo = data.Network;
 
-                if (msg.event_code == Constants.EVENT_ADDR_ADDED_IP4) {
+                if (msg->event_code == Constants.EVENT_ADDR_ADDED_IP4) {
                     newEvent.Name = "EVENT_ADDR_ADDED_IP4";
                 }
-                if (msg.event_code == Constants.EVENT_ADDR_ADDED_IP6) {
+                if (msg->event_code == Constants.EVENT_ADDR_ADDED_IP6) {
                     newEvent.Name = "EVENT_ADDR_ADDED_IP6";
                 }
-                if (msg.event_code == Constants.EVENT_ADDR_REMOVED_IP4) {
+                if (msg->event_code == Constants.EVENT_ADDR_REMOVED_IP4) {
                     newEvent.Name = "EVENT_ADDR_REMOVED_IP4";
                 }
-                if (msg.event_code == Constants.EVENT_ADDR_REMOVED_IP6) {
+                if (msg->event_code == Constants.EVENT_ADDR_REMOVED_IP6) {
                     newEvent.Name = "EVENT_ADDR_REMOVED_IP6";
                 }
             }
 
             // Storage
 
-            if (msg.cache != IntPtr.Zero) {
+            if (msg->cache != IntPtr.Zero) {
                 newEvent = new ZeroTier.Core.Event();
-                newEvent.Code = msg.event_code;
-                // newEvent.AddressInfo = default;   // new AddressInfo();
+                newEvent.Code = msg->event_code;
 
-                if (msg.event_code == Constants.EVENT_STORE_IDENTITY_SECRET) {
+                if (msg->event_code == Constants.EVENT_STORE_IDENTITY_SECRET) {
                     newEvent.Name = "EVENT_STORE_IDENTITY_SECRET";
                 }
-                if (msg.event_code == Constants.EVENT_STORE_IDENTITY_PUBLIC) {
+                if (msg->event_code == Constants.EVENT_STORE_IDENTITY_PUBLIC) {
                     newEvent.Name = "EVENT_STORE_IDENTITY_PUBLIC";
                 }
-                if (msg.event_code == Constants.EVENT_STORE_PLANET) {
+                if (msg->event_code == Constants.EVENT_STORE_PLANET) {
                     newEvent.Name = "EVENT_STORE_PLANET";
                 }
-                if (msg.event_code == Constants.EVENT_STORE_PEER) {
+                if (msg->event_code == Constants.EVENT_STORE_PEER) {
                     newEvent.Name = "EVENT_STORE_PEER";
                 }
-                if (msg.event_code == Constants.EVENT_STORE_NETWORK) {
+                if (msg->event_code == Constants.EVENT_STORE_NETWORK) {
                     newEvent.Name = "EVENT_STORE_NETWORK";
                 }
             }
-
-            // Pass the converted Event to the managed callback (visible to user)
-            if (newEvent != null) {
-                _managedCallback(newEvent);
-            }
+            return newEvent;
         }
 
         public List<NetworkInfo> Networks
@@ -511,7 +573,14 @@ namespace ZeroTier.Core
             _id = 0x0;
             _hasBeenFreed = true;
             ClearNode();
-            return zts_node_free();
+            int res = zts_node_free();
+            if (_targetBuffer != IntPtr.Zero) {
+                Marshal.FreeHGlobal(_targetBuffer);
+                Marshal.FreeHGlobal(_viaBuffer);
+                _targetBuffer = IntPtr.Zero;
+                _viaBuffer = IntPtr.Zero;
+            }
+            return res;
         }
 
         public int Stop()
@@ -800,11 +869,10 @@ namespace ZeroTier.Core
         }
 
         [StructLayout(LayoutKind.Sequential)]
-        struct zts_net_info_t {
+        unsafe struct zts_net_info_t {
             public ulong net_id;
             public ulong mac;
-            [MarshalAs(UnmanagedType.ByValArray, SizeConst = 128)]
-            public byte[] name;
+            public fixed byte name[128];
             public int status;
             public int type;
             public uint mtu;
@@ -825,9 +893,9 @@ namespace ZeroTier.Core
         }
 
         [StructLayout(LayoutKind.Sequential)]
-        struct zts_addr_info_t {
-            ulong nwid;
-            IntPtr addr;
+        unsafe struct zts_addr_info_t {
+            public ulong net_id;
+            public fixed byte addr[28];   // struct zts_sockaddr_storage
         }
 
         [StructLayout(LayoutKind.Sequential)]
@@ -15,6 +15,10 @@ using System;
 using System.Net;
 using System.Net.Sockets;
 using System.Runtime.InteropServices;
+#if NETSTANDARD2_1_OR_GREATER || NETCOREAPP3_0_OR_GREATER
+using System.Threading;
+using System.Threading.Tasks;
+#endif
 
 using ZeroTier;
 
@@ -233,6 +237,9 @@ namespace ZeroTier.Sockets
             if (_isClosed) {
                 throw new ObjectDisposedException("Socket has already been closed");
             }
+#if NETSTANDARD2_1_OR_GREATER || NETCOREAPP3_0_OR_GREATER
+            SocketPoller.Forget(_fd);
+#endif
             zts_bsd_close(_fd);
             _isClosed = true;
         }
@@ -290,6 +297,15 @@ namespace ZeroTier.Sockets
         }
 
         public Int32 Send(Byte[] buffer)
+        {
+            if (buffer == null) {
+                throw new ArgumentNullException("buffer");
+            }
+            return Send(buffer, 0, buffer.Length);
+        }
+
+        /// <summary>Send size bytes of buffer starting at offset</summary>
+        public unsafe Int32 Send(Byte[] buffer, int offset, int size)
         {
             if (_isClosed) {
                 throw new ObjectDisposedException("Socket has been closed");
@@ -300,12 +316,27 @@ namespace ZeroTier.Sockets
             if (buffer == null) {
                 throw new ArgumentNullException("buffer");
             }
+            if (offset < 0 || size < 0 || offset > buffer.Length - size) {
+                throw new ArgumentOutOfRangeException("offset");
+            }
             int flags = 0;
-            IntPtr bufferPtr = Marshal.UnsafeAddrOfPinnedArrayElement(buffer, 0);
-            return zts_bsd_send(_fd, bufferPtr, (uint)Buffer.ByteLength(buffer), (int)flags);
+            // The array must stay pinned for as long as the native call can see it
+            fixed (byte* bufferPtr = buffer)
+            {
+                return zts_bsd_send(_fd, (IntPtr)(bufferPtr + offset), (uint)size, (int)flags);
+            }
         }
 
         public Int32 Receive(Byte[] buffer)
+        {
+            if (buffer == null) {
+                throw new ArgumentNullException("buffer");
+            }
+            return Receive(buffer, 0, buffer.Length);
+        }
+
+        /// <summary>Receive up to size bytes into buffer starting at offset</summary>
+        public unsafe Int32 Receive(Byte[] buffer, int offset, int size)
         {
             if (_isClosed) {
                 throw new ObjectDisposedException("Socket has been closed");
@@ -316,11 +347,195 @@ namespace ZeroTier.Sockets
             if (buffer == null) {
                 throw new ArgumentNullException("buffer");
             }
+            if (offset < 0 || size < 0 || offset > buffer.Length - size) {
+                throw new ArgumentOutOfRangeException("offset");
+            }
             int flags = 0;
-            IntPtr bufferPtr = Marshal.UnsafeAddrOfPinnedArrayElement(buffer, 0);
-            return zts_bsd_recv(_fd, bufferPtr, (uint)Buffer.ByteLength(buffer), (int)flags);
+            fixed (byte* bufferPtr = buffer)
+            {
+                return zts_bsd_recv(_fd, (IntPtr)(bufferPtr + offset), (uint)size, (int)flags);
+            }
+        }
+
+#if NETSTANDARD2_1_OR_GREATER || NETCOREAPP3_0_OR_GREATER
+        SocketOperation _readOperation;
+        SocketOperation _writeOperation;
+
+        internal int FileDescriptor
+        {
+            get {
+                return _fd;
+            }
+        }
+
+        private void EnsureUsable()
+        {
+            if (_isClosed) {
+                throw new ObjectDisposedException("Socket has been closed");
+            }
+            if (_fd < 0) {
+                throw new ZeroTier.Sockets.SocketException((int)ZeroTier.Constants.ERR_SOCKET);
+            }
+        }
+
+        private SocketOperation ReadOperation
+        {
+            get {
+                if (_readOperation == null) {
+                    Interlocked.CompareExchange(ref _readOperation, new SocketOperation(this, true), null);
+                }
+                return _readOperation;
+            }
+        }
+
+        private SocketOperation WriteOperation
+        {
+            get {
+                if (_writeOperation == null) {
+                    Interlocked.CompareExchange(ref _writeOperation, new SocketOperation(this, false), null);
+                }
+                return _writeOperation;
+            }
+        }
+
+        private static bool WouldBlock(int errno)
+        {
+            return errno == Constants.EAGAIN || errno == Constants.EWOULDBLOCK;
+        }
+
+        internal unsafe int TryReceive(Span<byte> buffer, int flags)
+        {
+            fixed (byte* bufferPtr = buffer)
+            {
+                return zts_bsd_recv(_fd, (IntPtr)bufferPtr, (uint)buffer.Length, flags | (ushort)Constants.MSG_DONTWAIT);
+            }
+        }
+
+        internal unsafe int TrySend(ReadOnlySpan<byte> buffer, int flags)
+        {
+            fixed (byte* bufferPtr = buffer)
+            {
+                return zts_bsd_send(_fd, (IntPtr)bufferPtr, (uint)buffer.Length, flags | (ushort)Constants.MSG_DONTWAIT);
+            }
+        }
+
+        /// <summary>Send the contents of a span without copying it</summary>
+        public unsafe Int32 Send(ReadOnlySpan<byte> buffer)
+        {
+            EnsureUsable();
+            fixed (byte* bufferPtr = buffer)
+            {
+                return zts_bsd_send(_fd, (IntPtr)bufferPtr, (uint)buffer.Length, 0);
+            }
+        }
+
+        /// <summary>Receive directly into a span without an intermediate copy</summary>
+        public unsafe Int32 Receive(Span<byte> buffer)
+        {
+            EnsureUsable();
+            fixed (byte* bufferPtr = buffer)
+            {
+                return zts_bsd_recv(_fd, (IntPtr)bufferPtr, (uint)buffer.Length, 0);
+            }
+        }
+
+        /// <summary>
+        /// Receive into buffer without blocking the calling thread. Completion is driven by a shared
+        /// native poller; the buffer is only pinned while data is being copied into it.
+        /// </summary>
+        /// <returns>Number of bytes received, 0 if the peer has closed the connection</returns>
+        public ValueTask<int> ReceiveAsync(Memory<byte> buffer, CancellationToken cancellationToken = default)
+        {
+            EnsureUsable();
+            int result = TryReceive(buffer.Span, 0);
+            if (result >= 0) {
+                return new ValueTask<int>(result);
+            }
+            int errno = ErrNo;
+            if (! WouldBlock(errno)) {
+                throw new ZeroTier.Sockets.SocketException(result, errno);
+            }
+            return ReadOperation.StartReceive(buffer, 0, cancellationToken);
+        }
+
+        /// <summary>
+        /// Send from buffer without blocking the calling thread
+        /// </summary>
+        /// <returns>Number of bytes sent, which may be less than the length of buffer</returns>
+        public ValueTask<int> SendAsync(ReadOnlyMemory<byte> buffer, CancellationToken cancellationToken = default)
+        {
+            EnsureUsable();
+            int result = TrySend(buffer.Span, 0);
+            if (result >= 0) {
+                return new ValueTask<int>(result);
+            }
+            int errno = ErrNo;
+            if (! WouldBlock(errno)) {
+                throw new ZeroTier.Sockets.SocketException(result, errno);
+            }
+            return WriteOperation.StartSend(buffer, 0, cancellationToken);
         }
 
+        /// <summary>Wait for an incoming connection without blocking the calling thread</summary>
+        public async ValueTask<Socket> AcceptAsync(CancellationToken cancellationToken = default)
+        {
+            EnsureUsable();
+            if (_isListening == false) {
+                throw new InvalidOperationException("Socket is not in a listening state. Call Listen() first");
+            }
+            await ReadOperation.StartWait(cancellationToken).ConfigureAwait(false);
+            return Accept();
+        }
+
+        /// <summary>Connect without blocking the calling thread</summary>
+        public async ValueTask ConnectAsync(IPEndPoint remoteEndPoint, CancellationToken cancellationToken = default)
+        {
+            EnsureUsable();
+            if (remoteEndPoint == null) {
+                throw new ArgumentNullException("remoteEndPoint");
+            }
+            bool wasBlocking = Blocking;
+            Blocking = false;
+            try {
+                int err = BeginConnect(remoteEndPoint);
+                if (err < 0) {
+                    int errno = ErrNo;
+                    if (errno != Constants.EINPROGRESS) {
+                        throw new ZeroTier.Sockets.SocketException(err, errno);
+                    }
+                    await WriteOperation.StartWait(cancellationToken).ConfigureAwait(false);
+                    int socketError = zts_get_socket_error(_fd);
+                    if (socketError != 0) {
+                        throw new ZeroTier.Sockets.SocketException((int)Constants.ERR_SOCKET, socketError);
+                    }
+                }
+            }
+            finally {
+                if (wasBlocking && ! _isClosed) {
+                    Blocking = true;
+                }
+            }
+            _remoteEndPoint = remoteEndPoint;
+            _isConnected = true;
+        }
+
+        private unsafe int BeginConnect(IPEndPoint remoteEndPoint)
+        {
+            // Large enough for a zts_sockaddr_storage
+            byte* addr = stackalloc byte[128];
+            uint addrlen = 128;
+            int err = zts_util_ipstr_to_saddr(
+                remoteEndPoint.Address.ToString(),
+                remoteEndPoint.Port,
+                (IntPtr)addr,
+                (IntPtr)(&addrlen));
+            if (err < 0) {
+                throw new ZeroTier.Sockets.SocketException(err);
+            }
+            return zts_bsd_connect(_fd, (IntPtr)addr, (ushort)addrlen);
+        }
+#endif
+
         public int ReceiveTimeout
         {
             get {
@@ -642,6 +857,9 @@ namespace ZeroTier.Sockets
         [DllImport("libzt", EntryPoint = "CSharp_zts_get_keepalive")]
         static extern int zts_get_keepalive(int fd);
 
+        [DllImport("libzt", EntryPoint = "CSharp_zts_get_socket_error")]
+        static extern int zts_get_socket_error(int fd);
+
         [DllImport("libzt", EntryPoint = "CSharp_zts_add_dns_nameserver")]
         static extern int zts_add_dns_nameserver(IntPtr arg1);
 
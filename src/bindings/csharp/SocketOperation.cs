@@ -0,0 +1,197 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+#if NETSTANDARD2_1_OR_GREATER || NETCOREAPP3_0_OR_GREATER
+
+using System;
+using System.Threading;
+using System.Threading.Tasks;
+using System.Threading.Tasks.Sources;
+
+using ZeroTier;
+
+namespace ZeroTier.Sockets
+{
+    /// <summary>
+    /// Reusable awaitable for one direction (read or write) of a socket. Each Socket owns at most
+    /// one of each, so steady-state asynchronous I/O does not allocate.
+    /// </summary>
+    internal sealed class SocketOperation : IValueTaskSource<int> {
+        internal enum Kind
+        {
+            Receive,
+            Send,
+            // Completes with the poll events once the socket is readable or writable
+            Readable,
+            Writable
+        }
+
+        static readonly Action<object> _cancelCallback = s => ((SocketOperation)s).Cancel();
+
+        readonly Socket _socket;
+        readonly bool _isRead;
+        ManualResetValueTaskSourceCore<int> _core;
+        Kind _kind;
+        Memory<byte> _receiveBuffer;
+        ReadOnlyMemory<byte> _sendBuffer;
+        int _flags;
+        CancellationToken _cancellationToken;
+        CancellationTokenRegistration _cancellationRegistration;
+        int _busy;
+        int _cancelRequested;
+
+        internal SocketOperation(Socket socket, bool isRead)
+        {
+            _socket = socket;
+            _isRead = isRead;
+            _core.RunContinuationsAsynchronously = true;
+        }
+
+        internal bool IsRead
+        {
+            get {
+                return _isRead;
+            }
+        }
+
+        internal int Fd
+        {
+            get {
+                return _socket.FileDescriptor;
+            }
+        }
+
+        ValueTask<int> Start(Kind kind, CancellationToken cancellationToken)
+        {
+            if (Interlocked.Exchange(ref _busy, 1) != 0) {
+                throw new InvalidOperationException("An asynchronous operation of this kind is already in progress");
+            }
+            _core.Reset();
+            _kind = kind;
+            _cancelRequested = 0;
+            _cancellationToken = cancellationToken;
+            short version = _core.Version;
+            SocketPoller poller = SocketPoller.Instance;
+            if (cancellationToken.CanBeCanceled) {
+                _cancellationRegistration = cancellationToken.Register(_cancelCallback, this);
+            }
+            int err = poller.Arm(Fd, this);
+            if (err < 0) {
+                Fail(err);
+            }
+            else if (Volatile.Read(ref _cancelRequested) != 0 && poller.Disarm(Fd, this)) {
+                // Cancelled before it was armed
+                _core.SetException(new OperationCanceledException(_cancellationToken));
+            }
+            return new ValueTask<int>(this, version);
+        }
+
+        internal ValueTask<int> StartReceive(Memory<byte> buffer, int flags, CancellationToken cancellationToken)
+        {
+            _receiveBuffer = buffer;
+            _flags = flags;
+            return Start(Kind.Receive, cancellationToken);
+        }
+
+        internal ValueTask<int> StartSend(ReadOnlyMemory<byte> buffer, int flags, CancellationToken cancellationToken)
+        {
+            _sendBuffer = buffer;
+            _flags = flags;
+            return Start(Kind.Send, cancellationToken);
+        }
+
+        internal ValueTask<int> StartWait(CancellationToken cancellationToken)
+        {
+            return Start(_isRead ? Kind.Readable : Kind.Writable, cancellationToken);
+        }
+
+        /// <summary>
+        /// Called on the poller thread once the socket reports readiness.
+        /// Returns false if the operation would still block and must wait again.
+        /// </summary>
+        internal bool OnReady(short revents)
+        {
+            if (Volatile.Read(ref _cancelRequested) != 0) {
+                _core.SetException(new OperationCanceledException(_cancellationToken));
+                return true;
+            }
+            int result;
+            switch (_kind) {
+                case Kind.Receive:
+                    result = _socket.TryReceive(_receiveBuffer.Span, _flags);
+                    break;
+                case Kind.Send:
+                    result = _socket.TrySend(_sendBuffer.Span, _flags);
+                    break;
+                default:
+                    _core.SetResult(revents);
+                    return true;
+            }
+            if (result < 0) {
+                int errno = Socket.ErrNo;
+                if (errno == Constants.EAGAIN || errno == Constants.EWOULDBLOCK) {
+                    return false;
+                }
+                _core.SetException(new ZeroTier.Sockets.SocketException(result, errno));
+                return true;
+            }
+            _core.SetResult(result);
+            return true;
+        }
+
+        internal void Fail(int err)
+        {
+            _core.SetException(new ZeroTier.Sockets.SocketException(err));
+        }
+
+        void Cancel()
+        {
+            Volatile.Write(ref _cancelRequested, 1);
+            // If the poller thread has already claimed the operation it observes the flag instead
+            if (SocketPoller.Instance.Disarm(Fd, this)) {
+                _core.SetException(new OperationCanceledException(_cancellationToken));
+            }
+        }
+
+        public int GetResult(short token)
+        {
+            try {
+                return _core.GetResult(token);
+            }
+            finally {
+                _cancellationRegistration.Dispose();
+                _cancellationRegistration = default(CancellationTokenRegistration);
+                _cancellationToken = default(CancellationToken);
+                _receiveBuffer = default(Memory<byte>);
+                _sendBuffer = default(ReadOnlyMemory<byte>);
+                Volatile.Write(ref _busy, 0);
+            }
+        }
+
+        public ValueTaskSourceStatus GetStatus(short token)
+        {
+            return _core.GetStatus(token);
+        }
+
+        public void OnCompleted(
+            Action<object> continuation,
+            object state,
+            short token,
+            ValueTaskSourceOnCompletedFlags flags)
+        {
+            _core.OnCompleted(continuation, state, token, flags);
+        }
+    }
+}
+
+#endif
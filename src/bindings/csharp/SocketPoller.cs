@@ -0,0 +1,267 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+#if NETSTANDARD2_1_OR_GREATER || NETCOREAPP3_0_OR_GREATER
+
+using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+using ZeroTier;
+
+namespace ZeroTier.Sockets
+{
+    /// <summary>
+    /// Process-wide readiness dispatcher for asynchronous socket operations. Every socket
+    /// with a pending async operation is registered with a single native zts_poller and one
+    /// background thread completes operations as their sockets become ready, so the number
+    /// of threads does not grow with the number of sockets.
+    /// </summary>
+    internal sealed class SocketPoller {
+        const int MaxEvents = 256;
+
+        static readonly object _instanceLock = new object();
+        static SocketPoller _instance;
+
+        /// <summary>A socket's pending operations, reused for as long as the socket is open</summary>
+        sealed class Registration {
+            public SocketOperation Reader;
+            public SocketOperation Writer;
+        }
+
+        readonly int _pfd;
+        readonly object _lock = new object();
+        readonly Dictionary<int, Registration> _registrations = new Dictionary<int, Registration>();
+        readonly zts_poller_event_t[] _events = new zts_poller_event_t[MaxEvents];
+        readonly List<SocketOperation> _ready = new List<SocketOperation>();
+        readonly List<short> _readyEvents = new List<short>();
+        readonly Thread _thread;
+
+        SocketPoller(int pfd)
+        {
+            _pfd = pfd;
+            _thread = new Thread(Run);
+            _thread.IsBackground = true;
+            _thread.Name = "ZeroTier socket poller";
+            _thread.Start();
+        }
+
+        internal static SocketPoller Instance
+        {
+            get {
+                lock (_instanceLock) {
+                    if (_instance == null) {
+                        int pfd = zts_poller_new();
+                        if (pfd < 0) {
+                            throw new ZeroTier.Sockets.SocketException(pfd);
+                        }
+                        _instance = new SocketPoller(pfd);
+                    }
+                    return _instance;
+                }
+            }
+        }
+
+        /// <summary>Forget a socket that is being closed. Safe to call if no poller exists</summary>
+        internal static void Forget(int fd)
+        {
+            SocketPoller poller;
+            lock (_instanceLock) {
+                poller = _instance;
+            }
+            if (poller != null) {
+                lock (poller._lock) {
+                    poller._registrations.Remove(fd);
+                }
+            }
+        }
+
+        short InterestOf(Registration reg)
+        {
+            short events = 0;
+            if (reg.Reader != null) {
+                events |= Constants.POLLIN;
+            }
+            if (reg.Writer != null) {
+                events |= Constants.POLLOUT;
+            }
+            return events;
+        }
+
+        void UpdateInterest(int fd, Registration reg)
+        {
+            short events = InterestOf(reg);
+            if (events != 0) {
+                zts_poller_set(_pfd, fd, events);
+            }
+            else {
+                zts_poller_remove(_pfd, fd);
+            }
+        }
+
+        /// <summary>Wait for the socket to become ready for the given operation</summary>
+        internal int Arm(int fd, SocketOperation op)
+        {
+            lock (_lock) {
+                Registration reg;
+                if (! _registrations.TryGetValue(fd, out reg)) {
+                    reg = new Registration();
+                    _registrations.Add(fd, reg);
+                }
+                if (op.IsRead) {
+                    reg.Reader = op;
+                }
+                else {
+                    reg.Writer = op;
+                }
+                int err = zts_poller_set(_pfd, fd, InterestOf(reg));
+                if (err < 0) {
+                    if (op.IsRead) {
+                        reg.Reader = null;
+                    }
+                    else {
+                        reg.Writer = null;
+                    }
+                }
+                return err;
+            }
+        }
+
+        /// <summary>
+        /// Withdraw an operation that has not yet been picked up by the poller thread.
+        /// Returns false if the poller thread already owns it.
+        /// </summary>
+        internal bool Disarm(int fd, SocketOperation op)
+        {
+            lock (_lock) {
+                Registration reg;
+                if (! _registrations.TryGetValue(fd, out reg)) {
+                    return false;
+                }
+                if (reg.Reader == op) {
+                    reg.Reader = null;
+                }
+                else if (reg.Writer == op) {
+                    reg.Writer = null;
+                }
+                else {
+                    return false;
+                }
+                UpdateInterest(fd, reg);
+                return true;
+            }
+        }
+
+        unsafe void Run()
+        {
+            short failed = (short)((ushort)Constants.POLLERR | (ushort)Constants.POLLHUP | (ushort)Constants.POLLNVAL);
+            while (true) {
+                int n;
+                fixed (zts_poller_event_t* events = _events)
+                {
+                    n = zts_poller_wait(_pfd, (IntPtr)events, MaxEvents, -1);
+                }
+                if (n < 0) {
+                    Shutdown(n);
+                    return;
+                }
+                // Claim ready operations under the lock, then run them outside of it
+                lock (_lock) {
+                    for (int i = 0; i < n; i++) {
+                        Registration reg;
+                        if (! _registrations.TryGetValue(_events[i].fd, out reg)) {
+                            continue;
+                        }
+                        short revents = _events[i].revents;
+                        if (reg.Reader != null && (revents & (Constants.POLLIN | failed)) != 0) {
+                            _ready.Add(reg.Reader);
+                            _readyEvents.Add(revents);
+                            reg.Reader = null;
+                        }
+                        if (reg.Writer != null && (revents & (Constants.POLLOUT | failed)) != 0) {
+                            _ready.Add(reg.Writer);
+                            _readyEvents.Add(revents);
+                            reg.Writer = null;
+                        }
+                        UpdateInterest(_events[i].fd, reg);
+                    }
+                }
+                for (int i = 0; i < _ready.Count; i++) {
+                    SocketOperation op = _ready[i];
+                    if (! op.OnReady(_readyEvents[i])) {
+                        // Spurious wakeup, wait again
+                        int err = Arm(op.Fd, op);
+                        if (err < 0) {
+                            op.Fail(err);
+                        }
+                    }
+                }
+                _ready.Clear();
+                _readyEvents.Clear();
+            }
+        }
+
+        /// <summary>Fail everything still pending once the poller can no longer be used</summary>
+        void Shutdown(int err)
+        {
+            lock (_instanceLock) {
+                if (_instance == this) {
+                    _instance = null;
+                }
+            }
+            List<SocketOperation> pending = new List<SocketOperation>();
+            lock (_lock) {
+                foreach (Registration reg in _registrations.Values) {
+                    if (reg.Reader != null) {
+                        pending.Add(reg.Reader);
+                    }
+                    if (reg.Writer != null) {
+                        pending.Add(reg.Writer);
+                    }
+                }
+                _registrations.Clear();
+            }
+            foreach (SocketOperation op in pending) {
+                op.Fail(err);
+            }
+            zts_poller_free(_pfd);
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        struct zts_poller_event_t {
+            public int fd;
+            public short revents;
+        }
+
+        [DllImport("libzt", EntryPoint = "CSharp_zts_poller_new")]
+        static extern int zts_poller_new();
+
+        [DllImport("libzt", EntryPoint = "CSharp_zts_poller_free")]
+        static extern int zts_poller_free(int pfd);
+
+        [DllImport("libzt", EntryPoint = "CSharp_zts_poller_set")]
+        static extern int zts_poller_set(int pfd, int fd, short events);
+
+        [DllImport("libzt", EntryPoint = "CSharp_zts_poller_remove")]
+        static extern int zts_poller_remove(int pfd, int fd);
+
+        [DllImport("libzt", EntryPoint = "CSharp_zts_poller_wait")]
+        static extern int zts_poller_wait(int pfd, IntPtr events, int max_events, int timeout_ms);
+
+        [DllImport("libzt", EntryPoint = "CSharp_zts_poller_wakeup")]
+        static extern int zts_poller_wakeup(int pfd);
+    }
+}
+
+#endif
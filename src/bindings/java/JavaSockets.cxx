@@ -26,7 +26,9 @@
 #include "lwip/sockets.h"
 #include "lwip/stats.h"
 
+#include <algorithm>
 #include <jni.h>
+#include <vector>
 
 extern int zts_errno;
 
@@ -70,13 +72,14 @@ JNIEXPORT jint JNICALL Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1socket(
     return retval > -1 ? retval : -(zts_errno);   // Encode lwIP errno into return value for JNI functions only
 }
 
-/*
 JNIEXPORT jint JNICALL
 Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1connect(JNIEnv* env, jobject thisObj, jint fd, jobject addr)
 {
     struct zts_sockaddr_storage ss;
+    memset(&ss, 0, sizeof(ss));
     zta2ss(env, &ss, addr);
-    socklen_t addrlen = ss.ss_family == ZTS_AF_INET ? sizeof(struct zts_sockaddr_in) : sizeof(struct zts_sockaddr_in6);
+    zts_socklen_t addrlen =
+        ss.ss_family == ZTS_AF_INET ? sizeof(struct zts_sockaddr_in) : sizeof(struct zts_sockaddr_in6);
     int retval = zts_bsd_connect(fd, (struct zts_sockaddr*)&ss, addrlen);
     return retval > -1 ? retval : -(zts_errno);
 }
@@ -85,13 +88,13 @@ JNIEXPORT jint JNICALL
 Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1bind(JNIEnv* env, jobject thisObj, jint fd, jobject addr)
 {
     struct zts_sockaddr_storage ss;
+    memset(&ss, 0, sizeof(ss));
     zta2ss(env, &ss, addr);
     zts_socklen_t addrlen =
         ss.ss_family == ZTS_AF_INET ? sizeof(struct zts_sockaddr_in) : sizeof(struct zts_sockaddr_in6);
     int retval = zts_bsd_bind(fd, (struct zts_sockaddr*)&ss, addrlen);
     return retval > -1 ? retval : -(zts_errno);
 }
-*/
 
 JNIEXPORT jint JNICALL
 Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1listen(JNIEnv* env, jobject thisObj, jint fd, int backlog)
@@ -101,12 +104,14 @@ Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1listen(JNIEnv* env, jobject thisO
 }
 
 JNIEXPORT jint JNICALL
-Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1accept(JNIEnv* env, jobject thisObj, jint fd, jobject addr, jint port)
+Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1accept(JNIEnv* env, jobject thisObj, jint fd, jobject addr)
 {
     struct zts_sockaddr_storage ss;
     zts_socklen_t addrlen = sizeof(struct zts_sockaddr_storage);
     int retval = zts_bsd_accept(fd, (zts_sockaddr*)&ss, &addrlen);
-    ss2zta(env, &ss, addr);
+    if (retval > -1) {
+        ss2zta(env, &ss, addr);
+    }
     return retval > -1 ? retval : -(zts_errno);
 }
 /*
@@ -196,13 +201,15 @@ JNIEXPORT jint JNICALL Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1getsockopt
 }
 */
 
-JNIEXPORT jboolean JNICALL
+JNIEXPORT jint JNICALL
 Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1getsockname(JNIEnv* env, jobject thisObj, jint fd, jobject addr)
 {
     struct zts_sockaddr_storage ss;
     zts_socklen_t addrlen = sizeof(struct zts_sockaddr_storage);
     int retval = zts_bsd_getsockname(fd, (struct zts_sockaddr*)&ss, &addrlen);
-    ss2zta(env, &ss, addr);
+    if (retval > -1) {
+        ss2zta(env, &ss, addr);
+    }
     return retval > -1 ? retval : -(zts_errno);
 }
 
@@ -210,9 +217,11 @@ JNIEXPORT jint JNICALL
 Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1getpeername(JNIEnv* env, jobject thisObj, jint fd, jobject addr)
 {
     struct zts_sockaddr_storage ss;
-    int retval =
-        zts_bsd_getpeername(fd, (struct zts_sockaddr*)&ss, (zts_socklen_t*)sizeof(struct zts_sockaddr_storage));
-    ss2zta(env, &ss, addr);
+    zts_socklen_t addrlen = sizeof(struct zts_sockaddr_storage);
+    int retval = zts_bsd_getpeername(fd, (struct zts_sockaddr*)&ss, &addrlen);
+    if (retval > -1) {
+        ss2zta(env, &ss, addr);
+    }
     return retval > -1 ? retval : -(zts_errno);
 }
 
@@ -405,9 +414,12 @@ JNIEXPORT jint JNICALL Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1write_1off
     jint offset,
     jint len)
 {
-    void* data = env->GetPrimitiveArrayCritical(&(buf[offset]), NULL);   // PENDING: check?
-    int retval = zts_bsd_write(fd, data, len);
-    env->ReleasePrimitiveArrayCritical(buf, data, 0);
+    if (offset < 0 || len < 0 || (offset + len) > env->GetArrayLength(buf)) {
+        return ZTS_ERR_ARG;
+    }
+    void* data = env->GetPrimitiveArrayCritical(buf, NULL);
+    int retval = zts_bsd_write(fd, (char*)data + offset, len);
+    env->ReleasePrimitiveArrayCritical(buf, data, JNI_ABORT);
     return retval > -1 ? retval : -(zts_errno);
 }
 
@@ -418,6 +430,199 @@ Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1write_1byte(JNIEnv* env, jobject
     return retval > -1 ? retval : -(zts_errno);
 }
 
+/*
+ * The following functions operate on direct java.nio.ByteBuffer objects. The
+ * backing memory of a direct buffer lives outside of the Java heap and will not
+ * be moved by the garbage collector, so unlike the byte[] variants above no JNI
+ * critical region is held while the (possibly blocking) socket call runs.
+ * Only the bytes in [position, limit) are used.
+ */
+
+static char* zts_direct_buffer_region(JNIEnv* env, jobject buf, jint position, jint limit)
+{
+    if (! buf || position < 0 || limit < position) {
+        return NULL;
+    }
+    char* data = (char*)env->GetDirectBufferAddress(buf);
+    if (! data || limit > env->GetDirectBufferCapacity(buf)) {
+        return NULL;
+    }
+    return data + position;
+}
+
+JNIEXPORT jint JNICALL Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1read_1direct(
+    JNIEnv* env,
+    jobject thisObj,
+    jint fd,
+    jobject buf,
+    jint position,
+    jint limit)
+{
+    char* data = zts_direct_buffer_region(env, buf, position, limit);
+    if (! data) {
+        return ZTS_ERR_ARG;
+    }
+    int retval = zts_bsd_read(fd, data, limit - position);
+    return retval > -1 ? retval : -(zts_errno);
+}
+
+JNIEXPORT jint JNICALL Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1recv_1direct(
+    JNIEnv* env,
+    jobject thisObj,
+    jint fd,
+    jobject buf,
+    jint position,
+    jint limit,
+    jint flags)
+{
+    char* data = zts_direct_buffer_region(env, buf, position, limit);
+    if (! data) {
+        return ZTS_ERR_ARG;
+    }
+    int retval = zts_bsd_recv(fd, data, limit - position, flags);
+    return retval > -1 ? retval : -(zts_errno);
+}
+
+JNIEXPORT jint JNICALL Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1write_1direct(
+    JNIEnv* env,
+    jobject thisObj,
+    jint fd,
+    jobject buf,
+    jint position,
+    jint limit)
+{
+    char* data = zts_direct_buffer_region(env, buf, position, limit);
+    if (! data) {
+        return ZTS_ERR_ARG;
+    }
+    int retval = zts_bsd_write(fd, data, limit - position);
+    return retval > -1 ? retval : -(zts_errno);
+}
+
+JNIEXPORT jint JNICALL Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1send_1direct(
+    JNIEnv* env,
+    jobject thisObj,
+    jint fd,
+    jobject buf,
+    jint position,
+    jint limit,
+    jint flags)
+{
+    char* data = zts_direct_buffer_region(env, buf, position, limit);
+    if (! data) {
+        return ZTS_ERR_ARG;
+    }
+    int retval = zts_bsd_send(fd, data, limit - position, flags);
+    return retval > -1 ? retval : -(zts_errno);
+}
+
+JNIEXPORT jint JNICALL Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1recvfrom_1direct(
+    JNIEnv* env,
+    jobject thisObj,
+    jint fd,
+    jobject buf,
+    jint position,
+    jint limit,
+    jint flags,
+    jobject addr)
+{
+    char* data = zts_direct_buffer_region(env, buf, position, limit);
+    if (! data) {
+        return ZTS_ERR_ARG;
+    }
+    struct zts_sockaddr_storage ss;
+    memset(&ss, 0, sizeof(ss));
+    zts_socklen_t addrlen = sizeof(struct zts_sockaddr_storage);
+    int retval = zts_bsd_recvfrom(fd, data, limit - position, flags, (struct zts_sockaddr*)&ss, &addrlen);
+    if (retval > -1) {
+        ss2zta(env, &ss, addr);
+    }
+    return retval > -1 ? retval : -(zts_errno);
+}
+
+JNIEXPORT jint JNICALL Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1sendto_1direct(
+    JNIEnv* env,
+    jobject thisObj,
+    jint fd,
+    jobject buf,
+    jint position,
+    jint limit,
+    jint flags,
+    jobject addr)
+{
+    char* data = zts_direct_buffer_region(env, buf, position, limit);
+    if (! data) {
+        return ZTS_ERR_ARG;
+    }
+    struct zts_sockaddr_storage ss;
+    memset(&ss, 0, sizeof(ss));
+    zta2ss(env, &ss, addr);
+    zts_socklen_t addrlen =
+        ss.ss_family == ZTS_AF_INET ? sizeof(struct zts_sockaddr_in) : sizeof(struct zts_sockaddr_in6);
+    int retval = zts_bsd_sendto(fd, data, limit - position, flags, (struct zts_sockaddr*)&ss, addrlen);
+    return retval > -1 ? retval : -(zts_errno);
+}
+
+/*
+ * Poller. Readiness is reported into a pair of int arrays rather than an array
+ * of objects so that a selector can reuse them across calls without allocating.
+ * The native wait happens before any array is touched so no critical region is
+ * held while blocked.
+ */
+
+JNIEXPORT jint JNICALL Java_com_zerotier_sdk_ZeroTierNative_zts_1poller_1new(JNIEnv* env, jobject thisObj)
+{
+    return zts_poller_new();
+}
+
+JNIEXPORT jint JNICALL Java_com_zerotier_sdk_ZeroTierNative_zts_1poller_1free(JNIEnv* env, jobject thisObj, jint pfd)
+{
+    return zts_poller_free(pfd);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_zerotier_sdk_ZeroTierNative_zts_1poller_1set(JNIEnv* env, jobject thisObj, jint pfd, jint fd, jint events)
+{
+    return zts_poller_set(pfd, fd, (short)events);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_zerotier_sdk_ZeroTierNative_zts_1poller_1remove(JNIEnv* env, jobject thisObj, jint pfd, jint fd)
+{
+    return zts_poller_remove(pfd, fd);
+}
+
+JNIEXPORT jint JNICALL Java_com_zerotier_sdk_ZeroTierNative_zts_1poller_1wait(
+    JNIEnv* env,
+    jobject thisObj,
+    jint pfd,
+    jintArray fds,
+    jintArray revents,
+    jint timeout_ms)
+{
+    if (! fds || ! revents) {
+        return ZTS_ERR_ARG;
+    }
+    int max_events = std::min(env->GetArrayLength(fds), env->GetArrayLength(revents));
+    if (max_events <= 0) {
+        return ZTS_ERR_ARG;
+    }
+    std::vector<zts_poller_event_t> events(max_events);
+    int retval = zts_poller_wait(pfd, events.data(), max_events, timeout_ms);
+    for (int i = 0; i < retval; i++) {
+        jint fd = events[i].fd;
+        jint ev = events[i].revents;
+        env->SetIntArrayRegion(fds, i, 1, &fd);
+        env->SetIntArrayRegion(revents, i, 1, &ev);
+    }
+    return retval;
+}
+
+JNIEXPORT jint JNICALL Java_com_zerotier_sdk_ZeroTierNative_zts_1poller_1wakeup(JNIEnv* env, jobject thisObj, jint pfd)
+{
+    return zts_poller_wakeup(pfd);
+}
+
 JNIEXPORT jint JNICALL
 Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1shutdown(JNIEnv* env, jobject thisObj, int fd, int how)
 {
@@ -1060,6 +1265,12 @@ JNIEXPORT jint JNICALL Java_com_zerotier_sdk_ZeroTierNative_zts_1get_1keepalive(
     return zts_get_keepalive(fd);
 }
 
+JNIEXPORT jint JNICALL
+Java_com_zerotier_sdk_ZeroTierNative_zts_1get_1socket_1error(JNIEnv* jenv, jobject thisObj, jint fd)
+{
+    return zts_get_socket_error(fd);
+}
+
 struct hostent*
 Java_com_zerotier_sdk_ZeroTierNative_zts_1bsd_1gethostbyname(JNIEnv* jenv, jobject thisObj, jstring name)
 {
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+package com.zerotier.sdk;
+
+import java.nio.ByteBuffer;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.atomic.AtomicInteger;
+
+/**
+ * Process-wide pool of direct ByteBuffers used by the ZeroTier streams. Direct
+ * buffers are expensive to allocate and are only reclaimed by the garbage
+ * collector lazily, so they are recycled here instead.
+ */
+public class ZeroTierBufferPool {
+    /**
+     * Size of each pooled buffer
+     */
+    public static final int BUFFER_SIZE = 16384;
+
+    /**
+     * Maximum number of idle buffers retained by the pool
+     */
+    public static final int MAX_IDLE_BUFFERS = 64;
+
+    private static final ConcurrentLinkedQueue<ByteBuffer> _idle = new ConcurrentLinkedQueue<ByteBuffer>();
+    private static final AtomicInteger _idleCount = new AtomicInteger(0);
+
+    private ZeroTierBufferPool()
+    {
+    }
+
+    /**
+     * Take a cleared direct buffer from the pool, allocating one if none are idle
+     * @return A direct buffer of BUFFER_SIZE bytes
+     */
+    public static ByteBuffer acquire()
+    {
+        ByteBuffer buf = _idle.poll();
+        if (buf == null) {
+            return ByteBuffer.allocateDirect(BUFFER_SIZE);
+        }
+        _idleCount.decrementAndGet();
+        buf.clear();
+        return buf;
+    }
+
+    /**
+     * Return a buffer to the pool. Buffers beyond MAX_IDLE_BUFFERS are left to the garbage collector
+     * @param buf Buffer previously obtained from acquire()
+     */
+    public static void release(ByteBuffer buf)
+    {
+        if (buf == null || ! buf.isDirect() || buf.capacity() != BUFFER_SIZE) {
+            return;
+        }
+        if (_idleCount.incrementAndGet() > MAX_IDLE_BUFFERS) {
+            _idleCount.decrementAndGet();
+            return;
+        }
+        _idle.offer(buf);
+    }
+}
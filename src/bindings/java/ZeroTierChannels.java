@@ -0,0 +1,326 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+package com.zerotier.sdk;
+
+import com.zerotier.sdk.ZeroTierNative;
+import java.io.IOException;
+import java.net.InetSocketAddress;
+import java.net.SocketAddress;
+import java.net.SocketOption;
+import java.net.StandardSocketOptions;
+import java.nio.ByteBuffer;
+import java.nio.channels.UnresolvedAddressException;
+import java.nio.channels.UnsupportedAddressTypeException;
+
+/**
+ * I/O, address and option helpers shared by the ZeroTier NIO channels. Used internally.
+ *
+ * All native calls return a negative errno on failure. Heap buffers are staged
+ * through a pooled direct buffer so that no JNI critical region is held while
+ * the native layer blocks.
+ */
+final class ZeroTierChannels {
+    private ZeroTierChannels()
+    {
+    }
+
+    /**
+     * Throw if a native call failed, otherwise return its result
+     */
+    static int check(int retval, String op) throws IOException
+    {
+        if (retval < 0) {
+            throw new IOException(op + ", errno=" + retval);
+        }
+        return retval;
+    }
+
+    /**
+     * Whether a native call failed only because a non-blocking socket was not ready
+     */
+    static boolean wouldBlock(int retval)
+    {
+        return retval == -ZeroTierNative.ZTS_EAGAIN || retval == -ZeroTierNative.ZTS_EWOULDBLOCK;
+    }
+
+    /**
+     * Convert a java.net address into one the native layer understands
+     */
+    static ZeroTierSocketAddress toNative(SocketAddress addr)
+    {
+        if (! (addr instanceof InetSocketAddress)) {
+            throw new UnsupportedAddressTypeException();
+        }
+        InetSocketAddress isa = (InetSocketAddress)addr;
+        if (isa.isUnresolved()) {
+            throw new UnresolvedAddressException();
+        }
+        return new ZeroTierSocketAddress(isa.getAddress().getHostAddress(), isa.getPort());
+    }
+
+    /**
+     * Convert an address returned by the native layer into a java.net address
+     */
+    static InetSocketAddress fromNative(ZeroTierSocketAddress addr)
+    {
+        return new InetSocketAddress(addr.ipString(), addr.getPort());
+    }
+
+    /**
+     * Wildcard address of the given family, used when binding to a null address
+     */
+    static ZeroTierSocketAddress anyAddress(int family)
+    {
+        return new ZeroTierSocketAddress(family == ZeroTierNative.ZTS_AF_INET6 ? "::" : "0.0.0.0", 0);
+    }
+
+    static InetSocketAddress localAddress(int fd) throws IOException
+    {
+        ZeroTierSocketAddress addr = new ZeroTierSocketAddress();
+        check(ZeroTierNative.zts_bsd_getsockname(fd, addr), "getsockname()");
+        return fromNative(addr);
+    }
+
+    static void configureBlocking(int fd, boolean block) throws IOException
+    {
+        int err = ZeroTierNative.zts_set_blocking(fd, block ? 1 : 0);
+        if (err < 0) {
+            throw new IOException("configureBlocking(), error=" + err);
+        }
+    }
+
+    /**
+     * Block the calling thread until fd reports one of the ZTS_POLL* events in events
+     */
+    static void waitFor(int fd, int events) throws IOException
+    {
+        ZeroTierFileDescriptorSet r = new ZeroTierFileDescriptorSet();
+        ZeroTierFileDescriptorSet w = new ZeroTierFileDescriptorSet();
+        while (true) {
+            r.ZERO();
+            w.ZERO();
+            if ((events & ZeroTierNative.ZTS_POLLIN) != 0) {
+                r.SET(fd);
+            }
+            if ((events & ZeroTierNative.ZTS_POLLOUT) != 0) {
+                w.SET(fd);
+            }
+            int retval = ZeroTierNative.zts_bsd_select(fd + 1, r, w, null, 1, 0);
+            if (retval > 0) {
+                return;
+            }
+            if (retval < 0 && retval != -ZeroTierNative.ZTS_EINTR) {
+                throw new IOException("select(), errno=" + retval);
+            }
+            if (Thread.currentThread().isInterrupted()) {
+                return;
+            }
+        }
+    }
+
+    /**
+     * Read into the remaining space of dst, advancing its position
+     * @return Raw return value of the native read
+     */
+    static int read(int fd, ByteBuffer dst)
+    {
+        if (dst.isDirect()) {
+            int retval = ZeroTierNative.zts_bsd_read_direct(fd, dst, dst.position(), dst.limit());
+            if (retval > 0) {
+                dst.position(dst.position() + retval);
+            }
+            return retval;
+        }
+        ByteBuffer buf = ZeroTierBufferPool.acquire();
+        try {
+            int retval = ZeroTierNative.zts_bsd_read_direct(fd, buf, 0, Math.min(dst.remaining(), buf.capacity()));
+            if (retval > 0) {
+                buf.limit(retval);
+                dst.put(buf);
+            }
+            return retval;
+        }
+        finally {
+            ZeroTierBufferPool.release(buf);
+        }
+    }
+
+    /**
+     * Write the remaining bytes of src, advancing its position by the number written
+     * @return Raw return value of the native write
+     */
+    static int write(int fd, ByteBuffer src)
+    {
+        if (src.isDirect()) {
+            int retval = ZeroTierNative.zts_bsd_write_direct(fd, src, src.position(), src.limit());
+            if (retval > 0) {
+                src.position(src.position() + retval);
+            }
+            return retval;
+        }
+        ByteBuffer buf = ZeroTierBufferPool.acquire();
+        try {
+            int len = stage(src, buf);
+            int retval = ZeroTierNative.zts_bsd_write_direct(fd, buf, 0, len);
+            if (retval > 0) {
+                src.position(src.position() + retval);
+            }
+            return retval;
+        }
+        finally {
+            ZeroTierBufferPool.release(buf);
+        }
+    }
+
+    /**
+     * Receive a datagram into dst, filling in the sender's address
+     * @return Raw return value of the native recvfrom
+     */
+    static int recvfrom(int fd, ByteBuffer dst, ZeroTierSocketAddress from)
+    {
+        if (dst.isDirect()) {
+            int retval = ZeroTierNative.zts_bsd_recvfrom_direct(fd, dst, dst.position(), dst.limit(), 0, from);
+            if (retval > 0) {
+                dst.position(dst.position() + retval);
+            }
+            return retval;
+        }
+        ByteBuffer buf = ZeroTierBufferPool.acquire();
+        try {
+            int retval =
+                ZeroTierNative.zts_bsd_recvfrom_direct(fd, buf, 0, Math.min(dst.remaining(), buf.capacity()), 0, from);
+            if (retval > 0) {
+                buf.limit(retval);
+                dst.put(buf);
+            }
+            return retval;
+        }
+        finally {
+            ZeroTierBufferPool.release(buf);
+        }
+    }
+
+    /**
+     * Send the remaining bytes of src as one datagram
+     * @return Raw return value of the native sendto
+     */
+    static int sendto(int fd, ByteBuffer src, ZeroTierSocketAddress to)
+    {
+        if (src.isDirect()) {
+            int retval = ZeroTierNative.zts_bsd_sendto_direct(fd, src, src.position(), src.limit(), 0, to);
+            if (retval > 0) {
+                src.position(src.position() + retval);
+            }
+            return retval;
+        }
+        ByteBuffer buf = ZeroTierBufferPool.acquire();
+        try {
+            int len = stage(src, buf);
+            int retval = ZeroTierNative.zts_bsd_sendto_direct(fd, buf, 0, len, 0, to);
+            if (retval > 0) {
+                src.position(src.position() + retval);
+            }
+            return retval;
+        }
+        finally {
+            ZeroTierBufferPool.release(buf);
+        }
+    }
+
+    /**
+     * Copy as much of src as fits into buf without moving the position of src
+     * @return Number of bytes copied
+     */
+    private static int stage(ByteBuffer src, ByteBuffer buf)
+    {
+        int len = Math.min(src.remaining(), buf.capacity());
+        ByteBuffer slice = src.duplicate();
+        slice.limit(slice.position() + len);
+        buf.put(slice);
+        return len;
+    }
+
+    static <T> void setOption(int fd, SocketOption<T> name, T value) throws IOException
+    {
+        if (value == null) {
+            throw new IllegalArgumentException("option value must not be null");
+        }
+        int err;
+        if (name == StandardSocketOptions.TCP_NODELAY) {
+            err = ZeroTierNative.zts_set_no_delay(fd, (Boolean)value ? 1 : 0);
+        }
+        else if (name == StandardSocketOptions.SO_KEEPALIVE) {
+            err = ZeroTierNative.zts_set_keepalive(fd, (Boolean)value ? 1 : 0);
+        }
+        else if (name == StandardSocketOptions.SO_REUSEADDR) {
+            err = ZeroTierNative.zts_set_reuse_addr(fd, (Boolean)value ? 1 : 0);
+        }
+        else if (name == StandardSocketOptions.SO_RCVBUF) {
+            err = ZeroTierNative.zts_set_recv_buf_size(fd, (Integer)value);
+        }
+        else if (name == StandardSocketOptions.SO_SNDBUF) {
+            err = ZeroTierNative.zts_set_send_buf_size(fd, (Integer)value);
+        }
+        else if (name == StandardSocketOptions.SO_LINGER) {
+            int seconds = (Integer)value;
+            err = ZeroTierNative.zts_set_linger(fd, seconds >= 0 ? 1 : 0, Math.max(seconds, 0));
+        }
+        else {
+            throw new UnsupportedOperationException("'" + name + "' not supported");
+        }
+        if (err < 0) {
+            throw new IOException("setOption(" + name + "), error=" + err);
+        }
+    }
+
+    @SuppressWarnings("unchecked")
+    static <T> T getOption(int fd, SocketOption<T> name) throws IOException
+    {
+        int retval;
+        if (name == StandardSocketOptions.TCP_NODELAY) {
+            retval = ZeroTierNative.zts_get_no_delay(fd);
+        }
+        else if (name == StandardSocketOptions.SO_KEEPALIVE) {
+            retval = ZeroTierNative.zts_get_keepalive(fd);
+        }
+        else if (name == StandardSocketOptions.SO_REUSEADDR) {
+            retval = ZeroTierNative.zts_get_reuse_addr(fd);
+        }
+        else if (name == StandardSocketOptions.SO_RCVBUF) {
+            retval = ZeroTierNative.zts_get_recv_buf_size(fd);
+        }
+        else if (name == StandardSocketOptions.SO_SNDBUF) {
+            retval = ZeroTierNative.zts_get_send_buf_size(fd);
+        }
+        else if (name == StandardSocketOptions.SO_LINGER) {
+            retval = ZeroTierNative.zts_get_linger_enabled(fd);
+            if (retval == 0) {
+                return (T)Integer.valueOf(-1);
+            }
+            if (retval > 0) {
+                retval = ZeroTierNative.zts_get_linger_value(fd);
+            }
+        }
+        else {
+            throw new UnsupportedOperationException("'" + name + "' not supported");
+        }
+        if (retval < 0) {
+            throw new IOException("getOption(" + name + "), error=" + retval);
+        }
+        if (name.type() == Boolean.class) {
+            return (T)Boolean.valueOf(retval != 0);
+        }
+        return (T)Integer.valueOf(retval);
+    }
+}
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+package com.zerotier.sdk;
+
+import com.zerotier.sdk.ZeroTierNative;
+import java.io.IOException;
+import java.net.DatagramSocket;
+import java.net.InetAddress;
+import java.net.InetSocketAddress;
+import java.net.NetworkInterface;
+import java.net.SocketAddress;
+import java.net.SocketOption;
+import java.net.StandardSocketOptions;
+import java.nio.ByteBuffer;
+import java.nio.channels.AlreadyBoundException;
+import java.nio.channels.ClosedChannelException;
+import java.nio.channels.DatagramChannel;
+import java.nio.channels.MembershipKey;
+import java.nio.channels.NotYetConnectedException;
+import java.nio.channels.SelectionKey;
+import java.nio.channels.spi.SelectorProvider;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.HashSet;
+import java.util.Set;
+
+/**
+ * DatagramChannel over a ZeroTier UDP socket. Obtain instances from ZeroTierSelectorProvider.
+ *
+ * Multicast group membership and the java.net.DatagramSocket adaptor are not supported.
+ */
+public class ZeroTierDatagramChannel extends DatagramChannel implements ZeroTierSelectableChannel {
+    private static final Set<SocketOption<?>> _options = Collections.unmodifiableSet(new HashSet<SocketOption<?>>(
+        Arrays.<SocketOption<?>>asList(
+            StandardSocketOptions.SO_REUSEADDR,
+            StandardSocketOptions.SO_RCVBUF,
+            StandardSocketOptions.SO_SNDBUF)));
+
+    private final int _zfd;
+    private final int _family;
+    private final Object _readLock = new Object();
+    private final Object _writeLock = new Object();
+    private final Object _stateLock = new Object();
+    private volatile boolean _bound;
+    private volatile InetSocketAddress _remoteAddr;
+
+    // Native address of the connected peer, reused for every write()
+    private ZeroTierSocketAddress _remoteNativeAddr;
+
+    ZeroTierDatagramChannel(SelectorProvider provider, int family) throws IOException
+    {
+        super(provider);
+        _family = family;
+        _zfd = ZeroTierChannels.check(
+            ZeroTierNative.zts_bsd_socket(family, ZeroTierNative.ZTS_SOCK_DGRAM, 0),
+            "socket()");
+    }
+
+    public int getNativeFd()
+    {
+        return _zfd;
+    }
+
+    public int translateInterestOps(int ops)
+    {
+        int events = 0;
+        if ((ops & SelectionKey.OP_READ) != 0) {
+            events |= ZeroTierNative.ZTS_POLLIN;
+        }
+        if ((ops & SelectionKey.OP_WRITE) != 0) {
+            events |= ZeroTierNative.ZTS_POLLOUT;
+        }
+        return events;
+    }
+
+    public int translateReadyOps(int revents, int interestOps)
+    {
+        if ((revents & (ZeroTierNative.ZTS_POLLERR | ZeroTierNative.ZTS_POLLNVAL)) != 0) {
+            return interestOps;
+        }
+        int ops = 0;
+        if ((revents & ZeroTierNative.ZTS_POLLIN) != 0) {
+            ops |= SelectionKey.OP_READ;
+        }
+        if ((revents & ZeroTierNative.ZTS_POLLOUT) != 0) {
+            ops |= SelectionKey.OP_WRITE;
+        }
+        return ops & interestOps;
+    }
+
+    private void ensureOpen() throws ClosedChannelException
+    {
+        if (! isOpen()) {
+            throw new ClosedChannelException();
+        }
+    }
+
+    private void ensureConnected() throws IOException
+    {
+        ensureOpen();
+        if (_remoteAddr == null) {
+            throw new NotYetConnectedException();
+        }
+    }
+
+    public DatagramChannel bind(SocketAddress local) throws IOException
+    {
+        synchronized (_stateLock) {
+            ensureOpen();
+            if (_bound) {
+                throw new AlreadyBoundException();
+            }
+            ZeroTierSocketAddress addr =
+                local == null ? ZeroTierChannels.anyAddress(_family) : ZeroTierChannels.toNative(local);
+            ZeroTierChannels.check(ZeroTierNative.zts_bsd_bind(_zfd, addr), "bind()");
+            _bound = true;
+        }
+        return this;
+    }
+
+    public <T> DatagramChannel setOption(SocketOption<T> name, T value) throws IOException
+    {
+        ensureOpen();
+        if (! _options.contains(name)) {
+            throw new UnsupportedOperationException("'" + name + "' not supported");
+        }
+        ZeroTierChannels.setOption(_zfd, name, value);
+        return this;
+    }
+
+    public <T> T getOption(SocketOption<T> name) throws IOException
+    {
+        ensureOpen();
+        if (! _options.contains(name)) {
+            throw new UnsupportedOperationException("'" + name + "' not supported");
+        }
+        return ZeroTierChannels.getOption(_zfd, name);
+    }
+
+    public Set<SocketOption<?>> supportedOptions()
+    {
+        return _options;
+    }
+
+    /**
+     * Not supported
+     */
+    public DatagramSocket socket()
+    {
+        throw new UnsupportedOperationException("socket() adaptor not supported, use setOption()/getOption()");
+    }
+
+    public boolean isConnected()
+    {
+        return _remoteAddr != null;
+    }
+
+    public DatagramChannel connect(SocketAddress remote) throws IOException
+    {
+        synchronized (_stateLock) {
+            ensureOpen();
+            ZeroTierSocketAddress addr = ZeroTierChannels.toNative(remote);
+            ZeroTierChannels.check(ZeroTierNative.zts_bsd_connect(_zfd, addr), "connect()");
+            _bound = true;
+            _remoteNativeAddr = addr;
+            _remoteAddr = (InetSocketAddress)remote;
+        }
+        return this;
+    }
+
+    public DatagramChannel disconnect() throws IOException
+    {
+        synchronized (_stateLock) {
+            if (_remoteAddr == null || ! isOpen()) {
+                return this;
+            }
+            // An address with no family is passed down as AF_UNSPEC, which dissolves the association
+            ZeroTierChannels.check(ZeroTierNative.zts_bsd_connect(_zfd, new ZeroTierSocketAddress()), "disconnect()");
+            _remoteAddr = null;
+            _remoteNativeAddr = null;
+        }
+        return this;
+    }
+
+    public SocketAddress getRemoteAddress() throws IOException
+    {
+        ensureOpen();
+        return _remoteAddr;
+    }
+
+    public SocketAddress getLocalAddress() throws IOException
+    {
+        ensureOpen();
+        return _bound ? ZeroTierChannels.localAddress(_zfd) : null;
+    }
+
+    public SocketAddress receive(ByteBuffer dst) throws IOException
+    {
+        synchronized (_readLock) {
+            ensureOpen();
+            ZeroTierSocketAddress from = new ZeroTierSocketAddress();
+            int retval = -1;
+            try {
+                begin();
+                retval = ZeroTierChannels.recvfrom(_zfd, dst, from);
+            }
+            finally {
+                end(retval >= 0 || ZeroTierChannels.wouldBlock(retval));
+            }
+            if (ZeroTierChannels.wouldBlock(retval)) {
+                return null;
+            }
+            ZeroTierChannels.check(retval, "receive()");
+            return ZeroTierChannels.fromNative(from);
+        }
+    }
+
+    public int send(ByteBuffer src, SocketAddress target) throws IOException
+    {
+        synchronized (_writeLock) {
+            ensureOpen();
+            ZeroTierSocketAddress to = ZeroTierChannels.toNative(target);
+            int retval = -1;
+            try {
+                begin();
+                retval = ZeroTierChannels.sendto(_zfd, src, to);
+            }
+            finally {
+                end(retval >= 0 || ZeroTierChannels.wouldBlock(retval));
+            }
+            if (ZeroTierChannels.wouldBlock(retval)) {
+                return 0;
+            }
+            _bound = true;
+            return ZeroTierChannels.check(retval, "send()");
+        }
+    }
+
+    public int read(ByteBuffer dst) throws IOException
+    {
+        synchronized (_readLock) {
+            ensureConnected();
+            int retval = -1;
+            try {
+                begin();
+                retval = ZeroTierChannels.read(_zfd, dst);
+            }
+            finally {
+                end(retval >= 0 || ZeroTierChannels.wouldBlock(retval));
+            }
+            if (ZeroTierChannels.wouldBlock(retval)) {
+                return 0;
+            }
+            return ZeroTierChannels.check(retval, "read()");
+        }
+    }
+
+    public long read(ByteBuffer[] dsts, int offset, int length) throws IOException
+    {
+        if (offset < 0 || length < 0 || offset > dsts.length - length) {
+            throw new IndexOutOfBoundsException();
+        }
+        // One datagram per call, delivered into the first buffer with space
+        for (int i = offset; i < offset + length; i++) {
+            if (dsts[i].hasRemaining()) {
+                return read(dsts[i]);
+            }
+        }
+        return 0;
+    }
+
+    public int write(ByteBuffer src) throws IOException
+    {
+        synchronized (_writeLock) {
+            ensureConnected();
+            int retval = -1;
+            try {
+                begin();
+                retval = ZeroTierChannels.sendto(_zfd, src, _remoteNativeAddr);
+            }
+            finally {
+                end(retval >= 0 || ZeroTierChannels.wouldBlock(retval));
+            }
+            if (ZeroTierChannels.wouldBlock(retval)) {
+                return 0;
+            }
+            return ZeroTierChannels.check(retval, "write()");
+        }
+    }
+
+    public long write(ByteBuffer[] srcs, int offset, int length) throws IOException
+    {
+        if (offset < 0 || length < 0 || offset > srcs.length - length) {
+            throw new IndexOutOfBoundsException();
+        }
+        // Gather into a single datagram
+        int total = 0;
+        for (int i = offset; i < offset + length; i++) {
+            total += srcs[i].remaining();
+        }
+        ByteBuffer buf = ByteBuffer.allocate(total);
+        for (int i = offset; i < offset + length; i++) {
+            buf.put(srcs[i].duplicate());
+        }
+        buf.flip();
+        int written = write(buf);
+        for (int i = offset, n = written; i < offset + length && n > 0; i++) {
+            int consumed = Math.min(n, srcs[i].remaining());
+            srcs[i].position(srcs[i].position() + consumed);
+            n -= consumed;
+        }
+        return written;
+    }
+
+    /**
+     * Not supported
+     */
+    public MembershipKey join(InetAddress group, NetworkInterface interf) throws IOException
+    {
+        throw new UnsupportedOperationException("Multicast group membership is not supported");
+    }
+
+    /**
+     * Not supported
+     */
+    public MembershipKey join(InetAddress group, NetworkInterface interf, InetAddress source) throws IOException
+    {
+        throw new UnsupportedOperationException("Multicast group membership is not supported");
+    }
+
+    protected void implCloseSelectableChannel() throws IOException
+    {
+        ZeroTierNative.zts_bsd_close(_zfd);
+    }
+
+    protected void implConfigureBlocking(boolean block) throws IOException
+    {
+        ZeroTierChannels.configureBlocking(_zfd, block);
+    }
+
+    public String toString()
+    {
+        return "ZeroTierDatagramChannel[fd=" + _zfd + ", remote=" + _remoteAddr + "]";
+    }
+}
@@ -15,10 +15,13 @@ package com.zerotier.sdk;
 
 import com.zerotier.sdk.ZeroTierNative;
 import java.io.*;
+import java.nio.ByteBuffer;
 import java.util.Objects;
 
 /**
- * Extends InputStream using ZeroTier as a transport
+ * Extends InputStream using ZeroTier as a transport. Reads are performed into
+ * a pooled direct buffer so that no JNI critical region is held while the
+ * native layer blocks waiting for data.
  */
 public class ZeroTierInputStream extends InputStream {
     /**
@@ -26,11 +29,76 @@ public class ZeroTierInputStream extends InputStream {
      */
     public int zfd = -1;
 
+    // Direct staging buffer, borrowed from ZeroTierBufferPool on first use
+    private ByteBuffer _buf;
+    // Number of reads using _buf, guarded by _bufLock
+    private int _bufUsers;
+    private boolean _closed;
+    private final Object _bufLock = new Object();
+
+    /**
+     * Borrow the staging buffer for one native call. Every call must be paired
+     * with returnStagingBuffer(), even if the call fails
+     */
+    private ByteBuffer stagingBuffer() throws IOException
+    {
+        synchronized (_bufLock) {
+            if (_closed) {
+                throw new IOException("Stream closed");
+            }
+            if (_buf == null) {
+                _buf = ZeroTierBufferPool.acquire();
+            }
+            _bufUsers++;
+            return _buf;
+        }
+    }
+
+    private void returnStagingBuffer()
+    {
+        synchronized (_bufLock) {
+            if (--_bufUsers == 0 && _closed) {
+                releaseBuffer();
+            }
+        }
+    }
+
+    /**
+     * Return the staging buffer to the pool. A read blocked in the native layer
+     * when the stream is closed still owns the buffer, so it is only returned
+     * once the last user is done with it. Called with _bufLock held
+     */
+    private void releaseBuffer()
+    {
+        ZeroTierBufferPool.release(_buf);
+        _buf = null;
+    }
+
+    /**
+     * Read at most numBytes into the staging buffer and copy them into destBuffer
+     * @return Raw return value of the native read
+     */
+    private int readStaged(byte[] destBuffer, int offset, int numBytes) throws IOException
+    {
+        ByteBuffer buf = stagingBuffer();
+        try {
+            int retval = ZeroTierNative.zts_bsd_read_direct(zfd, buf, 0, Math.min(numBytes, buf.capacity()));
+            if (retval > 0) {
+                buf.clear();
+                buf.get(destBuffer, offset, retval);
+            }
+            return retval;
+        }
+        finally {
+            returnStagingBuffer();
+        }
+    }
+
     /**
      * Close the ZeroTierInputStream
      * @exception IOException when an I/O error occurs
      */
-    public void close​() throws IOException
+    public void close() throws IOException
     {
         /* Note: this operation currently only stops RX on a socket that is shared
         between both I/OStreams. This means that closing this stream will only shutdown
@@ -39,20 +107,27 @@ public class ZeroTierInputStream extends InputStream {
         both I/OStreams are closed separately */
         ZeroTierNative.zts_bsd_shutdown(zfd, ZeroTierNative.ZTS_SHUT_RD);
         zfd = -1;
+        synchronized (_bufLock) {
+            _closed = true;
+            if (_bufUsers == 0) {
+                releaseBuffer();
+            }
+        }
     }
 
     /**
      * Transfer bytes from this stream to another
-     * @param destStream Unused
+     * @param destStream Destination stream
      * @return Number of bytes transferred
      * @exception IOException when an I/O error occurs
      */
-    public long transferTo​(OutputStream destStream) throws IOException
+    public long transferTo(OutputStream destStream) throws IOException
     {
         Objects.requireNonNull(destStream, "destStream must not be null");
-        int bytesTransferred = 0, bytesRead;
-        byte[] buf = new byte[8192];
-        while (((bytesRead = ZeroTierNative.zts_bsd_read(zfd, buf)) >= 0)) {
+        long bytesTransferred = 0;
+        int bytesRead;
+        byte[] buf = new byte[ZeroTierBufferPool.BUFFER_SIZE];
+        while ((bytesRead = readStaged(buf, 0, buf.length)) > 0) {
             destStream.write(buf, 0, bytesRead);
             bytesTransferred += bytesRead;
         }
@@ -61,21 +136,26 @@ public class ZeroTierInputStream extends InputStream {
 
     /**
      * Read a single byte from the stream
-     * @return Single byte read
+     * @return Single byte read (0-255), or -1 at end of stream
      * @exception IOException when an I/O error occurs
      */
-    public int read​() throws IOException
+    public int read() throws IOException
     {
-        byte[] buf = new byte[1];
-        // Unlike a native read(), if nothing is read we should return -1
-        int retval = ZeroTierNative.zts_bsd_read(zfd, buf);
-        if ((retval == 0) | (retval == -104) /* EINTR, from SO_RCVTIMEO */) {
-            return -1;
+        ByteBuffer buf = stagingBuffer();
+        try {
+            // Unlike a native read(), if nothing is read we should return -1
+            int retval = ZeroTierNative.zts_bsd_read_direct(zfd, buf, 0, 1);
+            if ((retval == 0) | (retval == -104) /* EINTR, from SO_RCVTIMEO */) {
+                return -1;
+            }
+            if (retval < 0) {
+                throw new IOException("read(), errno=" + retval);
+            }
+            return buf.get(0) & 0xFF;
         }
-        if (retval < 0) {
-            throw new IOException("read​(), errno=" + retval);
+        finally {
+            returnStagingBuffer();
         }
-        return buf[0];
     }
 
     /**
@@ -84,18 +164,10 @@ public class ZeroTierInputStream extends InputStream {
      * @return Number of bytes read
      * @exception IOException when an I/O error occurs
      */
-    public int read​(byte[] destBuffer) throws IOException
+    public int read(byte[] destBuffer) throws IOException
     {
         Objects.requireNonNull(destBuffer, "input byte array must not be null");
-        // Unlike a native read(), if nothing is read we should return -1
-        int retval = ZeroTierNative.zts_bsd_read(zfd, destBuffer);
-        if ((retval == 0) | (retval == -104) /* EINTR, from SO_RCVTIMEO */) {
-            return -1;
-        }
-        if (retval < 0) {
-            throw new IOException("read​(destBuffer), errno=" + retval);
-        }
-        return retval;
+        return read(destBuffer, 0, destBuffer.length);
     }
 
     /**
@@ -106,7 +178,7 @@ public class ZeroTierInputStream extends InputStream {
      * @return Number of bytes read.
      * @exception IOException when an I/O error occurs
      */
-    public int read​(byte[] destBuffer, int offset, int numBytes) throws IOException
+    public int read(byte[] destBuffer, int offset, int numBytes) throws IOException
     {
         Objects.requireNonNull(destBuffer, "input byte array must not be null");
         if (offset < 0) {
@@ -122,31 +194,79 @@ public class ZeroTierInputStream extends InputStream {
             return 0;
         }
         // Unlike a native read(), if nothing is read we should return -1
-        int retval = ZeroTierNative.zts_bsd_read_offset(zfd, destBuffer, offset, numBytes);
+        int retval = readStaged(destBuffer, offset, numBytes);
         if ((retval == 0) | (retval == -104) /* EINTR, from SO_RCVTIMEO */) {
             return -1;
         }
         if (retval < 0) {
-            throw new IOException("read​(destBuffer, offset, numBytes), errno=" + retval);
+            throw new IOException("read(destBuffer, offset, numBytes), errno=" + retval);
         }
         return retval;
     }
 
     /**
-     * Read all available data from stream
-     * @return Array of bytes
+     * Read from stream into the remaining space of a ByteBuffer. Direct buffers
+     * are filled in place without any intermediate copy.
+     * @param destBuffer Destination buffer, its position is advanced by the number of bytes read
+     * @return Number of bytes read, or -1 at end of stream
      * @exception IOException when an I/O error occurs
      */
-    public byte[] readAllBytes​() throws IOException
+    public int read(ByteBuffer destBuffer) throws IOException
     {
-        int pendingDataSize = ZeroTierNative.zts_get_pending_data_size(zfd);
-        byte[] buf = new byte[pendingDataSize];
-        int retval = ZeroTierNative.zts_bsd_read(zfd, buf);
+        Objects.requireNonNull(destBuffer, "destination buffer must not be null");
+        if (! destBuffer.hasRemaining()) {
+            return 0;
+        }
+        int retval;
+        if (destBuffer.isDirect()) {
+            retval = ZeroTierNative.zts_bsd_read_direct(zfd, destBuffer, destBuffer.position(), destBuffer.limit());
+            if (retval > 0) {
+                destBuffer.position(destBuffer.position() + retval);
+            }
+        }
+        else {
+            ByteBuffer buf = stagingBuffer();
+            try {
+                retval =
+                    ZeroTierNative.zts_bsd_read_direct(zfd, buf, 0, Math.min(destBuffer.remaining(), buf.capacity()));
+                if (retval > 0) {
+                    buf.clear();
+                    buf.limit(retval);
+                    destBuffer.put(buf);
+                }
+            }
+            finally {
+                returnStagingBuffer();
+            }
+        }
         if ((retval == 0) | (retval == -104) /* EINTR, from SO_RCVTIMEO */) {
-            // No action needed
+            return -1;
         }
         if (retval < 0) {
-            throw new IOException("readAllBytes​(), errno=" + retval);
+            throw new IOException("read(destBuffer), errno=" + retval);
+        }
+        return retval;
+    }
+
+    /**
+     * Read all available data from stream
+     * @return Array of bytes
+     * @exception IOException when an I/O error occurs
+     */
+    public byte[] readAllBytes() throws IOException
+    {
+        int pendingDataSize = ZeroTierNative.zts_get_pending_data_size(zfd);
+        byte[] buf = new byte[Math.max(pendingDataSize, 0)];
+        int bytesRead = 0;
+        while (bytesRead < buf.length) {
+            int retval = readStaged(buf, bytesRead, buf.length - bytesRead);
+            if ((retval == 0) | (retval == -104) /* EINTR, from SO_RCVTIMEO */) {
+                break;
+            }
+            if (retval < 0) {
+                throw new IOException("readAllBytes(), errno=" + retval);
+            }
+            bytesRead += retval;
         }
         return buf;
     }
@@ -156,10 +276,10 @@ public class ZeroTierInputStream extends InputStream {
      * @param destBuffer Destination buffer
      * @param offset Where in the destination buffer bytes should be written
      * @param numBytes Number of bytes to read
-     * @return Nothing.
+     * @return Number of bytes read
      * @exception IOException when an I/O error occurs
      */
-    public int readNBytes​(byte[] destBuffer, int offset, int numBytes) throws IOException
+    public int readNBytes(byte[] destBuffer, int offset, int numBytes) throws IOException
     {
         Objects.requireNonNull(destBuffer, "input byte array must not be null");
         if (offset < 0) {
@@ -171,39 +291,49 @@ public class ZeroTierInputStream extends InputStream {
         if (numBytes > (destBuffer.length - offset)) {
             throw new IndexOutOfBoundsException("numBytes > destBuffer.length - offset");
         }
-        if (numBytes == 0) {
-            return 0;
-        }
-        int retval = ZeroTierNative.zts_bsd_read_offset(zfd, destBuffer, offset, numBytes);
-        if ((retval == 0) | (retval == -104) /* EINTR, from SO_RCVTIMEO */) {
-            // No action needed
-        }
-        if (retval < 0) {
-            throw new IOException("readNBytes​(destBuffer, offset, numBytes), errno=" + retval);
+        int bytesRead = 0;
+        while (bytesRead < numBytes) {
+            int retval = readStaged(destBuffer, offset + bytesRead, numBytes - bytesRead);
+            if ((retval == 0) | (retval == -104) /* EINTR, from SO_RCVTIMEO */) {
+                break;
+            }
+            if (retval < 0) {
+                throw new IOException("readNBytes(destBuffer, offset, numBytes), errno=" + retval);
+            }
+            bytesRead += retval;
         }
-        return retval;
+        return bytesRead;
     }
 
     /**
      * Skip a certain number of bytes
-     * @param numBytes Unused
-     * @return Nothing.
+     * @param numBytes Number of bytes to discard
+     * @return Number of bytes actually skipped
      * @exception IOException when an I/O error occurs
      */
-    public long skip​(long numBytes) throws IOException
+    public long skip(long numBytes) throws IOException
     {
         if (numBytes <= 0) {
             return 0;
         }
-        long bytesRemaining = numBytes, bytesRead;
-        int bufSize = (int)Math.min(2048, bytesRemaining);
-        byte[] buf = new byte[bufSize];
-        while (bytesRemaining > 0) {
-            if ((bytesRead = ZeroTierNative.zts_bsd_read_length(zfd, buf, (int)Math.min(bufSize, bytesRemaining)))
-                < 0) {
-                break;
+        ByteBuffer buf = stagingBuffer();
+        long bytesRemaining = numBytes;
+        try {
+            int bytesRead;
+            while (bytesRemaining > 0) {
+                if ((bytesRead = ZeroTierNative.zts_bsd_read_direct(
+                         zfd,
+                         buf,
+                         0,
+                         (int)Math.min(buf.capacity(), bytesRemaining)))
+                    <= 0) {
+                    break;
+                }
+                bytesRemaining -= bytesRead;
             }
-            bytesRemaining -= bytesRead;
+        }
+        finally {
+            returnStagingBuffer();
         }
         return numBytes - bytesRemaining;
     }
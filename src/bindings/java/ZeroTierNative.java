@@ -13,6 +13,8 @@
 
 package com.zerotier.sdk;
 
+import java.nio.ByteBuffer;
+
 /**
  * Class that exposes the low-level C socket interface provided by libzt. This
  * can be used instead of the higher-level ZeroTierSocket API.
@@ -213,6 +215,12 @@ public class ZeroTierNative {
     public static int ZTS_SHUT_RD = 0x00000000;
     public static int ZTS_SHUT_WR = 0x00000001;
     public static int ZTS_SHUT_RDWR = 0x00000002;
+    // poll() and zts_poller_*() events
+    public static int ZTS_POLLIN = 0x00000001;
+    public static int ZTS_POLLOUT = 0x00000002;
+    public static int ZTS_POLLERR = 0x00000004;
+    public static int ZTS_POLLNVAL = 0x00000008;
+    public static int ZTS_POLLHUP = 0x00000200;
     // ioctl() commands
     public static int ZTS_FIONREAD = 0x4008667F;
     public static int ZTS_FIONBIO = 0x8008667E;
@@ -525,6 +533,7 @@ public class ZeroTierNative {
     public static native int zts_get_blocking(int fd);
     public static native int zts_set_keepalive(int fd, int enabled);
     public static native int zts_get_keepalive(int fd);
+    public static native int zts_get_socket_error(int fd);
     // struct hostent* gethostbyname(/*const*/ String name);
     // public static native int zts_dns_set_server(uint8_t index, /*const*/ ip_addr* addr);
     // ZTS_API /*const*/ ip_addr* ZTCALL dns_get_server(uint8_t index);
@@ -566,8 +575,8 @@ public class ZeroTierNative {
     //////////////////////////////////////////////////////////////////////////////
 
     public static native int zts_bsd_socket(int family, int type, int protocol);
-    // public static native int zts_bsd_connect(int fd, ZeroTierSocketAddress addr);
-    // public static native int zts_bsd_bind(int fd, ZeroTierSocketAddress addr);
+    public static native int zts_bsd_connect(int fd, ZeroTierSocketAddress addr);
+    public static native int zts_bsd_bind(int fd, ZeroTierSocketAddress addr);
     public static native int zts_bsd_listen(int fd, int backlog);
     public static native int zts_bsd_accept(int fd, ZeroTierSocketAddress addr);
 
@@ -586,10 +595,21 @@ public class ZeroTierNative {
     public static native int zts_bsd_sendto(int fd, byte[] buf, int flags, ZeroTierSocketAddress addr);
     public static native int zts_bsd_send(int fd, byte[] buf, int flags);
 
+    // Variants operating on the [position, limit) region of a direct ByteBuffer. No JNI critical
+    // region is held while these block, so the garbage collector is never stalled on network waits.
+    public static native int zts_bsd_read_direct(int fd, ByteBuffer buf, int position, int limit);
+    public static native int zts_bsd_recv_direct(int fd, ByteBuffer buf, int position, int limit, int flags);
+    public static native int zts_bsd_write_direct(int fd, ByteBuffer buf, int position, int limit);
+    public static native int zts_bsd_send_direct(int fd, ByteBuffer buf, int position, int limit, int flags);
+    public static native int
+    zts_bsd_recvfrom_direct(int fd, ByteBuffer buf, int position, int limit, int flags, ZeroTierSocketAddress addr);
+    public static native int
+    zts_bsd_sendto_direct(int fd, ByteBuffer buf, int position, int limit, int flags, ZeroTierSocketAddress addr);
+
     public static native int zts_bsd_shutdown(int fd, int how);
     public static native int zts_bsd_close(int fd);
 
-    public static native boolean zts_bsd_getsockname(int fd, ZeroTierSocketAddress addr);
+    public static native int zts_bsd_getsockname(int fd, ZeroTierSocketAddress addr);
     public static native int zts_bsd_getpeername(int fd, ZeroTierSocketAddress addr);
     public static native int zts_bsd_fcntl(int sock, int cmd, int flag);
     // public static native int zts_bsd_ioctl(int fd, long request, ZeroTierIoctlArg arg);
@@ -600,4 +620,16 @@ public class ZeroTierNative {
         ZeroTierFileDescriptorSet exceptfds,
         int timeout_sec,
         int timeout_usec);
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Poller                                                                   //
+    //////////////////////////////////////////////////////////////////////////////
+
+    public static native int zts_poller_new();
+    public static native int zts_poller_free(int pfd);
+    public static native int zts_poller_set(int pfd, int fd, int events);
+    public static native int zts_poller_remove(int pfd, int fd);
+    // Ready descriptors and their events are written to the two arrays, returns the number of entries filled
+    public static native int zts_poller_wait(int pfd, int[] fds, int[] revents, int timeout_ms);
+    public static native int zts_poller_wakeup(int pfd);
 }
@@ -15,11 +15,14 @@ package com.zerotier.sdk;
 
 import com.zerotier.sdk.*;
 import java.io.*;
+import java.nio.ByteBuffer;
 import java.util.Arrays;
 import java.util.Objects;
 
 /**
- * Extends OutputStream using ZeroTier as a transport
+ * Extends OutputStream using ZeroTier as a transport. Writes are staged through
+ * a pooled direct buffer so that no JNI critical region is held while the
+ * native layer blocks on a full send buffer.
  */
 public class ZeroTierOutputStream extends OutputStream {
     /**
@@ -27,6 +30,65 @@ public class ZeroTierOutputStream extends OutputStream {
      */
     public int zfd = -1;
 
+    // Direct staging buffer, borrowed from ZeroTierBufferPool on first use
+    private ByteBuffer _buf;
+    // Number of writes using _buf, guarded by _bufLock
+    private int _bufUsers;
+    private boolean _closed;
+    private final Object _bufLock = new Object();
+
+    /**
+     * Borrow the staging buffer for one native call. Every call must be paired
+     * with returnStagingBuffer(), even if the call fails
+     */
+    private ByteBuffer stagingBuffer() throws IOException
+    {
+        synchronized (_bufLock) {
+            if (_closed) {
+                throw new IOException("Stream closed");
+            }
+            if (_buf == null) {
+                _buf = ZeroTierBufferPool.acquire();
+            }
+            _bufUsers++;
+            return _buf;
+        }
+    }
+
+    private void returnStagingBuffer()
+    {
+        synchronized (_bufLock) {
+            if (--_bufUsers == 0 && _closed) {
+                releaseBuffer();
+            }
+        }
+    }
+
+    /**
+     * Return the staging buffer to the pool. A write blocked in the native layer
+     * when the stream is closed still owns the buffer, so it is only returned
+     * once the last user is done with it. Called with _bufLock held
+     */
+    private void releaseBuffer()
+    {
+        ZeroTierBufferPool.release(_buf);
+        _buf = null;
+    }
+
+    /**
+     * Write the [position, limit) region of a direct buffer until it is fully sent
+     */
+    private void writeFully(ByteBuffer buf, int position, int limit) throws IOException
+    {
+        while (position < limit) {
+            int bytesWritten = ZeroTierNative.zts_bsd_write_direct(zfd, buf, position, limit);
+            if (bytesWritten < 0) {
+                throw new IOException("write(), errno=" + bytesWritten);
+            }
+            position += bytesWritten;
+        }
+    }
+
     /**
      * Close the stream
      * @exception IOException when an I/O error occurs
@@ -41,6 +103,12 @@ public class ZeroTierOutputStream extends OutputStream {
         are closed separately */
         ZeroTierNative.zts_bsd_shutdown(zfd, ZeroTierNative.ZTS_SHUT_WR);
         zfd = -1;
+        synchronized (_bufLock) {
+            _closed = true;
+            if (_bufUsers == 0) {
+                releaseBuffer();
+            }
+        }
     }
 
     /**
@@ -50,10 +118,8 @@ public class ZeroTierOutputStream extends OutputStream {
      */
     public void write(byte[] originBuffer) throws IOException
     {
-        int bytesWritten = ZeroTierNative.zts_bsd_write(zfd, originBuffer);
-        if (bytesWritten < 0) {
-            throw new IOException("write(originBuffer[]), errno=" + bytesWritten);
-        }
+        Objects.requireNonNull(originBuffer, "input byte array (originBuffer) must not be null");
+        write(originBuffer, 0, originBuffer.length);
     }
 
     /**
@@ -75,9 +141,50 @@ public class ZeroTierOutputStream extends OutputStream {
         if ((offset + numBytes) > originBuffer.length) {
             throw new IndexOutOfBoundsException("(offset+numBytes) > originBuffer.length");
         }
-        int bytesWritten = ZeroTierNative.zts_bsd_write_offset(zfd, originBuffer, offset, numBytes);
-        if (bytesWritten < 0) {
-            throw new IOException("write(originBuffer[],offset,numBytes), errno=" + bytesWritten);
+        ByteBuffer buf = stagingBuffer();
+        try {
+            while (numBytes > 0) {
+                int chunk = Math.min(numBytes, buf.capacity());
+                buf.clear();
+                buf.put(originBuffer, offset, chunk);
+                writeFully(buf, 0, chunk);
+                offset += chunk;
+                numBytes -= chunk;
+            }
+        }
+        finally {
+            returnStagingBuffer();
+        }
+    }
+
+    /**
+     * Write the remaining bytes of a ByteBuffer. Direct buffers are sent in
+     * place without any intermediate copy.
+     * @param originBuffer Source buffer, its position is advanced to its limit
+     * @exception IOException when an I/O error occurs
+     */
+    public void write(ByteBuffer originBuffer) throws IOException
+    {
+        Objects.requireNonNull(originBuffer, "source buffer must not be null");
+        if (originBuffer.isDirect()) {
+            writeFully(originBuffer, originBuffer.position(), originBuffer.limit());
+            originBuffer.position(originBuffer.limit());
+            return;
+        }
+        ByteBuffer buf = stagingBuffer();
+        try {
+            while (originBuffer.hasRemaining()) {
+                int chunk = Math.min(originBuffer.remaining(), buf.capacity());
+                ByteBuffer slice = originBuffer.duplicate();
+                slice.limit(slice.position() + chunk);
+                buf.clear();
+                buf.put(slice);
+                writeFully(buf, 0, chunk);
+                originBuffer.position(originBuffer.position() + chunk);
+            }
+        }
+        finally {
+            returnStagingBuffer();
         }
     }
 
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+package com.zerotier.sdk;
+
+/**
+ * Implemented by channels that can be registered with a ZeroTierSelector. Used internally.
+ */
+interface ZeroTierSelectableChannel {
+    /**
+     * File descriptor used by lower native layer
+     */
+    int getNativeFd();
+
+    /**
+     * Convert SelectionKey interest operations into ZTS_POLL* events
+     */
+    int translateInterestOps(int ops);
+
+    /**
+     * Convert ZTS_POLL* events reported by the poller into SelectionKey ready operations
+     */
+    int translateReadyOps(int revents, int interestOps);
+}
@@ -0,0 +1,333 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+package com.zerotier.sdk;
+
+import com.zerotier.sdk.ZeroTierNative;
+import java.io.IOException;
+import java.nio.channels.CancelledKeyException;
+import java.nio.channels.ClosedSelectorException;
+import java.nio.channels.IllegalSelectorException;
+import java.nio.channels.SelectableChannel;
+import java.nio.channels.SelectionKey;
+import java.nio.channels.Selector;
+import java.nio.channels.spi.AbstractSelectableChannel;
+import java.nio.channels.spi.AbstractSelectionKey;
+import java.nio.channels.spi.AbstractSelector;
+import java.nio.channels.spi.SelectorProvider;
+import java.util.AbstractSet;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.Iterator;
+import java.util.Set;
+
+/**
+ * Selector backed by a native zts_poller. Channels must come from ZeroTierSelectorProvider.
+ */
+public class ZeroTierSelector extends AbstractSelector {
+    /**
+     * Maximum number of ready descriptors collected per select()
+     */
+    public static final int MAX_EVENTS = 256;
+
+    private final int _pfd;
+
+    // Reused across selects so that polling allocates nothing
+    private final int[] _readyFds = new int[MAX_EVENTS];
+    private final int[] _readyEvents = new int[MAX_EVENTS];
+
+    // Guards the key sets and the fd map, never held while waiting in the poller
+    private final Object _lock = new Object();
+    private final HashMap<Integer, Key> _fdKeys = new HashMap<Integer, Key>();
+    private final HashSet<SelectionKey> _keys = new HashSet<SelectionKey>();
+    private final HashSet<SelectionKey> _selectedKeys = new HashSet<SelectionKey>();
+    private final Set<SelectionKey> _publicKeys = Collections.unmodifiableSet(_keys);
+    private final Set<SelectionKey> _publicSelectedKeys = new UngrowableSet(_selectedKeys);
+
+    ZeroTierSelector(SelectorProvider provider) throws IOException
+    {
+        super(provider);
+        _pfd = ZeroTierNative.zts_poller_new();
+        if (_pfd < 0) {
+            throw new IOException("zts_poller_new(), error=" + _pfd);
+        }
+    }
+
+    /**
+     * Selection key for a ZeroTier channel
+     */
+    private static class Key extends AbstractSelectionKey {
+        final ZeroTierSelector selector;
+        final SelectableChannel channel;
+        final int fd;
+        volatile int interestOps;
+        volatile int readyOps;
+
+        Key(ZeroTierSelector selector, SelectableChannel channel, int fd)
+        {
+            this.selector = selector;
+            this.channel = channel;
+            this.fd = fd;
+        }
+
+        private void ensureValid()
+        {
+            if (! isValid()) {
+                throw new CancelledKeyException();
+            }
+        }
+
+        public SelectableChannel channel()
+        {
+            return channel;
+        }
+
+        public Selector selector()
+        {
+            return selector;
+        }
+
+        public int interestOps()
+        {
+            ensureValid();
+            return interestOps;
+        }
+
+        public SelectionKey interestOps(int ops)
+        {
+            ensureValid();
+            if ((ops & ~channel.validOps()) != 0) {
+                throw new IllegalArgumentException("Invalid interest ops: " + ops);
+            }
+            interestOps = ops;
+            selector.updateInterest(this);
+            return this;
+        }
+
+        public int readyOps()
+        {
+            ensureValid();
+            return readyOps;
+        }
+    }
+
+    /**
+     * A view of the selected-key set that permits removal but not addition
+     */
+    private static class UngrowableSet extends AbstractSet<SelectionKey> {
+        private final Set<SelectionKey> _set;
+
+        UngrowableSet(Set<SelectionKey> set)
+        {
+            _set = set;
+        }
+
+        public int size()
+        {
+            return _set.size();
+        }
+
+        public Iterator<SelectionKey> iterator()
+        {
+            return _set.iterator();
+        }
+
+        public boolean contains(Object o)
+        {
+            return _set.contains(o);
+        }
+
+        public boolean remove(Object o)
+        {
+            return _set.remove(o);
+        }
+
+        public void clear()
+        {
+            _set.clear();
+        }
+
+        public boolean add(SelectionKey key)
+        {
+            throw new UnsupportedOperationException();
+        }
+    }
+
+    private void ensureOpen()
+    {
+        if (! isOpen()) {
+            throw new ClosedSelectorException();
+        }
+    }
+
+    private void updateInterest(Key key)
+    {
+        ZeroTierSelectableChannel ch = (ZeroTierSelectableChannel)key.channel;
+        int events = ch.translateInterestOps(key.interestOps);
+        synchronized (_lock) {
+            // The descriptor may have been closed and reused by a channel with a newer key
+            if (_fdKeys.get(key.fd) != key) {
+                return;
+            }
+            if (events != 0) {
+                ZeroTierNative.zts_poller_set(_pfd, key.fd, events);
+            }
+            else {
+                ZeroTierNative.zts_poller_remove(_pfd, key.fd);
+            }
+        }
+    }
+
+    protected SelectionKey register(AbstractSelectableChannel ch, int ops, Object att)
+    {
+        if (! (ch instanceof ZeroTierSelectableChannel)) {
+            throw new IllegalSelectorException();
+        }
+        ensureOpen();
+        Key key = new Key(this, ch, ((ZeroTierSelectableChannel)ch).getNativeFd());
+        key.attach(att);
+        synchronized (_lock) {
+            _keys.add(key);
+            _fdKeys.put(key.fd, key);
+        }
+        key.interestOps(ops);
+        return key;
+    }
+
+    /**
+     * Forget keys cancelled since the last selection
+     */
+    private void processDeregisterQueue()
+    {
+        Set<SelectionKey> cancelled = cancelledKeys();
+        synchronized (cancelled) {
+            if (cancelled.isEmpty()) {
+                return;
+            }
+            synchronized (_lock) {
+                for (SelectionKey k : cancelled) {
+                    Key key = (Key)k;
+                    _keys.remove(key);
+                    _selectedKeys.remove(key);
+                    if (_fdKeys.get(key.fd) == key) {
+                        _fdKeys.remove(key.fd);
+                        ZeroTierNative.zts_poller_remove(_pfd, key.fd);
+                    }
+                    deregister(key);
+                }
+            }
+            cancelled.clear();
+        }
+    }
+
+    /**
+     * @param timeout Timeout in milliseconds, -1 to block indefinitely, 0 to return immediately
+     */
+    private int doSelect(int timeout) throws IOException
+    {
+        ensureOpen();
+        processDeregisterQueue();
+        int n;
+        try {
+            begin();
+            n = ZeroTierNative.zts_poller_wait(_pfd, _readyFds, _readyEvents, timeout);
+        }
+        finally {
+            end();
+        }
+        if (n < 0) {
+            ensureOpen();
+            throw new IOException("select(), error=" + n);
+        }
+        processDeregisterQueue();
+        int numUpdated = 0;
+        synchronized (_lock) {
+            for (int i = 0; i < n; i++) {
+                Key key = _fdKeys.get(_readyFds[i]);
+                if (key == null || ! key.isValid()) {
+                    continue;
+                }
+                int ready = ((ZeroTierSelectableChannel)key.channel).translateReadyOps(_readyEvents[i], key.interestOps);
+                if (ready == 0) {
+                    continue;
+                }
+                if (_selectedKeys.contains(key)) {
+                    if ((key.readyOps | ready) != key.readyOps) {
+                        key.readyOps |= ready;
+                        numUpdated++;
+                    }
+                }
+                else {
+                    key.readyOps = ready;
+                    _selectedKeys.add(key);
+                    numUpdated++;
+                }
+            }
+        }
+        return numUpdated;
+    }
+
+    public Set<SelectionKey> keys()
+    {
+        ensureOpen();
+        return _publicKeys;
+    }
+
+    public Set<SelectionKey> selectedKeys()
+    {
+        ensureOpen();
+        return _publicSelectedKeys;
+    }
+
+    public int selectNow() throws IOException
+    {
+        return doSelect(0);
+    }
+
+    public int select(long timeout) throws IOException
+    {
+        if (timeout < 0) {
+            throw new IllegalArgumentException("Negative timeout");
+        }
+        return doSelect(timeout == 0 ? -1 : (int)Math.min(timeout, Integer.MAX_VALUE));
+    }
+
+    public int select() throws IOException
+    {
+        return doSelect(-1);
+    }
+
+    public Selector wakeup()
+    {
+        if (isOpen()) {
+            ZeroTierNative.zts_poller_wakeup(_pfd);
+        }
+        return this;
+    }
+
+    protected void implCloseSelector() throws IOException
+    {
+        ZeroTierNative.zts_poller_wakeup(_pfd);
+        SelectionKey[] keys;
+        synchronized (_lock) {
+            keys = _keys.toArray(new SelectionKey[0]);
+        }
+        // Cancelled outside of _lock since cancel() takes the cancelled-key set's lock
+        for (SelectionKey k : keys) {
+            k.cancel();
+        }
+        processDeregisterQueue();
+        ZeroTierNative.zts_poller_free(_pfd);
+    }
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+package com.zerotier.sdk;
+
+import com.zerotier.sdk.ZeroTierNative;
+import java.io.IOException;
+import java.net.ProtocolFamily;
+import java.net.StandardProtocolFamily;
+import java.nio.channels.DatagramChannel;
+import java.nio.channels.Pipe;
+import java.nio.channels.ServerSocketChannel;
+import java.nio.channels.SocketChannel;
+import java.nio.channels.spi.AbstractSelector;
+import java.nio.channels.spi.SelectorProvider;
+
+/**
+ * java.nio SelectorProvider whose channels and selectors run over ZeroTier.
+ *
+ * Frameworks that accept a SelectorProvider (e.g. Netty's NioEventLoopGroup) can
+ * be handed ZeroTierSelectorProvider.provider() to multiplex many ZeroTier sockets
+ * on a few threads. Readiness is delivered by the native zts_poller_* API, so a
+ * select() only ever examines sockets that have seen activity.
+ */
+public class ZeroTierSelectorProvider extends SelectorProvider {
+    private static final ZeroTierSelectorProvider _instance = new ZeroTierSelectorProvider();
+
+    /**
+     * Shared provider instance
+     */
+    public static ZeroTierSelectorProvider provider()
+    {
+        return _instance;
+    }
+
+    protected ZeroTierSelectorProvider()
+    {
+    }
+
+    static int toNativeFamily(ProtocolFamily family)
+    {
+        if (family == StandardProtocolFamily.INET) {
+            return ZeroTierNative.ZTS_AF_INET;
+        }
+        if (family == StandardProtocolFamily.INET6) {
+            return ZeroTierNative.ZTS_AF_INET6;
+        }
+        throw new UnsupportedOperationException("Protocol family not supported: " + family);
+    }
+
+    /**
+     * Open an IPv4 datagram channel
+     */
+    public DatagramChannel openDatagramChannel() throws IOException
+    {
+        return new ZeroTierDatagramChannel(this, ZeroTierNative.ZTS_AF_INET);
+    }
+
+    public DatagramChannel openDatagramChannel(ProtocolFamily family) throws IOException
+    {
+        return new ZeroTierDatagramChannel(this, toNativeFamily(family));
+    }
+
+    /**
+     * Not supported, ZeroTier sockets cannot be used to signal between threads of the same process
+     */
+    public Pipe openPipe() throws IOException
+    {
+        throw new UnsupportedOperationException("openPipe() is not supported");
+    }
+
+    public AbstractSelector openSelector() throws IOException
+    {
+        return new ZeroTierSelector(this);
+    }
+
+    /**
+     * Open an IPv4 server socket channel
+     */
+    public ServerSocketChannel openServerSocketChannel() throws IOException
+    {
+        return new ZeroTierServerSocketChannel(this, ZeroTierNative.ZTS_AF_INET);
+    }
+
+    public ServerSocketChannel openServerSocketChannel(ProtocolFamily family) throws IOException
+    {
+        return new ZeroTierServerSocketChannel(this, toNativeFamily(family));
+    }
+
+    /**
+     * Open an IPv4 socket channel
+     */
+    public SocketChannel openSocketChannel() throws IOException
+    {
+        return new ZeroTierSocketChannel(this, ZeroTierNative.ZTS_AF_INET);
+    }
+
+    public SocketChannel openSocketChannel(ProtocolFamily family) throws IOException
+    {
+        return new ZeroTierSocketChannel(this, toNativeFamily(family));
+    }
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+package com.zerotier.sdk;
+
+import com.zerotier.sdk.ZeroTierNative;
+import java.io.IOException;
+import java.net.ServerSocket;
+import java.net.SocketAddress;
+import java.net.SocketOption;
+import java.net.StandardSocketOptions;
+import java.nio.channels.AlreadyBoundException;
+import java.nio.channels.ClosedChannelException;
+import java.nio.channels.NotYetBoundException;
+import java.nio.channels.SelectionKey;
+import java.nio.channels.ServerSocketChannel;
+import java.nio.channels.SocketChannel;
+import java.nio.channels.spi.SelectorProvider;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.HashSet;
+import java.util.Set;
+
+/**
+ * ServerSocketChannel over a ZeroTier TCP socket. Obtain instances from ZeroTierSelectorProvider.
+ *
+ * The java.net.ServerSocket adaptor returned by socket() is not supported.
+ */
+public class ZeroTierServerSocketChannel extends ServerSocketChannel implements ZeroTierSelectableChannel {
+    private static final Set<SocketOption<?>> _options = Collections.unmodifiableSet(new HashSet<SocketOption<?>>(
+        Arrays.<SocketOption<?>>asList(StandardSocketOptions.SO_REUSEADDR, StandardSocketOptions.SO_RCVBUF)));
+
+    private final int _zfd;
+    private final int _family;
+    private final Object _acceptLock = new Object();
+    private volatile boolean _bound;
+
+    ZeroTierServerSocketChannel(SelectorProvider provider, int family) throws IOException
+    {
+        super(provider);
+        _family = family;
+        _zfd = ZeroTierChannels.check(
+            ZeroTierNative.zts_bsd_socket(family, ZeroTierNative.ZTS_SOCK_STREAM, 0),
+            "socket()");
+    }
+
+    public int getNativeFd()
+    {
+        return _zfd;
+    }
+
+    public int translateInterestOps(int ops)
+    {
+        return (ops & SelectionKey.OP_ACCEPT) != 0 ? ZeroTierNative.ZTS_POLLIN : 0;
+    }
+
+    public int translateReadyOps(int revents, int interestOps)
+    {
+        if ((revents & (ZeroTierNative.ZTS_POLLIN | ZeroTierNative.ZTS_POLLERR | ZeroTierNative.ZTS_POLLNVAL)) != 0) {
+            return interestOps & SelectionKey.OP_ACCEPT;
+        }
+        return 0;
+    }
+
+    private void ensureOpen() throws ClosedChannelException
+    {
+        if (! isOpen()) {
+            throw new ClosedChannelException();
+        }
+    }
+
+    public ServerSocketChannel bind(SocketAddress local, int backlog) throws IOException
+    {
+        synchronized (_acceptLock) {
+            ensureOpen();
+            if (_bound) {
+                throw new AlreadyBoundException();
+            }
+            ZeroTierSocketAddress addr =
+                local == null ? ZeroTierChannels.anyAddress(_family) : ZeroTierChannels.toNative(local);
+            ZeroTierChannels.check(ZeroTierNative.zts_bsd_bind(_zfd, addr), "bind()");
+            ZeroTierChannels.check(ZeroTierNative.zts_bsd_listen(_zfd, backlog < 1 ? 50 : backlog), "listen()");
+            _bound = true;
+        }
+        return this;
+    }
+
+    public <T> ServerSocketChannel setOption(SocketOption<T> name, T value) throws IOException
+    {
+        ensureOpen();
+        if (! _options.contains(name)) {
+            throw new UnsupportedOperationException("'" + name + "' not supported");
+        }
+        ZeroTierChannels.setOption(_zfd, name, value);
+        return this;
+    }
+
+    public <T> T getOption(SocketOption<T> name) throws IOException
+    {
+        ensureOpen();
+        if (! _options.contains(name)) {
+            throw new UnsupportedOperationException("'" + name + "' not supported");
+        }
+        return ZeroTierChannels.getOption(_zfd, name);
+    }
+
+    public Set<SocketOption<?>> supportedOptions()
+    {
+        return _options;
+    }
+
+    /**
+     * Not supported
+     */
+    public ServerSocket socket()
+    {
+        throw new UnsupportedOperationException("socket() adaptor not supported, use setOption()/getOption()");
+    }
+
+    /**
+     * Accept a connection
+     * @return The new channel (in blocking mode), or null if non-blocking and no connection is pending
+     */
+    public SocketChannel accept() throws IOException
+    {
+        synchronized (_acceptLock) {
+            ensureOpen();
+            if (! _bound) {
+                throw new NotYetBoundException();
+            }
+            ZeroTierSocketAddress remoteAddr = new ZeroTierSocketAddress();
+            int retval = -1;
+            try {
+                begin();
+                retval = ZeroTierNative.zts_bsd_accept(_zfd, remoteAddr);
+            }
+            finally {
+                end(retval >= 0 || ZeroTierChannels.wouldBlock(retval));
+            }
+            if (ZeroTierChannels.wouldBlock(retval)) {
+                return null;
+            }
+            ZeroTierChannels.check(retval, "accept()");
+            return new ZeroTierSocketChannel(provider(), _family, retval, ZeroTierChannels.fromNative(remoteAddr));
+        }
+    }
+
+    public SocketAddress getLocalAddress() throws IOException
+    {
+        ensureOpen();
+        return _bound ? ZeroTierChannels.localAddress(_zfd) : null;
+    }
+
+    protected void implCloseSelectableChannel() throws IOException
+    {
+        ZeroTierNative.zts_bsd_close(_zfd);
+    }
+
+    protected void implConfigureBlocking(boolean block) throws IOException
+    {
+        ZeroTierChannels.configureBlocking(_zfd, block);
+    }
+
+    public String toString()
+    {
+        return "ZeroTierServerSocketChannel[fd=" + _zfd + "]";
+    }
+}
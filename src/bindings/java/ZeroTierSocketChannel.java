@@ -0,0 +1,402 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+package com.zerotier.sdk;
+
+import com.zerotier.sdk.ZeroTierNative;
+import java.io.IOException;
+import java.net.ConnectException;
+import java.net.InetSocketAddress;
+import java.net.Socket;
+import java.net.SocketAddress;
+import java.net.SocketOption;
+import java.net.StandardSocketOptions;
+import java.nio.ByteBuffer;
+import java.nio.channels.AlreadyConnectedException;
+import java.nio.channels.ClosedChannelException;
+import java.nio.channels.ConnectionPendingException;
+import java.nio.channels.NoConnectionPendingException;
+import java.nio.channels.NotYetConnectedException;
+import java.nio.channels.SelectionKey;
+import java.nio.channels.SocketChannel;
+import java.nio.channels.spi.SelectorProvider;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.HashSet;
+import java.util.Set;
+
+/**
+ * SocketChannel over a ZeroTier TCP socket. Obtain instances from ZeroTierSelectorProvider.
+ *
+ * The java.net.Socket adaptor returned by socket() is not supported, use
+ * setOption() and getOption() instead.
+ */
+public class ZeroTierSocketChannel extends SocketChannel implements ZeroTierSelectableChannel {
+    private static final Set<SocketOption<?>> _options = Collections.unmodifiableSet(new HashSet<SocketOption<?>>(
+        Arrays.<SocketOption<?>>asList(
+            StandardSocketOptions.TCP_NODELAY,
+            StandardSocketOptions.SO_KEEPALIVE,
+            StandardSocketOptions.SO_REUSEADDR,
+            StandardSocketOptions.SO_RCVBUF,
+            StandardSocketOptions.SO_SNDBUF,
+            StandardSocketOptions.SO_LINGER)));
+
+    private static final int ST_UNCONNECTED = 0;
+    private static final int ST_PENDING = 1;
+    private static final int ST_CONNECTED = 2;
+
+    private final int _zfd;
+    private final int _family;
+    private final Object _readLock = new Object();
+    private final Object _writeLock = new Object();
+    private final Object _stateLock = new Object();
+    private volatile int _state = ST_UNCONNECTED;
+    private volatile boolean _inputShutdown;
+    private volatile boolean _outputShutdown;
+    private InetSocketAddress _remoteAddr;
+
+    ZeroTierSocketChannel(SelectorProvider provider, int family) throws IOException
+    {
+        super(provider);
+        _family = family;
+        _zfd = ZeroTierChannels.check(
+            ZeroTierNative.zts_bsd_socket(family, ZeroTierNative.ZTS_SOCK_STREAM, 0),
+            "socket()");
+    }
+
+    /**
+     * Wrap a socket returned by accept()
+     */
+    ZeroTierSocketChannel(SelectorProvider provider, int family, int zfd, InetSocketAddress remoteAddr)
+    {
+        super(provider);
+        _family = family;
+        _zfd = zfd;
+        _remoteAddr = remoteAddr;
+        _state = ST_CONNECTED;
+    }
+
+    public int getNativeFd()
+    {
+        return _zfd;
+    }
+
+    public int translateInterestOps(int ops)
+    {
+        int events = 0;
+        if ((ops & SelectionKey.OP_READ) != 0) {
+            events |= ZeroTierNative.ZTS_POLLIN;
+        }
+        if ((ops & (SelectionKey.OP_WRITE | SelectionKey.OP_CONNECT)) != 0) {
+            events |= ZeroTierNative.ZTS_POLLOUT;
+        }
+        return events;
+    }
+
+    public int translateReadyOps(int revents, int interestOps)
+    {
+        if ((revents & (ZeroTierNative.ZTS_POLLERR | ZeroTierNative.ZTS_POLLHUP | ZeroTierNative.ZTS_POLLNVAL)) != 0) {
+            // Let whichever operation the caller attempts next observe the error
+            return interestOps;
+        }
+        int ops = 0;
+        if ((revents & ZeroTierNative.ZTS_POLLIN) != 0) {
+            ops |= SelectionKey.OP_READ;
+        }
+        if ((revents & ZeroTierNative.ZTS_POLLOUT) != 0) {
+            ops |= (_state == ST_PENDING) ? SelectionKey.OP_CONNECT : SelectionKey.OP_WRITE;
+        }
+        return ops & interestOps;
+    }
+
+    private void ensureOpen() throws ClosedChannelException
+    {
+        if (! isOpen()) {
+            throw new ClosedChannelException();
+        }
+    }
+
+    private void ensureConnected() throws IOException
+    {
+        ensureOpen();
+        if (_state != ST_CONNECTED) {
+            throw new NotYetConnectedException();
+        }
+    }
+
+    public SocketChannel bind(SocketAddress local) throws IOException
+    {
+        synchronized (_stateLock) {
+            ensureOpen();
+            if (_state != ST_UNCONNECTED) {
+                throw new AlreadyConnectedException();
+            }
+            ZeroTierSocketAddress addr =
+                local == null ? ZeroTierChannels.anyAddress(_family) : ZeroTierChannels.toNative(local);
+            ZeroTierChannels.check(ZeroTierNative.zts_bsd_bind(_zfd, addr), "bind()");
+        }
+        return this;
+    }
+
+    public <T> SocketChannel setOption(SocketOption<T> name, T value) throws IOException
+    {
+        ensureOpen();
+        if (! _options.contains(name)) {
+            throw new UnsupportedOperationException("'" + name + "' not supported");
+        }
+        ZeroTierChannels.setOption(_zfd, name, value);
+        return this;
+    }
+
+    public <T> T getOption(SocketOption<T> name) throws IOException
+    {
+        ensureOpen();
+        if (! _options.contains(name)) {
+            throw new UnsupportedOperationException("'" + name + "' not supported");
+        }
+        return ZeroTierChannels.getOption(_zfd, name);
+    }
+
+    public Set<SocketOption<?>> supportedOptions()
+    {
+        return _options;
+    }
+
+    public SocketChannel shutdownInput() throws IOException
+    {
+        ensureConnected();
+        if (! _inputShutdown) {
+            ZeroTierChannels.check(ZeroTierNative.zts_bsd_shutdown(_zfd, ZeroTierNative.ZTS_SHUT_RD), "shutdown()");
+            _inputShutdown = true;
+        }
+        return this;
+    }
+
+    public SocketChannel shutdownOutput() throws IOException
+    {
+        ensureConnected();
+        if (! _outputShutdown) {
+            ZeroTierChannels.check(ZeroTierNative.zts_bsd_shutdown(_zfd, ZeroTierNative.ZTS_SHUT_WR), "shutdown()");
+            _outputShutdown = true;
+        }
+        return this;
+    }
+
+    /**
+     * Not supported
+     */
+    public Socket socket()
+    {
+        throw new UnsupportedOperationException("socket() adaptor not supported, use setOption()/getOption()");
+    }
+
+    public boolean isConnected()
+    {
+        return _state == ST_CONNECTED;
+    }
+
+    public boolean isConnectionPending()
+    {
+        return _state == ST_PENDING;
+    }
+
+    public boolean connect(SocketAddress remote) throws IOException
+    {
+        synchronized (_stateLock) {
+            ensureOpen();
+            if (_state == ST_CONNECTED) {
+                throw new AlreadyConnectedException();
+            }
+            if (_state == ST_PENDING) {
+                throw new ConnectionPendingException();
+            }
+            ZeroTierSocketAddress addr = ZeroTierChannels.toNative(remote);
+            int retval = -1;
+            try {
+                begin();
+                retval = ZeroTierNative.zts_bsd_connect(_zfd, addr);
+            }
+            finally {
+                end(retval >= 0 || retval == -ZeroTierNative.ZTS_EINPROGRESS);
+            }
+            if (retval >= 0) {
+                _remoteAddr = (InetSocketAddress)remote;
+                _state = ST_CONNECTED;
+                return true;
+            }
+            if (retval == -ZeroTierNative.ZTS_EINPROGRESS) {
+                _remoteAddr = (InetSocketAddress)remote;
+                _state = ST_PENDING;
+                return false;
+            }
+            throw new ConnectException("connect(), errno=" + retval);
+        }
+    }
+
+    public boolean finishConnect() throws IOException
+    {
+        synchronized (_stateLock) {
+            ensureOpen();
+            if (_state == ST_CONNECTED) {
+                return true;
+            }
+            if (_state != ST_PENDING) {
+                throw new NoConnectionPendingException();
+            }
+            while (true) {
+                int err = ZeroTierNative.zts_get_socket_error(_zfd);
+                if (err != 0) {
+                    throw new ConnectException("finishConnect(), error=" + err);
+                }
+                // lwIP reports EISCONN once the handshake has completed, EALREADY while it is underway
+                int retval = ZeroTierNative.zts_bsd_connect(_zfd, ZeroTierChannels.toNative(_remoteAddr));
+                if (retval >= 0 || retval == -ZeroTierNative.ZTS_EISCONN) {
+                    _state = ST_CONNECTED;
+                    return true;
+                }
+                if (retval != -ZeroTierNative.ZTS_EALREADY && retval != -ZeroTierNative.ZTS_EINPROGRESS) {
+                    throw new ConnectException("finishConnect(), errno=" + retval);
+                }
+                if (! isBlocking()) {
+                    return false;
+                }
+                try {
+                    begin();
+                    ZeroTierChannels.waitFor(_zfd, ZeroTierNative.ZTS_POLLOUT);
+                }
+                finally {
+                    end(true);
+                }
+            }
+        }
+    }
+
+    public SocketAddress getRemoteAddress() throws IOException
+    {
+        ensureOpen();
+        return _state == ST_CONNECTED ? _remoteAddr : null;
+    }
+
+    public SocketAddress getLocalAddress() throws IOException
+    {
+        ensureOpen();
+        return ZeroTierChannels.localAddress(_zfd);
+    }
+
+    public int read(ByteBuffer dst) throws IOException
+    {
+        synchronized (_readLock) {
+            ensureConnected();
+            if (_inputShutdown) {
+                return -1;
+            }
+            if (! dst.hasRemaining()) {
+                return 0;
+            }
+            int retval = 0;
+            try {
+                begin();
+                retval = ZeroTierChannels.read(_zfd, dst);
+            }
+            finally {
+                end(retval >= 0 || ZeroTierChannels.wouldBlock(retval));
+            }
+            if (retval == 0) {
+                return -1;
+            }
+            if (ZeroTierChannels.wouldBlock(retval)) {
+                return 0;
+            }
+            return ZeroTierChannels.check(retval, "read()");
+        }
+    }
+
+    public long read(ByteBuffer[] dsts, int offset, int length) throws IOException
+    {
+        if (offset < 0 || length < 0 || offset > dsts.length - length) {
+            throw new IndexOutOfBoundsException();
+        }
+        long total = 0;
+        for (int i = offset; i < offset + length; i++) {
+            if (! dsts[i].hasRemaining()) {
+                continue;
+            }
+            int n = read(dsts[i]);
+            if (n < 0) {
+                return total > 0 ? total : -1;
+            }
+            total += n;
+            if (dsts[i].hasRemaining()) {
+                break;
+            }
+        }
+        return total;
+    }
+
+    public int write(ByteBuffer src) throws IOException
+    {
+        synchronized (_writeLock) {
+            ensureConnected();
+            if (_outputShutdown) {
+                throw new ClosedChannelException();
+            }
+            int written = 0;
+            while (src.hasRemaining()) {
+                int retval = 0;
+                try {
+                    begin();
+                    retval = ZeroTierChannels.write(_zfd, src);
+                }
+                finally {
+                    end(retval >= 0 || ZeroTierChannels.wouldBlock(retval));
+                }
+                // A non-blocking channel stops once the send buffer is full
+                if (ZeroTierChannels.wouldBlock(retval)) {
+                    break;
+                }
+                written += ZeroTierChannels.check(retval, "write()");
+            }
+            return written;
+        }
+    }
+
+    public long write(ByteBuffer[] srcs, int offset, int length) throws IOException
+    {
+        if (offset < 0 || length < 0 || offset > srcs.length - length) {
+            throw new IndexOutOfBoundsException();
+        }
+        long total = 0;
+        for (int i = offset; i < offset + length; i++) {
+            total += write(srcs[i]);
+            if (srcs[i].hasRemaining()) {
+                break;
+            }
+        }
+        return total;
+    }
+
+    protected void implCloseSelectableChannel() throws IOException
+    {
+        ZeroTierNative.zts_bsd_close(_zfd);
+    }
+
+    protected void implConfigureBlocking(boolean block) throws IOException
+    {
+        ZeroTierChannels.configureBlocking(_zfd, block);
+    }
+
+    public String toString()
+    {
+        return "ZeroTierSocketChannel[fd=" + _zfd + ", remote=" + _remoteAddr + "]";
+    }
+}
@@ -0,0 +1,876 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * N-API addon backing the Node.js binding (libzt.js)
+ *
+ * Sockets are always non-blocking. Readiness is delivered to JavaScript by watching the OS fd
+ * of a zts_poller with a uv_poll_t on the Node event loop, so no call made here ever blocks or
+ * occupies a libuv threadpool worker. Data is read into and written from the memory of the
+ * caller's Buffer without an intermediate copy.
+ */
+
+#define NAPI_VERSION 4
+
+#include "ZeroTierSockets.h"
+
+#include <map>
+#include <node_api.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <uv.h>
+#include <vector>
+
+#define NODE_ZTS_MAX_ARGS 4
+
+// Hex representation of a 64-bit ID, network and node IDs exceed what a JS number can hold
+#define NODE_ZTS_ID_STR_LEN 17
+
+#define NODE_ZTS_MAX_PATH_LEN 4096
+
+#define NAPI_CALL(env, call)                                                                                           \
+    do {                                                                                                               \
+        if ((call) != napi_ok) {                                                                                       \
+            node_zts_throw_last_error(env);                                                                            \
+            return NULL;                                                                                               \
+        }                                                                                                              \
+    } while (0)
+
+static void node_zts_throw_last_error(napi_env env)
+{
+    bool pending = false;
+    napi_is_exception_pending(env, &pending);
+    if (! pending) {
+        const napi_extended_error_info* info = NULL;
+        napi_get_last_error_info(env, &info);
+        napi_throw_error(env, NULL, (info && info->error_message) ? info->error_message : "N-API call failed");
+    }
+}
+
+/** Return value convention shared with the Java binding: results >= 0 pass through, errors become -errno */
+static int node_zts_result(int retval)
+{
+    return retval > -1 ? retval : -(zts_errno);
+}
+
+static napi_value node_zts_int(napi_env env, int value)
+{
+    napi_value result = NULL;
+    napi_create_int32(env, value, &result);
+    return result;
+}
+
+static napi_value node_zts_bool(napi_env env, bool value)
+{
+    napi_value result = NULL;
+    napi_get_boolean(env, value, &result);
+    return result;
+}
+
+static napi_value node_zts_string(napi_env env, const char* value)
+{
+    napi_value result = NULL;
+    napi_create_string_utf8(env, value, NAPI_AUTO_LENGTH, &result);
+    return result;
+}
+
+static napi_value node_zts_id(napi_env env, uint64_t id)
+{
+    char str[NODE_ZTS_ID_STR_LEN];
+    snprintf(str, sizeof(str), "%llx", (unsigned long long)id);
+    return node_zts_string(env, str);
+}
+
+static bool node_zts_get_args(napi_env env, napi_callback_info info, size_t expected, napi_value* argv)
+{
+    size_t argc = NODE_ZTS_MAX_ARGS;
+    if (napi_get_cb_info(env, info, &argc, argv, NULL, NULL) != napi_ok) {
+        node_zts_throw_last_error(env);
+        return false;
+    }
+    if (argc < expected) {
+        napi_throw_type_error(env, NULL, "Wrong number of arguments");
+        return false;
+    }
+    return true;
+}
+
+static bool node_zts_get_int(napi_env env, napi_value value, int* out)
+{
+    if (napi_get_value_int32(env, value, out) != napi_ok) {
+        napi_throw_type_error(env, NULL, "Expected a number");
+        return false;
+    }
+    return true;
+}
+
+static bool node_zts_get_str(napi_env env, napi_value value, char* out, size_t len)
+{
+    size_t copied = 0;
+    if (napi_get_value_string_utf8(env, value, out, len, &copied) != napi_ok) {
+        napi_throw_type_error(env, NULL, "Expected a string");
+        return false;
+    }
+    return true;
+}
+
+static bool node_zts_get_id(napi_env env, napi_value value, uint64_t* out)
+{
+    char str[NODE_ZTS_ID_STR_LEN + 1];
+    if (! node_zts_get_str(env, value, str, sizeof(str))) {
+        return false;
+    }
+    char* end = NULL;
+    *out = strtoull(str, &end, 16);
+    if (end == str || *end != '\0') {
+        napi_throw_type_error(env, NULL, "Expected a hexadecimal ID string");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Resolve a (buffer, offset, length) triple into a pointer into the Buffer's own memory
+ */
+static bool node_zts_get_buffer(napi_env env, napi_value* argv, char** data, size_t* len)
+{
+    void* base = NULL;
+    size_t size = 0;
+    int offset = 0;
+    int length = 0;
+    if (napi_get_buffer_info(env, argv[0], &base, &size) != napi_ok) {
+        napi_throw_type_error(env, NULL, "Expected a Buffer");
+        return false;
+    }
+    if (! node_zts_get_int(env, argv[1], &offset) || ! node_zts_get_int(env, argv[2], &length)) {
+        return false;
+    }
+    if (offset < 0 || length < 0 || (size_t)offset + (size_t)length > size) {
+        napi_throw_range_error(env, NULL, "Offset and length exceed the bounds of the Buffer");
+        return false;
+    }
+    *data = (char*)base + offset;
+    *len = (size_t)length;
+    return true;
+}
+
+static napi_value node_zts_sockaddr_to_object(napi_env env, struct zts_sockaddr_storage* ss, zts_socklen_t addrlen)
+{
+    char ipstr[ZTS_INET6_ADDRSTRLEN] = { 0 };
+    unsigned short port = 0;
+    if (zts_util_ntop((struct zts_sockaddr*)ss, addrlen, ipstr, ZTS_INET6_ADDRSTRLEN, &port) != ZTS_ERR_OK) {
+        return node_zts_int(env, ZTS_ERR_ARG);
+    }
+    napi_value obj = NULL;
+    napi_create_object(env, &obj);
+    napi_set_named_property(env, obj, "address", node_zts_string(env, ipstr));
+    napi_set_named_property(env, obj, "port", node_zts_int(env, port));
+    napi_set_named_property(
+        env,
+        obj,
+        "family",
+        node_zts_string(env, ss->ss_family == ZTS_AF_INET6 ? "IPv6" : "IPv4"));
+    return obj;
+}
+
+//----------------------------------------------------------------------------//
+// Sockets                                                                    //
+//----------------------------------------------------------------------------//
+
+/** socket(family, type, protocol) -> fd, always non-blocking */
+static napi_value node_zts_socket(napi_env env, napi_callback_info info)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    int family, type, protocol;
+    if (! node_zts_get_args(env, info, 3, argv) || ! node_zts_get_int(env, argv[0], &family)
+        || ! node_zts_get_int(env, argv[1], &type) || ! node_zts_get_int(env, argv[2], &protocol)) {
+        return NULL;
+    }
+    int fd = zts_bsd_socket(family, type, protocol);
+    if (fd < 0) {
+        return node_zts_int(env, node_zts_result(fd));
+    }
+    int err = zts_set_blocking(fd, 0);
+    if (err < 0) {
+        err = node_zts_result(err);
+        zts_bsd_close(fd);
+        return node_zts_int(env, err);
+    }
+    return node_zts_int(env, fd);
+}
+
+typedef int(ZTCALL* node_zts_addr_fn)(int fd, const struct zts_sockaddr* addr, zts_socklen_t addrlen);
+
+static napi_value node_zts_addr_call(napi_env env, napi_callback_info info, node_zts_addr_fn fn)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    int fd, port;
+    char ipstr[ZTS_INET6_ADDRSTRLEN];
+    if (! node_zts_get_args(env, info, 3, argv) || ! node_zts_get_int(env, argv[0], &fd)
+        || ! node_zts_get_str(env, argv[1], ipstr, sizeof(ipstr)) || ! node_zts_get_int(env, argv[2], &port)) {
+        return NULL;
+    }
+    struct zts_sockaddr_storage ss;
+    zts_socklen_t addrlen = sizeof(ss);
+    memset(&ss, 0, sizeof(ss));
+    if (zts_util_ipstr_to_saddr(ipstr, (unsigned short)port, (struct zts_sockaddr*)&ss, &addrlen) != ZTS_ERR_OK) {
+        return node_zts_int(env, -ZTS_EINVAL);
+    }
+    return node_zts_int(env, node_zts_result(fn(fd, (struct zts_sockaddr*)&ss, addrlen)));
+}
+
+/** bind(fd, ip, port) -> 0 or -errno */
+static napi_value node_zts_bind(napi_env env, napi_callback_info info)
+{
+    return node_zts_addr_call(env, info, zts_bsd_bind);
+}
+
+/** connect(fd, ip, port) -> 0 or -errno, typically -EINPROGRESS */
+static napi_value node_zts_connect(napi_env env, napi_callback_info info)
+{
+    return node_zts_addr_call(env, info, zts_bsd_connect);
+}
+
+/** listen(fd, backlog) -> 0 or -errno */
+static napi_value node_zts_listen(napi_env env, napi_callback_info info)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    int fd, backlog;
+    if (! node_zts_get_args(env, info, 2, argv) || ! node_zts_get_int(env, argv[0], &fd)
+        || ! node_zts_get_int(env, argv[1], &backlog)) {
+        return NULL;
+    }
+    return node_zts_int(env, node_zts_result(zts_bsd_listen(fd, backlog)));
+}
+
+/** accept(fd) -> new non-blocking fd or -errno */
+static napi_value node_zts_accept(napi_env env, napi_callback_info info)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    int fd;
+    if (! node_zts_get_args(env, info, 1, argv) || ! node_zts_get_int(env, argv[0], &fd)) {
+        return NULL;
+    }
+    int newfd = zts_bsd_accept(fd, NULL, NULL);
+    if (newfd < 0) {
+        return node_zts_int(env, node_zts_result(newfd));
+    }
+    int err = zts_set_blocking(newfd, 0);
+    if (err < 0) {
+        err = node_zts_result(err);
+        zts_bsd_close(newfd);
+        return node_zts_int(env, err);
+    }
+    return node_zts_int(env, newfd);
+}
+
+typedef int(ZTCALL* node_zts_name_fn)(int fd, struct zts_sockaddr* addr, zts_socklen_t* addrlen);
+
+static napi_value node_zts_name_call(napi_env env, napi_callback_info info, node_zts_name_fn fn)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    int fd;
+    if (! node_zts_get_args(env, info, 1, argv) || ! node_zts_get_int(env, argv[0], &fd)) {
+        return NULL;
+    }
+    struct zts_sockaddr_storage ss;
+    zts_socklen_t addrlen = sizeof(ss);
+    memset(&ss, 0, sizeof(ss));
+    int err = fn(fd, (struct zts_sockaddr*)&ss, &addrlen);
+    if (err < 0) {
+        return node_zts_int(env, node_zts_result(err));
+    }
+    return node_zts_sockaddr_to_object(env, &ss, addrlen);
+}
+
+/** peername(fd) -> { address, port, family } or -errno */
+static napi_value node_zts_peername(napi_env env, napi_callback_info info)
+{
+    return node_zts_name_call(env, info, zts_bsd_getpeername);
+}
+
+/** sockname(fd) -> { address, port, family } or -errno */
+static napi_value node_zts_sockname(napi_env env, napi_callback_info info)
+{
+    return node_zts_name_call(env, info, zts_bsd_getsockname);
+}
+
+/** recv(fd, buffer, offset, length) -> bytes read (0 on EOF) or -errno. Reads straight into the Buffer */
+static napi_value node_zts_recv(napi_env env, napi_callback_info info)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    int fd;
+    char* data = NULL;
+    size_t len = 0;
+    if (! node_zts_get_args(env, info, 4, argv) || ! node_zts_get_int(env, argv[0], &fd)
+        || ! node_zts_get_buffer(env, argv + 1, &data, &len)) {
+        return NULL;
+    }
+    return node_zts_int(env, node_zts_result(zts_bsd_recv(fd, data, len, 0)));
+}
+
+/** send(fd, buffer, offset, length) -> bytes written or -errno. Writes straight from the Buffer */
+static napi_value node_zts_send(napi_env env, napi_callback_info info)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    int fd;
+    char* data = NULL;
+    size_t len = 0;
+    if (! node_zts_get_args(env, info, 4, argv) || ! node_zts_get_int(env, argv[0], &fd)
+        || ! node_zts_get_buffer(env, argv + 1, &data, &len)) {
+        return NULL;
+    }
+    return node_zts_int(env, node_zts_result(zts_bsd_send(fd, data, len, 0)));
+}
+
+/** shutdown(fd, how) -> 0 or -errno */
+static napi_value node_zts_shutdown(napi_env env, napi_callback_info info)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    int fd, how;
+    if (! node_zts_get_args(env, info, 2, argv) || ! node_zts_get_int(env, argv[0], &fd)
+        || ! node_zts_get_int(env, argv[1], &how)) {
+        return NULL;
+    }
+    return node_zts_int(env, node_zts_result(zts_bsd_shutdown(fd, how)));
+}
+
+/** close(fd) -> 0 or -errno */
+static napi_value node_zts_close(napi_env env, napi_callback_info info)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    int fd;
+    if (! node_zts_get_args(env, info, 1, argv) || ! node_zts_get_int(env, argv[0], &fd)) {
+        return NULL;
+    }
+    return node_zts_int(env, node_zts_result(zts_bsd_close(fd)));
+}
+
+typedef int(ZTCALL* node_zts_flag_fn)(int fd, int enabled);
+
+static napi_value node_zts_flag_call(napi_env env, napi_callback_info info, node_zts_flag_fn fn)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    int fd;
+    bool enabled = false;
+    if (! node_zts_get_args(env, info, 2, argv) || ! node_zts_get_int(env, argv[0], &fd)) {
+        return NULL;
+    }
+    if (napi_get_value_bool(env, argv[1], &enabled) != napi_ok) {
+        napi_throw_type_error(env, NULL, "Expected a boolean");
+        return NULL;
+    }
+    return node_zts_int(env, node_zts_result(fn(fd, enabled)));
+}
+
+/** setNoDelay(fd, enabled) -> 0 or -errno */
+static napi_value node_zts_set_no_delay(napi_env env, napi_callback_info info)
+{
+    return node_zts_flag_call(env, info, zts_set_no_delay);
+}
+
+/** setKeepAlive(fd, enabled) -> 0 or -errno */
+static napi_value node_zts_set_keepalive(napi_env env, napi_callback_info info)
+{
+    return node_zts_flag_call(env, info, zts_set_keepalive);
+}
+
+/** getSocketError(fd) -> pending error (0 if none) or -errno */
+static napi_value node_zts_get_socket_error(napi_env env, napi_callback_info info)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    int fd;
+    if (! node_zts_get_args(env, info, 1, argv) || ! node_zts_get_int(env, argv[0], &fd)) {
+        return NULL;
+    }
+    return node_zts_int(env, node_zts_result(zts_get_socket_error(fd)));
+}
+
+//----------------------------------------------------------------------------//
+// Poller integration with the libuv event loop                               //
+//----------------------------------------------------------------------------//
+
+/**
+ * A poller being watched by the event loop. When its OS fd becomes readable all pending
+ * readiness events are drained into a JS Int32Array as (fd, revents) pairs and the JS
+ * callback is invoked once with the number of pairs.
+ */
+struct NodeZtsWatch {
+    napi_env env;
+    int pfd;
+    uv_poll_t handle;
+    napi_ref callback;
+    napi_ref events;
+    napi_async_context context;
+    std::vector<zts_poller_event_t> scratch;
+};
+
+static std::map<int, NodeZtsWatch*> _watches;
+
+static void node_zts_watch_closed(uv_handle_t* handle)
+{
+    delete (NodeZtsWatch*)handle->data;
+}
+
+static void node_zts_watch_release(NodeZtsWatch* watch)
+{
+    uv_poll_stop(&watch->handle);
+    napi_delete_reference(watch->env, watch->callback);
+    napi_delete_reference(watch->env, watch->events);
+    napi_async_destroy(watch->env, watch->context);
+    uv_close((uv_handle_t*)&watch->handle, node_zts_watch_closed);
+}
+
+static void node_zts_watch_ready(uv_poll_t* handle, int status, int uv_events)
+{
+    NodeZtsWatch* watch = (NodeZtsWatch*)handle->data;
+    napi_env env = watch->env;
+    napi_handle_scope scope;
+    if (napi_open_handle_scope(env, &scope) != napi_ok) {
+        return;
+    }
+    napi_value events = NULL;
+    napi_value callback = NULL;
+    napi_get_reference_value(env, watch->events, &events);
+    napi_get_reference_value(env, watch->callback, &callback);
+    napi_typedarray_type type;
+    size_t length = 0;
+    void* data = NULL;
+    if (events && callback
+        && napi_get_typedarray_info(env, events, &type, &length, &data, NULL, NULL) == napi_ok) {
+        // A wait with a zero timeout also consumes the wakeup on the OS fd
+        int max_events = (int)(length / 2);
+        if ((int)watch->scratch.size() < max_events) {
+            watch->scratch.resize(max_events);
+        }
+        int n = zts_poller_wait(watch->pfd, watch->scratch.data(), max_events, 0);
+        int32_t* pairs = (int32_t*)data;
+        for (int i = 0; i < n; i++) {
+            pairs[2 * i] = watch->scratch[i].fd;
+            pairs[2 * i + 1] = watch->scratch[i].revents;
+        }
+        napi_value argv[1] = { node_zts_int(env, n < 0 ? node_zts_result(n) : n) };
+        // Unlike napi_call_function, napi_make_callback needs an object as the receiver
+        napi_value recv = NULL;
+        napi_get_global(env, &recv);
+        napi_value result = NULL;
+        if (napi_make_callback(env, watch->context, recv, callback, 1, argv, &result) != napi_ok) {
+            bool pending = false;
+            napi_is_exception_pending(env, &pending);
+            if (pending) {
+                napi_value exception = NULL;
+                napi_get_and_clear_last_exception(env, &exception);
+                napi_fatal_exception(env, exception);
+            }
+        }
+    }
+    napi_close_handle_scope(env, scope);
+}
+
+/** pollerNew() -> pfd or -errno */
+static napi_value node_zts_poller_new(napi_env env, napi_callback_info info)
+{
+    return node_zts_int(env, node_zts_result(zts_poller_new()));
+}
+
+/** pollerFree(pfd) -> 0 or -errno. Also stops watching it */
+static napi_value node_zts_poller_free(napi_env env, napi_callback_info info)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    int pfd;
+    if (! node_zts_get_args(env, info, 1, argv) || ! node_zts_get_int(env, argv[0], &pfd)) {
+        return NULL;
+    }
+    std::map<int, NodeZtsWatch*>::iterator it = _watches.find(pfd);
+    if (it != _watches.end()) {
+        node_zts_watch_release(it->second);
+        _watches.erase(it);
+    }
+    return node_zts_int(env, node_zts_result(zts_poller_free(pfd)));
+}
+
+/** pollerSet(pfd, fd, events) -> 0 or -errno */
+static napi_value node_zts_poller_set(napi_env env, napi_callback_info info)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    int pfd, fd, events;
+    if (! node_zts_get_args(env, info, 3, argv) || ! node_zts_get_int(env, argv[0], &pfd)
+        || ! node_zts_get_int(env, argv[1], &fd) || ! node_zts_get_int(env, argv[2], &events)) {
+        return NULL;
+    }
+    return node_zts_int(env, node_zts_result(zts_poller_set(pfd, fd, (short)events)));
+}
+
+/** pollerRemove(pfd, fd) -> 0 or -errno */
+static napi_value node_zts_poller_remove(napi_env env, napi_callback_info info)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    int pfd, fd;
+    if (! node_zts_get_args(env, info, 2, argv) || ! node_zts_get_int(env, argv[0], &pfd)
+        || ! node_zts_get_int(env, argv[1], &fd)) {
+        return NULL;
+    }
+    return node_zts_int(env, node_zts_result(zts_poller_remove(pfd, fd)));
+}
+
+/**
+ * pollerWatch(pfd, events, callback) -> 0 or -errno
+ *
+ * Start delivering readiness for `pfd` on the current event loop. `events` is an Int32Array
+ * that is filled with (fd, revents) pairs before each call to `callback(count)`.
+ */
+static napi_value node_zts_poller_watch(napi_env env, napi_callback_info info)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    int pfd;
+    if (! node_zts_get_args(env, info, 3, argv) || ! node_zts_get_int(env, argv[0], &pfd)) {
+        return NULL;
+    }
+    napi_typedarray_type type;
+    size_t length = 0;
+    if (napi_get_typedarray_info(env, argv[1], &type, &length, NULL, NULL, NULL) != napi_ok
+        || type != napi_int32_array || length < 2) {
+        napi_throw_type_error(env, NULL, "Expected an Int32Array with room for at least one event");
+        return NULL;
+    }
+    if (_watches.count(pfd)) {
+        return node_zts_int(env, -ZTS_EEXIST);
+    }
+    int os_fd = zts_poller_get_os_fd(pfd);
+    if (os_fd < 0) {
+        return node_zts_int(env, node_zts_result(os_fd));
+    }
+    uv_loop_t* loop = NULL;
+    NAPI_CALL(env, napi_get_uv_event_loop(env, &loop));
+    NodeZtsWatch* watch = new NodeZtsWatch();
+    watch->env = env;
+    watch->pfd = pfd;
+    watch->handle.data = watch;
+    if (uv_poll_init(loop, &watch->handle, os_fd) != 0) {
+        delete watch;
+        return node_zts_int(env, -ZTS_EBADF);
+    }
+    napi_value resource_name = node_zts_string(env, "ZeroTierPoller");
+    napi_create_reference(env, argv[2], 1, &watch->callback);
+    napi_create_reference(env, argv[1], 1, &watch->events);
+    napi_async_init(env, NULL, resource_name, &watch->context);
+    uv_poll_start(&watch->handle, UV_READABLE, node_zts_watch_ready);
+    _watches[pfd] = watch;
+    return node_zts_int(env, ZTS_ERR_OK);
+}
+
+/** pollerUnwatch(pfd) -> 0, lets the event loop exit if nothing else keeps it alive */
+static napi_value node_zts_poller_unwatch(napi_env env, napi_callback_info info)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    int pfd;
+    if (! node_zts_get_args(env, info, 1, argv) || ! node_zts_get_int(env, argv[0], &pfd)) {
+        return NULL;
+    }
+    std::map<int, NodeZtsWatch*>::iterator it = _watches.find(pfd);
+    if (it != _watches.end()) {
+        node_zts_watch_release(it->second);
+        _watches.erase(it);
+    }
+    return node_zts_int(env, ZTS_ERR_OK);
+}
+
+//----------------------------------------------------------------------------//
+// Node and network control                                                   //
+//----------------------------------------------------------------------------//
+
+struct NodeZtsEvent {
+    int code;
+    uint64_t id;
+};
+
+static napi_threadsafe_function _event_tsfn = NULL;
+
+/** Runs on the libzt callback thread. Copies what JS needs since msg is freed on return */
+static void node_zts_on_event(void* ptr)
+{
+    zts_event_msg_t* msg = (zts_event_msg_t*)ptr;
+    NodeZtsEvent* event = new NodeZtsEvent();
+    event->code = msg->event_code;
+    event->id = 0;
+    if (msg->node) {
+        event->id = msg->node->node_id;
+    }
+    else if (msg->network) {
+        event->id = msg->network->net_id;
+    }
+    else if (msg->peer) {
+        event->id = msg->peer->peer_id;
+    }
+    else if (msg->addr) {
+        event->id = msg->addr->net_id;
+    }
+    if (! _event_tsfn || napi_call_threadsafe_function(_event_tsfn, event, napi_tsfn_nonblocking) != napi_ok) {
+        delete event;
+    }
+}
+
+/** Runs on the Node event loop thread */
+static void node_zts_call_event_js(napi_env env, napi_value callback, void* context, void* data)
+{
+    NodeZtsEvent* event = (NodeZtsEvent*)data;
+    if (env && callback) {
+        napi_value argv[2] = { node_zts_int(env, event->code), node_zts_id(env, event->id) };
+        napi_value recv = NULL;
+        napi_get_undefined(env, &recv);
+        napi_call_function(env, recv, callback, 2, argv, NULL);
+    }
+    delete event;
+}
+
+/** initSetEventHandler(callback(code, idHex)) -> 0 or error */
+static napi_value node_zts_init_set_event_handler(napi_env env, napi_callback_info info)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    if (! node_zts_get_args(env, info, 1, argv)) {
+        return NULL;
+    }
+    if (_event_tsfn) {
+        return node_zts_int(env, ZTS_ERR_SERVICE);
+    }
+    napi_value resource_name = node_zts_string(env, "ZeroTierEvent");
+    NAPI_CALL(
+        env,
+        napi_create_threadsafe_function(
+            env,
+            argv[0],
+            NULL,
+            resource_name,
+            0,
+            1,
+            NULL,
+            NULL,
+            NULL,
+            node_zts_call_event_js,
+            &_event_tsfn));
+    // Events alone should not keep the process alive
+    napi_unref_threadsafe_function(env, _event_tsfn);
+    return node_zts_int(env, zts_init_set_event_handler(node_zts_on_event));
+}
+
+/** initFromStorage(path) -> 0 or error */
+static napi_value node_zts_init_from_storage(napi_env env, napi_callback_info info)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    char path[NODE_ZTS_MAX_PATH_LEN];
+    if (! node_zts_get_args(env, info, 1, argv) || ! node_zts_get_str(env, argv[0], path, sizeof(path))) {
+        return NULL;
+    }
+    return node_zts_int(env, zts_init_from_storage(path));
+}
+
+static napi_value node_zts_node_start(napi_env env, napi_callback_info info)
+{
+    return node_zts_int(env, zts_node_start());
+}
+
+static napi_value node_zts_node_stop(napi_env env, napi_callback_info info)
+{
+    return node_zts_int(env, zts_node_stop());
+}
+
+static napi_value node_zts_node_free(napi_env env, napi_callback_info info)
+{
+    return node_zts_int(env, zts_node_free());
+}
+
+static napi_value node_zts_node_is_online(napi_env env, napi_callback_info info)
+{
+    return node_zts_bool(env, zts_node_is_online() == 1);
+}
+
+/** nodeGetId() -> hex string */
+static napi_value node_zts_node_get_id(napi_env env, napi_callback_info info)
+{
+    return node_zts_id(env, zts_node_get_id());
+}
+
+typedef int(ZTCALL* node_zts_net_fn)(uint64_t net_id);
+
+static napi_value node_zts_net_call(napi_env env, napi_callback_info info, node_zts_net_fn fn)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    uint64_t net_id = 0;
+    if (! node_zts_get_args(env, info, 1, argv) || ! node_zts_get_id(env, argv[0], &net_id)) {
+        return NULL;
+    }
+    return node_zts_int(env, fn(net_id));
+}
+
+/** netJoin(netIdHex) -> 0 or error */
+static napi_value node_zts_net_join(napi_env env, napi_callback_info info)
+{
+    return node_zts_net_call(env, info, zts_net_join);
+}
+
+/** netLeave(netIdHex) -> 0 or error */
+static napi_value node_zts_net_leave(napi_env env, napi_callback_info info)
+{
+    return node_zts_net_call(env, info, zts_net_leave);
+}
+
+static int ZTCALL node_zts_net_transport_is_ready_fn(uint64_t net_id)
+{
+    return zts_net_transport_is_ready(net_id);
+}
+
+/** netTransportIsReady(netIdHex) -> boolean */
+static napi_value node_zts_net_transport_is_ready(napi_env env, napi_callback_info info)
+{
+    napi_value result = node_zts_net_call(env, info, node_zts_net_transport_is_ready_fn);
+    int ready = 0;
+    if (! result || napi_get_value_int32(env, result, &ready) != napi_ok) {
+        return NULL;
+    }
+    return node_zts_bool(env, ready == 1);
+}
+
+/** addrGetStr(netIdHex, family) -> address string, or error code if none is assigned */
+static napi_value node_zts_addr_get_str(napi_env env, napi_callback_info info)
+{
+    napi_value argv[NODE_ZTS_MAX_ARGS];
+    uint64_t net_id = 0;
+    int family;
+    if (! node_zts_get_args(env, info, 2, argv) || ! node_zts_get_id(env, argv[0], &net_id)
+        || ! node_zts_get_int(env, argv[1], &family)) {
+        return NULL;
+    }
+    char ipstr[ZTS_INET6_ADDRSTRLEN] = { 0 };
+    int err = zts_addr_get_str(net_id, family, ipstr, ZTS_INET6_ADDRSTRLEN);
+    if (err != ZTS_ERR_OK) {
+        return node_zts_int(env, err);
+    }
+    return node_zts_string(env, ipstr);
+}
+
+//----------------------------------------------------------------------------//
+// Module registration                                                        //
+//----------------------------------------------------------------------------//
+
+struct NodeZtsConstant {
+    const char* name;
+    int value;
+};
+
+static const NodeZtsConstant _constants[] = {
+    { "ZTS_ERR_OK", ZTS_ERR_OK },
+    { "ZTS_ERR_SOCKET", ZTS_ERR_SOCKET },
+    { "ZTS_ERR_SERVICE", ZTS_ERR_SERVICE },
+    { "ZTS_ERR_ARG", ZTS_ERR_ARG },
+    { "ZTS_ERR_NO_RESULT", ZTS_ERR_NO_RESULT },
+    { "ZTS_ERR_GENERAL", ZTS_ERR_GENERAL },
+    { "ZTS_AF_INET", ZTS_AF_INET },
+    { "ZTS_AF_INET6", ZTS_AF_INET6 },
+    { "ZTS_SOCK_STREAM", ZTS_SOCK_STREAM },
+    { "ZTS_SOCK_DGRAM", ZTS_SOCK_DGRAM },
+    { "ZTS_SHUT_RD", ZTS_SHUT_RD },
+    { "ZTS_SHUT_WR", ZTS_SHUT_WR },
+    { "ZTS_SHUT_RDWR", ZTS_SHUT_RDWR },
+    { "ZTS_POLLIN", ZTS_POLLIN },
+    { "ZTS_POLLOUT", ZTS_POLLOUT },
+    { "ZTS_POLLERR", ZTS_POLLERR },
+    { "ZTS_POLLHUP", ZTS_POLLHUP },
+    { "ZTS_POLLNVAL", ZTS_POLLNVAL },
+    { "ZTS_EAGAIN", ZTS_EAGAIN },
+    { "ZTS_EWOULDBLOCK", ZTS_EWOULDBLOCK },
+    { "ZTS_EINPROGRESS", ZTS_EINPROGRESS },
+    { "ZTS_EALREADY", ZTS_EALREADY },
+    { "ZTS_EINTR", ZTS_EINTR },
+    { "ZTS_ECONNRESET", ZTS_ECONNRESET },
+    { "ZTS_ENOTCONN", ZTS_ENOTCONN },
+    { "ZTS_ETIMEDOUT", ZTS_ETIMEDOUT },
+    { "ZTS_EEXIST", ZTS_EEXIST },
+    { "ZTS_EVENT_NODE_UP", ZTS_EVENT_NODE_UP },
+    { "ZTS_EVENT_NODE_ONLINE", ZTS_EVENT_NODE_ONLINE },
+    { "ZTS_EVENT_NODE_OFFLINE", ZTS_EVENT_NODE_OFFLINE },
+    { "ZTS_EVENT_NODE_DOWN", ZTS_EVENT_NODE_DOWN },
+    { "ZTS_EVENT_NODE_FATAL_ERROR", ZTS_EVENT_NODE_FATAL_ERROR },
+    { "ZTS_EVENT_NETWORK_NOT_FOUND", ZTS_EVENT_NETWORK_NOT_FOUND },
+    { "ZTS_EVENT_NETWORK_CLIENT_TOO_OLD", ZTS_EVENT_NETWORK_CLIENT_TOO_OLD },
+    { "ZTS_EVENT_NETWORK_REQ_CONFIG", ZTS_EVENT_NETWORK_REQ_CONFIG },
+    { "ZTS_EVENT_NETWORK_OK", ZTS_EVENT_NETWORK_OK },
+    { "ZTS_EVENT_NETWORK_ACCESS_DENIED", ZTS_EVENT_NETWORK_ACCESS_DENIED },
+    { "ZTS_EVENT_NETWORK_READY_IP4", ZTS_EVENT_NETWORK_READY_IP4 },
+    { "ZTS_EVENT_NETWORK_READY_IP6", ZTS_EVENT_NETWORK_READY_IP6 },
+    { "ZTS_EVENT_NETWORK_READY_IP4_IP6", ZTS_EVENT_NETWORK_READY_IP4_IP6 },
+    { "ZTS_EVENT_NETWORK_DOWN", ZTS_EVENT_NETWORK_DOWN },
+    { "ZTS_EVENT_NETWORK_UPDATE", ZTS_EVENT_NETWORK_UPDATE },
+    { "ZTS_EVENT_STACK_UP", ZTS_EVENT_STACK_UP },
+    { "ZTS_EVENT_STACK_DOWN", ZTS_EVENT_STACK_DOWN },
+    { "ZTS_EVENT_NETIF_UP", ZTS_EVENT_NETIF_UP },
+    { "ZTS_EVENT_NETIF_DOWN", ZTS_EVENT_NETIF_DOWN },
+    { "ZTS_EVENT_PEER_DIRECT", ZTS_EVENT_PEER_DIRECT },
+    { "ZTS_EVENT_PEER_RELAY", ZTS_EVENT_PEER_RELAY },
+    { "ZTS_EVENT_PEER_UNREACHABLE", ZTS_EVENT_PEER_UNREACHABLE },
+    { "ZTS_EVENT_PEER_PATH_DISCOVERED", ZTS_EVENT_PEER_PATH_DISCOVERED },
+    { "ZTS_EVENT_PEER_PATH_DEAD", ZTS_EVENT_PEER_PATH_DEAD },
+    { "ZTS_EVENT_ROUTE_ADDED", ZTS_EVENT_ROUTE_ADDED },
+    { "ZTS_EVENT_ROUTE_REMOVED", ZTS_EVENT_ROUTE_REMOVED },
+    { "ZTS_EVENT_ADDR_ADDED_IP4", ZTS_EVENT_ADDR_ADDED_IP4 },
+    { "ZTS_EVENT_ADDR_REMOVED_IP4", ZTS_EVENT_ADDR_REMOVED_IP4 },
+    { "ZTS_EVENT_ADDR_ADDED_IP6", ZTS_EVENT_ADDR_ADDED_IP6 },
+    { "ZTS_EVENT_ADDR_REMOVED_IP6", ZTS_EVENT_ADDR_REMOVED_IP6 },
+};
+
+static napi_value node_zts_module_init(napi_env env, napi_value exports)
+{
+    napi_property_descriptor functions[] = {
+        { "socket", NULL, node_zts_socket, NULL, NULL, NULL, napi_default, NULL },
+        { "bind", NULL, node_zts_bind, NULL, NULL, NULL, napi_default, NULL },
+        { "connect", NULL, node_zts_connect, NULL, NULL, NULL, napi_default, NULL },
+        { "listen", NULL, node_zts_listen, NULL, NULL, NULL, napi_default, NULL },
+        { "accept", NULL, node_zts_accept, NULL, NULL, NULL, napi_default, NULL },
+        { "peername", NULL, node_zts_peername, NULL, NULL, NULL, napi_default, NULL },
+        { "sockname", NULL, node_zts_sockname, NULL, NULL, NULL, napi_default, NULL },
+        { "recv", NULL, node_zts_recv, NULL, NULL, NULL, napi_default, NULL },
+        { "send", NULL, node_zts_send, NULL, NULL, NULL, napi_default, NULL },
+        { "shutdown", NULL, node_zts_shutdown, NULL, NULL, NULL, napi_default, NULL },
+        { "close", NULL, node_zts_close, NULL, NULL, NULL, napi_default, NULL },
+        { "setNoDelay", NULL, node_zts_set_no_delay, NULL, NULL, NULL, napi_default, NULL },
+        { "setKeepAlive", NULL, node_zts_set_keepalive, NULL, NULL, NULL, napi_default, NULL },
+        { "getSocketError", NULL, node_zts_get_socket_error, NULL, NULL, NULL, napi_default, NULL },
+        { "pollerNew", NULL, node_zts_poller_new, NULL, NULL, NULL, napi_default, NULL },
+        { "pollerFree", NULL, node_zts_poller_free, NULL, NULL, NULL, napi_default, NULL },
+        { "pollerSet", NULL, node_zts_poller_set, NULL, NULL, NULL, napi_default, NULL },
+        { "pollerRemove", NULL, node_zts_poller_remove, NULL, NULL, NULL, napi_default, NULL },
+        { "pollerWatch", NULL, node_zts_poller_watch, NULL, NULL, NULL, napi_default, NULL },
+        { "pollerUnwatch", NULL, node_zts_poller_unwatch, NULL, NULL, NULL, napi_default, NULL },
+        { "initSetEventHandler", NULL, node_zts_init_set_event_handler, NULL, NULL, NULL, napi_default, NULL },
+        { "initFromStorage", NULL, node_zts_init_from_storage, NULL, NULL, NULL, napi_default, NULL },
+        { "nodeStart", NULL, node_zts_node_start, NULL, NULL, NULL, napi_default, NULL },
+        { "nodeStop", NULL, node_zts_node_stop, NULL, NULL, NULL, napi_default, NULL },
+        { "nodeFree", NULL, node_zts_node_free, NULL, NULL, NULL, napi_default, NULL },
+        { "nodeIsOnline", NULL, node_zts_node_is_online, NULL, NULL, NULL, napi_default, NULL },
+        { "nodeGetId", NULL, node_zts_node_get_id, NULL, NULL, NULL, napi_default, NULL },
+        { "netJoin", NULL, node_zts_net_join, NULL, NULL, NULL, napi_default, NULL },
+        { "netLeave", NULL, node_zts_net_leave, NULL, NULL, NULL, napi_default, NULL },
+        { "netTransportIsReady", NULL, node_zts_net_transport_is_ready, NULL, NULL, NULL, napi_default, NULL },
+        { "addrGetStr", NULL, node_zts_addr_get_str, NULL, NULL, NULL, napi_default, NULL },
+    };
+    NAPI_CALL(env, napi_define_properties(env, exports, sizeof(functions) / sizeof(functions[0]), functions));
+    for (size_t i = 0; i < sizeof(_constants) / sizeof(_constants[0]); i++) {
+        napi_value value = node_zts_int(env, _constants[i].value);
+        NAPI_CALL(env, napi_set_named_property(env, exports, _constants[i].name, value));
+    }
+    return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, node_zts_module_init)
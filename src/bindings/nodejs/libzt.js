@@ -0,0 +1,606 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * ZeroTier sockets for Node.js
+ *
+ * Socket and Server mirror net.Socket and net.Server. All sockets are non-blocking and share
+ * one native poller whose OS fd is watched by the Node event loop, so no I/O is ever run on
+ * the libuv threadpool and the number of connections is not limited by its size.
+ */
+
+"use strict";
+
+const EventEmitter = require("events");
+const stream = require("stream");
+const zts = require("./build/Release/libzt.node");
+
+const READ_CHUNK_SIZE = 64 * 1024;
+const MAX_POLL_EVENTS = 256;
+const POLL_FAILED = zts.ZTS_POLLERR | zts.ZTS_POLLHUP | zts.ZTS_POLLNVAL;
+
+function wouldBlock(err)
+{
+    return err === -zts.ZTS_EAGAIN || err === -zts.ZTS_EWOULDBLOCK;
+}
+
+function errnoException(err, syscall)
+{
+    const e = new Error(syscall + " failed (errno " + -err + ")");
+    e.errno = -err;
+    e.syscall = syscall;
+    return e;
+}
+
+/**
+ * Dispatches readiness from the shared native poller to the sockets interested in it. The
+ * poller is only watched while at least one socket is registered so that an idle process
+ * can exit.
+ */
+class Poller {
+    constructor()
+    {
+        this._pfd = -1;
+        this._handlers = new Map();
+        this._events = new Int32Array(2 * MAX_POLL_EVENTS);
+        this._watching = false;
+        this._onReady = this._onReady.bind(this);
+    }
+
+    set(fd, events, handler)
+    {
+        if (this._pfd < 0) {
+            const pfd = zts.pollerNew();
+            if (pfd < 0) {
+                return pfd;
+            }
+            this._pfd = pfd;
+        }
+        const err = zts.pollerSet(this._pfd, fd, events);
+        if (err < 0) {
+            return err;
+        }
+        this._handlers.set(fd, handler);
+        if (! this._watching) {
+            const werr = zts.pollerWatch(this._pfd, this._events, this._onReady);
+            if (werr < 0) {
+                return werr;
+            }
+            this._watching = true;
+        }
+        return 0;
+    }
+
+    remove(fd)
+    {
+        if (! this._handlers.delete(fd)) {
+            return;
+        }
+        zts.pollerRemove(this._pfd, fd);
+        if (this._handlers.size === 0 && this._watching) {
+            zts.pollerUnwatch(this._pfd);
+            this._watching = false;
+        }
+    }
+
+    _onReady(count)
+    {
+        for (let i = 0; i < count; i++) {
+            const handler = this._handlers.get(this._events[2 * i]);
+            if (handler) {
+                handler(this._events[2 * i + 1]);
+            }
+        }
+    }
+}
+
+const poller = new Poller();
+
+/**
+ * A ZeroTier TCP connection, usable wherever a net.Socket duplex stream is expected
+ */
+class Socket extends stream.Duplex {
+    constructor(options)
+    {
+        options = options || {};
+        super({ allowHalfOpen: !! options.allowHalfOpen, readableHighWaterMark: options.readableHighWaterMark });
+        this._fd = options.fd !== undefined ? options.fd : -1;
+        this._connecting = false;
+        this._reading = false;
+        this._pendingWrite = null;
+        this._interest = 0;
+        this._onPoll = this._onPoll.bind(this);
+        this.bytesRead = 0;
+        this.bytesWritten = 0;
+        this.remoteAddress = undefined;
+        this.remotePort = undefined;
+        this.remoteFamily = undefined;
+        if (this._fd >= 0) {
+            this._setPeer();
+        }
+    }
+
+    get connecting()
+    {
+        return this._connecting;
+    }
+
+    get pending()
+    {
+        return this._fd < 0 || this._connecting;
+    }
+
+    get readyState()
+    {
+        if (this._connecting) {
+            return "opening";
+        }
+        if (this.readable && this.writable) {
+            return "open";
+        }
+        if (this.readable) {
+            return "readOnly";
+        }
+        return this.writable ? "writeOnly" : "closed";
+    }
+
+    /**
+     * Connect to a remote ZeroTier address. Accepts (port, host, listener) or ({ port, host }, listener)
+     */
+    connect(port, host, listener)
+    {
+        if (typeof port === "object" && port !== null) {
+            listener = host;
+            host = port.host;
+            port = port.port;
+        }
+        if (typeof host === "function") {
+            listener = host;
+            host = undefined;
+        }
+        if (typeof listener === "function") {
+            this.once("connect", listener);
+        }
+        host = host || "127.0.0.1";
+        const family = host.indexOf(":") >= 0 ? zts.ZTS_AF_INET6 : zts.ZTS_AF_INET;
+        const fd = zts.socket(family, zts.ZTS_SOCK_STREAM, 0);
+        if (fd < 0) {
+            process.nextTick(() => this.destroy(errnoException(fd, "socket")));
+            return this;
+        }
+        this._fd = fd;
+        this._connecting = true;
+        const err = zts.connect(fd, host, port);
+        if (err === 0) {
+            process.nextTick(() => this._onConnected());
+        }
+        else if (err === -zts.ZTS_EINPROGRESS || wouldBlock(err)) {
+            this._updateInterest(zts.ZTS_POLLOUT);
+        }
+        else {
+            process.nextTick(() => this.destroy(errnoException(err, "connect")));
+        }
+        return this;
+    }
+
+    _onConnected()
+    {
+        this._connecting = false;
+        this._setPeer();
+        this.emit("connect");
+        this.emit("ready");
+        if (this._reading) {
+            this._read();
+        }
+        if (this._pendingWrite) {
+            this._flush();
+        }
+    }
+
+    _setPeer()
+    {
+        const peer = zts.peername(this._fd);
+        if (typeof peer === "object") {
+            this.remoteAddress = peer.address;
+            this.remotePort = peer.port;
+            this.remoteFamily = peer.family;
+        }
+    }
+
+    /** Set the events the poller should report for this socket, 0 stops watching it */
+    _updateInterest(events)
+    {
+        if (this._interest === events || this._fd < 0) {
+            return;
+        }
+        this._interest = events;
+        if (events === 0) {
+            poller.remove(this._fd);
+            return;
+        }
+        const err = poller.set(this._fd, events, this._onPoll);
+        if (err < 0) {
+            this.destroy(errnoException(err, "poll"));
+        }
+    }
+
+    _onPoll(revents)
+    {
+        if (this._connecting) {
+            if ((revents & (zts.ZTS_POLLOUT | POLL_FAILED)) === 0) {
+                return;
+            }
+            const err = zts.getSocketError(this._fd);
+            this._updateInterest(0);
+            if (err !== 0) {
+                this.destroy(errnoException(err < 0 ? err : -err, "connect"));
+                return;
+            }
+            this._onConnected();
+            return;
+        }
+        if ((revents & (zts.ZTS_POLLOUT | POLL_FAILED)) && this._pendingWrite) {
+            this._flush();
+        }
+        if ((revents & (zts.ZTS_POLLIN | POLL_FAILED)) && this._reading) {
+            this._read();
+        }
+        this._updateInterest(
+            (this._reading ? zts.ZTS_POLLIN : 0) | (this._pendingWrite ? zts.ZTS_POLLOUT : 0));
+    }
+
+    _read()
+    {
+        this._reading = true;
+        if (this._fd < 0 || this._connecting || this.destroyed) {
+            return;
+        }
+        while (this._reading) {
+            const chunk = Buffer.allocUnsafe(READ_CHUNK_SIZE);
+            const n = zts.recv(this._fd, chunk, 0, chunk.length);
+            if (n > 0) {
+                this.bytesRead += n;
+                this._reading = this.push(n === chunk.length ? chunk : chunk.subarray(0, n));
+            }
+            else if (n === 0) {
+                this._reading = false;
+                this.push(null);
+            }
+            else if (wouldBlock(n)) {
+                break;
+            }
+            else {
+                this.destroy(errnoException(n, "recv"));
+                return;
+            }
+        }
+        this._updateInterest(
+            (this._reading ? zts.ZTS_POLLIN : 0) | (this._pendingWrite ? zts.ZTS_POLLOUT : 0));
+    }
+
+    _write(chunk, encoding, callback)
+    {
+        if (typeof chunk === "string") {
+            chunk = Buffer.from(chunk, encoding);
+        }
+        this._pendingWrite = { chunk: chunk, offset: 0, callback: callback };
+        if (! this._connecting && this._fd >= 0) {
+            this._flush();
+        }
+    }
+
+    /** Send as much of the pending write as the stack accepts, then wait for POLLOUT */
+    _flush()
+    {
+        const w = this._pendingWrite;
+        while (w.offset < w.chunk.length) {
+            const n = zts.send(this._fd, w.chunk, w.offset, w.chunk.length - w.offset);
+            if (n >= 0) {
+                w.offset += n;
+                this.bytesWritten += n;
+            }
+            else if (wouldBlock(n)) {
+                this._updateInterest(this._interest | zts.ZTS_POLLOUT);
+                return;
+            }
+            else {
+                this._pendingWrite = null;
+                w.callback(errnoException(n, "send"));
+                return;
+            }
+        }
+        this._pendingWrite = null;
+        this._updateInterest(this._reading ? zts.ZTS_POLLIN : 0);
+        w.callback();
+    }
+
+    _final(callback)
+    {
+        if (this._fd >= 0 && ! this._connecting) {
+            zts.shutdown(this._fd, zts.ZTS_SHUT_WR);
+        }
+        callback();
+    }
+
+    _destroy(err, callback)
+    {
+        if (this._fd >= 0) {
+            poller.remove(this._fd);
+            zts.close(this._fd);
+            this._fd = -1;
+        }
+        this._connecting = false;
+        this._reading = false;
+        if (this._pendingWrite) {
+            const w = this._pendingWrite;
+            this._pendingWrite = null;
+            w.callback(err || new Error("Socket closed"));
+        }
+        callback(err);
+    }
+
+    setNoDelay(noDelay)
+    {
+        if (this._fd >= 0) {
+            zts.setNoDelay(this._fd, noDelay === undefined ? true : !! noDelay);
+        }
+        return this;
+    }
+
+    setKeepAlive(enable)
+    {
+        if (this._fd >= 0) {
+            zts.setKeepAlive(this._fd, !! enable);
+        }
+        return this;
+    }
+
+    address()
+    {
+        const local = this._fd >= 0 ? zts.sockname(this._fd) : undefined;
+        return typeof local === "object" ? local : {};
+    }
+
+    get localAddress()
+    {
+        return this.address().address;
+    }
+
+    get localPort()
+    {
+        return this.address().port;
+    }
+
+    /** Present for compatibility with net.Socket, the poller never keeps a socket alive by itself */
+    ref()
+    {
+        return this;
+    }
+
+    unref()
+    {
+        return this;
+    }
+}
+
+/**
+ * Accepts ZeroTier TCP connections, mirroring net.Server
+ */
+class Server extends EventEmitter {
+    constructor(options, connectionListener)
+    {
+        super();
+        if (typeof options === "function") {
+            connectionListener = options;
+            options = {};
+        }
+        this._options = options || {};
+        this._fd = -1;
+        this._onPoll = this._onPoll.bind(this);
+        this.listening = false;
+        if (typeof connectionListener === "function") {
+            this.on("connection", connectionListener);
+        }
+    }
+
+    /**
+     * Listen on a ZeroTier address. Accepts (port, host, backlog, listener) or ({ port, host, backlog }, listener)
+     */
+    listen(port, host, backlog, listener)
+    {
+        if (typeof port === "object" && port !== null) {
+            listener = host;
+            backlog = port.backlog;
+            host = port.host;
+            port = port.port;
+        }
+        const args = [ host, backlog, listener ];
+        listener = args.find(a => typeof a === "function");
+        host = typeof host === "string" ? host : "0.0.0.0";
+        backlog = typeof backlog === "number" ? backlog : 511;
+        if (listener) {
+            this.once("listening", listener);
+        }
+        const family = host.indexOf(":") >= 0 ? zts.ZTS_AF_INET6 : zts.ZTS_AF_INET;
+        const fd = zts.socket(family, zts.ZTS_SOCK_STREAM, 0);
+        if (fd < 0) {
+            process.nextTick(() => this.emit("error", errnoException(fd, "socket")));
+            return this;
+        }
+        let err = zts.bind(fd, host, port || 0);
+        if (err === 0) {
+            err = zts.listen(fd, backlog);
+        }
+        if (err === 0) {
+            err = poller.set(fd, zts.ZTS_POLLIN, this._onPoll);
+        }
+        if (err < 0) {
+            zts.close(fd);
+            process.nextTick(() => this.emit("error", errnoException(err, "listen")));
+            return this;
+        }
+        this._fd = fd;
+        this.listening = true;
+        process.nextTick(() => this.emit("listening"));
+        return this;
+    }
+
+    _onPoll(revents)
+    {
+        // Level-triggered: accept everything pending, anything left is reported again
+        while (this._fd >= 0) {
+            const fd = zts.accept(this._fd);
+            if (fd >= 0) {
+                const socket = new Socket({ fd: fd, allowHalfOpen: this._options.allowHalfOpen });
+                this.emit("connection", socket);
+            }
+            else {
+                if (! wouldBlock(fd)) {
+                    this.emit("error", errnoException(fd, "accept"));
+                }
+                return;
+            }
+        }
+    }
+
+    address()
+    {
+        const local = this._fd >= 0 ? zts.sockname(this._fd) : null;
+        return typeof local === "object" ? local : null;
+    }
+
+    close(callback)
+    {
+        if (typeof callback === "function") {
+            this.once("close", callback);
+        }
+        if (this._fd >= 0) {
+            poller.remove(this._fd);
+            zts.close(this._fd);
+            this._fd = -1;
+        }
+        this.listening = false;
+        process.nextTick(() => this.emit("close"));
+        return this;
+    }
+
+    ref()
+    {
+        return this;
+    }
+
+    unref()
+    {
+        return this;
+    }
+}
+
+function createServer(options, connectionListener)
+{
+    return new Server(options, connectionListener);
+}
+
+function connect(port, host, listener)
+{
+    return new Socket().connect(port, host, listener);
+}
+
+/**
+ * The local ZeroTier node. Events are delivered on the event loop as ("event", code, id) and
+ * under their own names (e.g. "ZTS_EVENT_NODE_ONLINE"). Node and network IDs are hex strings.
+ */
+class Node extends EventEmitter {
+    constructor()
+    {
+        super();
+        this._eventNames = {};
+        this._handlerSet = false;
+        for (const name of Object.keys(zts)) {
+            if (name.startsWith("ZTS_EVENT_")) {
+                this._eventNames[zts[name]] = name;
+            }
+        }
+    }
+
+    initFromStorage(path)
+    {
+        return zts.initFromStorage(path);
+    }
+
+    start()
+    {
+        if (! this._handlerSet) {
+            const err = zts.initSetEventHandler((code, id) => {
+                this.emit("event", code, id);
+                if (this._eventNames[code]) {
+                    this.emit(this._eventNames[code], id);
+                }
+            });
+            if (err < 0) {
+                return err;
+            }
+            this._handlerSet = true;
+        }
+        return zts.nodeStart();
+    }
+
+    stop()
+    {
+        return zts.nodeStop();
+    }
+
+    free()
+    {
+        return zts.nodeFree();
+    }
+
+    isOnline()
+    {
+        return zts.nodeIsOnline();
+    }
+
+    get id()
+    {
+        return zts.nodeGetId();
+    }
+
+    join(netId)
+    {
+        return zts.netJoin(netId);
+    }
+
+    leave(netId)
+    {
+        return zts.netLeave(netId);
+    }
+
+    isTransportReady(netId)
+    {
+        return zts.netTransportIsReady(netId);
+    }
+
+    getAddress(netId, family)
+    {
+        return zts.addrGetStr(netId, family === undefined ? zts.ZTS_AF_INET : family);
+    }
+}
+
+module.exports = {
+    Socket,
+    Server,
+    Node,
+    createServer,
+    connect,
+    createConnection: connect,
+    native: zts,
+};
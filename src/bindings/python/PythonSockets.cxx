@@ -36,6 +36,7 @@ int zts_py_setblocking(int fd, int block)
         goto done;
     }
 
+    new_flags = cur_flags;
     if (! block) {
         new_flags |= ZTS_O_NONBLOCK;
     }
@@ -80,12 +81,13 @@ static int zts_py_tuple_to_sockaddr(int family, PyObject* addr_obj, struct zts_s
             return ZTS_ERR_ARG;
         }
         addr = (struct zts_sockaddr_in*)dst_addr;
-        zts_inet_pton(ZTS_AF_INET, host_str, &(addr->sin_addr.s_addr));
+        memset(addr, 0, sizeof *addr);
+        result = zts_inet_pton(ZTS_AF_INET, host_str, &(addr->sin_addr.s_addr));
         PyMem_Free(host_str);
         if (port < 0 || port > 0xFFFF) {
             return ZTS_ERR_ARG;
         }
-        if (result < 0) {
+        if (result <= 0) {
             return ZTS_ERR_ARG;
         }
         addr->sin_family = AF_INET;
@@ -94,16 +96,75 @@ static int zts_py_tuple_to_sockaddr(int family, PyObject* addr_obj, struct zts_s
         return ZTS_ERR_OK;
     }
     if (family == AF_INET6) {
-        // TODO
+        struct zts_sockaddr_in6* addr;
+        char* host_str;
+        int result, port;
+        unsigned int flowinfo = 0, scope_id = 0;
+        if (! PyTuple_Check(addr_obj)) {
+            return ZTS_ERR_ARG;
+        }
+        if (! PyArg_ParseTuple(
+                addr_obj,
+                "eti|II:zts_py_tuple_to_sockaddr",
+                "idna",
+                &host_str,
+                &port,
+                &flowinfo,
+                &scope_id)) {
+            return ZTS_ERR_ARG;
+        }
+        addr = (struct zts_sockaddr_in6*)dst_addr;
+        memset(addr, 0, sizeof *addr);
+        result = zts_inet_pton(ZTS_AF_INET6, host_str, &(addr->sin6_addr));
+        PyMem_Free(host_str);
+        if (port < 0 || port > 0xFFFF) {
+            return ZTS_ERR_ARG;
+        }
+        if (result <= 0) {
+            return ZTS_ERR_ARG;
+        }
+        addr->sin6_family = AF_INET6;
+        addr->sin6_port = lwip_htons((short)port);
+        addr->sin6_flowinfo = lwip_htonl(flowinfo);
+        addr->sin6_scope_id = scope_id;
+        *addrlen = sizeof *addr;
+        return ZTS_ERR_OK;
     }
     return ZTS_ERR_ARG;
 }
 
+/**
+ * Convert a native address into the tuple form used by Python's socket module:
+ * (host, port) for IPv4, (host, port, flowinfo, scope_id) for IPv6
+ */
+static PyObject* zts_py_sockaddr_to_tuple(struct zts_sockaddr* addr)
+{
+    char ipstr[ZTS_INET6_ADDRSTRLEN] = { 0 };
+    if (addr->sa_family == ZTS_AF_INET) {
+        struct zts_sockaddr_in* in4 = (struct zts_sockaddr_in*)addr;
+        zts_inet_ntop(ZTS_AF_INET, &(in4->sin_addr), ipstr, ZTS_INET_ADDRSTRLEN);
+        return Py_BuildValue("(si)", ipstr, lwip_ntohs(in4->sin_port));
+    }
+    if (addr->sa_family == ZTS_AF_INET6) {
+        struct zts_sockaddr_in6* in6 = (struct zts_sockaddr_in6*)addr;
+        zts_inet_ntop(ZTS_AF_INET6, &(in6->sin6_addr), ipstr, ZTS_INET6_ADDRSTRLEN);
+        return Py_BuildValue(
+            "(siII)",
+            ipstr,
+            lwip_ntohs(in6->sin6_port),
+            (unsigned int)lwip_ntohl(in6->sin6_flowinfo),
+            (unsigned int)in6->sin6_scope_id);
+    }
+    Py_RETURN_NONE;
+}
+
 PyObject* zts_py_accept(int fd)
 {
     struct zts_sockaddr_in addrbuf = { 0 };
     socklen_t addrlen = sizeof(addrbuf);
-    int err = zts_bsd_accept(fd, (struct zts_sockaddr*)&addrbuf, &addrlen);
+    int err;
+    Py_BEGIN_ALLOW_THREADS err = zts_bsd_accept(fd, (struct zts_sockaddr*)&addrbuf, &addrlen);
+    Py_END_ALLOW_THREADS
     char ipstr[ZTS_INET_ADDRSTRLEN] = { 0 };
     zts_inet_ntop(ZTS_AF_INET, &(addrbuf.sin_addr), ipstr, ZTS_INET_ADDRSTRLEN);
     PyObject* t;
@@ -157,8 +218,10 @@ PyObject* zts_py_recv(int fd, int len, int flags)
         return NULL;
     }
 
-    bytes_read = zts_bsd_recv(fd, PyBytes_AS_STRING(buf), len, flags);
-    t = PyTuple_New(2);
+    Py_BEGIN_ALLOW_THREADS bytes_read = zts_bsd_recv(fd, PyBytes_AS_STRING(buf), len, flags);
+    Py_END_ALLOW_THREADS
+
+        t = PyTuple_New(2);
     PyTuple_SetItem(t, 0, PyLong_FromLong(bytes_read));
 
     if (bytes_read < 0) {
@@ -178,6 +241,110 @@ PyObject* zts_py_recv(int fd, int len, int flags)
     return t;
 }
 
+int zts_py_recv_into(int fd, PyObject* buf, int len, int flags)
+{
+    Py_buffer input;
+    int bytes_read;
+
+    if (PyObject_GetBuffer(buf, &input, PyBUF_WRITABLE) != 0) {
+        PyErr_Clear();
+        return ZTS_ERR_ARG;
+    }
+    if (len < 0 || len > input.len) {
+        PyBuffer_Release(&input);
+        return ZTS_ERR_ARG;
+    }
+    if (len == 0) {
+        len = input.len;
+    }
+
+    Py_BEGIN_ALLOW_THREADS bytes_read = zts_bsd_recv(fd, input.buf, len, flags);
+    Py_END_ALLOW_THREADS
+
+        PyBuffer_Release(&input);
+    return bytes_read;
+}
+
+PyObject* zts_py_recvfrom(int fd, int len, int flags)
+{
+    PyObject *t, *buf;
+    struct zts_sockaddr_storage addrbuf;
+    zts_socklen_t addrlen = sizeof(addrbuf);
+    int bytes_read;
+
+    buf = PyBytes_FromStringAndSize((char*)0, len);
+    if (buf == NULL) {
+        return NULL;
+    }
+    memset(&addrbuf, 0, sizeof(addrbuf));
+
+    Py_BEGIN_ALLOW_THREADS bytes_read =
+        zts_bsd_recvfrom(fd, PyBytes_AS_STRING(buf), len, flags, (struct zts_sockaddr*)&addrbuf, &addrlen);
+    Py_END_ALLOW_THREADS
+
+        t = PyTuple_New(3);
+    PyTuple_SetItem(t, 0, PyLong_FromLong(bytes_read));
+
+    if (bytes_read < 0) {
+        Py_DECREF(buf);
+        Py_INCREF(Py_None);
+        PyTuple_SetItem(t, 1, Py_None);
+        Py_INCREF(Py_None);
+        PyTuple_SetItem(t, 2, Py_None);
+        return t;
+    }
+
+    if (bytes_read != len) {
+        _PyBytes_Resize(&buf, bytes_read);
+    }
+
+    PyTuple_SetItem(t, 1, buf);
+    PyTuple_SetItem(t, 2, zts_py_sockaddr_to_tuple((struct zts_sockaddr*)&addrbuf));
+    return t;
+}
+
+PyObject* zts_py_recvfrom_into(int fd, PyObject* buf, int len, int flags)
+{
+    Py_buffer input;
+    PyObject* t;
+    struct zts_sockaddr_storage addrbuf;
+    zts_socklen_t addrlen = sizeof(addrbuf);
+    int bytes_read;
+
+    t = PyTuple_New(2);
+    if (PyObject_GetBuffer(buf, &input, PyBUF_WRITABLE) != 0) {
+        PyErr_Clear();
+        bytes_read = ZTS_ERR_ARG;
+        goto done;
+    }
+    if (len < 0 || len > input.len) {
+        PyBuffer_Release(&input);
+        bytes_read = ZTS_ERR_ARG;
+        goto done;
+    }
+    if (len == 0) {
+        len = input.len;
+    }
+    memset(&addrbuf, 0, sizeof(addrbuf));
+
+    Py_BEGIN_ALLOW_THREADS bytes_read =
+        zts_bsd_recvfrom(fd, input.buf, len, flags, (struct zts_sockaddr*)&addrbuf, &addrlen);
+    Py_END_ALLOW_THREADS
+
+        PyBuffer_Release(&input);
+
+done:
+    PyTuple_SetItem(t, 0, PyLong_FromLong(bytes_read));
+    if (bytes_read < 0) {
+        Py_INCREF(Py_None);
+        PyTuple_SetItem(t, 1, Py_None);
+    }
+    else {
+        PyTuple_SetItem(t, 1, zts_py_sockaddr_to_tuple((struct zts_sockaddr*)&addrbuf));
+    }
+    return t;
+}
+
 int zts_py_send(int fd, PyObject* buf, int flags)
 {
     Py_buffer output;
@@ -187,12 +354,93 @@ int zts_py_send(int fd, PyObject* buf, int flags)
         return 0;
     }
 
-    bytes_sent = zts_bsd_send(fd, output.buf, output.len, flags);
-    PyBuffer_Release(&output);
+    Py_BEGIN_ALLOW_THREADS bytes_sent = zts_bsd_send(fd, output.buf, output.len, flags);
+    Py_END_ALLOW_THREADS
+
+        PyBuffer_Release(&output);
+
+    return bytes_sent;
+}
+
+int zts_py_sendall(int fd, PyObject* buf, int flags)
+{
+    Py_buffer output;
+    int err = ZTS_ERR_OK;
+
+    if (PyObject_GetBuffer(buf, &output, PyBUF_SIMPLE) != 0) {
+        PyErr_Clear();
+        return ZTS_ERR_ARG;
+    }
+
+    // The whole loop runs without the GIL, the buffer is pinned until released below
+    Py_BEGIN_ALLOW_THREADS char* data = (char*)output.buf;
+    Py_ssize_t remaining = output.len;
+    while (remaining > 0) {
+        int bytes_sent = zts_bsd_send(fd, data, remaining, flags);
+        if (bytes_sent < 0) {
+            err = bytes_sent;
+            break;
+        }
+        data += bytes_sent;
+        remaining -= bytes_sent;
+    }
+    Py_END_ALLOW_THREADS
+
+        PyBuffer_Release(&output);
+    return err;
+}
+
+int zts_py_sendto(int fd, PyObject* buf, int flags, int family, PyObject* addr_obj)
+{
+    Py_buffer output;
+    struct zts_sockaddr_storage addrbuf;
+    int addrlen;
+    int bytes_sent;
 
+    if (zts_py_tuple_to_sockaddr(family, addr_obj, (struct zts_sockaddr*)&addrbuf, &addrlen) != ZTS_ERR_OK) {
+        PyErr_Clear();
+        return ZTS_ERR_ARG;
+    }
+    if (PyObject_GetBuffer(buf, &output, PyBUF_SIMPLE) != 0) {
+        PyErr_Clear();
+        return ZTS_ERR_ARG;
+    }
+
+    Py_BEGIN_ALLOW_THREADS bytes_sent =
+        zts_bsd_sendto(fd, output.buf, output.len, flags, (struct zts_sockaddr*)&addrbuf, addrlen);
+    Py_END_ALLOW_THREADS
+
+        PyBuffer_Release(&output);
     return bytes_sent;
 }
 
+PyObject* zts_py_poller_wait(int pfd, int max_events, int timeout_ms)
+{
+    if (max_events <= 0) {
+        return PyLong_FromLong(ZTS_ERR_ARG);
+    }
+    zts_poller_event_t* events = (zts_poller_event_t*)PyMem_Malloc(max_events * sizeof(zts_poller_event_t));
+    if (! events) {
+        return PyErr_NoMemory();
+    }
+    int n;
+
+    Py_BEGIN_ALLOW_THREADS n = zts_poller_wait(pfd, events, max_events, timeout_ms);
+    Py_END_ALLOW_THREADS
+
+        if (n < 0)
+    {
+        PyMem_Free(events);
+        return PyLong_FromLong(n);
+    }
+    PyObject* list = PyList_New(n);
+    for (int i = 0; i < n; i++) {
+        PyList_SetItem(list, i, Py_BuildValue("(ii)", events[i].fd, (int)events[i].revents));
+    }
+    PyMem_Free(events);
+    return list;
+}
+
 int zts_py_close(int fd)
 {
     int err;
@@ -0,0 +1,568 @@
+"""asyncio integration for ZeroTier sockets and events
+
+Every ZeroTier socket used from an event loop is registered with one native
+poller (see zts_poller_new()) whose OS descriptor is watched by the loop, so a
+single thread can service thousands of connections. Node events are read from
+a queue instead of through the director callback, so they never re-enter the
+interpreter from a libzt thread.
+
+Example:
+
+    async def handle(reader, writer):
+        writer.write(await reader.read(1024))
+        await writer.drain()
+        writer.close()
+
+    server = await libzt.aio.start_server(handle, "0.0.0.0", 8080)
+    async with server:
+        await server.serve_forever()
+"""
+
+import asyncio
+import collections
+import errno as _errno
+
+import libzt
+
+_MAX_EVENTS = 256  # readiness events collected per wakeup
+_READ_SIZE = 65536  # bytes read per data_received() call
+
+_reactors = {}  # event loop -> _Reactor
+_event_queue_fd = None  # OS descriptor signalled by the native event queue
+
+
+def _raise_for(what, err=None):
+    if err is None or err == libzt.ZTS_ERR_SOCKET:
+        err = libzt.cvar.zts_errno
+    raise OSError(err, what + " failed (zts_errno=" + str(err) + ")")
+
+
+def _would_block():
+    err = libzt.cvar.zts_errno
+    return err == libzt.ZTS_EAGAIN or err == libzt.ZTS_EWOULDBLOCK
+
+
+def _family_of(host):
+    return libzt.ZTS_AF_INET6 if ":" in host else libzt.ZTS_AF_INET
+
+
+class _Reactor:
+    """Dispatches readiness of ZeroTier sockets to callbacks on one event loop"""
+
+    def __init__(self, loop):
+        self._loop = loop
+        self._pfd = libzt.zts_poller_new()
+        if self._pfd < 0:
+            raise OSError(_errno.EIO, "zts_poller_new() failed (" + str(self._pfd) + ")")
+        self._os_fd = libzt.zts_poller_get_os_fd(self._pfd)
+        if self._os_fd < 0:
+            libzt.zts_poller_free(self._pfd)
+            raise OSError(_errno.ENOSYS, "zts_poller_get_os_fd() is not supported on this platform")
+        self._readers = {}
+        self._writers = {}
+        loop.add_reader(self._os_fd, self._process)
+
+    def _update(self, fd):
+        events = 0
+        if fd in self._readers:
+            events |= libzt.ZTS_POLLIN
+        if fd in self._writers:
+            events |= libzt.ZTS_POLLOUT
+        if events:
+            libzt.zts_poller_set(self._pfd, fd, events)
+        else:
+            libzt.zts_poller_remove(self._pfd, fd)
+
+    def add_reader(self, fd, callback, *args):
+        self._readers[fd] = (callback, args)
+        self._update(fd)
+
+    def remove_reader(self, fd):
+        if self._readers.pop(fd, None) is not None:
+            self._update(fd)
+
+    def add_writer(self, fd, callback, *args):
+        self._writers[fd] = (callback, args)
+        self._update(fd)
+
+    def remove_writer(self, fd):
+        if self._writers.pop(fd, None) is not None:
+            self._update(fd)
+
+    def forget(self, fd):
+        """Drop all callbacks for a socket that is about to be closed"""
+        self._readers.pop(fd, None)
+        self._writers.pop(fd, None)
+
+    def _process(self):
+        ready = libzt.zts_py_poller_wait(self._pfd, _MAX_EVENTS, 0)
+        if isinstance(ready, int):
+            return
+        failed = libzt.ZTS_POLLERR | libzt.ZTS_POLLHUP | libzt.ZTS_POLLNVAL
+        for fd, revents in ready:
+            # Errors are delivered to both sides so that the next operation observes them
+            if revents & (libzt.ZTS_POLLIN | failed):
+                handler = self._readers.get(fd)
+                if handler is not None:
+                    handler[0](*handler[1])
+            if revents & (libzt.ZTS_POLLOUT | failed):
+                handler = self._writers.get(fd)
+                if handler is not None:
+                    handler[0](*handler[1])
+
+    def close(self):
+        self._loop.remove_reader(self._os_fd)
+        libzt.zts_poller_free(self._pfd)
+        self._readers.clear()
+        self._writers.clear()
+
+
+def _get_reactor(loop=None):
+    if loop is None:
+        loop = asyncio.get_running_loop()
+    reactor = _reactors.get(loop)
+    if reactor is None:
+        reactor = _reactors[loop] = _Reactor(loop)
+    return reactor
+
+
+def close_loop(loop=None):
+    """Release the native poller associated with an event loop. Call before closing the loop"""
+    if loop is None:
+        loop = asyncio.get_event_loop()
+    reactor = _reactors.pop(loop, None)
+    if reactor is not None:
+        reactor.close()
+
+
+async def _wait_writable(reactor, fd):
+    fut = reactor._loop.create_future()
+
+    def _ready():
+        reactor.remove_writer(fd)
+        if not fut.done():
+            fut.set_result(None)
+
+    reactor.add_writer(fd, _ready)
+    try:
+        await fut
+    finally:
+        reactor.remove_writer(fd)
+
+
+async def sock_connect(fd, family, address):
+    """Connect a non-blocking ZeroTier socket without blocking the loop"""
+    reactor = _get_reactor()
+    err = libzt.zts_py_connect(fd, family, libzt.ZTS_SOCK_STREAM, address)
+    if err < 0:
+        if libzt.cvar.zts_errno != libzt.ZTS_EINPROGRESS:
+            _raise_for("connect()", err)
+        await _wait_writable(reactor, fd)
+        err = libzt.zts_get_socket_error(fd)
+        if err != 0:
+            raise OSError(err, "connect() failed (" + str(err) + ")")
+
+
+class _ZeroTierTransport(asyncio.Transport):
+    """Stream transport over a non-blocking ZeroTier socket"""
+
+    def __init__(self, reactor, fd, protocol, extra=None, server=None):
+        super().__init__(extra)
+        self._reactor = reactor
+        self._loop = reactor._loop
+        self._fd = fd
+        self._protocol = protocol
+        self._server = server
+        self._buffer = bytearray(_READ_SIZE)
+        self._view = memoryview(self._buffer)
+        self._write_buffer = collections.deque()
+        self._write_size = 0
+        self._high_water = 64 * 1024
+        self._low_water = 16 * 1024
+        self._protocol_paused = False
+        self._reading = True
+        self._eof_pending = False
+        self._closing = False
+        if server is not None:
+            server._attach()
+        self._loop.call_soon(self._protocol.connection_made, self)
+        self._loop.call_soon(self._resume_reading_now)
+
+    def _resume_reading_now(self):
+        if self._reading and not self._closing:
+            self._reactor.add_reader(self._fd, self._read_ready)
+
+    def get_extra_info(self, name, default=None):
+        return self._extra.get(name, default)
+
+    def is_closing(self):
+        return self._closing
+
+    def is_reading(self):
+        return self._reading and not self._closing
+
+    def pause_reading(self):
+        if self._closing or not self._reading:
+            return
+        self._reading = False
+        self._reactor.remove_reader(self._fd)
+
+    def resume_reading(self):
+        if self._closing or self._reading:
+            return
+        self._reading = True
+        self._reactor.add_reader(self._fd, self._read_ready)
+
+    def set_protocol(self, protocol):
+        self._protocol = protocol
+
+    def get_protocol(self):
+        return self._protocol
+
+    def _read_ready(self):
+        n = libzt.zts_py_recv_into(self._fd, self._view, _READ_SIZE, libzt.ZTS_MSG_DONTWAIT)
+        if n < 0:
+            if _would_block():
+                return
+            self._fatal_error(OSError(libzt.cvar.zts_errno, "recv() failed"))
+            return
+        if n == 0:
+            self._reactor.remove_reader(self._fd)
+            keep_open = self._protocol.eof_received()
+            if not keep_open:
+                self.close()
+            return
+        self._protocol.data_received(bytes(self._view[:n]))
+
+    def write(self, data):
+        if self._eof_pending:
+            raise RuntimeError("Cannot call write() after write_eof()")
+        if not data or self._closing:
+            return
+        if not self._write_buffer:
+            n = libzt.zts_py_send(self._fd, data, libzt.ZTS_MSG_DONTWAIT)
+            if n < 0:
+                if not _would_block():
+                    self._fatal_error(OSError(libzt.cvar.zts_errno, "send() failed"))
+                    return
+                n = 0
+            if n == len(data):
+                return
+            data = memoryview(data)[n:]
+            self._reactor.add_writer(self._fd, self._write_ready)
+        self._write_buffer.append(bytes(data))
+        self._write_size += len(data)
+        self._maybe_pause_protocol()
+
+    def _write_ready(self):
+        while self._write_buffer:
+            chunk = self._write_buffer[0]
+            n = libzt.zts_py_send(self._fd, chunk, libzt.ZTS_MSG_DONTWAIT)
+            if n < 0:
+                if _would_block():
+                    break
+                self._fatal_error(OSError(libzt.cvar.zts_errno, "send() failed"))
+                return
+            self._write_size -= n
+            if n < len(chunk):
+                self._write_buffer[0] = chunk[n:]
+                break
+            self._write_buffer.popleft()
+        self._maybe_resume_protocol()
+        if self._write_buffer:
+            return
+        self._reactor.remove_writer(self._fd)
+        if self._eof_pending:
+            libzt.zts_bsd_shutdown(self._fd, libzt.ZTS_SHUT_WR)
+        if self._closing:
+            self._call_connection_lost(None)
+
+    def _maybe_pause_protocol(self):
+        if self._write_size > self._high_water and not self._protocol_paused:
+            self._protocol_paused = True
+            self._protocol.pause_writing()
+
+    def _maybe_resume_protocol(self):
+        if self._protocol_paused and self._write_size <= self._low_water:
+            self._protocol_paused = False
+            self._protocol.resume_writing()
+
+    def get_write_buffer_size(self):
+        return self._write_size
+
+    def get_write_buffer_limits(self):
+        return (self._low_water, self._high_water)
+
+    def set_write_buffer_limits(self, high=None, low=None):
+        if high is None:
+            high = 64 * 1024 if low is None else 4 * low
+        if low is None:
+            low = high // 4
+        self._high_water = high
+        self._low_water = low
+        self._maybe_pause_protocol()
+
+    def can_write_eof(self):
+        return True
+
+    def write_eof(self):
+        if self._closing or self._eof_pending:
+            return
+        self._eof_pending = True
+        if not self._write_buffer:
+            libzt.zts_bsd_shutdown(self._fd, libzt.ZTS_SHUT_WR)
+
+    def close(self):
+        if self._closing:
+            return
+        self._closing = True
+        self._reactor.remove_reader(self._fd)
+        # Pending writes are flushed before the socket is closed
+        if not self._write_buffer:
+            self._loop.call_soon(self._call_connection_lost, None)
+
+    def abort(self):
+        self._force_close(None)
+
+    def _fatal_error(self, exc):
+        self._force_close(exc)
+
+    def _force_close(self, exc):
+        if self._fd < 0:
+            return
+        self._write_buffer.clear()
+        self._write_size = 0
+        self._reactor.remove_writer(self._fd)
+        if not self._closing:
+            self._closing = True
+            self._reactor.remove_reader(self._fd)
+        self._loop.call_soon(self._call_connection_lost, exc)
+
+    def _call_connection_lost(self, exc):
+        if self._fd < 0:
+            return
+        self._reactor.forget(self._fd)
+        libzt.zts_py_close(self._fd)
+        self._fd = -1
+        try:
+            self._protocol.connection_lost(exc)
+        finally:
+            self._protocol = None
+            if self._server is not None:
+                self._server._detach()
+                self._server = None
+
+
+async def create_connection(protocol_factory, host, port):
+    """Open a ZeroTier TCP connection and return a (transport, protocol) pair
+
+    Equivalent to loop.create_connection() for addresses on ZeroTier networks"""
+    reactor = _get_reactor()
+    family = _family_of(host)
+    fd = libzt.zts_bsd_socket(family, libzt.ZTS_SOCK_STREAM, 0)
+    if fd < 0:
+        _raise_for("socket()", fd)
+    try:
+        libzt.zts_py_setblocking(fd, False)
+        await sock_connect(fd, family, (host, port))
+    except BaseException:
+        reactor.forget(fd)
+        libzt.zts_py_close(fd)
+        raise
+    protocol = protocol_factory()
+    transport = _ZeroTierTransport(reactor, fd, protocol, {"peername": (host, port)})
+    return transport, protocol
+
+
+class Server(asyncio.AbstractServer):
+    """A listening ZeroTier socket that accepts connections on the event loop"""
+
+    def __init__(self, reactor, fd, protocol_factory, sockname):
+        self._reactor = reactor
+        self._loop = reactor._loop
+        self._fd = fd
+        self._protocol_factory = protocol_factory
+        self._sockname = sockname
+        self._active_count = 0
+        self._waiters = []
+        self._serving = False
+        self._serving_forever_fut = None
+
+    def _attach(self):
+        self._active_count += 1
+
+    def _detach(self):
+        self._active_count -= 1
+        if self._active_count == 0 and self._fd < 0:
+            self._wakeup()
+
+    def _wakeup(self):
+        waiters, self._waiters = self._waiters, None
+        for waiter in waiters or ():
+            if not waiter.done():
+                waiter.set_result(None)
+
+    def _accept_ready(self):
+        # Accept everything that is pending so a burst costs one wakeup
+        while True:
+            conn_fd, addr, port = libzt.zts_py_accept(self._fd)
+            if conn_fd < 0:
+                return
+            libzt.zts_py_setblocking(conn_fd, False)
+            _ZeroTierTransport(
+                self._reactor,
+                conn_fd,
+                self._protocol_factory(),
+                {"peername": (addr, port), "sockname": self._sockname},
+                self,
+            )
+
+    def get_loop(self):
+        return self._loop
+
+    def is_serving(self):
+        return self._serving
+
+    @property
+    def sockets(self):
+        return ()
+
+    def close(self):
+        if self._fd < 0:
+            return
+        self._serving = False
+        self._reactor.forget(self._fd)
+        libzt.zts_py_close(self._fd)
+        self._fd = -1
+        if self._serving_forever_fut is not None and not self._serving_forever_fut.done():
+            self._serving_forever_fut.cancel()
+        if self._active_count == 0:
+            self._wakeup()
+
+    async def start_serving(self):
+        if self._serving or self._fd < 0:
+            return
+        self._serving = True
+        # Non-blocking accept so that _accept_ready() can drain the backlog
+        libzt.zts_py_setblocking(self._fd, False)
+        self._reactor.add_reader(self._fd, self._accept_ready)
+
+    async def serve_forever(self):
+        if self._serving_forever_fut is not None:
+            raise RuntimeError("serve_forever() is already running")
+        await self.start_serving()
+        self._serving_forever_fut = self._loop.create_future()
+        try:
+            await self._serving_forever_fut
+        except asyncio.CancelledError:
+            try:
+                self.close()
+                await self.wait_closed()
+            finally:
+                raise
+        finally:
+            self._serving_forever_fut = None
+
+    async def wait_closed(self):
+        if self._waiters is None:
+            return
+        waiter = self._loop.create_future()
+        self._waiters.append(waiter)
+        await waiter
+
+
+async def create_server(protocol_factory, host, port, backlog=100, start_serving=True):
+    """Listen on a ZeroTier address and return a Server
+
+    Equivalent to loop.create_server() for addresses on ZeroTier networks"""
+    reactor = _get_reactor()
+    family = _family_of(host)
+    fd = libzt.zts_bsd_socket(family, libzt.ZTS_SOCK_STREAM, 0)
+    if fd < 0:
+        _raise_for("socket()", fd)
+    err = libzt.zts_py_bind(fd, family, libzt.ZTS_SOCK_STREAM, (host, port))
+    if err >= 0:
+        err = libzt.zts_py_listen(fd, backlog)
+    if err < 0:
+        libzt.zts_py_close(fd)
+        _raise_for("bind()/listen()", err)
+    server = Server(reactor, fd, protocol_factory, (host, port))
+    if start_serving:
+        await server.start_serving()
+    return server
+
+
+async def open_connection(host, port, limit=2 ** 16):
+    """Open a ZeroTier TCP connection and return a (StreamReader, StreamWriter) pair"""
+    loop = asyncio.get_running_loop()
+    reader = asyncio.StreamReader(limit=limit, loop=loop)
+    protocol = asyncio.StreamReaderProtocol(reader, loop=loop)
+    transport, _ = await create_connection(lambda: protocol, host, port)
+    writer = asyncio.StreamWriter(transport, protocol, reader, loop)
+    return reader, writer
+
+
+async def start_server(client_connected_cb, host, port, limit=2 ** 16, backlog=100):
+    """Start a ZeroTier stream server, calling client_connected_cb(reader, writer) per connection"""
+    loop = asyncio.get_running_loop()
+
+    def factory():
+        reader = asyncio.StreamReader(limit=limit, loop=loop)
+        return asyncio.StreamReaderProtocol(reader, client_connected_cb, loop=loop)
+
+    return await create_server(factory, host, port, backlog)
+
+
+class Events:
+    """Async iterator over node events as (event_code, id) tuples
+
+    Must be created before zts_node_start() and replaces any handler set with
+    zts_init_set_event_handler(). Events are buffered natively until read."""
+
+    def __init__(self, loop=None):
+        global _event_queue_fd
+        self._loop = loop
+        self._waiter = None
+        if _event_queue_fd is None:
+            fd = libzt.zts_py_init_event_queue()
+            if fd < 0:
+                _raise_for("zts_py_init_event_queue()", fd)
+            _event_queue_fd = fd
+        self._os_fd = _event_queue_fd
+
+    def _readable(self):
+        if self._waiter is not None and not self._waiter.done():
+            self._waiter.set_result(None)
+
+    async def next(self):
+        """Wait for and return the next (event_code, id) tuple"""
+        loop = self._loop or asyncio.get_running_loop()
+        while True:
+            event = libzt.zts_py_event_next()
+            if event is not None:
+                return event
+            self._waiter = loop.create_future()
+            loop.add_reader(self._os_fd, self._readable)
+            try:
+                await self._waiter
+            finally:
+                loop.remove_reader(self._os_fd)
+                self._waiter = None
+
+    async def wait_for(self, event_code):
+        """Wait until a given event code arrives and return its id, discarding others"""
+        while True:
+            code, id = await self.next()
+            if code == event_code:
+                return id
+
+    def __aiter__(self):
+        return self
+
+    async def __anext__(self):
+        return await self.next()
+
+
+def events(loop=None):
+    """Return an async iterator over node events, e.g. `async for code, id in events():`"""
+    return Events(loop)
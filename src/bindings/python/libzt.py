@@ -590,6 +590,26 @@ def zts_py_send(fd, buf, flags):
     return _libzt.zts_py_send(fd, buf, flags)
 
 
+def zts_py_recv_into(fd, buf, len, flags):
+    return _libzt.zts_py_recv_into(fd, buf, len, flags)
+
+
+def zts_py_recvfrom(fd, len, flags):
+    return _libzt.zts_py_recvfrom(fd, len, flags)
+
+
+def zts_py_recvfrom_into(fd, buf, len, flags):
+    return _libzt.zts_py_recvfrom_into(fd, buf, len, flags)
+
+
+def zts_py_sendall(fd, buf, flags):
+    return _libzt.zts_py_sendall(fd, buf, flags)
+
+
+def zts_py_sendto(fd, buf, flags, family, addro):
+    return _libzt.zts_py_sendto(fd, buf, flags, family, addro)
+
+
 def zts_py_close(fd):
     return _libzt.zts_py_close(fd)
 
@@ -602,6 +622,18 @@ def zts_py_getblocking(fd):
     return _libzt.zts_py_getblocking(fd)
 
 
+def zts_py_init_event_queue():
+    return _libzt.zts_py_init_event_queue()
+
+
+def zts_py_event_next():
+    return _libzt.zts_py_event_next()
+
+
+def zts_py_poller_wait(pfd, max_events, timeout_ms):
+    return _libzt.zts_py_poller_wait(pfd, max_events, timeout_ms)
+
+
 ZTS_DISABLE_CENTRAL_API = _libzt.ZTS_DISABLE_CENTRAL_API
 ZTS_ID_STR_BUF_LEN = _libzt.ZTS_ID_STR_BUF_LEN
 
@@ -1063,6 +1095,30 @@ def zts_bsd_poll(fds, nfds, timeout):
     return _libzt.zts_bsd_poll(fds, nfds, timeout)
 
 
+def zts_poller_new():
+    return _libzt.zts_poller_new()
+
+
+def zts_poller_free(pfd):
+    return _libzt.zts_poller_free(pfd)
+
+
+def zts_poller_set(pfd, fd, events):
+    return _libzt.zts_poller_set(pfd, fd, events)
+
+
+def zts_poller_remove(pfd, fd):
+    return _libzt.zts_poller_remove(pfd, fd)
+
+
+def zts_poller_wakeup(pfd):
+    return _libzt.zts_poller_wakeup(pfd)
+
+
+def zts_poller_get_os_fd(pfd):
+    return _libzt.zts_poller_get_os_fd(pfd)
+
+
 def zts_bsd_ioctl(fd, request, argp):
     return _libzt.zts_bsd_ioctl(fd, request, argp)
 
@@ -1263,6 +1319,10 @@ def zts_get_keepalive(fd):
     return _libzt.zts_get_keepalive(fd)
 
 
+def zts_get_socket_error(fd):
+    return _libzt.zts_get_socket_error(fd)
+
+
 class zts_hostent(object):
     thisown = property(
         lambda x: x.this.own(), lambda x, v: x.this.own(v), doc="The membership flag"
@@ -1,5 +1,8 @@
 """ZeroTier low-level socket interface"""
 
+import io
+import socket as _pysocket
+
 import libzt
 
 
@@ -37,12 +40,14 @@ class socket:
     _connected = False
     _closed = True
     _bound = False
+    _io_refs = 0  # streams returned by makefile() that are still open
 
     def __init__(self, sock_family=-1, sock_type=-1, sock_proto=-1, sock_fd=None):
         self._fd = sock_fd
         self._family = sock_family
         self._type = sock_type
         self._family = sock_family
+        self._closed = False
         # Only create native socket if no fd was provided. We may have
         # accepted a connection
         if sock_fd is None:
@@ -227,11 +232,27 @@ class socket:
     def close(self):
         """close()
 
-        Close the socket"""
+        Close the socket. If streams returned by makefile() are still open the
+        native socket is closed once the last of them is closed."""
+        self._closed = True
+        if self._io_refs <= 0:
+            self._real_close()
+
+    def _real_close(self):
+        if self._fd is None or self._fd < 0:
+            return
         err = libzt.zts_py_close(self._fd)
+        self._fd = -1
         if err < 0:
             handle_error(err)
 
+    def _decref_socketios(self):
+        """Called by streams returned by makefile() when they are closed"""
+        if self._io_refs > 0:
+            self._io_refs -= 1
+        if self._closed:
+            self.close()
+
     def connect(self, remote_address):
         """connect(address)
 
@@ -312,9 +333,44 @@ class socket:
         if err < 0:
             handle_error(err)
 
-    def makefile(mode="r", buffering=None, *, encoding=None, errors=None, newline=None):
-        """libzt does not support this (yet)"""
-        raise NotImplementedError("libzt does not support this (yet?)")
+    def makefile(
+        self, mode="r", buffering=None, *, encoding=None, errors=None, newline=None
+    ):
+        """makefile(...) -> an I/O stream connected to the socket
+
+        Same semantics as the standard library's socket.makefile(). The raw
+        stream reads with recv_into() so buffered reads do not allocate."""
+        if not set(mode) <= {"r", "w", "b"}:
+            raise ValueError("invalid mode %r (only r, w, b allowed)" % (mode,))
+        writing = "w" in mode
+        reading = "r" in mode or not writing
+        binary = "b" in mode
+        rawmode = ""
+        if reading:
+            rawmode += "r"
+        if writing:
+            rawmode += "w"
+        raw = _pysocket.SocketIO(self, rawmode)
+        self._io_refs += 1
+        if buffering is None:
+            buffering = -1
+        if buffering < 0:
+            buffering = io.DEFAULT_BUFFER_SIZE
+        if buffering == 0:
+            if not binary:
+                raise ValueError("unbuffered streams must be binary")
+            return raw
+        if reading and writing:
+            buffer = io.BufferedRWPair(raw, raw, buffering)
+        elif reading:
+            buffer = io.BufferedReader(raw, buffering)
+        else:
+            buffer = io.BufferedWriter(raw, buffering)
+        if binary:
+            return buffer
+        text = io.TextIOWrapper(buffer, encoding, errors, newline)
+        text.mode = mode
+        return text
 
     def recv(self, n_bytes, flags=0):
         """recv(buffersize[, flags]) -> data
@@ -333,25 +389,75 @@ class socket:
             return None
         return data
 
-    def recvfrom(self, bufsize, flags):
-        """libzt does not support this (yet)"""
-        raise NotImplementedError("libzt does not support this (yet?)")
+    def recvfrom(self, bufsize, flags=0):
+        """recvfrom(buffersize[, flags]) -> (data, address info)
 
-    def recvmsg(self, bufsize, ancbufsize, flags):
-        """libzt does not support this (yet)"""
-        raise NotImplementedError("libzt does not support this (yet?)")
+        Like recv(buffersize, flags) but also return the sender's address info."""
+        err, data, address = libzt.zts_py_recvfrom(self._fd, bufsize, flags)
+        if err < 0:
+            handle_error(err)
+            return None
+        return data, address
 
-    def recvmsg_into(self, buffers, ancbufsize, flags):
-        """libzt does not support this (yet)"""
-        raise NotImplementedError("libzt does not support this (yet?)")
+    def recvmsg(self, bufsize, ancbufsize=0, flags=0):
+        """recvmsg(bufsize[, ancbufsize[, flags]]) -> (data, ancdata, msg_flags, address)
 
-    def recvfrom_into(self, buffer, n_bytes, flags):
-        """libzt does not support this (yet)"""
-        raise NotImplementedError("libzt does not support this (yet?)")
+        Receive normal data. Ancillary data is not supported by libzt so ancdata
+        is always an empty list and msg_flags is always 0."""
+        result = self.recvfrom(bufsize, flags)
+        if result is None:
+            return None
+        data, address = result
+        return data, [], 0, address
+
+    def recvmsg_into(self, buffers, ancbufsize=0, flags=0):
+        """recvmsg_into(buffers[, ancbufsize[, flags]]) -> (nbytes, ancdata, msg_flags, address)
+
+        Receive normal data into a sequence of writable buffers, filling each
+        in turn. Ancillary data is not supported by libzt."""
+        views = [memoryview(buf).cast("B") for buf in buffers]
+        if len(views) == 1:
+            result = self.recvfrom_into(views[0], 0, flags)
+            if result is None:
+                return None
+            n_bytes, address = result
+            return n_bytes, [], 0, address
+        scratch = bytearray(sum(len(view) for view in views))
+        result = self.recvfrom_into(scratch, 0, flags)
+        if result is None:
+            return None
+        n_bytes, address = result
+        offset = 0
+        for view in views:
+            if offset >= n_bytes:
+                break
+            count = min(len(view), n_bytes - offset)
+            view[:count] = scratch[offset : offset + count]
+            offset += count
+        return n_bytes, [], 0, address
+
+    def recvfrom_into(self, buffer, n_bytes=0, flags=0):
+        """recvfrom_into(buffer[, nbytes[, flags]]) -> (nbytes, address info)
+
+        Like recv_into(buffer[, nbytes[, flags]]) but also return the sender's address info."""
+        err, address = libzt.zts_py_recvfrom_into(self._fd, buffer, n_bytes, flags)
+        if err < 0:
+            handle_error(err)
+            return None
+        return err, address
 
-    def recv_into(self, buffer, n_bytes, flags):
-        """libzt does not support this (yet)"""
-        raise NotImplementedError("libzt does not support this (yet?)")
+    def recv_into(self, buffer, n_bytes=0, flags=0):
+        """recv_into(buffer, [nbytes[, flags]]) -> nbytes_read
+
+        Read up to nbytes bytes directly into a writable buffer (e.g. bytearray
+        or memoryview) instead of allocating a new bytes object. If nbytes is
+        not specified (or 0), read up to the size of the buffer. Other threads
+        keep running while this call waits for data."""
+        err = libzt.zts_py_recv_into(self._fd, buffer, n_bytes, flags)
+        if err < 0:
+            handle_error(err)
+            return None
+        return err
 
     def send(self, data, flags=0):
         """send(data[, flags]) -> count
@@ -369,13 +475,28 @@ class socket:
             handle_error(err)
         return err
 
-    def sendall(self, n_bytes, flags):
-        """libzt does not support this (yet)"""
-        raise NotImplementedError("libzt does not support this (yet?)")
+    def sendall(self, data, flags=0):
+        """sendall(data[, flags])
 
-    def sendto(self, n_bytes, flags, address):
-        """libzt does not support this (yet)"""
-        raise NotImplementedError("libzt does not support this (yet?)")
+        Send all of data to the socket, retrying until everything has been
+        written or an error occurs. Other threads keep running meanwhile."""
+        err = libzt.zts_py_sendall(self._fd, data, flags)
+        if err < 0:
+            handle_error(err)
+
+    def sendto(self, data, flags_or_address, address=None):
+        """sendto(data[, flags], address) -> count
+
+        Like send(data, flags) but allows specifying the destination address.
+        For IP sockets, the address is a pair (hostaddr, port)."""
+        if address is None:
+            flags, address = 0, flags_or_address
+        else:
+            flags = flags_or_address
+        err = libzt.zts_py_sendto(self._fd, data, flags, self._family, address)
+        if err < 0:
+            handle_error(err)
+        return err
 
     def sendmsg(self, buffers, ancdata, flags, address):
         """libzt does not support this (yet)"""
@@ -34,4 +34,20 @@
 %ignore zts_nfds_t;
 %ignore zts_msghdr;
 
+/* Release the GIL while these wait on the network. Calls made through the
+   zts_py_* helpers release it themselves */
+%define ZTS_PY_ALLOW_THREADS(name)
+%exception name {
+    Py_BEGIN_ALLOW_THREADS $action
+    Py_END_ALLOW_THREADS
+}
+%enddef
+ZTS_PY_ALLOW_THREADS(zts_bsd_connect)
+ZTS_PY_ALLOW_THREADS(zts_bsd_accept)
+ZTS_PY_ALLOW_THREADS(zts_bsd_close)
+ZTS_PY_ALLOW_THREADS(zts_bsd_select)
+ZTS_PY_ALLOW_THREADS(zts_bsd_poll)
+ZTS_PY_ALLOW_THREADS(zts_connect)
+ZTS_PY_ALLOW_THREADS(zts_accept)
+
 %include "ZeroTierSockets.h"
@@ -10902,6 +10902,315 @@ fail:
     return NULL;
 }
 
+SWIGINTERN PyObject* _wrap_zts_py_recv_into(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
+{
+    PyObject* resultobj = 0;
+    int arg1;
+    PyObject* arg2 = (PyObject*)0;
+    int arg3;
+    int arg4;
+    int val1;
+    int ecode1 = 0;
+    int val3;
+    int ecode3 = 0;
+    int val4;
+    int ecode4 = 0;
+    PyObject* swig_obj[4];
+    int result;
+
+    if (! SWIG_Python_UnpackTuple(args, "zts_py_recv_into", 4, 4, swig_obj))
+        SWIG_fail;
+    ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+    if (! SWIG_IsOK(ecode1)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode1),
+            "in method '"
+            "zts_py_recv_into"
+            "', argument "
+            "1"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg1 = static_cast<int>(val1);
+    arg2 = swig_obj[1];
+    ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+    if (! SWIG_IsOK(ecode3)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode3),
+            "in method '"
+            "zts_py_recv_into"
+            "', argument "
+            "3"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg3 = static_cast<int>(val3);
+    ecode4 = SWIG_AsVal_int(swig_obj[3], &val4);
+    if (! SWIG_IsOK(ecode4)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode4),
+            "in method '"
+            "zts_py_recv_into"
+            "', argument "
+            "4"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg4 = static_cast<int>(val4);
+    result = (int)zts_py_recv_into(arg1, arg2, arg3, arg4);
+    resultobj = SWIG_From_int(static_cast<int>(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+SWIGINTERN PyObject* _wrap_zts_py_recvfrom(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
+{
+    PyObject* resultobj = 0;
+    int arg1;
+    int arg2;
+    int arg3;
+    int val1;
+    int ecode1 = 0;
+    int val2;
+    int ecode2 = 0;
+    int val3;
+    int ecode3 = 0;
+    PyObject* swig_obj[3];
+    PyObject* result = 0;
+
+    if (! SWIG_Python_UnpackTuple(args, "zts_py_recvfrom", 3, 3, swig_obj))
+        SWIG_fail;
+    ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+    if (! SWIG_IsOK(ecode1)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode1),
+            "in method '"
+            "zts_py_recvfrom"
+            "', argument "
+            "1"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg1 = static_cast<int>(val1);
+    ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+    if (! SWIG_IsOK(ecode2)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode2),
+            "in method '"
+            "zts_py_recvfrom"
+            "', argument "
+            "2"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg2 = static_cast<int>(val2);
+    ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+    if (! SWIG_IsOK(ecode3)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode3),
+            "in method '"
+            "zts_py_recvfrom"
+            "', argument "
+            "3"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg3 = static_cast<int>(val3);
+    result = (PyObject*)zts_py_recvfrom(arg1, arg2, arg3);
+    resultobj = result;
+    return resultobj;
+fail:
+    return NULL;
+}
+
+SWIGINTERN PyObject* _wrap_zts_py_recvfrom_into(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
+{
+    PyObject* resultobj = 0;
+    int arg1;
+    PyObject* arg2 = (PyObject*)0;
+    int arg3;
+    int arg4;
+    int val1;
+    int ecode1 = 0;
+    int val3;
+    int ecode3 = 0;
+    int val4;
+    int ecode4 = 0;
+    PyObject* swig_obj[4];
+    PyObject* result = 0;
+
+    if (! SWIG_Python_UnpackTuple(args, "zts_py_recvfrom_into", 4, 4, swig_obj))
+        SWIG_fail;
+    ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+    if (! SWIG_IsOK(ecode1)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode1),
+            "in method '"
+            "zts_py_recvfrom_into"
+            "', argument "
+            "1"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg1 = static_cast<int>(val1);
+    arg2 = swig_obj[1];
+    ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+    if (! SWIG_IsOK(ecode3)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode3),
+            "in method '"
+            "zts_py_recvfrom_into"
+            "', argument "
+            "3"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg3 = static_cast<int>(val3);
+    ecode4 = SWIG_AsVal_int(swig_obj[3], &val4);
+    if (! SWIG_IsOK(ecode4)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode4),
+            "in method '"
+            "zts_py_recvfrom_into"
+            "', argument "
+            "4"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg4 = static_cast<int>(val4);
+    result = (PyObject*)zts_py_recvfrom_into(arg1, arg2, arg3, arg4);
+    resultobj = result;
+    return resultobj;
+fail:
+    return NULL;
+}
+
+SWIGINTERN PyObject* _wrap_zts_py_sendall(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
+{
+    PyObject* resultobj = 0;
+    int arg1;
+    PyObject* arg2 = (PyObject*)0;
+    int arg3;
+    int val1;
+    int ecode1 = 0;
+    int val3;
+    int ecode3 = 0;
+    PyObject* swig_obj[3];
+    int result;
+
+    if (! SWIG_Python_UnpackTuple(args, "zts_py_sendall", 3, 3, swig_obj))
+        SWIG_fail;
+    ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+    if (! SWIG_IsOK(ecode1)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode1),
+            "in method '"
+            "zts_py_sendall"
+            "', argument "
+            "1"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg1 = static_cast<int>(val1);
+    arg2 = swig_obj[1];
+    ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+    if (! SWIG_IsOK(ecode3)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode3),
+            "in method '"
+            "zts_py_sendall"
+            "', argument "
+            "3"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg3 = static_cast<int>(val3);
+    result = (int)zts_py_sendall(arg1, arg2, arg3);
+    resultobj = SWIG_From_int(static_cast<int>(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+SWIGINTERN PyObject* _wrap_zts_py_sendto(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
+{
+    PyObject* resultobj = 0;
+    int arg1;
+    PyObject* arg2 = (PyObject*)0;
+    int arg3;
+    int arg4;
+    PyObject* arg5 = (PyObject*)0;
+    int val1;
+    int ecode1 = 0;
+    int val3;
+    int ecode3 = 0;
+    int val4;
+    int ecode4 = 0;
+    PyObject* swig_obj[5];
+    int result;
+
+    if (! SWIG_Python_UnpackTuple(args, "zts_py_sendto", 5, 5, swig_obj))
+        SWIG_fail;
+    ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+    if (! SWIG_IsOK(ecode1)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode1),
+            "in method '"
+            "zts_py_sendto"
+            "', argument "
+            "1"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg1 = static_cast<int>(val1);
+    arg2 = swig_obj[1];
+    ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+    if (! SWIG_IsOK(ecode3)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode3),
+            "in method '"
+            "zts_py_sendto"
+            "', argument "
+            "3"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg3 = static_cast<int>(val3);
+    ecode4 = SWIG_AsVal_int(swig_obj[3], &val4);
+    if (! SWIG_IsOK(ecode4)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode4),
+            "in method '"
+            "zts_py_sendto"
+            "', argument "
+            "4"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg4 = static_cast<int>(val4);
+    arg5 = swig_obj[4];
+    result = (int)zts_py_sendto(arg1, arg2, arg3, arg4, arg5);
+    resultobj = SWIG_From_int(static_cast<int>(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
 SWIGINTERN PyObject* _wrap_zts_py_close(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
 {
     PyObject* resultobj = 0;
@@ -10996,18 +11305,109 @@ SWIGINTERN PyObject* _wrap_zts_py_getblocking(PyObject* SWIGUNUSEDPARM(self), Py
     ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
     if (! SWIG_IsOK(ecode1)) {
         SWIG_exception_fail(
-            SWIG_ArgError(ecode1),
+            SWIG_ArgError(ecode1),
+            "in method '"
+            "zts_py_getblocking"
+            "', argument "
+            "1"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg1 = static_cast<int>(val1);
+    result = (int)zts_py_getblocking(arg1);
+    resultobj = SWIG_From_int(static_cast<int>(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+SWIGINTERN PyObject* _wrap_zts_py_init_event_queue(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
+{
+    PyObject* resultobj = 0;
+    int result;
+
+    if (! SWIG_Python_UnpackTuple(args, "zts_py_init_event_queue", 0, 0, 0))
+        SWIG_fail;
+    result = (int)zts_py_init_event_queue();
+    resultobj = SWIG_From_int(static_cast<int>(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+SWIGINTERN PyObject* _wrap_zts_py_event_next(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
+{
+    PyObject* resultobj = 0;
+    PyObject* result = 0;
+
+    if (! SWIG_Python_UnpackTuple(args, "zts_py_event_next", 0, 0, 0))
+        SWIG_fail;
+    result = (PyObject*)zts_py_event_next();
+    resultobj = result;
+    return resultobj;
+fail:
+    return NULL;
+}
+
+SWIGINTERN PyObject* _wrap_zts_py_poller_wait(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
+{
+    PyObject* resultobj = 0;
+    int arg1;
+    int arg2;
+    int arg3;
+    int val1;
+    int ecode1 = 0;
+    int val2;
+    int ecode2 = 0;
+    int val3;
+    int ecode3 = 0;
+    PyObject* swig_obj[3];
+    PyObject* result = 0;
+
+    if (! SWIG_Python_UnpackTuple(args, "zts_py_poller_wait", 3, 3, swig_obj))
+        SWIG_fail;
+    ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+    if (! SWIG_IsOK(ecode1)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode1),
+            "in method '"
+            "zts_py_poller_wait"
+            "', argument "
+            "1"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg1 = static_cast<int>(val1);
+    ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+    if (! SWIG_IsOK(ecode2)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode2),
+            "in method '"
+            "zts_py_poller_wait"
+            "', argument "
+            "2"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg2 = static_cast<int>(val2);
+    ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+    if (! SWIG_IsOK(ecode3)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode3),
             "in method '"
-            "zts_py_getblocking"
+            "zts_py_poller_wait"
             "', argument "
-            "1"
+            "3"
             " of type '"
             "int"
             "'");
     }
-    arg1 = static_cast<int>(val1);
-    result = (int)zts_py_getblocking(arg1);
-    resultobj = SWIG_From_int(static_cast<int>(result));
+    arg3 = static_cast<int>(val3);
+    result = (PyObject*)zts_py_poller_wait(arg1, arg2, arg3);
+    resultobj = result;
     return resultobj;
 fail:
     return NULL;
@@ -15801,7 +16201,10 @@ SWIGINTERN PyObject* _wrap_zts_bsd_connect(PyObject* SWIGUNUSEDPARM(self), PyObj
             "'");
     }
     arg3 = static_cast<zts_socklen_t>(val3);
-    result = (int)zts_bsd_connect(arg1, (zts_sockaddr const*)arg2, arg3);
+    {
+        Py_BEGIN_ALLOW_THREADS result = (int)zts_bsd_connect(arg1, (zts_sockaddr const*)arg2, arg3);
+        Py_END_ALLOW_THREADS
+    }
     resultobj = SWIG_From_int(static_cast<int>(result));
     return resultobj;
 fail:
@@ -15974,7 +16377,10 @@ SWIGINTERN PyObject* _wrap_zts_bsd_accept(PyObject* SWIGUNUSEDPARM(self), PyObje
             "'");
     }
     arg3 = reinterpret_cast<zts_socklen_t*>(argp3);
-    result = (int)zts_bsd_accept(arg1, arg2, arg3);
+    {
+        Py_BEGIN_ALLOW_THREADS result = (int)zts_bsd_accept(arg1, arg2, arg3);
+        Py_END_ALLOW_THREADS
+    }
     resultobj = SWIG_From_int(static_cast<int>(result));
     return resultobj;
 fail:
@@ -16318,7 +16724,10 @@ SWIGINTERN PyObject* _wrap_zts_bsd_close(PyObject* SWIGUNUSEDPARM(self), PyObjec
             "'");
     }
     arg1 = static_cast<int>(val1);
-    result = (int)zts_bsd_close(arg1);
+    {
+        Py_BEGIN_ALLOW_THREADS result = (int)zts_bsd_close(arg1);
+        Py_END_ALLOW_THREADS
+    }
     resultobj = SWIG_From_int(static_cast<int>(result));
     return resultobj;
 fail:
@@ -16630,7 +17039,10 @@ SWIGINTERN PyObject* _wrap_zts_bsd_select(PyObject* SWIGUNUSEDPARM(self), PyObje
             "'");
     }
     arg5 = reinterpret_cast<zts_timeval*>(argp5);
-    result = (int)zts_bsd_select(arg1, arg2, arg3, arg4, arg5);
+    {
+        Py_BEGIN_ALLOW_THREADS result = (int)zts_bsd_select(arg1, arg2, arg3, arg4, arg5);
+        Py_END_ALLOW_THREADS
+    }
     resultobj = SWIG_From_int(static_cast<int>(result));
     return resultobj;
 fail:
@@ -16756,7 +17168,230 @@ SWIGINTERN PyObject* _wrap_zts_bsd_poll(PyObject* SWIGUNUSEDPARM(self), PyObject
             "'");
     }
     arg3 = static_cast<int>(val3);
-    result = (int)zts_bsd_poll(arg1, arg2, arg3);
+    {
+        Py_BEGIN_ALLOW_THREADS result = (int)zts_bsd_poll(arg1, arg2, arg3);
+        Py_END_ALLOW_THREADS
+    }
+    resultobj = SWIG_From_int(static_cast<int>(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+SWIGINTERN PyObject* _wrap_zts_poller_new(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
+{
+    PyObject* resultobj = 0;
+    int result;
+
+    if (! SWIG_Python_UnpackTuple(args, "zts_poller_new", 0, 0, 0))
+        SWIG_fail;
+    result = (int)zts_poller_new();
+    resultobj = SWIG_From_int(static_cast<int>(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+SWIGINTERN PyObject* _wrap_zts_poller_free(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
+{
+    PyObject* resultobj = 0;
+    int arg1;
+    int val1;
+    int ecode1 = 0;
+    PyObject* swig_obj[1];
+    int result;
+
+    if (! args)
+        SWIG_fail;
+    swig_obj[0] = args;
+    ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+    if (! SWIG_IsOK(ecode1)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode1),
+            "in method '"
+            "zts_poller_free"
+            "', argument "
+            "1"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg1 = static_cast<int>(val1);
+    result = (int)zts_poller_free(arg1);
+    resultobj = SWIG_From_int(static_cast<int>(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+SWIGINTERN PyObject* _wrap_zts_poller_set(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
+{
+    PyObject* resultobj = 0;
+    int arg1;
+    int arg2;
+    short arg3;
+    int val1;
+    int ecode1 = 0;
+    int val2;
+    int ecode2 = 0;
+    short val3;
+    int ecode3 = 0;
+    PyObject* swig_obj[3];
+    int result;
+
+    if (! SWIG_Python_UnpackTuple(args, "zts_poller_set", 3, 3, swig_obj))
+        SWIG_fail;
+    ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+    if (! SWIG_IsOK(ecode1)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode1),
+            "in method '"
+            "zts_poller_set"
+            "', argument "
+            "1"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg1 = static_cast<int>(val1);
+    ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+    if (! SWIG_IsOK(ecode2)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode2),
+            "in method '"
+            "zts_poller_set"
+            "', argument "
+            "2"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg2 = static_cast<int>(val2);
+    ecode3 = SWIG_AsVal_short(swig_obj[2], &val3);
+    if (! SWIG_IsOK(ecode3)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode3),
+            "in method '"
+            "zts_poller_set"
+            "', argument "
+            "3"
+            " of type '"
+            "short"
+            "'");
+    }
+    arg3 = static_cast<short>(val3);
+    result = (int)zts_poller_set(arg1, arg2, arg3);
+    resultobj = SWIG_From_int(static_cast<int>(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+SWIGINTERN PyObject* _wrap_zts_poller_remove(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
+{
+    PyObject* resultobj = 0;
+    int arg1;
+    int arg2;
+    int val1;
+    int ecode1 = 0;
+    int val2;
+    int ecode2 = 0;
+    PyObject* swig_obj[2];
+    int result;
+
+    if (! SWIG_Python_UnpackTuple(args, "zts_poller_remove", 2, 2, swig_obj))
+        SWIG_fail;
+    ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+    if (! SWIG_IsOK(ecode1)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode1),
+            "in method '"
+            "zts_poller_remove"
+            "', argument "
+            "1"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg1 = static_cast<int>(val1);
+    ecode2 = SWIG_AsVal_int(swig_obj[1], &val2);
+    if (! SWIG_IsOK(ecode2)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode2),
+            "in method '"
+            "zts_poller_remove"
+            "', argument "
+            "2"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg2 = static_cast<int>(val2);
+    result = (int)zts_poller_remove(arg1, arg2);
+    resultobj = SWIG_From_int(static_cast<int>(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+SWIGINTERN PyObject* _wrap_zts_poller_wakeup(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
+{
+    PyObject* resultobj = 0;
+    int arg1;
+    int val1;
+    int ecode1 = 0;
+    PyObject* swig_obj[1];
+    int result;
+
+    if (! args)
+        SWIG_fail;
+    swig_obj[0] = args;
+    ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+    if (! SWIG_IsOK(ecode1)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode1),
+            "in method '"
+            "zts_poller_wakeup"
+            "', argument "
+            "1"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg1 = static_cast<int>(val1);
+    result = (int)zts_poller_wakeup(arg1);
+    resultobj = SWIG_From_int(static_cast<int>(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+SWIGINTERN PyObject* _wrap_zts_poller_get_os_fd(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
+{
+    PyObject* resultobj = 0;
+    int arg1;
+    int val1;
+    int ecode1 = 0;
+    PyObject* swig_obj[1];
+    int result;
+
+    if (! args)
+        SWIG_fail;
+    swig_obj[0] = args;
+    ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+    if (! SWIG_IsOK(ecode1)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode1),
+            "in method '"
+            "zts_poller_get_os_fd"
+            "', argument "
+            "1"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg1 = static_cast<int>(val1);
+    result = (int)zts_poller_get_os_fd(arg1);
     resultobj = SWIG_From_int(static_cast<int>(result));
     return resultobj;
 fail:
@@ -17935,7 +18570,10 @@ SWIGINTERN PyObject* _wrap_zts_connect(PyObject* SWIGUNUSEDPARM(self), PyObject*
             "'");
     }
     arg4 = static_cast<int>(val4);
-    result = (int)zts_connect(arg1, (char const*)arg2, arg3, arg4);
+    {
+        Py_BEGIN_ALLOW_THREADS result = (int)zts_connect(arg1, (char const*)arg2, arg3, arg4);
+        Py_END_ALLOW_THREADS
+    }
     resultobj = SWIG_From_int(static_cast<int>(result));
     if (alloc2 == SWIG_NEWOBJ)
         delete[] buf2;
@@ -18087,7 +18725,10 @@ SWIGINTERN PyObject* _wrap_zts_accept(PyObject* SWIGUNUSEDPARM(self), PyObject*
             "'");
     }
     arg4 = reinterpret_cast<unsigned short*>(argp4);
-    result = (int)zts_accept(arg1, arg2, arg3, arg4);
+    {
+        Py_BEGIN_ALLOW_THREADS result = (int)zts_accept(arg1, arg2, arg3, arg4);
+        Py_END_ALLOW_THREADS
+    }
     resultobj = SWIG_From_int(static_cast<int>(result));
     if (alloc2 == SWIG_NEWOBJ)
         delete[] buf2;
@@ -19414,6 +20055,38 @@ fail:
     return NULL;
 }
 
+SWIGINTERN PyObject* _wrap_zts_get_socket_error(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
+{
+    PyObject* resultobj = 0;
+    int arg1;
+    int val1;
+    int ecode1 = 0;
+    PyObject* swig_obj[1];
+    int result;
+
+    if (! args)
+        SWIG_fail;
+    swig_obj[0] = args;
+    ecode1 = SWIG_AsVal_int(swig_obj[0], &val1);
+    if (! SWIG_IsOK(ecode1)) {
+        SWIG_exception_fail(
+            SWIG_ArgError(ecode1),
+            "in method '"
+            "zts_get_socket_error"
+            "', argument "
+            "1"
+            " of type '"
+            "int"
+            "'");
+    }
+    arg1 = static_cast<int>(val1);
+    result = (int)zts_get_socket_error(arg1);
+    resultobj = SWIG_From_int(static_cast<int>(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
 SWIGINTERN PyObject* _wrap_zts_hostent_h_name_set(PyObject* SWIGUNUSEDPARM(self), PyObject* args)
 {
     PyObject* resultobj = 0;
@@ -21821,9 +22494,17 @@ static PyMethodDef SwigMethods[] = {
     { "zts_py_listen", _wrap_zts_py_listen, METH_VARARGS, NULL },
     { "zts_py_recv", _wrap_zts_py_recv, METH_VARARGS, NULL },
     { "zts_py_send", _wrap_zts_py_send, METH_VARARGS, NULL },
+    { "zts_py_recv_into", _wrap_zts_py_recv_into, METH_VARARGS, NULL },
+    { "zts_py_recvfrom", _wrap_zts_py_recvfrom, METH_VARARGS, NULL },
+    { "zts_py_recvfrom_into", _wrap_zts_py_recvfrom_into, METH_VARARGS, NULL },
+    { "zts_py_sendall", _wrap_zts_py_sendall, METH_VARARGS, NULL },
+    { "zts_py_sendto", _wrap_zts_py_sendto, METH_VARARGS, NULL },
     { "zts_py_close", _wrap_zts_py_close, METH_O, NULL },
     { "zts_py_setblocking", _wrap_zts_py_setblocking, METH_VARARGS, NULL },
     { "zts_py_getblocking", _wrap_zts_py_getblocking, METH_O, NULL },
+    { "zts_py_init_event_queue", _wrap_zts_py_init_event_queue, METH_NOARGS, NULL },
+    { "zts_py_event_next", _wrap_zts_py_event_next, METH_NOARGS, NULL },
+    { "zts_py_poller_wait", _wrap_zts_py_poller_wait, METH_VARARGS, NULL },
     { "zts_id_new", _wrap_zts_id_new, METH_VARARGS, NULL },
     { "zts_id_pair_is_valid", _wrap_zts_id_pair_is_valid, METH_VARARGS, NULL },
     { "zts_init_from_storage", _wrap_zts_init_from_storage, METH_O, NULL },
@@ -21963,6 +22644,12 @@ static PyMethodDef SwigMethods[] = {
     { "zts_bsd_select", _wrap_zts_bsd_select, METH_VARARGS, NULL },
     { "zts_bsd_fcntl", _wrap_zts_bsd_fcntl, METH_VARARGS, NULL },
     { "zts_bsd_poll", _wrap_zts_bsd_poll, METH_VARARGS, NULL },
+    { "zts_poller_new", _wrap_zts_poller_new, METH_NOARGS, NULL },
+    { "zts_poller_free", _wrap_zts_poller_free, METH_O, NULL },
+    { "zts_poller_set", _wrap_zts_poller_set, METH_VARARGS, NULL },
+    { "zts_poller_remove", _wrap_zts_poller_remove, METH_VARARGS, NULL },
+    { "zts_poller_wakeup", _wrap_zts_poller_wakeup, METH_O, NULL },
+    { "zts_poller_get_os_fd", _wrap_zts_poller_get_os_fd, METH_O, NULL },
     { "zts_bsd_ioctl", _wrap_zts_bsd_ioctl, METH_VARARGS, NULL },
     { "zts_bsd_send", _wrap_zts_bsd_send, METH_VARARGS, NULL },
     { "zts_bsd_sendto", _wrap_zts_bsd_sendto, METH_VARARGS, NULL },
@@ -22014,6 +22701,7 @@ static PyMethodDef SwigMethods[] = {
     { "zts_get_blocking", _wrap_zts_get_blocking, METH_O, NULL },
     { "zts_set_keepalive", _wrap_zts_set_keepalive, METH_VARARGS, NULL },
     { "zts_get_keepalive", _wrap_zts_get_keepalive, METH_O, NULL },
+    { "zts_get_socket_error", _wrap_zts_get_socket_error, METH_O, NULL },
     { "zts_hostent_h_name_set", _wrap_zts_hostent_h_name_set, METH_VARARGS, NULL },
     { "zts_hostent_h_name_get", _wrap_zts_hostent_h_name_get, METH_O, NULL },
     { "zts_hostent_h_aliases_set", _wrap_zts_hostent_h_aliases_set, METH_VARARGS, NULL },
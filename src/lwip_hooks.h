@@ -0,0 +1,47 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * lwIP hooks implemented by libzt. Included by lwIP through LWIP_HOOK_FILENAME
+ */
+
+#ifndef ZTS_LWIP_HOOKS_H
+#define ZTS_LWIP_HOOKS_H
+
+#include "lwip/ip_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct netif;
+
+/**
+ * Pick the netif that holds `src` if `dest` is on its subnet. Several nodes may join networks
+ * with overlapping subnets, and this keeps a socket bound to one node's address on that node
+ * rather than on whichever netif was added first. Returns NULL to fall back to lwIP's routing.
+ */
+struct netif* zts_lwip_route4_src(const ip4_addr_t* src, const ip4_addr_t* dest);
+
+/**
+ * IPv6 counterpart of zts_lwip_route4_src()
+ */
+struct netif* zts_lwip_route6_src(const ip6_addr_t* src, const ip6_addr_t* dest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // ZTS_LWIP_HOOKS_H
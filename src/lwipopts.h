@@ -78,12 +78,24 @@
 #define LWIP_NETIF_EXT_STATUS_CALLBACK  0
 #define LWIP_NETIF_LINK_CALLBACK        0
 #define LWIP_NETIF_REMOVE_CALLBACK      0
+// Hooks. Routes are chosen by source address first, see lwip_hooks.h
+#define LWIP_HOOK_FILENAME              "lwip_hooks.h"
+#define LWIP_HOOK_IP4_ROUTE_SRC(src, dest) zts_lwip_route4_src(src, dest)
+#define LWIP_HOOK_IP6_ROUTE(src, dest)  zts_lwip_route6_src(src, dest)
 
 /*------------------------------------------------------------------------------
 ------------------------------------ Presets -----------------------------------
 ------------------------------------------------------------------------------*/
 
-#define LWIP_MTU                        2800
+// Largest MTU of any netif, equal to ZT_MAX_MTU. Each netif takes its network's MTU and TCP
+// derives each connection's MSS from that, so TCP_MSS below is only an upper bound
+#define LWIP_MTU                        10000
+// MTU of netifs with virtual TSO (see zts_init_set_tso()). Their TCP segments may be this large
+// and are split to the network's MTU as they leave the stack. At most 0xffff / 4 to leave
+// room for TCP_SNDLOWAT. SYNs are not rewritten, so such a netif announces TCP_MSS below and
+// keeps the MSS each peer announces: segments this large are only sent to peers that also use
+// virtual TSO, every other peer gets segments of its own MSS and no gain from the option
+#define LWIP_TSO_MTU                    16384
 #define LWIP_CHKSUM_ALGORITHM           2
 // memory
 #define MEMP_NUM_NETCONN                1024
@@ -91,6 +103,9 @@
 #define MEMP_NUM_TCPIP_MSG_API          1024
 #define MEMP_NUM_TCPIP_MSG_INPKT        1024
 #define PBUF_POOL_SIZE                  1024
+// Don't free queued out-of-sequence segments from the tcpip thread when the pbuf pool runs dry. It
+// is only dry when the heap is (MEMP_MEM_MALLOC), and caller-driven mode has no tcpip thread
+#define PBUF_POOL_FREE_OOSEQ            0
 #define TCP_DEFAULT_LISTEN_BACKLOG      0xff
 // arp
 #define ARP_TABLE_SIZE                  64
@@ -100,6 +115,10 @@
 // ip
 #define IP_REASS_MAXAGE                 15
 #define IP_REASS_MAX_PBUFS              32
+// multicast. Groups joined by IGMP/MLD are passed on to ZeroTier as multicast subscriptions
+#define LWIP_IGMP                       1
+#define MEMP_NUM_IGMP_GROUP             64
+#define MEMP_NUM_MLD6_GROUP             64
 // tcp
 #define TCP_TMR_INTERVAL                250
 #define TCP_WND                         0xffff0
@@ -107,8 +126,8 @@
 #define TCP_SYNMAXRTX                   12
 #define LWIP_TCP_SACK_OUT               1
 #define LWIP_TCP_MAX_SACK_NUM           4
-#define TCP_MSS                         (LWIP_MTU - 40)
-#define TCP_SND_BUF                     (64 * TCP_MSS)
+#define TCP_MSS                         (LWIP_TSO_MTU - 40)
+#define TCP_SND_BUF                     (64 * (LWIP_MTU - 40))
 #define TCP_SND_QUEUELEN                (64 * (2 * (TCP_SND_BUF/TCP_MSS)))
 #define TCP_SNDLOWAT                    (0xffff - (4*TCP_MSS) - 1)
 #define TCP_SNDQUEUELOWAT               LWIP_MAX(((TCP_SND_QUEUELEN)/2), 5)
@@ -120,9 +139,11 @@
 #define LWIP_TCPIP_CORE_LOCKING         1
 #define LWIP_TCPIP_CORE_LOCKING_INPUT   1
 // netconn
-#define LWIP_NETCONN_FULLDUPLEX         0
+#define LWIP_NETCONN_SEM_PER_THREAD     1
+#define LWIP_NETCONN_FULLDUPLEX         1
 // netif
 #define LWIP_SINGLE_NETIF               0
+#define LWIP_CHECKSUM_CTRL_PER_NETIF    1
 #define LWIP_NETIF_HWADDRHINT           1
 #define LWIP_NETIF_TX_SINGLE_PBUF       0
 #define TCPIP_THREAD_PRIO               1
@@ -0,0 +1,1572 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * LD_PRELOAD shim (libzt-preload.so) that carries the TCP connections of an unmodified
+ * application over ZeroTier.
+ *
+ * Sockets are only taken over once their destination is known: `connect()` to, or `bind()`
+ * and `listen()` on, an address covered by the joined network's routes. At that point the
+ * application's descriptor is replaced (with `dup3()`, keeping its number and flags) by one
+ * end of an AF_UNIX socketpair, and a single relay thread moves data between the other end
+ * and a libzt socket. Because the application is left holding an ordinary kernel descriptor,
+ * `send`/`recv`/`read`/`write`/`poll`/`epoll`/`select` need no interposition and mixed
+ * waits on ZeroTier and kernel sockets stay as efficient as the kernel makes them. The relay
+ * thread itself sleeps in `epoll_wait()` on the socketpairs and on the OS descriptor of a
+ * single `zts_poller`.
+ *
+ * Until a non-blocking connect completes, the application's end is kept unwritable by filling
+ * its (temporarily shrunk) send buffer, so `POLLOUT` means "connected" just as it does for a
+ * kernel socket. Accepted connections are handed to `accept()` over the listener's socketpair
+ * with `SCM_RIGHTS`, which also works in children forked after `listen()` (pre-fork servers).
+ *
+ * Configuration (environment):
+ *
+ *   ZTS_PRELOAD_STORAGE   Identity storage path (default: ./.libzt-preload)
+ *   ZTS_PRELOAD_NETWORK   Network ID to join (hex). Without it everything goes to libc
+ *   ZTS_PRELOAD_ROUTES    Comma-separated CIDRs to send over ZeroTier. Defaults to the
+ *                         network's assigned subnets and managed routes
+ *   ZTS_PRELOAD_BIND_ANY  If 1, wildcard TCP binds (0.0.0.0, ::) listen on ZeroTier
+ *   ZTS_PRELOAD_TIMEOUT   Seconds to wait for the network to come up (default: 30)
+ *
+ * Limitations: only TCP is carried, UDP always goes to the OS. Connections made by children
+ * forked after start-up go to the OS since the node belongs to the parent. Readiness
+ * registrations made on a descriptor before it is taken over (e.g. epoll before connect) are
+ * lost, as are address and option lookups on duplicates made with dup().
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "ZeroTierSockets.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define ZTS_PRELOAD_EXPORT extern "C" __attribute__((visibility("default")))
+
+// Application descriptors above this are never taken over
+#define ZTS_PRELOAD_MAX_FDS 65536
+
+#define ZTS_PRELOAD_BUF_LEN (64 * 1024)
+
+#define ZTS_PRELOAD_MAX_EVENTS 256
+
+#define ZTS_PRELOAD_DEFAULT_STORAGE "./.libzt-preload"
+
+#define ZTS_PRELOAD_DEFAULT_TIMEOUT 30
+
+//----------------------------------------------------------------------------//
+// libc                                                                       //
+//----------------------------------------------------------------------------//
+
+namespace {
+
+typedef int (*connect_fn)(int, const struct sockaddr*, socklen_t);
+typedef int (*bind_fn)(int, const struct sockaddr*, socklen_t);
+typedef int (*listen_fn)(int, int);
+typedef int (*accept_fn)(int, struct sockaddr*, socklen_t*);
+typedef int (*accept4_fn)(int, struct sockaddr*, socklen_t*, int);
+typedef int (*close_fn)(int);
+typedef int (*getname_fn)(int, struct sockaddr*, socklen_t*);
+typedef int (*getsockopt_fn)(int, int, int, void*, socklen_t*);
+typedef int (*setsockopt_fn)(int, int, int, const void*, socklen_t);
+
+connect_fn real_connect;
+bind_fn real_bind;
+listen_fn real_listen;
+accept_fn real_accept;
+accept4_fn real_accept4;
+close_fn real_close;
+getname_fn real_getsockname;
+getname_fn real_getpeername;
+getsockopt_fn real_getsockopt;
+setsockopt_fn real_setsockopt;
+
+// Resolved on first use since other constructors may call in before ours runs
+template <typename F> F resolve(F& slot, const char* name)
+{
+    if (! slot) {
+        slot = (F)dlsym(RTLD_NEXT, name);
+    }
+    return slot;
+}
+
+#define REAL(fn) resolve(real_##fn, #fn)
+
+//----------------------------------------------------------------------------//
+// Address helpers                                                            //
+//----------------------------------------------------------------------------//
+
+/** Convert a host sockaddr to its libzt (lwIP) layout */
+bool to_zts(const struct sockaddr* sa, socklen_t len, struct zts_sockaddr_storage* ss, zts_socklen_t* zlen)
+{
+    memset(ss, 0, sizeof(*ss));
+    if (sa->sa_family == AF_INET && len >= sizeof(struct sockaddr_in)) {
+        const struct sockaddr_in* in4 = (const struct sockaddr_in*)sa;
+        struct zts_sockaddr_in* z4 = (struct zts_sockaddr_in*)ss;
+        z4->sin_len = sizeof(*z4);
+        z4->sin_family = ZTS_AF_INET;
+        z4->sin_port = in4->sin_port;
+        memcpy(&z4->sin_addr, &in4->sin_addr, 4);
+        *zlen = sizeof(*z4);
+        return true;
+    }
+    if (sa->sa_family == AF_INET6 && len >= sizeof(struct sockaddr_in6)) {
+        const struct sockaddr_in6* in6 = (const struct sockaddr_in6*)sa;
+        struct zts_sockaddr_in6* z6 = (struct zts_sockaddr_in6*)ss;
+        z6->sin6_len = sizeof(*z6);
+        z6->sin6_family = ZTS_AF_INET6;
+        z6->sin6_port = in6->sin6_port;
+        z6->sin6_flowinfo = in6->sin6_flowinfo;
+        memcpy(&z6->sin6_addr, &in6->sin6_addr, 16);
+        z6->sin6_scope_id = in6->sin6_scope_id;
+        *zlen = sizeof(*z6);
+        return true;
+    }
+    return false;
+}
+
+/** Convert a libzt sockaddr to the host layout */
+socklen_t from_zts(const struct zts_sockaddr_storage* ss, struct sockaddr_storage* out)
+{
+    memset(out, 0, sizeof(*out));
+    if (ss->ss_family == ZTS_AF_INET) {
+        const struct zts_sockaddr_in* z4 = (const struct zts_sockaddr_in*)ss;
+        struct sockaddr_in* in4 = (struct sockaddr_in*)out;
+        in4->sin_family = AF_INET;
+        in4->sin_port = z4->sin_port;
+        memcpy(&in4->sin_addr, &z4->sin_addr, 4);
+        return sizeof(*in4);
+    }
+    if (ss->ss_family == ZTS_AF_INET6) {
+        const struct zts_sockaddr_in6* z6 = (const struct zts_sockaddr_in6*)ss;
+        struct sockaddr_in6* in6 = (struct sockaddr_in6*)out;
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = z6->sin6_port;
+        in6->sin6_flowinfo = z6->sin6_flowinfo;
+        memcpy(&in6->sin6_addr, &z6->sin6_addr, 16);
+        in6->sin6_scope_id = z6->sin6_scope_id;
+        return sizeof(*in6);
+    }
+    return 0;
+}
+
+/** Copy an address out to the caller of getsockname()/getpeername()/accept() */
+void copy_out(const struct sockaddr_storage* ss, socklen_t sslen, struct sockaddr* addr, socklen_t* addrlen)
+{
+    if (! addr || ! addrlen) {
+        return;
+    }
+    memcpy(addr, ss, *addrlen < sslen ? *addrlen : sslen);
+    *addrlen = sslen;
+}
+
+bool is_wildcard(const struct sockaddr* sa)
+{
+    if (sa->sa_family == AF_INET) {
+        return ((const struct sockaddr_in*)sa)->sin_addr.s_addr == htonl(INADDR_ANY);
+    }
+    if (sa->sa_family == AF_INET6) {
+        return IN6_IS_ADDR_UNSPECIFIED(&((const struct sockaddr_in6*)sa)->sin6_addr);
+    }
+    return false;
+}
+
+int socket_type(int fd)
+{
+    int type = 0;
+    socklen_t len = sizeof(type);
+    if (REAL(getsockopt)(fd, SOL_SOCKET, SO_TYPE, &type, &len) < 0) {
+        return -1;
+    }
+    return type;
+}
+
+//----------------------------------------------------------------------------//
+// Routing                                                                    //
+//----------------------------------------------------------------------------//
+
+struct Prefix {
+    int family;
+    uint8_t addr[16];
+    unsigned int bits;
+};
+
+bool prefix_contains(const Prefix& p, const struct sockaddr* sa)
+{
+    const uint8_t* a = NULL;
+    if (sa->sa_family == AF_INET && p.family == AF_INET) {
+        a = (const uint8_t*)&((const struct sockaddr_in*)sa)->sin_addr;
+    }
+    else if (sa->sa_family == AF_INET6 && p.family == AF_INET6) {
+        a = (const uint8_t*)&((const struct sockaddr_in6*)sa)->sin6_addr;
+    }
+    if (! a) {
+        return false;
+    }
+    unsigned int full = p.bits / 8;
+    if (memcmp(a, p.addr, full) != 0) {
+        return false;
+    }
+    unsigned int rem = p.bits % 8;
+    if (rem) {
+        uint8_t mask = (uint8_t)(0xff << (8 - rem));
+        return (a[full] & mask) == (p.addr[full] & mask);
+    }
+    return true;
+}
+
+bool parse_prefix(const char* str, Prefix* p)
+{
+    char buf[ZTS_INET6_ADDRSTRLEN + 8];
+    snprintf(buf, sizeof(buf), "%s", str);
+    char* slash = strchr(buf, '/');
+    if (slash) {
+        *slash = '\0';
+    }
+    memset(p, 0, sizeof(*p));
+    if (inet_pton(AF_INET, buf, p->addr) == 1) {
+        p->family = AF_INET;
+        p->bits = 32;
+    }
+    else if (inet_pton(AF_INET6, buf, p->addr) == 1) {
+        p->family = AF_INET6;
+        p->bits = 128;
+    }
+    else {
+        return false;
+    }
+    if (slash) {
+        unsigned int bits = (unsigned int)atoi(slash + 1);
+        if (bits < p->bits) {
+            p->bits = bits;
+        }
+    }
+    return true;
+}
+
+/** A ZeroTier-pushed address or route target, the netmask bits are carried in the port field */
+bool prefix_from_zts(const struct zts_sockaddr_storage* ss, Prefix* p)
+{
+    memset(p, 0, sizeof(*p));
+    if (ss->ss_family == ZTS_AF_INET) {
+        const struct zts_sockaddr_in* z4 = (const struct zts_sockaddr_in*)ss;
+        p->family = AF_INET;
+        memcpy(p->addr, &z4->sin_addr, 4);
+        p->bits = ntohs(z4->sin_port);
+        return p->bits > 0 && p->bits <= 32;
+    }
+    if (ss->ss_family == ZTS_AF_INET6) {
+        const struct zts_sockaddr_in6* z6 = (const struct zts_sockaddr_in6*)ss;
+        p->family = AF_INET6;
+        memcpy(p->addr, &z6->sin6_addr, 16);
+        p->bits = ntohs(z6->sin6_port);
+        return p->bits > 0 && p->bits <= 128;
+    }
+    return false;
+}
+
+//----------------------------------------------------------------------------//
+// Descriptor table                                                           //
+//----------------------------------------------------------------------------//
+
+enum EntryKind { ENTRY_BOUND, ENTRY_LISTENER, ENTRY_CONN };
+
+enum ConnState { CONN_CONNECTING, CONN_CONNECTED, CONN_FAILED };
+
+/**
+ * State shared between an application descriptor and the relay's view of it. Reference counted
+ * since either side may go away first.
+ */
+struct Shared {
+    std::mutex lock;
+    std::condition_variable cond;
+    int refs;
+    int state;
+    int error;
+    int zfd;
+    struct sockaddr_storage local;
+    socklen_t local_len;
+    struct sockaddr_storage peer;
+    socklen_t peer_len;
+
+    Shared() : refs(1), state(CONN_CONNECTED), error(0), zfd(-1), local_len(0), peer_len(0)
+    {
+        memset(&local, 0, sizeof(local));
+        memset(&peer, 0, sizeof(peer));
+    }
+
+    void retain()
+    {
+        std::lock_guard<std::mutex> l(lock);
+        refs++;
+    }
+
+    void release()
+    {
+        bool last;
+        {
+            std::lock_guard<std::mutex> l(lock);
+            last = --refs == 0;
+        }
+        if (last) {
+            delete this;
+        }
+    }
+};
+
+struct Entry {
+    EntryKind kind;
+    int family;
+    Shared* shared;
+};
+
+std::mutex _table_lock;
+Entry* _table[ZTS_PRELOAD_MAX_FDS];
+
+Entry* lookup(int fd)
+{
+    if (fd < 0 || fd >= ZTS_PRELOAD_MAX_FDS) {
+        return NULL;
+    }
+    std::lock_guard<std::mutex> l(_table_lock);
+    Entry* e = _table[fd];
+    if (e) {
+        e->shared->retain();
+    }
+    return e;
+}
+
+void install(int fd, EntryKind kind, int family, Shared* shared)
+{
+    Entry* e = new Entry();
+    e->kind = kind;
+    e->family = family;
+    e->shared = shared;
+    Entry* old;
+    {
+        std::lock_guard<std::mutex> l(_table_lock);
+        old = _table[fd];
+        _table[fd] = e;
+    }
+    if (old) {
+        old->shared->release();
+        delete old;
+    }
+}
+
+void uninstall(int fd)
+{
+    if (fd < 0 || fd >= ZTS_PRELOAD_MAX_FDS) {
+        return;
+    }
+    Entry* old;
+    {
+        std::lock_guard<std::mutex> l(_table_lock);
+        old = _table[fd];
+        _table[fd] = NULL;
+    }
+    if (old) {
+        old->shared->release();
+        delete old;
+    }
+}
+
+/** Release a reference obtained from lookup() */
+struct EntryRef {
+    Entry* e;
+    explicit EntryRef(Entry* e) : e(e)
+    {
+    }
+    ~EntryRef()
+    {
+        if (e) {
+            e->shared->release();
+        }
+    }
+};
+
+//----------------------------------------------------------------------------//
+// Relay                                                                      //
+//----------------------------------------------------------------------------//
+
+struct Buffer {
+    char data[ZTS_PRELOAD_BUF_LEN];
+    size_t off;
+    size_t len;
+
+    Buffer() : off(0), len(0)
+    {
+    }
+    bool empty() const
+    {
+        return off == len;
+    }
+};
+
+enum HandleType { HANDLE_CONN, HANDLE_LISTENER, HANDLE_INTERNAL };
+
+struct Handle {
+    HandleType type;
+};
+
+/** One relayed TCP connection */
+struct Conn : Handle {
+    Shared* shared;
+    int zfd;
+    int b;
+    // Duplicate of the application's end, held only while the connect is pending
+    int app_dup;
+    int app_sndbuf;
+    size_t filler;
+    struct zts_sockaddr_storage remote;
+    zts_socklen_t remote_len;
+    bool connecting;
+    bool b_eof;
+    bool z_eof;
+    bool z_shut;
+    bool b_shut;
+    uint32_t b_events;
+    short z_events;
+    Buffer k2z;
+    Buffer z2k;
+};
+
+/** A listening socket, accepted connections are passed to the application over b */
+struct Listener : Handle {
+    Shared* shared;
+    int zfd;
+    int b;
+    int family;
+    uint32_t b_events;
+    short z_events;
+    // Accepted but not yet handed over because the socketpair was full
+    std::deque<Conn*> backlog;
+};
+
+/** What accept() receives along with the descriptor */
+struct AcceptMsg {
+    struct sockaddr_storage local;
+    socklen_t local_len;
+    struct sockaddr_storage peer;
+    socklen_t peer_len;
+};
+
+class Relay {
+  public:
+    Relay() : _ep(-1), _wake(-1), _pfd(-1), _started(false)
+    {
+        _wake_handle.type = HANDLE_INTERNAL;
+        _poller_handle.type = HANDLE_INTERNAL;
+    }
+
+    /** Start the relay thread, the node must be online */
+    int start()
+    {
+        std::lock_guard<std::mutex> l(_lock);
+        if (_started) {
+            return 0;
+        }
+        _pfd = zts_poller_new();
+        if (_pfd < 0) {
+            return -1;
+        }
+        _ep = epoll_create1(EPOLL_CLOEXEC);
+        _wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        int os_fd = zts_poller_get_os_fd(_pfd);
+        if (_ep < 0 || _wake < 0 || os_fd < 0) {
+            return -1;
+        }
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = &_wake_handle;
+        epoll_ctl(_ep, EPOLL_CTL_ADD, _wake, &ev);
+        ev.data.ptr = &_poller_handle;
+        epoll_ctl(_ep, EPOLL_CTL_ADD, os_fd, &ev);
+        std::thread(&Relay::run, this).detach();
+        _started = true;
+        return 0;
+    }
+
+    /** Hand a handle to the relay thread */
+    void submit(Handle* h)
+    {
+        {
+            std::lock_guard<std::mutex> l(_lock);
+            _incoming.push_back(h);
+        }
+        uint64_t one = 1;
+        ssize_t ignored = write(_wake, &one, sizeof(one));
+        (void)ignored;
+    }
+
+  private:
+    void run()
+    {
+        struct epoll_event events[ZTS_PRELOAD_MAX_EVENTS];
+        for (;;) {
+            int n = epoll_wait(_ep, events, ZTS_PRELOAD_MAX_EVENTS, -1);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            for (int i = 0; i < n; i++) {
+                Handle* h = (Handle*)events[i].data.ptr;
+                if (h == &_wake_handle) {
+                    uint64_t count;
+                    ssize_t ignored = read(_wake, &count, sizeof(count));
+                    (void)ignored;
+                    adopt();
+                }
+                else if (h == &_poller_handle) {
+                    dispatch_zts();
+                }
+                else if (h->type == HANDLE_CONN) {
+                    on_conn_b((Conn*)h, events[i].events);
+                }
+                else if (h->type == HANDLE_LISTENER) {
+                    on_listener_b((Listener*)h, events[i].events);
+                }
+            }
+        }
+    }
+
+    void adopt()
+    {
+        std::vector<Handle*> incoming;
+        {
+            std::lock_guard<std::mutex> l(_lock);
+            incoming.swap(_incoming);
+        }
+        for (size_t i = 0; i < incoming.size(); i++) {
+            if (incoming[i]->type == HANDLE_CONN) {
+                Conn* c = (Conn*)incoming[i];
+                _zfds[c->zfd] = c;
+                epoll_add(c->b, c);
+                if (c->connecting) {
+                    start_connect(c);
+                }
+                else {
+                    update_conn(c);
+                }
+            }
+            else {
+                Listener* li = (Listener*)incoming[i];
+                _zfds[li->zfd] = li;
+                epoll_add(li->b, li);
+                update_listener(li);
+            }
+        }
+    }
+
+    void dispatch_zts()
+    {
+        zts_poller_event_t events[ZTS_PRELOAD_MAX_EVENTS];
+        int n = zts_poller_wait(_pfd, events, ZTS_PRELOAD_MAX_EVENTS, 0);
+        for (int i = 0; i < n; i++) {
+            std::map<int, Handle*>::iterator it = _zfds.find(events[i].fd);
+            if (it == _zfds.end()) {
+                continue;
+            }
+            if (it->second->type == HANDLE_CONN) {
+                on_conn_z((Conn*)it->second, events[i].revents);
+            }
+            else {
+                on_listener_z((Listener*)it->second);
+            }
+        }
+    }
+
+    void epoll_add(int fd, Handle* h)
+    {
+        struct epoll_event ev;
+        ev.events = 0;
+        ev.data.ptr = h;
+        epoll_ctl(_ep, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    void set_interest(int b, Handle* h, uint32_t* current, uint32_t b_events, int zfd, short* z_current, short z_events)
+    {
+        if (*current != b_events) {
+            struct epoll_event ev;
+            ev.events = b_events;
+            ev.data.ptr = h;
+            epoll_ctl(_ep, EPOLL_CTL_MOD, b, &ev);
+            *current = b_events;
+        }
+        if (*z_current != z_events) {
+            if (z_events) {
+                zts_poller_set(_pfd, zfd, z_events);
+            }
+            else {
+                zts_poller_remove(_pfd, zfd);
+            }
+            *z_current = z_events;
+        }
+    }
+
+    //------------------------------------------------------------------------//
+    // Connections                                                            //
+    //------------------------------------------------------------------------//
+
+    void start_connect(Conn* c)
+    {
+        if (zts_bsd_connect(c->zfd, (struct zts_sockaddr*)&c->remote, c->remote_len) == 0) {
+            connected(c);
+            return;
+        }
+        if (zts_errno == ZTS_EINPROGRESS || zts_errno == ZTS_EAGAIN) {
+            update_conn(c);
+            return;
+        }
+        fail(c, zts_errno);
+    }
+
+    void connected(Conn* c)
+    {
+        c->connecting = false;
+        struct zts_sockaddr_storage local;
+        zts_socklen_t local_len = sizeof(local);
+        {
+            std::lock_guard<std::mutex> l(c->shared->lock);
+            if (zts_bsd_getsockname(c->zfd, (struct zts_sockaddr*)&local, &local_len) == 0) {
+                c->shared->local_len = from_zts(&local, &c->shared->local);
+            }
+            c->shared->state = CONN_CONNECTED;
+        }
+        c->shared->cond.notify_all();
+        // Give the application its send buffer back, it becomes writable once the filler drains
+        if (c->app_dup >= 0) {
+            REAL(setsockopt)(c->app_dup, SOL_SOCKET, SO_SNDBUF, &c->app_sndbuf, sizeof(c->app_sndbuf));
+            REAL(close)(c->app_dup);
+            c->app_dup = -1;
+        }
+        update_conn(c);
+    }
+
+    void on_conn_z(Conn* c, short revents)
+    {
+        if (c->connecting) {
+            int err = zts_get_socket_error(c->zfd);
+            if (err == 0) {
+                connected(c);
+            }
+            else {
+                fail(c, err > 0 ? err : ZTS_EIO);
+            }
+            return;
+        }
+        if (revents & (ZTS_POLLIN | ZTS_POLLERR | ZTS_POLLHUP)) {
+            if (! pump_z2k(c)) {
+                return;
+            }
+        }
+        if (revents & (ZTS_POLLOUT | ZTS_POLLERR | ZTS_POLLHUP)) {
+            if (! pump_k2z(c)) {
+                return;
+            }
+        }
+        finish_or_update(c);
+    }
+
+    void on_conn_b(Conn* c, uint32_t events)
+    {
+        if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+            if (! pump_k2z(c)) {
+                return;
+            }
+        }
+        if (events & (EPOLLOUT | EPOLLERR)) {
+            if (! pump_z2k(c)) {
+                return;
+            }
+        }
+        finish_or_update(c);
+    }
+
+    /** Application -> ZeroTier. Returns false if the connection was torn down */
+    bool pump_k2z(Conn* c)
+    {
+        for (;;) {
+            if (c->k2z.empty() && ! c->b_eof) {
+                ssize_t n = read(c->b, c->k2z.data, sizeof(c->k2z.data));
+                if (n == 0) {
+                    c->b_eof = true;
+                }
+                else if (n < 0) {
+                    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                        c->b_eof = true;
+                    }
+                }
+                else {
+                    c->k2z.off = 0;
+                    c->k2z.len = (size_t)n;
+                    // Bytes written while connecting only served to keep the app unwritable
+                    size_t skip = c->filler < (size_t)n ? c->filler : (size_t)n;
+                    c->filler -= skip;
+                    c->k2z.off = skip;
+                }
+            }
+            if (c->k2z.empty()) {
+                break;
+            }
+            ssize_t n = zts_bsd_send(c->zfd, c->k2z.data + c->k2z.off, c->k2z.len - c->k2z.off, 0);
+            if (n < 0) {
+                if (zts_errno == ZTS_EAGAIN) {
+                    break;
+                }
+                fail(c, zts_errno);
+                return false;
+            }
+            c->k2z.off += (size_t)n;
+        }
+        if (c->b_eof && c->k2z.empty() && ! c->z_shut) {
+            zts_bsd_shutdown(c->zfd, ZTS_SHUT_WR);
+            c->z_shut = true;
+        }
+        return true;
+    }
+
+    /** ZeroTier -> application. Returns false if the connection was torn down */
+    bool pump_z2k(Conn* c)
+    {
+        for (;;) {
+            if (c->z2k.empty() && ! c->z_eof) {
+                ssize_t n = zts_bsd_recv(c->zfd, c->z2k.data, sizeof(c->z2k.data), 0);
+                if (n == 0) {
+                    c->z_eof = true;
+                }
+                else if (n < 0) {
+                    if (zts_errno != ZTS_EAGAIN) {
+                        fail(c, zts_errno);
+                        return false;
+                    }
+                }
+                else {
+                    c->z2k.off = 0;
+                    c->z2k.len = (size_t)n;
+                }
+            }
+            if (c->z2k.empty()) {
+                break;
+            }
+            ssize_t n = send(c->b, c->z2k.data + c->z2k.off, c->z2k.len - c->z2k.off, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                // The application closed its end
+                destroy(c);
+                return false;
+            }
+            c->z2k.off += (size_t)n;
+        }
+        if (c->z_eof && c->z2k.empty() && ! c->b_shut) {
+            shutdown(c->b, SHUT_WR);
+            c->b_shut = true;
+        }
+        return true;
+    }
+
+    void finish_or_update(Conn* c)
+    {
+        if (c->b_eof && c->z_eof && c->k2z.empty() && c->z2k.empty()) {
+            destroy(c);
+            return;
+        }
+        update_conn(c);
+    }
+
+    void update_conn(Conn* c)
+    {
+        uint32_t b_events = 0;
+        short z_events = 0;
+        if (c->connecting) {
+            z_events = ZTS_POLLOUT;
+        }
+        else {
+            if (c->k2z.empty() && ! c->b_eof) {
+                b_events |= EPOLLIN;
+            }
+            if (! c->z2k.empty()) {
+                b_events |= EPOLLOUT;
+            }
+            if (c->z2k.empty() && ! c->z_eof) {
+                z_events |= ZTS_POLLIN;
+            }
+            if (! c->k2z.empty()) {
+                z_events |= ZTS_POLLOUT;
+            }
+        }
+        set_interest(c->b, c, &c->b_events, b_events, c->zfd, &c->z_events, z_events);
+    }
+
+    void fail(Conn* c, int err)
+    {
+        {
+            std::lock_guard<std::mutex> l(c->shared->lock);
+            c->shared->error = err;
+            if (c->connecting) {
+                c->shared->state = CONN_FAILED;
+            }
+        }
+        c->shared->cond.notify_all();
+        destroy(c);
+    }
+
+    void destroy(Conn* c)
+    {
+        _zfds.erase(c->zfd);
+        epoll_ctl(_ep, EPOLL_CTL_DEL, c->b, NULL);
+        zts_bsd_close(c->zfd);
+        // Closing b (and the duplicate, if any) frees the filler so the app sees POLLOUT|POLLHUP
+        REAL(close)(c->b);
+        if (c->app_dup >= 0) {
+            REAL(close)(c->app_dup);
+        }
+        {
+            std::lock_guard<std::mutex> l(c->shared->lock);
+            c->shared->zfd = -1;
+        }
+        c->shared->release();
+        delete c;
+    }
+
+    //------------------------------------------------------------------------//
+    // Listeners                                                              //
+    //------------------------------------------------------------------------//
+
+    void on_listener_z(Listener* li)
+    {
+        while (li->backlog.empty()) {
+            struct zts_sockaddr_storage peer;
+            zts_socklen_t peer_len = sizeof(peer);
+            int zfd = zts_bsd_accept(li->zfd, (struct zts_sockaddr*)&peer, &peer_len);
+            if (zfd < 0) {
+                break;
+            }
+            zts_set_blocking(zfd, 0);
+            int sv[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) < 0) {
+                zts_bsd_close(zfd);
+                break;
+            }
+            Conn* c = new_conn(zfd, sv[1], new Shared());
+            c->app_dup = sv[0];
+            c->shared->peer_len = from_zts(&peer, &c->shared->peer);
+            struct zts_sockaddr_storage local;
+            zts_socklen_t local_len = sizeof(local);
+            if (zts_bsd_getsockname(zfd, (struct zts_sockaddr*)&local, &local_len) == 0) {
+                c->shared->local_len = from_zts(&local, &c->shared->local);
+            }
+            li->backlog.push_back(c);
+            hand_over(li);
+        }
+        update_listener(li);
+    }
+
+    /** Pass accepted connections to the application, oldest first */
+    void hand_over(Listener* li)
+    {
+        while (! li->backlog.empty()) {
+            Conn* c = li->backlog.front();
+            AcceptMsg msg;
+            memset(&msg, 0, sizeof(msg));
+            {
+                std::lock_guard<std::mutex> l(c->shared->lock);
+                msg.local = c->shared->local;
+                msg.local_len = c->shared->local_len;
+                msg.peer = c->shared->peer;
+                msg.peer_len = c->shared->peer_len;
+            }
+            struct iovec iov;
+            iov.iov_base = &msg;
+            iov.iov_len = sizeof(msg);
+            char control[CMSG_SPACE(sizeof(int))];
+            memset(control, 0, sizeof(control));
+            struct msghdr mh;
+            memset(&mh, 0, sizeof(mh));
+            mh.msg_iov = &iov;
+            mh.msg_iovlen = 1;
+            mh.msg_control = control;
+            mh.msg_controllen = sizeof(control);
+            struct cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+            cm->cmsg_level = SOL_SOCKET;
+            cm->cmsg_type = SCM_RIGHTS;
+            cm->cmsg_len = CMSG_LEN(sizeof(int));
+            memcpy(CMSG_DATA(cm), &c->app_dup, sizeof(int));
+            if (sendmsg(li->b, &mh, MSG_NOSIGNAL | MSG_DONTWAIT) < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                // Nobody is listening any more
+                destroy_listener(li);
+                return;
+            }
+            REAL(close)(c->app_dup);
+            c->app_dup = -1;
+            li->backlog.pop_front();
+            // Relay only once handed over, until then the data waits in the stack
+            _zfds[c->zfd] = c;
+            epoll_add(c->b, c);
+            update_conn(c);
+        }
+    }
+
+    void on_listener_b(Listener* li, uint32_t events)
+    {
+        if (events & (EPOLLHUP | EPOLLERR)) {
+            destroy_listener(li);
+            return;
+        }
+        if (events & EPOLLOUT) {
+            hand_over(li);
+        }
+        update_listener(li);
+    }
+
+    void update_listener(Listener* li)
+    {
+        uint32_t b_events = li->backlog.empty() ? EPOLLRDHUP : (EPOLLOUT | EPOLLRDHUP);
+        short z_events = li->backlog.empty() ? ZTS_POLLIN : 0;
+        set_interest(li->b, li, &li->b_events, b_events, li->zfd, &li->z_events, z_events);
+    }
+
+    void destroy_listener(Listener* li)
+    {
+        _zfds.erase(li->zfd);
+        epoll_ctl(_ep, EPOLL_CTL_DEL, li->b, NULL);
+        zts_bsd_close(li->zfd);
+        REAL(close)(li->b);
+        while (! li->backlog.empty()) {
+            destroy(li->backlog.front());
+            li->backlog.pop_front();
+        }
+        li->shared->release();
+        delete li;
+    }
+
+  public:
+    static Conn* new_conn(int zfd, int b, Shared* shared)
+    {
+        Conn* c = new Conn();
+        c->type = HANDLE_CONN;
+        c->shared = shared;
+        c->zfd = zfd;
+        c->b = b;
+        c->app_dup = -1;
+        c->app_sndbuf = 0;
+        c->filler = 0;
+        c->remote_len = 0;
+        c->connecting = false;
+        c->b_eof = false;
+        c->z_eof = false;
+        c->z_shut = false;
+        c->b_shut = false;
+        c->b_events = 0;
+        c->z_events = 0;
+        {
+            std::lock_guard<std::mutex> l(shared->lock);
+            shared->zfd = zfd;
+        }
+        return c;
+    }
+
+  private:
+    std::mutex _lock;
+    std::vector<Handle*> _incoming;
+    std::map<int, Handle*> _zfds;
+    Handle _wake_handle;
+    Handle _poller_handle;
+    int _ep;
+    int _wake;
+    int _pfd;
+    bool _started;
+};
+
+Relay _relay;
+
+//----------------------------------------------------------------------------//
+// Node                                                                       //
+//----------------------------------------------------------------------------//
+
+std::mutex _node_lock;
+std::condition_variable _node_cond;
+uint64_t _net_id = 0;
+pid_t _owner_pid = 0;
+bool _bind_any = false;
+bool _static_routes = false;
+bool _net_ready = false;
+bool _net_failed = false;
+int _timeout_sec = ZTS_PRELOAD_DEFAULT_TIMEOUT;
+std::chrono::steady_clock::time_point _deadline;
+std::vector<Prefix> _routes;
+
+void on_zts_event(void* ptr)
+{
+    zts_event_msg_t* msg = (zts_event_msg_t*)ptr;
+    int code = msg->event_code;
+    if (! msg->network || msg->network->net_id != _net_id) {
+        return;
+    }
+    std::lock_guard<std::mutex> l(_node_lock);
+    if (code == ZTS_EVENT_NETWORK_NOT_FOUND || code == ZTS_EVENT_NETWORK_ACCESS_DENIED
+        || code == ZTS_EVENT_NETWORK_CLIENT_TOO_OLD) {
+        _net_failed = true;
+        _node_cond.notify_all();
+        return;
+    }
+    if (code != ZTS_EVENT_NETWORK_READY_IP4 && code != ZTS_EVENT_NETWORK_READY_IP6
+        && code != ZTS_EVENT_NETWORK_READY_IP4_IP6 && code != ZTS_EVENT_NETWORK_UPDATE) {
+        return;
+    }
+    if (! _static_routes) {
+        std::vector<Prefix> routes;
+        Prefix p;
+        for (unsigned int i = 0; i < msg->network->assigned_addr_count && i < ZTS_MAX_ASSIGNED_ADDRESSES; i++) {
+            if (prefix_from_zts(&msg->network->assigned_addrs[i], &p)) {
+                routes.push_back(p);
+            }
+        }
+        // A default route would capture all traffic, including ZeroTier's own
+        for (unsigned int i = 0; i < msg->network->route_count && i < ZTS_MAX_NETWORK_ROUTES; i++) {
+            if (prefix_from_zts(&msg->network->routes[i].target, &p)) {
+                routes.push_back(p);
+            }
+        }
+        _routes.swap(routes);
+    }
+    if (code != ZTS_EVENT_NETWORK_UPDATE) {
+        _net_ready = true;
+    }
+    _node_cond.notify_all();
+}
+
+void parse_routes(const char* str)
+{
+    char buf[4096];
+    snprintf(buf, sizeof(buf), "%s", str);
+    char* save = NULL;
+    for (char* tok = strtok_r(buf, ", ", &save); tok; tok = strtok_r(NULL, ", ", &save)) {
+        Prefix p;
+        if (parse_prefix(tok, &p)) {
+            _routes.push_back(p);
+        }
+    }
+    _static_routes = ! _routes.empty();
+}
+
+__attribute__((constructor)) void preload_init()
+{
+    const char* net = getenv("ZTS_PRELOAD_NETWORK");
+    if (! net || ! *net) {
+        return;
+    }
+    _net_id = strtoull(net, NULL, 16);
+    const char* storage = getenv("ZTS_PRELOAD_STORAGE");
+    const char* routes = getenv("ZTS_PRELOAD_ROUTES");
+    const char* bind_any = getenv("ZTS_PRELOAD_BIND_ANY");
+    const char* timeout = getenv("ZTS_PRELOAD_TIMEOUT");
+    if (routes) {
+        parse_routes(routes);
+    }
+    _bind_any = bind_any && atoi(bind_any) == 1;
+    if (timeout && atoi(timeout) > 0) {
+        _timeout_sec = atoi(timeout);
+    }
+    // Programs exec'd from here must not start a second node with the same identity
+    unsetenv("ZTS_PRELOAD_NETWORK");
+    _owner_pid = getpid();
+    _deadline = std::chrono::steady_clock::now() + std::chrono::seconds(_timeout_sec);
+    zts_init_from_storage(storage && *storage ? storage : ZTS_PRELOAD_DEFAULT_STORAGE);
+    zts_init_set_event_handler(on_zts_event);
+    if (zts_node_start() != ZTS_ERR_OK) {
+        _net_id = 0;
+        return;
+    }
+    // Joining requires the node to be online, so finish start-up off the loader's thread
+    std::thread([]() {
+        for (int i = 0; i < _timeout_sec * 10 && ! zts_node_is_online(); i++) {
+            usleep(100 * 1000);
+        }
+        if (zts_net_join(_net_id) != ZTS_ERR_OK) {
+            std::lock_guard<std::mutex> l(_node_lock);
+            _net_failed = true;
+            _node_cond.notify_all();
+        }
+    }).detach();
+}
+
+/** Wait for the network, at most until ZTS_PRELOAD_TIMEOUT after start-up. True if it is usable */
+bool wait_ready(std::unique_lock<std::mutex>& l)
+{
+    if (! _net_id || getpid() != _owner_pid) {
+        return false;
+    }
+    _node_cond.wait_until(l, _deadline, []() { return _net_ready || _net_failed; });
+    return _net_ready;
+}
+
+/** Whether a connection to, or listener on, this address should go over ZeroTier */
+bool routed(const struct sockaddr* sa, bool local)
+{
+    if (! _net_id || (sa->sa_family != AF_INET && sa->sa_family != AF_INET6)) {
+        return false;
+    }
+    std::unique_lock<std::mutex> l(_node_lock);
+    if (local && is_wildcard(sa)) {
+        return _bind_any && wait_ready(l);
+    }
+    if (! _static_routes && ! wait_ready(l)) {
+        return false;
+    }
+    for (size_t i = 0; i < _routes.size(); i++) {
+        if (prefix_contains(_routes[i], sa)) {
+            return ! _static_routes || wait_ready(l);
+        }
+    }
+    return false;
+}
+
+//----------------------------------------------------------------------------//
+// Taking over application descriptors                                        //
+//----------------------------------------------------------------------------//
+
+/** Replace fd with `replacement`, keeping its number and O_NONBLOCK/FD_CLOEXEC flags */
+int replace_fd(int fd, int replacement)
+{
+    int fl = fcntl(fd, F_GETFL);
+    int fdfl = fcntl(fd, F_GETFD);
+    if (fl < 0 || fdfl < 0) {
+        return -1;
+    }
+    if (dup3(replacement, fd, (fdfl & FD_CLOEXEC) ? O_CLOEXEC : 0) < 0) {
+        return -1;
+    }
+    REAL(close)(replacement);
+    return fcntl(fd, F_SETFL, (fcntl(fd, F_GETFL) & ~O_NONBLOCK) | (fl & O_NONBLOCK));
+}
+
+int zt_socket(int family)
+{
+    int zfd = zts_bsd_socket(family == AF_INET6 ? ZTS_AF_INET6 : ZTS_AF_INET, ZTS_SOCK_STREAM, 0);
+    if (zfd < 0) {
+        errno = zts_errno ? zts_errno : ENETDOWN;
+        return -1;
+    }
+    zts_set_blocking(zfd, 0);
+    return zfd;
+}
+
+int zt_connect(int fd, const struct sockaddr* addr, socklen_t addrlen)
+{
+    if (fd >= ZTS_PRELOAD_MAX_FDS || _relay.start() < 0) {
+        errno = ENETUNREACH;
+        return -1;
+    }
+    bool nonblocking = (fcntl(fd, F_GETFL) & O_NONBLOCK) != 0;
+    struct zts_sockaddr_storage remote;
+    zts_socklen_t remote_len = 0;
+    if (! to_zts(addr, addrlen, &remote, &remote_len)) {
+        errno = EAFNOSUPPORT;
+        return -1;
+    }
+    int zfd = zt_socket(addr->sa_family);
+    if (zfd < 0) {
+        return -1;
+    }
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) < 0) {
+        zts_bsd_close(zfd);
+        return -1;
+    }
+    // Fill the application's (shrunk) send buffer so that it only turns writable once the
+    // relay, having connected, drains it
+    int app_sndbuf = 0;
+    socklen_t optlen = sizeof(app_sndbuf);
+    REAL(getsockopt)(sv[0], SOL_SOCKET, SO_SNDBUF, &app_sndbuf, &optlen);
+    app_sndbuf /= 2;   // The kernel reports twice what was set
+    int small = 1;
+    REAL(setsockopt)(sv[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+    static const char zeros[1024] = { 0 };
+    size_t filler = 0;
+    for (;;) {
+        ssize_t n = send(sv[0], zeros, sizeof(zeros), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n <= 0) {
+            break;
+        }
+        filler += (size_t)n;
+    }
+    Shared* shared = new Shared();
+    shared->state = CONN_CONNECTING;
+    shared->peer_len = addrlen < sizeof(shared->peer) ? addrlen : sizeof(shared->peer);
+    memcpy(&shared->peer, addr, shared->peer_len);
+    Conn* c = Relay::new_conn(zfd, sv[1], shared);
+    c->app_dup = fcntl(sv[0], F_DUPFD_CLOEXEC, 0);
+    c->app_sndbuf = app_sndbuf;
+    c->filler = filler;
+    c->remote = remote;
+    c->remote_len = remote_len;
+    c->connecting = true;
+    if (replace_fd(fd, sv[0]) < 0) {
+        int err = errno;
+        REAL(close)(sv[0]);
+        REAL(close)(c->app_dup);
+        REAL(close)(sv[1]);
+        zts_bsd_close(zfd);
+        shared->release();
+        delete c;
+        errno = err;
+        return -1;
+    }
+    shared->retain();
+    install(fd, ENTRY_CONN, addr->sa_family, shared);
+    _relay.submit(c);
+    if (nonblocking) {
+        errno = EINPROGRESS;
+        return -1;
+    }
+    std::unique_lock<std::mutex> l(shared->lock);
+    shared->cond.wait(l, [shared]() { return shared->state != CONN_CONNECTING; });
+    if (shared->state == CONN_FAILED) {
+        errno = shared->error;
+        shared->error = 0;
+        return -1;
+    }
+    return 0;
+}
+
+int zt_listen(int fd, Entry* e, int backlog)
+{
+    if (_relay.start() < 0) {
+        errno = ENETDOWN;
+        return -1;
+    }
+    Shared* shared = e->shared;
+    struct zts_sockaddr_storage local;
+    zts_socklen_t local_len = 0;
+    if (! to_zts((struct sockaddr*)&shared->local, shared->local_len, &local, &local_len)) {
+        errno = EAFNOSUPPORT;
+        return -1;
+    }
+    int zfd = zt_socket(e->family);
+    if (zfd < 0) {
+        return -1;
+    }
+    int one = 1;
+    zts_bsd_setsockopt(zfd, ZTS_SOL_SOCKET, ZTS_SO_REUSEADDR, &one, sizeof(one));
+    if (zts_bsd_bind(zfd, (struct zts_sockaddr*)&local, local_len) < 0
+        || zts_bsd_listen(zfd, backlog) < 0) {
+        errno = zts_errno;
+        zts_bsd_close(zfd);
+        return -1;
+    }
+    zts_socklen_t bound_len = sizeof(local);
+    if (zts_bsd_getsockname(zfd, (struct zts_sockaddr*)&local, &bound_len) == 0) {
+        std::lock_guard<std::mutex> l(shared->lock);
+        shared->local_len = from_zts(&local, &shared->local);
+    }
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) < 0) {
+        zts_bsd_close(zfd);
+        return -1;
+    }
+    if (replace_fd(fd, sv[0]) < 0) {
+        int err = errno;
+        REAL(close)(sv[0]);
+        REAL(close)(sv[1]);
+        zts_bsd_close(zfd);
+        errno = err;
+        return -1;
+    }
+    {
+        std::lock_guard<std::mutex> l(shared->lock);
+        shared->zfd = zfd;
+    }
+    Listener* li = new Listener();
+    li->type = HANDLE_LISTENER;
+    li->shared = shared;
+    li->zfd = zfd;
+    li->b = sv[1];
+    li->family = e->family;
+    li->b_events = 0;
+    li->z_events = 0;
+    shared->retain();
+    e->kind = ENTRY_LISTENER;
+    _relay.submit(li);
+    return 0;
+}
+
+int zt_accept(int fd, Entry* e, struct sockaddr* addr, socklen_t* addrlen, int flags)
+{
+    AcceptMsg msg;
+    struct iovec iov;
+    iov.iov_base = &msg;
+    iov.iov_len = sizeof(msg);
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = control;
+    mh.msg_controllen = sizeof(control);
+    // Blocks (or not) exactly as the listening descriptor does
+    ssize_t n = recvmsg(fd, &mh, MSG_CMSG_CLOEXEC);
+    if (n < 0) {
+        return -1;
+    }
+    struct cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+    if (n != sizeof(msg) || ! cm || cm->cmsg_type != SCM_RIGHTS) {
+        errno = ECONNABORTED;
+        return -1;
+    }
+    int newfd;
+    memcpy(&newfd, CMSG_DATA(cm), sizeof(int));
+    if (! (flags & SOCK_CLOEXEC)) {
+        fcntl(newfd, F_SETFD, 0);
+    }
+    fcntl(newfd, F_SETFL, (fcntl(newfd, F_GETFL) & ~O_NONBLOCK) | ((flags & SOCK_NONBLOCK) ? O_NONBLOCK : 0));
+    if (newfd < ZTS_PRELOAD_MAX_FDS) {
+        Shared* shared = new Shared();
+        shared->local = msg.local;
+        shared->local_len = msg.local_len;
+        shared->peer = msg.peer;
+        shared->peer_len = msg.peer_len;
+        install(newfd, ENTRY_CONN, e->family, shared);
+    }
+    copy_out(&msg.peer, msg.peer_len, addr, addrlen);
+    return newfd;
+}
+
+}   // namespace
+
+//----------------------------------------------------------------------------//
+// Interposed functions                                                       //
+//----------------------------------------------------------------------------//
+
+ZTS_PRELOAD_EXPORT int connect(int fd, const struct sockaddr* addr, socklen_t addrlen)
+{
+    Entry* e = lookup(fd);
+    if (e) {
+        EntryRef ref(e);
+        std::lock_guard<std::mutex> l(e->shared->lock);
+        errno = e->kind != ENTRY_CONN ? EOPNOTSUPP : e->shared->state == CONN_CONNECTING ? EALREADY : EISCONN;
+        return -1;
+    }
+    if (addr && _net_id && socket_type(fd) == SOCK_STREAM && routed(addr, false)) {
+        return zt_connect(fd, addr, addrlen);
+    }
+    return REAL(connect)(fd, addr, addrlen);
+}
+
+ZTS_PRELOAD_EXPORT int bind(int fd, const struct sockaddr* addr, socklen_t addrlen)
+{
+    if (addr && _net_id && fd < ZTS_PRELOAD_MAX_FDS && socket_type(fd) == SOCK_STREAM && routed(addr, true)) {
+        // Nothing is created until listen(), remember where to listen
+        Shared* shared = new Shared();
+        shared->local_len = addrlen < sizeof(shared->local) ? addrlen : sizeof(shared->local);
+        memcpy(&shared->local, addr, shared->local_len);
+        install(fd, ENTRY_BOUND, addr->sa_family, shared);
+        return 0;
+    }
+    return REAL(bind)(fd, addr, addrlen);
+}
+
+ZTS_PRELOAD_EXPORT int listen(int fd, int backlog)
+{
+    Entry* e = lookup(fd);
+    if (! e) {
+        return REAL(listen)(fd, backlog);
+    }
+    EntryRef ref(e);
+    if (e->kind == ENTRY_LISTENER) {
+        return 0;
+    }
+    if (e->kind != ENTRY_BOUND) {
+        errno = EINVAL;
+        return -1;
+    }
+    return zt_listen(fd, e, backlog);
+}
+
+ZTS_PRELOAD_EXPORT int accept4(int fd, struct sockaddr* addr, socklen_t* addrlen, int flags)
+{
+    Entry* e = lookup(fd);
+    if (! e) {
+        return REAL(accept4)(fd, addr, addrlen, flags);
+    }
+    EntryRef ref(e);
+    if (e->kind != ENTRY_LISTENER) {
+        errno = EINVAL;
+        return -1;
+    }
+    return zt_accept(fd, e, addr, addrlen, flags);
+}
+
+ZTS_PRELOAD_EXPORT int accept(int fd, struct sockaddr* addr, socklen_t* addrlen)
+{
+    Entry* e = lookup(fd);
+    if (! e) {
+        return REAL(accept)(fd, addr, addrlen);
+    }
+    EntryRef ref(e);
+    if (e->kind != ENTRY_LISTENER) {
+        errno = EINVAL;
+        return -1;
+    }
+    return zt_accept(fd, e, addr, addrlen, 0);
+}
+
+ZTS_PRELOAD_EXPORT int close(int fd)
+{
+    uninstall(fd);
+    return REAL(close)(fd);
+}
+
+ZTS_PRELOAD_EXPORT int getsockname(int fd, struct sockaddr* addr, socklen_t* addrlen)
+{
+    Entry* e = lookup(fd);
+    if (! e) {
+        return REAL(getsockname)(fd, addr, addrlen);
+    }
+    EntryRef ref(e);
+    std::lock_guard<std::mutex> l(e->shared->lock);
+    copy_out(&e->shared->local, e->shared->local_len, addr, addrlen);
+    return 0;
+}
+
+ZTS_PRELOAD_EXPORT int getpeername(int fd, struct sockaddr* addr, socklen_t* addrlen)
+{
+    Entry* e = lookup(fd);
+    if (! e) {
+        return REAL(getpeername)(fd, addr, addrlen);
+    }
+    EntryRef ref(e);
+    std::lock_guard<std::mutex> l(e->shared->lock);
+    if (e->kind != ENTRY_CONN || e->shared->state != CONN_CONNECTED) {
+        errno = ENOTCONN;
+        return -1;
+    }
+    copy_out(&e->shared->peer, e->shared->peer_len, addr, addrlen);
+    return 0;
+}
+
+ZTS_PRELOAD_EXPORT int getsockopt(int fd, int level, int optname, void* optval, socklen_t* optlen)
+{
+    Entry* e = lookup(fd);
+    if (! e) {
+        return REAL(getsockopt)(fd, level, optname, optval, optlen);
+    }
+    EntryRef ref(e);
+    if (level == SOL_SOCKET && optval && optlen && *optlen >= sizeof(int)) {
+        int value = -1;
+        std::lock_guard<std::mutex> l(e->shared->lock);
+        switch (optname) {
+            case SO_ERROR:
+                value = e->shared->error;
+                e->shared->error = 0;
+                break;
+            case SO_TYPE:
+                value = SOCK_STREAM;
+                break;
+            case SO_DOMAIN:
+                value = e->family;
+                break;
+            case SO_PROTOCOL:
+                value = IPPROTO_TCP;
+                break;
+            case SO_ACCEPTCONN:
+                value = e->kind == ENTRY_LISTENER;
+                break;
+        }
+        if (value >= 0) {
+            memcpy(optval, &value, sizeof(int));
+            *optlen = sizeof(int);
+            return 0;
+        }
+    }
+    if (level == IPPROTO_TCP && optval && optlen && *optlen >= sizeof(int)) {
+        int zfd;
+        {
+            std::lock_guard<std::mutex> l(e->shared->lock);
+            zfd = e->shared->zfd;
+        }
+        zts_socklen_t zlen = sizeof(int);
+        if (zfd >= 0 && zts_bsd_getsockopt(zfd, ZTS_IPPROTO_TCP, optname, optval, &zlen) == 0) {
+            *optlen = zlen;
+            return 0;
+        }
+        memset(optval, 0, sizeof(int));
+        *optlen = sizeof(int);
+        return 0;
+    }
+    return REAL(getsockopt)(fd, level, optname, optval, optlen);
+}
+
+ZTS_PRELOAD_EXPORT int setsockopt(int fd, int level, int optname, const void* optval, socklen_t optlen)
+{
+    Entry* e = lookup(fd);
+    if (! e) {
+        return REAL(setsockopt)(fd, level, optname, optval, optlen);
+    }
+    EntryRef ref(e);
+    int zfd;
+    {
+        std::lock_guard<std::mutex> l(e->shared->lock);
+        zfd = e->shared->zfd;
+    }
+    // TCP options apply to the ZeroTier socket, AF_UNIX would reject them
+    if (level == IPPROTO_TCP) {
+        if (zfd >= 0) {
+            zts_bsd_setsockopt(zfd, ZTS_IPPROTO_TCP, optname, optval, optlen);
+        }
+        return 0;
+    }
+    if (level == SOL_SOCKET && optname == SO_KEEPALIVE && zfd >= 0) {
+        zts_bsd_setsockopt(zfd, ZTS_SOL_SOCKET, ZTS_SO_KEEPALIVE, optval, optlen);
+    }
+    if (e->kind == ENTRY_BOUND) {
+        return REAL(setsockopt)(fd, level, optname, optval, optlen);
+    }
+    // Options meaningless for AF_UNIX are accepted and ignored
+    REAL(setsockopt)(fd, level, optname, optval, optlen);
+    return 0;
+}
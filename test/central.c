@@ -0,0 +1,223 @@
+/**
+ * Central API client against a local mock HTTP server
+ *
+ * Serves HTTP/1.1 with keep-alive on 127.0.0.1 and answers every request with
+ * 200 after REPLY_DELAY_MS. Checks that consecutive single requests share one
+ * connection, and that a batch of member updates reaches every member with at
+ * most the configured number of requests in flight over reused connections.
+ * Prints member updates per second for single requests and for the batch.
+ * Needs no network. Exits with 77 (skipped) while the Central API is compiled
+ * out, see ZTS_DISABLE_CENTRAL_API in ZeroTierSockets.h.
+ */
+
+#include "node.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#ifndef ZTS_DISABLE_CENTRAL_API
+
+#define NET_ID         0x8056c2e21c000001ULL
+#define TOKEN          "mocktoken"
+#define SINGLE_COUNT   50
+#define BATCH_COUNT    500
+#define CONCURRENCY    8
+#define REPLY_DELAY_MS 5
+
+static pthread_mutex_t m = PTHREAD_MUTEX_INITIALIZER;
+static int connections = 0;
+static int requests = 0;
+static int in_flight = 0;
+static int max_in_flight = 0;
+static int bad_requests = 0;
+static unsigned char seen[BATCH_COUNT + 1];
+
+static void count(int* counter, int delta)
+{
+    pthread_mutex_lock(&m);
+    *counter += delta;
+    if (counter == &in_flight && in_flight > max_in_flight) {
+        max_in_flight = in_flight;
+    }
+    pthread_mutex_unlock(&m);
+}
+
+// Check and record one request. Member IDs of the test are 1 to BATCH_COUNT
+static void check_request(const char* head)
+{
+    char route[64];
+    unsigned long long node_id = 0;
+    snprintf(route, sizeof(route), "POST /api/network/%llx/member/", (unsigned long long)NET_ID);
+    pthread_mutex_lock(&m);
+    requests++;
+    if (strncmp(head, route, strlen(route)) || ! strstr(head, "Authorization: Bearer " TOKEN "\r\n")
+        || (node_id = strtoull(head + strlen(route), NULL, 16)) == 0 || node_id > BATCH_COUNT) {
+        bad_requests++;
+    }
+    else {
+        seen[node_id]++;
+    }
+    pthread_mutex_unlock(&m);
+}
+
+// Serve requests on one connection until the client closes it
+static void* serve_connection(void* arg)
+{
+    static const char reply[] = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 2\r\n\r\n{}";
+    char buf[8192];
+    size_t len = 0;
+    int fd = (int)(intptr_t)arg;
+    for (;;) {
+        char* end;
+        while (! (end = strstr(buf, "\r\n\r\n"))) {
+            ssize_t n = len < sizeof(buf) - 1 ? recv(fd, buf + len, sizeof(buf) - 1 - len, 0) : -1;
+            if (n <= 0) {
+                close(fd);
+                return NULL;
+            }
+            len += n;
+            buf[len] = 0;
+        }
+        const char* cl = strstr(buf, "Content-Length: ");
+        size_t total = (end + 4 - buf) + (cl && cl < end ? strtoul(cl + 16, NULL, 10) : 0);
+        while (len < total) {
+            ssize_t n = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+            if (n <= 0) {
+                close(fd);
+                return NULL;
+            }
+            len += n;
+            buf[len] = 0;
+        }
+        count(&in_flight, 1);
+        check_request(buf);
+        zts_util_delay(REPLY_DELAY_MS);
+        count(&in_flight, -1);
+        if (send(fd, reply, sizeof(reply) - 1, MSG_NOSIGNAL) < 0) {
+            close(fd);
+            return NULL;
+        }
+        memmove(buf, buf + total, len - total);
+        len -= total;
+        buf[len] = 0;
+    }
+}
+
+static void* serve(void* arg)
+{
+    int lfd = (int)(intptr_t)arg;
+    for (;;) {
+        pthread_t t;
+        int fd = accept(lfd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        count(&connections, 1);
+        pthread_create(&t, NULL, serve_connection, (void*)(intptr_t)fd);
+        pthread_detach(t);
+    }
+    return NULL;
+}
+
+static int start_server()
+{
+    struct sockaddr_in in4;
+    socklen_t len = sizeof(in4);
+    pthread_t t;
+    memset(&in4, 0, sizeof(in4));
+    in4.sin_family = AF_INET;
+    in4.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&in4, sizeof(in4)) < 0 || listen(fd, 64) < 0
+        || getsockname(fd, (struct sockaddr*)&in4, &len) < 0) {
+        return -1;
+    }
+    pthread_create(&t, NULL, serve, (void*)(intptr_t)fd);
+    pthread_detach(t);
+    return ntohs(in4.sin_port);
+}
+
+static void reset_counters()
+{
+    pthread_mutex_lock(&m);
+    connections = requests = max_in_flight = bad_requests = 0;
+    memset(seen, 0, sizeof(seen));
+    pthread_mutex_unlock(&m);
+}
+
+int main()
+{
+    static char resp[4096];
+    static int codes[BATCH_COUNT];
+    static uint64_t ids[BATCH_COUNT];
+    char url[64];
+    int port = start_server();
+    if (port < 0) {
+        return 1;
+    }
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d", port);
+    CHECK(zts_central_init(url, TOKEN, resp, sizeof(resp)) == ZTS_ERR_OK);
+
+    // Read-only by default, so nothing is sent
+    CHECK(zts_central_node_auth_batch(codes, NET_ID, ids, 1, 1) == ZTS_ERR_ARG);
+    ids[0] = 1;
+    CHECK(zts_central_node_auth_batch(codes, NET_ID, ids, 1, 1) == ZTS_ERR_SERVICE);
+    CHECK(requests == 0);
+    CHECK(zts_central_set_access_mode(ZTS_CENTRAL_READ | ZTS_CENTRAL_WRITE) == ZTS_ERR_OK);
+
+    // Single requests reuse one connection
+    double start = now_ms();
+    for (int i = 1; i <= SINGLE_COUNT; i++) {
+        int code = 0;
+        CHECK(zts_central_node_auth(&code, NET_ID, i, 1) == ZTS_ERR_OK);
+        CHECK(code == 200);
+    }
+    double elapsed = now_ms() - start;
+    printf("single: %d updates in %.0f ms, %.0f/s\n", SINGLE_COUNT, elapsed, SINGLE_COUNT / (elapsed / 1000.0));
+    CHECK(connections == 1);
+    CHECK(requests == SINGLE_COUNT);
+    CHECK(bad_requests == 0);
+
+    reset_counters();
+    for (int i = 0; i < BATCH_COUNT; i++) {
+        ids[i] = i + 1;
+        codes[i] = -1;
+    }
+    CHECK(zts_central_set_concurrency(CONCURRENCY) == ZTS_ERR_OK);
+    start = now_ms();
+    CHECK(zts_central_node_auth_batch(codes, NET_ID, ids, BATCH_COUNT, 1) == BATCH_COUNT);
+    elapsed = now_ms() - start;
+    printf(
+        "batch:  %d updates in %.0f ms, %.0f/s, %d connections, at most %d in flight\n",
+        BATCH_COUNT,
+        elapsed,
+        BATCH_COUNT / (elapsed / 1000.0),
+        connections,
+        max_in_flight);
+    for (int i = 0; i < BATCH_COUNT; i++) {
+        CHECK(codes[i] == 200);
+        CHECK(seen[i + 1] == 1);
+    }
+    CHECK(requests == BATCH_COUNT);
+    CHECK(bad_requests == 0);
+    CHECK(max_in_flight > 1);
+    CHECK(max_in_flight <= CONCURRENCY);
+    CHECK(connections <= CONCURRENCY);
+
+    zts_central_cleanup();
+    return test_result();
+}
+
+#else
+
+int main()
+{
+    printf("Central API compiled out, skipping\n");
+    return SKIPPED;
+}
+
+#endif
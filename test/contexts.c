@@ -0,0 +1,111 @@
+/**
+ * Cost of running several nodes in one process with node contexts
+ *
+ * Starts the given number of contexts, each with its own identity under
+ * <storage_dir>, joins all of them to the same ad-hoc network and waits until
+ * each has an address. Then prints the time that took and the growth of
+ * resident memory and of the thread count, read from /proc/self/status (Linux
+ * only). Run once per instance count, since freed memory is not necessarily
+ * returned to the OS:
+ *
+ *     contexts <storage_dir> 1
+ *     contexts <storage_dir> 10
+ *     contexts <storage_dir> 100
+ *
+ * An ad-hoc network needs no controller, but each node still contacts the
+ * roots to come online.
+ */
+
+#include "ZeroTierSockets.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define PORT_BASE 20000
+
+static long status_field(const char* name)
+{
+    char line[256];
+    long value = -1;
+    size_t len = strlen(name);
+    FILE* f = fopen("/proc/self/status", "r");
+    if (! f) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, name, len) == 0 && line[len] == ':') {
+            value = strtol(line + len + 1, NULL, 10);
+            break;
+        }
+    }
+    fclose(f);
+    return value;
+}
+
+static double now_ms()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <storage_dir> <count>\n", argv[0]);
+        return 1;
+    }
+    int count = atoi(argv[2]);
+    if (count < 1) {
+        return 1;
+    }
+    zts_ctx_t** ctx = (zts_ctx_t**)calloc(count, sizeof(zts_ctx_t*));
+    uint64_t net_id = zts_net_compute_adhoc_id(9000, 9000);
+    long rss = status_field("VmRSS");
+    long threads = status_field("Threads");
+    double start = now_ms();
+
+    for (int i = 0; i < count; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%d", argv[1], i);
+        ctx[i] = zts_ctx_new();
+        if (zts_ctx_init_from_storage(ctx[i], path) != ZTS_ERR_OK
+            || zts_ctx_init_set_port(ctx[i], PORT_BASE + i) != ZTS_ERR_OK
+            || zts_ctx_node_start(ctx[i]) != ZTS_ERR_OK) {
+            fprintf(stderr, "failed to start node %d\n", i);
+            return 1;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        while (! zts_ctx_node_is_online(ctx[i])) {
+            zts_util_delay(50);
+        }
+        zts_ctx_net_join(ctx[i], net_id);
+    }
+    for (int i = 0; i < count; i++) {
+        while (! zts_ctx_net_transport_is_ready(ctx[i], net_id)) {
+            zts_util_delay(50);
+        }
+    }
+
+    double elapsed = now_ms() - start;
+    long rss_growth = status_field("VmRSS") - rss;
+    long thread_growth = status_field("Threads") - threads;
+    printf(
+        "%d contexts: ready in %.0f ms, RSS +%ld kB (%.0f kB each), threads +%ld (%.1f each)\n",
+        count,
+        elapsed,
+        rss_growth,
+        (double)rss_growth / count,
+        thread_growth,
+        (double)thread_growth / count);
+
+    for (int i = 0; i < count; i++) {
+        zts_ctx_node_free(ctx[i]);
+        zts_ctx_free(ctx[i]);
+    }
+    free(ctx);
+    return 0;
+}
@@ -0,0 +1,200 @@
+/**
+ * Coroutine layer against the blocking API: many connections doing round trips
+ *
+ * Forks an echo server built on zt::acceptor and zt::scheduler, then opens
+ * <connections> TCP connections to it twice: once with one thread per
+ * connection using the blocking API, and once as coroutines on a single
+ * zt::scheduler. Each connection does ROUND_TRIPS echoes of MSG_LEN bytes and
+ * checks what comes back. Prints the time each run took and its round trips
+ * per second:
+ *
+ *     coroutines <storage_dir> 1000
+ *
+ * Each process can have at most MEMP_NUM_NETCONN (1024) sockets, so 10k
+ * connections need a build with a larger pool in lwipopts.h. Both nodes
+ * contact the roots to come online.
+ */
+
+#include "ZeroTierCoroutines.hpp"
+#include "node.h"
+
+#include <atomic>
+#include <signal.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define TCP_PORT    8000
+#define ROUND_TRIPS 100
+#define MSG_LEN     64
+
+static uint64_t net_id;
+
+static zt::task<void> echo(zt::socket s)
+{
+    char buf[MSG_LEN * 4];
+    ssize_t n;
+    while ((n = co_await s.async_read(buf, sizeof(buf))) > 0) {
+        if (co_await s.async_write(buf, n) < 0) {
+            break;
+        }
+    }
+}
+
+static zt::task<void> serve(zt::scheduler& sched, zt::acceptor& a)
+{
+    for (;;) {
+        zt::socket s(sched);
+        if (co_await a.async_accept(s) < 0) {
+            co_return;
+        }
+        sched.spawn(echo(std::move(s)));
+    }
+}
+
+// Runs in the child: echo until killed
+static int run_server(int out, void* arg)
+{
+    std::string path = std::string((const char*)arg) + "/server";
+    int err = start_node(path.c_str(), 0, net_id);
+    if (err) {
+        return err;
+    }
+    zt::scheduler sched;
+    zt::acceptor a(sched);
+    if (sched.open() < 0 || a.listen(ZTS_AF_INET6, "::", TCP_PORT, 1024) < 0) {
+        return 1;
+    }
+    char addr[ZTS_IP_MAX_STR_LEN] = { 0 };
+    zts_addr_get_str(net_id, ZTS_AF_INET6, addr, ZTS_IP_MAX_STR_LEN);
+    if (write(out, addr, sizeof(addr)) != sizeof(addr)) {
+        return 1;
+    }
+    sched.spawn(serve(sched, a));
+    sched.run();
+    return 0;
+}
+
+static void fill(char* buf, int id, int i)
+{
+    memset(buf, (char)(id + i), MSG_LEN);
+}
+
+static bool blocking_client(const char* addr, int id)
+{
+    char out[MSG_LEN], in[MSG_LEN];
+    struct zts_sockaddr_storage ss;
+    zts_socklen_t len = sizeof(ss);
+    zts_util_ipstr_to_saddr(addr, TCP_PORT, (struct zts_sockaddr*)&ss, &len);
+    // zts_connect() would add a fixed delay to every attempt
+    int fd = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_STREAM, 0);
+    bool ok = fd >= 0 && zts_bsd_connect(fd, (struct zts_sockaddr*)&ss, len) == ZTS_ERR_OK;
+    for (int i = 0; ok && i < ROUND_TRIPS; i++) {
+        fill(out, id, i);
+        ok = zts_bsd_send(fd, out, MSG_LEN, 0) == MSG_LEN;
+        for (int got = 0; ok && got < MSG_LEN;) {
+            ssize_t n = zts_bsd_recv(fd, in + got, MSG_LEN - got, 0);
+            ok = n > 0;
+            got += n;
+        }
+        ok = ok && ! memcmp(in, out, MSG_LEN);
+    }
+    if (fd >= 0) {
+        zts_bsd_close(fd);
+    }
+    return ok;
+}
+
+static zt::task<void> coroutine_client(zt::scheduler& sched, const zt::endpoint& server, int id, int* passed)
+{
+    char out[MSG_LEN], in[MSG_LEN];
+    zt::socket s(sched);
+    if (co_await s.async_connect(server) < 0) {
+        co_return;
+    }
+    for (int i = 0; i < ROUND_TRIPS; i++) {
+        fill(out, id, i);
+        if (co_await s.async_write(out, MSG_LEN) < 0) {
+            co_return;
+        }
+        for (int got = 0; got < MSG_LEN;) {
+            ssize_t n = co_await s.async_read(in + got, MSG_LEN - got);
+            if (n <= 0) {
+                co_return;
+            }
+            got += n;
+        }
+        if (memcmp(in, out, MSG_LEN)) {
+            co_return;
+        }
+    }
+    (*passed)++;
+}
+
+static void report(const char* mode, int count, int passed, double elapsed)
+{
+    printf(
+        "%-10s %d connections: %.0f ms, %.0f round trips/s, %d failed\n",
+        mode,
+        count,
+        elapsed,
+        (double)passed * ROUND_TRIPS / (elapsed / 1000.0),
+        count - passed);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3 || atoi(argv[2]) < 1) {
+        fprintf(stderr, "usage: %s <storage_dir> <connections>\n", argv[0]);
+        return 1;
+    }
+    int count = atoi(argv[2]);
+    net_id = zts_net_compute_adhoc_id(TCP_PORT, TCP_PORT);
+    int fd = -1;
+    pid_t pid = fork_peer(run_server, argv[1], &fd);
+    if (pid < 0) {
+        return 1;
+    }
+    std::string path = std::string(argv[1]) + "/client";
+    char addr[ZTS_IP_MAX_STR_LEN];
+    if (start_node(path.c_str(), 0, net_id) != 0 || read(fd, addr, sizeof(addr)) != sizeof(addr)) {
+        fprintf(stderr, "nodes did not come online\n");
+        kill(pid, SIGTERM);
+        wait_peer(pid);
+        return 1;
+    }
+
+    std::atomic<int> blocking_passed(0);
+    double start = now_ms();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < count; i++) {
+        threads.emplace_back([&, i] {
+            if (blocking_client(addr, i)) {
+                blocking_passed++;
+            }
+        });
+    }
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    report("blocking", count, blocking_passed, now_ms() - start);
+
+    int coroutine_passed = 0;
+    zt::scheduler sched;
+    zt::endpoint server;
+    CHECK(sched.open() == ZTS_ERR_OK);
+    CHECK(server.assign(addr, TCP_PORT) == ZTS_ERR_OK);
+    start = now_ms();
+    for (int i = 0; i < count; i++) {
+        sched.spawn(coroutine_client(sched, server, i, &coroutine_passed));
+    }
+    CHECK(sched.run() == ZTS_ERR_OK);
+    report("coroutine", count, coroutine_passed, now_ms() - start);
+
+    CHECK(blocking_passed == count);
+    CHECK(coroutine_passed == count);
+    kill(pid, SIGTERM);
+    wait_peer(pid);
+    zts_node_free();
+    return test_result();
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * Smoke test of the C# bindings without a network
+ *
+ * Starts a node that joins no network and uses sockets the way an application
+ * would before any peer is reachable: Span and offset overloads, and pending
+ * asynchronous operations that are cancelled or fail through the shared poller.
+ * Checks that events reach both the raw and the managed handler. If the node
+ * comes online it also joins an ad-hoc network and checks the network state
+ * built from address and network events, otherwise that part is skipped.
+ */
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Net;
+using System.Net.Sockets;
+using System.Runtime.CompilerServices;
+using System.Threading;
+using System.Threading.Tasks;
+
+using ZeroTier;
+using ZeroTier.Core;
+
+using Socket = ZeroTier.Sockets.Socket;
+using SocketException = ZeroTier.Sockets.SocketException;
+
+public class Smoke {
+    const int WaitSeconds = 60;
+    const int UdpPort = 9000;
+    const int TcpPort = 8000;
+
+    static int _failures = 0;
+
+    static readonly object _eventsLock = new object();
+    static ulong _nodeUpId = 0;
+    static bool _online = false;
+    static NetworkInfo _addressEventNetwork = null;
+    static List<string> _eventNames = new List<string>();
+
+    static void Check(bool condition, string what, [CallerLineNumber] int line = 0)
+    {
+        if (! condition) {
+            Console.Error.WriteLine("Smoke.cs:" + line + ": check failed: " + what);
+            _failures++;
+        }
+    }
+
+    /// <summary>Run an operation that must fail with an exception of type T</summary>
+    static async Task CheckThrows<T>(Func<Task> operation, string what, [CallerLineNumber] int line = 0)
+        where T : Exception
+    {
+        try {
+            await operation();
+            Check(false, what + " did not throw", line);
+        }
+        catch (T) {
+        }
+        catch (Exception e) {
+            Check(false, what + " threw " + e.GetType().Name, line);
+        }
+    }
+
+    static void OnRawEvent(ref EventData data)
+    {
+        lock (_eventsLock) {
+            if (data.Code == Constants.EVENT_NODE_UP) {
+                _nodeUpId = data.Id;
+            }
+            if (data.Code == Constants.EVENT_NODE_ONLINE) {
+                _online = true;
+            }
+            if (data.Code == Constants.EVENT_ADDR_ADDED_IP4) {
+                _addressEventNetwork = data.Network;
+            }
+        }
+    }
+
+    static void OnEvent(Event nodeEvent)
+    {
+        lock (_eventsLock) {
+            _eventNames.Add(nodeEvent.Name);
+        }
+    }
+
+    /// <summary>Wait until condition holds, checked under the events lock</summary>
+    static bool WaitFor(Func<bool> condition)
+    {
+        for (int i = 0; i < WaitSeconds * 10; i++) {
+            lock (_eventsLock) {
+                if (condition()) {
+                    return true;
+                }
+            }
+            Thread.Sleep(100);
+        }
+        return false;
+    }
+
+    static void TestNodeEvents(Node node)
+    {
+        Check(WaitFor(() => _nodeUpId != 0), "EVENT_NODE_UP reached the raw handler");
+        Check(_nodeUpId == node.Id, "raw event carries the node ID");
+        Check(WaitFor(() => _eventNames.Contains("EVENT_NODE_UP")), "EVENT_NODE_UP reached the managed handler");
+    }
+
+    static void TestNetwork(Node node)
+    {
+        if (! WaitFor(() => _online)) {
+            Console.WriteLine("skipped network checks: node did not come online");
+            return;
+        }
+        ulong networkId = Node.zts_net_compute_adhoc_id(UdpPort, UdpPort);
+        Check(node.Join(networkId) == Constants.ERR_OK, "Join");
+        Check(WaitFor(() => node.IsNetworkTransportReady(networkId)), "network transport ready");
+        // Addresses come from EVENT_ADDR_* deltas, routes from the network config
+        Check(node.GetNetworkAddresses(networkId).Count > 0, "network has addresses");
+        Check(node.GetNetworkRoutes(networkId).Count > 0, "network has routes");
+        Check(WaitFor(() => _addressEventNetwork != null), "EVENT_ADDR_ADDED_IP4 carries its network");
+        Check(_addressEventNetwork != null && _addressEventNetwork.Id == networkId, "address event network ID");
+        Check(node.Leave(networkId) == Constants.ERR_OK, "Leave");
+        Check(node.GetNetworkAddresses(networkId).Count == 0, "no addresses after Leave");
+    }
+
+    static void TestArguments()
+    {
+        Socket socket = new Socket(AddressFamily.InterNetwork, SocketType.Dgram, ProtocolType.Udp);
+        byte[] buffer = new byte[16];
+        try {
+            socket.Send(buffer, 8, 16);
+            Check(false, "Send past the end of the buffer");
+        }
+        catch (ArgumentOutOfRangeException) {
+        }
+        try {
+            socket.Receive(buffer, -1, 4);
+            Check(false, "Receive before the start of the buffer");
+        }
+        catch (ArgumentOutOfRangeException) {
+        }
+        socket.Close();
+        try {
+            socket.Send(new ReadOnlySpan<byte>(buffer));
+            Check(false, "Send on a closed socket");
+        }
+        catch (ObjectDisposedException) {
+        }
+    }
+
+    static async Task TestUdp()
+    {
+        Socket socket = new Socket(AddressFamily.InterNetwork, SocketType.Dgram, ProtocolType.Udp);
+        socket.Bind(new IPEndPoint(IPAddress.Any, UdpPort));
+        socket.Blocking = false;
+        byte[] buffer = new byte[64];
+        // Nothing has arrived
+        Check(socket.Receive(new Span<byte>(buffer)) < 0, "non-blocking Receive(Span)");
+        Check(Socket.ErrNo == Constants.EAGAIN, "EAGAIN after Receive(Span)");
+
+        // A pending receive waits on the poller until cancelled, and its operation is then reused
+        for (int i = 0; i < 2; i++) {
+            using (CancellationTokenSource cts = new CancellationTokenSource(200)) {
+                await CheckThrows<OperationCanceledException>(
+                    async () => await socket.ReceiveAsync(new Memory<byte>(buffer), cts.Token),
+                    "cancelled ReceiveAsync");
+            }
+        }
+        using (CancellationTokenSource cts = new CancellationTokenSource()) {
+            cts.Cancel();
+            await CheckThrows<OperationCanceledException>(
+                async () => await socket.ReceiveAsync(new Memory<byte>(buffer), cts.Token),
+                "ReceiveAsync cancelled before it started");
+        }
+        socket.Close();
+    }
+
+    static async Task TestTcp()
+    {
+        Socket listener = new Socket(AddressFamily.InterNetwork, SocketType.Stream, ProtocolType.Tcp);
+        listener.Bind(new IPEndPoint(IPAddress.Any, TcpPort));
+        listener.Listen(1);
+        using (CancellationTokenSource cts = new CancellationTokenSource(200)) {
+            await CheckThrows<OperationCanceledException>(
+                async () => await listener.AcceptAsync(cts.Token),
+                "cancelled AcceptAsync");
+        }
+        listener.Close();
+
+        // Without a route the connect fails either at once or once the poller reports the socket
+        Socket socket = new Socket(AddressFamily.InterNetwork, SocketType.Stream, ProtocolType.Tcp);
+        using (CancellationTokenSource cts = new CancellationTokenSource(WaitSeconds * 1000)) {
+            await CheckThrows<SocketException>(
+                async () => await socket.ConnectAsync(new IPEndPoint(IPAddress.Parse("10.255.255.1"), 80), cts.Token),
+                "ConnectAsync without a route");
+        }
+        Check(! socket.Connected, "not connected after a failed ConnectAsync");
+        Check(socket.Blocking, "blocking again after ConnectAsync");
+        socket.Close();
+    }
+
+    public static int Main(string[] args)
+    {
+        string path = Path.Combine(Path.GetTempPath(), "libzt-csharp-" + Guid.NewGuid().ToString("N"));
+        Node node = new Node();
+        Check(node.InitFromStorage(path) == Constants.ERR_OK, "InitFromStorage");
+        Check(node.InitSetRawEventHandler(OnRawEvent) == Constants.ERR_OK, "InitSetRawEventHandler");
+        Check(node.InitSetEventHandler(OnEvent) == Constants.ERR_OK, "InitSetEventHandler");
+        Check(node.Start() == Constants.ERR_OK, "Start");
+
+        TestNodeEvents(node);
+        TestArguments();
+        TestUdp().Wait();
+        TestTcp().Wait();
+        TestNetwork(node);
+
+        node.Free();
+        if (_failures > 0) {
+            Console.Error.WriteLine(_failures + " checks failed");
+            return 1;
+        }
+        Console.WriteLine("ok");
+        return 0;
+    }
+}
@@ -0,0 +1,298 @@
+/**
+ * Full-duplex sockets under load
+ *
+ * Forks an echo node, then opens SOCKETS connections to it (or as many as
+ * given on the command line, up to about MEMP_NUM_NETCONN) and runs a reader
+ * and a writer thread on every one of them at the same time. Checks that every
+ * byte comes back in order, then blocks a reader in zts_bsd_recv() on every
+ * socket and closes the sockets from the main thread. Checks that each blocked
+ * reader returns with an error and that the closed sockets can all be opened
+ * again. Prints the aggregate echo throughput and how long the blocked readers
+ * took to return. Exits with 77 (skipped) if the nodes cannot come online,
+ * e.g. without Internet access.
+ */
+
+#include "node.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TCP_PORT         8000
+#define SOCKETS          64
+#define MAX_SOCKETS      1000
+#define BYTES_PER_SOCKET (256 * 1024)
+#define CHUNK            4096
+#define THREAD_STACK     (256 * 1024)
+
+static uint64_t net_id;
+static char storage_dir[256];
+static char server_addr[ZTS_IP_MAX_STR_LEN];
+
+static pthread_mutex_t m = PTHREAD_MUTEX_INITIALIZER;
+static int errors = 0;
+static int returned = 0;
+
+struct conn {
+    int fd;
+    int index;
+    pthread_t reader;
+    pthread_t writer;
+};
+
+// Byte at `offset` of the stream on connection `index`
+static unsigned char pattern(int index, size_t offset)
+{
+    return (unsigned char)(index * 31 + offset);
+}
+
+static void add(int* counter)
+{
+    pthread_mutex_lock(&m);
+    (*counter)++;
+    pthread_mutex_unlock(&m);
+}
+
+static int spawn(pthread_t* t, void* (*fn)(void*), void* arg)
+{
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, THREAD_STACK);
+    int err = pthread_create(t, &attr, fn, arg);
+    pthread_attr_destroy(&attr);
+    return err;
+}
+
+static void* echo(void* arg)
+{
+    char buf[CHUNK];
+    int fd = (int)(intptr_t)arg;
+    ssize_t n;
+    while ((n = zts_bsd_recv(fd, buf, sizeof(buf), 0)) > 0) {
+        for (ssize_t sent = 0, k; sent < n; sent += k) {
+            if ((k = zts_bsd_send(fd, buf + sent, n - sent, 0)) <= 0) {
+                zts_bsd_close(fd);
+                return NULL;
+            }
+        }
+    }
+    zts_bsd_close(fd);
+    return NULL;
+}
+
+// Runs in a child: echo every connection on its own thread until killed
+static int run_server(int out, void* arg)
+{
+    char path[512];
+    int backlog = *(int*)arg;
+    snprintf(path, sizeof(path), "%s/server", storage_dir);
+    int err = start_node(path, 0, net_id);
+    if (err) {
+        return err;
+    }
+    struct zts_sockaddr_storage ss;
+    zts_socklen_t len = sizeof(ss);
+    zts_util_ipstr_to_saddr("::", TCP_PORT, (struct zts_sockaddr*)&ss, &len);
+    int lfd = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_STREAM, 0);
+    if (zts_bsd_bind(lfd, (struct zts_sockaddr*)&ss, len) < 0 || zts_bsd_listen(lfd, backlog) < 0) {
+        return 1;
+    }
+    zts_addr_get_str(net_id, ZTS_AF_INET6, server_addr, ZTS_IP_MAX_STR_LEN);
+    if (write(out, server_addr, sizeof(server_addr)) != sizeof(server_addr)) {
+        return 1;
+    }
+    for (;;) {
+        pthread_t t;
+        int fd = zts_bsd_accept(lfd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        if (spawn(&t, echo, (void*)(intptr_t)fd)) {
+            zts_bsd_close(fd);
+            continue;
+        }
+        pthread_detach(t);
+    }
+    return 0;
+}
+
+static void* write_stream(void* arg)
+{
+    struct conn* c = (struct conn*)arg;
+    unsigned char buf[CHUNK];
+    for (size_t offset = 0; offset < BYTES_PER_SOCKET;) {
+        size_t len = 0;
+        for (; len < sizeof(buf) && offset + len < BYTES_PER_SOCKET; len++) {
+            buf[len] = pattern(c->index, offset + len);
+        }
+        for (size_t sent = 0; sent < len;) {
+            ssize_t n = zts_bsd_send(c->fd, buf + sent, len - sent, 0);
+            if (n <= 0) {
+                add(&errors);
+                return NULL;
+            }
+            sent += n;
+        }
+        offset += len;
+    }
+    return NULL;
+}
+
+static void* read_stream(void* arg)
+{
+    struct conn* c = (struct conn*)arg;
+    unsigned char buf[CHUNK];
+    for (size_t offset = 0; offset < BYTES_PER_SOCKET;) {
+        size_t want = BYTES_PER_SOCKET - offset < sizeof(buf) ? BYTES_PER_SOCKET - offset : sizeof(buf);
+        ssize_t n = zts_bsd_recv(c->fd, buf, want, 0);
+        if (n <= 0) {
+            add(&errors);
+            return NULL;
+        }
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] != pattern(c->index, offset + i)) {
+                add(&errors);
+                return NULL;
+            }
+        }
+        offset += n;
+    }
+    return NULL;
+}
+
+// Block in a receive until another thread closes the socket
+static void* wait_for_close(void* arg)
+{
+    struct conn* c = (struct conn*)arg;
+    char byte;
+    if (zts_bsd_recv(c->fd, &byte, 1, 0) > 0) {
+        add(&errors);
+    }
+    add(&returned);
+    return NULL;
+}
+
+static int connect_to_server()
+{
+    struct zts_sockaddr_storage ss;
+    zts_socklen_t len = sizeof(ss);
+    zts_util_ipstr_to_saddr(server_addr, TCP_PORT, (struct zts_sockaddr*)&ss, &len);
+    int fd = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_STREAM, 0);
+    if (fd >= 0 && zts_bsd_connect(fd, (struct zts_sockaddr*)&ss, len) < 0) {
+        zts_bsd_close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char** argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : SOCKETS;
+    if (count < 1 || count > MAX_SOCKETS) {
+        fprintf(stderr, "usage: %s [sockets, 1 to %d]\n", argv[0], MAX_SOCKETS);
+        return 1;
+    }
+    strcpy(storage_dir, "/tmp/libzt-duplex-XXXXXX");
+    if (! mkdtemp(storage_dir)) {
+        return 1;
+    }
+    net_id = zts_net_compute_adhoc_id(TCP_PORT, TCP_PORT);
+    int fd = -1;
+    pid_t server = fork_peer(run_server, &count, &fd);
+    if (server < 0) {
+        return 1;
+    }
+    if (read(fd, server_addr, sizeof(server_addr)) != sizeof(server_addr)) {
+        int err = wait_peer(server);
+        printf("echo node did not come online, skipping\n");
+        return err == SKIPPED ? SKIPPED : 1;
+    }
+    char path[512];
+    snprintf(path, sizeof(path), "%s/client", storage_dir);
+    int err = start_node(path, 0, net_id);
+    if (err) {
+        kill(server, SIGTERM);
+        wait_peer(server);
+        printf("node did not come online, skipping\n");
+        return err == SKIPPED ? SKIPPED : 1;
+    }
+
+    struct conn* conns = (struct conn*)calloc(count, sizeof(struct conn));
+    int opened = 0;
+    for (; opened < count; opened++) {
+        conns[opened].index = opened;
+        if ((conns[opened].fd = connect_to_server()) < 0) {
+            break;
+        }
+    }
+    CHECK(opened == count);
+
+    // A reader and a writer on every socket at once
+    double start = now_ms();
+    for (int i = 0; i < opened; i++) {
+        CHECK(spawn(&conns[i].reader, read_stream, &conns[i]) == 0);
+        CHECK(spawn(&conns[i].writer, write_stream, &conns[i]) == 0);
+    }
+    for (int i = 0; i < opened; i++) {
+        pthread_join(conns[i].writer, NULL);
+        pthread_join(conns[i].reader, NULL);
+    }
+    double elapsed = now_ms() - start;
+    CHECK(errors == 0);
+    printf(
+        "%d sockets echoed %d KB each in %.0f ms, %.1f MB/s\n",
+        opened,
+        BYTES_PER_SOCKET / 1024,
+        elapsed,
+        (double)opened * BYTES_PER_SOCKET / elapsed / 1000.0);
+
+    // Closing a socket wakes the thread blocked on it
+    errors = 0;
+    for (int i = 0; i < opened; i++) {
+        CHECK(spawn(&conns[i].reader, wait_for_close, &conns[i]) == 0);
+    }
+    zts_util_delay(500);
+    CHECK(returned == 0);
+    start = now_ms();
+    for (int i = 0; i < opened; i++) {
+        CHECK(zts_bsd_close(conns[i].fd) == ZTS_ERR_OK);
+    }
+    double deadline = start + WAIT_SECONDS * 1000.0;
+    while (now_ms() < deadline) {
+        pthread_mutex_lock(&m);
+        int done = returned;
+        pthread_mutex_unlock(&m);
+        if (done == opened) {
+            break;
+        }
+        zts_util_delay(1);
+    }
+    elapsed = now_ms() - start;
+    if (returned != opened) {
+        fprintf(stderr, "%d of %d blocked readers did not return after close\n", opened - returned, opened);
+        kill(server, SIGTERM);
+        wait_peer(server);
+        return 1;
+    }
+    for (int i = 0; i < opened; i++) {
+        pthread_join(conns[i].reader, NULL);
+    }
+    CHECK(errors == 0);
+    printf("%d blocked readers returned %.1f ms after close\n", opened, elapsed);
+
+    // Every closed socket was freed
+    for (int i = 0; i < opened; i++) {
+        conns[i].fd = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_STREAM, 0);
+        CHECK(conns[i].fd >= 0);
+    }
+    for (int i = 0; i < opened; i++) {
+        CHECK(zts_bsd_close(conns[i].fd) == ZTS_ERR_OK);
+    }
+    free(conns);
+
+    zts_node_free();
+    kill(server, SIGTERM);
+    wait_peer(server);
+    return test_result();
+}
@@ -0,0 +1,82 @@
+/**
+ * Node and stack events across restarts, without a network
+ *
+ * Checks that ZTS_EVENT_STACK_DOWN is delivered when the last node is freed,
+ * both from the application's thread and from an event handler. While the
+ * handler for ZTS_EVENT_STACK_DOWN still runs and calls into the API, the next
+ * node is started from the application's thread, which must not deadlock. A
+ * hang here shows up as a ctest timeout.
+ */
+
+#include "node.h"
+
+#include <string.h>
+
+#define HANDLER_DELAY_MS 200
+
+static volatile int node_up = 0;
+static volatile int stack_down = 0;
+static volatile int free_in_handler = 0;
+static volatile int freed_in_handler = 0;
+static volatile int handler_free_result = -1;
+
+static void on_event(void* ptr)
+{
+    zts_event_msg_t* msg = (zts_event_msg_t*)ptr;
+    if (msg->event_code == ZTS_EVENT_NODE_UP) {
+        node_up = 1;
+        if (free_in_handler) {
+            free_in_handler = 0;
+            handler_free_result = zts_node_free();
+            freed_in_handler = 1;
+        }
+    }
+    if (msg->event_code == ZTS_EVENT_STACK_DOWN) {
+        stack_down++;
+        // Still in the handler while the application starts the next node
+        zts_util_delay(HANDLER_DELAY_MS);
+        zts_node_is_online();
+    }
+}
+
+static int start(const char* path)
+{
+    node_up = 0;
+    CHECK(zts_init_from_storage(path) == ZTS_ERR_OK);
+    CHECK(zts_init_set_event_handler(&on_event) == ZTS_ERR_OK);
+    return zts_node_start();
+}
+
+static int wait_for(volatile int* flag)
+{
+    for (int i = 0; i < WAIT_SECONDS * 100 && ! *flag; i++) {
+        zts_util_delay(10);
+    }
+    return *flag;
+}
+
+int main()
+{
+    char path[] = "/tmp/libzt-events-XXXXXX";
+    if (! mkdtemp(path)) {
+        return 1;
+    }
+
+    // Freed by the application: the event is delivered before zts_node_free() returns
+    CHECK(start(path) == ZTS_ERR_OK);
+    CHECK(wait_for(&node_up));
+    CHECK(zts_node_free() == ZTS_ERR_OK);
+    CHECK(stack_down == 1);
+
+    // Freed by a handler, then restarted while the next handler runs
+    free_in_handler = 1;
+    CHECK(start(path) == ZTS_ERR_OK);
+    CHECK(wait_for(&freed_in_handler));
+    CHECK(handler_free_result == ZTS_ERR_OK);
+    CHECK(start(path) == ZTS_ERR_OK);
+    CHECK(stack_down == 2);
+    CHECK(wait_for(&node_up));
+    CHECK(zts_node_free() == ZTS_ERR_OK);
+    CHECK(stack_down == 3);
+    return test_result();
+}
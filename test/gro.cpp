@@ -0,0 +1,311 @@
+/**
+ * Virtual GRO: which received segments are merged before they enter lwIP
+ *
+ * Drives zts_lwip_eth_rx() and zts_lwip_gro_flush() of a tap with receive
+ * coalescing directly, with netifs that are never added to lwIP, and checks
+ * every packet the tap hands to them.
+ */
+
+#include "VirtualTap.hpp"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace ZeroTier;
+
+#define MTU         2800
+#define ETH_HDR_LEN 14
+#define SEGMENT     1000
+
+#define TCP_FLAG_FIN 0x01
+#define TCP_FLAG_PSH 0x08
+#define TCP_FLAG_ACK 0x10
+
+static int failures = 0;
+
+#define CHECK(cond)                                                                                                    \
+    do {                                                                                                               \
+        if (! (cond)) {                                                                                                \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);                                 \
+            failures++;                                                                                                \
+        }                                                                                                              \
+    } while (0)
+
+typedef std::vector<uint8_t> Packet;
+
+static std::vector<Packet> received;
+
+static void on_send(
+    void*,
+    void*,
+    uint64_t,
+    const MAC&,
+    const MAC&,
+    unsigned int,
+    unsigned int,
+    const void*,
+    unsigned int)
+{
+}
+
+static err_t on_input(struct pbuf* p, struct netif*)
+{
+    Packet frame(p->tot_len);
+    pbuf_copy_partial(p, &frame[0], p->tot_len, 0);
+    received.push_back(Packet(frame.begin() + ETH_HDR_LEN, frame.end()));
+    pbuf_free(p);
+    return ERR_OK;
+}
+
+static uint16_t get16(const uint8_t* b)
+{
+    return (uint16_t)((b[0] << 8) | b[1]);
+}
+
+static void put16(uint8_t* b, unsigned int v)
+{
+    b[0] = (uint8_t)(v >> 8);
+    b[1] = (uint8_t)v;
+}
+
+static uint32_t get32(const uint8_t* b)
+{
+    return ((uint32_t)get16(b) << 16) | get16(b + 2);
+}
+
+static void put32(uint8_t* b, uint32_t v)
+{
+    put16(b, v >> 16);
+    put16(b + 2, v & 0xffff);
+}
+
+static bool is_v4(const Packet& pkt)
+{
+    return (pkt[0] >> 4) == 4;
+}
+
+static unsigned int ip_len(const Packet& pkt)
+{
+    return is_v4(pkt) ? (pkt[0] & 0x0f) * 4 : 40;
+}
+
+static unsigned int tcp_len(const Packet& pkt)
+{
+    return (pkt[ip_len(pkt) + 12] >> 4) * 4;
+}
+
+// Byte at sequence number `seq` of the stream
+static uint8_t pattern(uint32_t seq)
+{
+    return (uint8_t)(seq * 7 + (seq >> 8));
+}
+
+/**
+ * Build a TCP segment with timestamps from port 5000 of the peer to port 6000
+ * of the node, carrying the stream bytes from `seq` on
+ */
+static Packet make_tcp(bool v4, uint8_t flags, uint32_t seq, unsigned int payload)
+{
+    static const uint8_t addr6[2][16] = { { 0xfd, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2 },
+                                          { 0xfd, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 } };
+    static const uint8_t addr4[2][4] = { { 10, 0, 0, 2 }, { 10, 0, 0, 1 } };
+    unsigned int ihl = v4 ? 20 : 40;
+    unsigned int thl = 32;
+    Packet pkt(ihl + thl + payload, 0);
+    uint8_t* ip = &pkt[0];
+    if (v4) {
+        ip[0] = 0x45;
+        put16(ip + 2, pkt.size());
+        put16(ip + 6, 0x4000);
+        ip[8] = 64;
+        ip[9] = 6;
+        memcpy(ip + 12, addr4[0], 4);
+        memcpy(ip + 16, addr4[1], 4);
+    }
+    else {
+        ip[0] = 0x60;
+        put16(ip + 4, thl + payload);
+        ip[6] = 6;
+        ip[7] = 64;
+        memcpy(ip + 8, addr6[0], 16);
+        memcpy(ip + 24, addr6[1], 16);
+    }
+    uint8_t* th = ip + ihl;
+    put16(th, 5000);
+    put16(th + 2, 6000);
+    put32(th + 4, seq);
+    put32(th + 8, 1);
+    th[12] = (uint8_t)((thl / 4) << 4);
+    th[13] = flags;
+    put16(th + 14, 0xffff);
+    // NOP, NOP, timestamps
+    th[20] = th[21] = 1;
+    th[22] = 8;
+    th[23] = 10;
+    for (unsigned int i = 0; i < payload; i++) {
+        th[thl + i] = pattern(seq + i);
+    }
+    return pkt;
+}
+
+static void receive(VirtualTap* tap, const Packet& pkt)
+{
+    MAC from(0x02aabbccdd02ULL);
+    MAC to(0x02aabbccdd01ULL);
+    zts_lwip_eth_rx(tap, from, to, is_v4(pkt) ? 0x0800 : 0x86dd, &pkt[0], pkt.size());
+}
+
+// Segments received since the last check, then the packets they entered the stack as
+static void gro_stats(VirtualTap* tap, uint64_t* segments, uint64_t* packets)
+{
+    *segments = 0;
+    *packets = 0;
+    zts_lwip_gro_stats(tap, segments, packets);
+}
+
+/**
+ * A packet that is several in-order segments merged: lengths match what it
+ * holds and its payload is the stream from `seq` on, byte for byte
+ */
+static bool is_stream(const Packet& pkt, uint32_t seq, unsigned int payload)
+{
+    unsigned int hl = ip_len(pkt) + tcp_len(pkt);
+    if (pkt.size() != hl + payload || get32(&pkt[ip_len(pkt) + 4]) != seq) {
+        return false;
+    }
+    unsigned int len = is_v4(pkt) ? get16(&pkt[2]) : 40 + get16(&pkt[4]);
+    if (len != pkt.size()) {
+        return false;
+    }
+    for (unsigned int i = 0; i < payload; i++) {
+        if (pkt[hl + i] != pattern(seq + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// In-order segments are merged until each batch ends, and no further
+static void check_in_order(VirtualTap* tap, bool v4)
+{
+    received.clear();
+    for (int i = 0; i < 4; i++) {
+        receive(tap, make_tcp(v4, TCP_FLAG_ACK, 1000 + i * SEGMENT, SEGMENT));
+    }
+    CHECK(received.empty());
+    zts_lwip_gro_flush(tap);
+    CHECK(received.size() == 1);
+    for (int i = 4; i < 7; i++) {
+        receive(tap, make_tcp(v4, TCP_FLAG_ACK, 1000 + i * SEGMENT, SEGMENT));
+    }
+    zts_lwip_gro_flush(tap);
+    CHECK(received.size() == 2);
+    if (received.size() == 2) {
+        CHECK(is_stream(received[0], 1000, 4 * SEGMENT));
+        CHECK(is_stream(received[1], 1000 + 4 * SEGMENT, 3 * SEGMENT));
+        CHECK(! (received[0][ip_len(received[0]) + 13] & TCP_FLAG_PSH));
+    }
+}
+
+// Each of `segments` enters the stack unchanged, in the order given
+static void check_unmerged(VirtualTap* tap, const std::vector<Packet>& segments)
+{
+    received.clear();
+    for (size_t i = 0; i < segments.size(); i++) {
+        receive(tap, segments[i]);
+    }
+    zts_lwip_gro_flush(tap);
+    CHECK(received.size() == segments.size());
+    for (size_t i = 0; i < received.size() && i < segments.size(); i++) {
+        CHECK(received[i] == segments[i]);
+    }
+}
+
+static void check_flow(VirtualTap* tap, bool v4)
+{
+    check_in_order(tap, v4);
+
+    // A gap, then the segment that fills it
+    std::vector<Packet> segments;
+    segments.push_back(make_tcp(v4, TCP_FLAG_ACK, 1000, SEGMENT));
+    segments.push_back(make_tcp(v4, TCP_FLAG_ACK, 1000 + 2 * SEGMENT, SEGMENT));
+    segments.push_back(make_tcp(v4, TCP_FLAG_ACK, 1000 + SEGMENT, SEGMENT));
+    check_unmerged(tap, segments);
+
+    // PSH is neither merged into what is held nor followed by a merge
+    segments.clear();
+    segments.push_back(make_tcp(v4, TCP_FLAG_ACK, 1000, SEGMENT));
+    segments.push_back(make_tcp(v4, TCP_FLAG_ACK | TCP_FLAG_PSH, 1000 + SEGMENT, SEGMENT));
+    segments.push_back(make_tcp(v4, TCP_FLAG_ACK, 1000 + 2 * SEGMENT, SEGMENT));
+    check_unmerged(tap, segments);
+
+    // Neither is FIN, even with data
+    segments.clear();
+    segments.push_back(make_tcp(v4, TCP_FLAG_ACK, 1000, SEGMENT));
+    segments.push_back(make_tcp(v4, TCP_FLAG_ACK | TCP_FLAG_FIN, 1000 + SEGMENT, SEGMENT));
+    check_unmerged(tap, segments);
+}
+
+static VirtualTap* new_tap(struct netif* n4, struct netif* n6)
+{
+    VirtualTap* tap = new VirtualTap("", MAC(0x02aabbccdd01ULL), MTU, 0, 0x1234, on_send, NULL);
+    tap->_gro = true;
+    memset(n4, 0, sizeof(*n4));
+    memset(n6, 0, sizeof(*n6));
+    n4->state = n6->state = tap;
+    n4->input = n6->input = on_input;
+    tap->netif4 = n4;
+    tap->netif6 = n6;
+    return tap;
+}
+
+static void delete_tap(VirtualTap* tap)
+{
+    tap->netif4 = NULL;
+    tap->netif6 = NULL;
+    delete tap;
+}
+
+int main()
+{
+    Events::setStackRunning(true);
+    struct netif n4, n6, other4, other6;
+    VirtualTap* tap = new_tap(&n4, &n6);
+    VirtualTap* other = new_tap(&other4, &other6);
+    uint64_t segments, packets;
+
+    check_flow(tap, true);
+    gro_stats(tap, &segments, &packets);
+    // 7 in order, 3 out of order, 2 around PSH and 1 before FIN, which are not counted
+    CHECK(segments == 13);
+    CHECK(packets == 8);
+    check_flow(tap, false);
+    gro_stats(tap, &segments, &packets);
+    CHECK(segments == 26);
+    CHECK(packets == 16);
+
+    // Counters belong to the tap that merged
+    gro_stats(other, &segments, &packets);
+    CHECK(segments == 0 && packets == 0);
+    received.clear();
+    receive(other, make_tcp(true, TCP_FLAG_ACK, 1000, SEGMENT));
+    receive(other, make_tcp(true, TCP_FLAG_ACK, 1000 + SEGMENT, SEGMENT));
+    zts_lwip_gro_flush(other);
+    CHECK(received.size() == 1);
+    gro_stats(other, &segments, &packets);
+    CHECK(segments == 2 && packets == 1);
+    gro_stats(tap, &segments, &packets);
+    CHECK(segments == 26 && packets == 16);
+
+    delete_tap(other);
+    delete_tap(tap);
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
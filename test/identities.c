@@ -0,0 +1,119 @@
+/**
+ * Batched identity generation and validation, and the identity pool
+ *
+ * Needs no network. Checks that batches produce distinct valid identities,
+ * that batch validation finds a broken key-pair, and that zts_id_new() is
+ * served from a filled pool. Prints identities per second on one thread and
+ * on one thread per core, and how long zts_id_new() takes with and without
+ * the pool.
+ */
+
+#include "node.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define POOL_SIZE 4
+
+static char* key_at(char* keys, unsigned int i)
+{
+    return keys + (size_t)i * ZTS_ID_STR_BUF_LEN;
+}
+
+static double batch(char* keys, unsigned int count, unsigned int threads)
+{
+    double start = now_ms();
+    CHECK(zts_id_new_batch(count, threads, keys) == ZTS_ERR_OK);
+    double rate = count / ((now_ms() - start) / 1000.0);
+    printf("%u identities on %u thread(s): %.1f/s\n", count, threads, rate);
+    return rate;
+}
+
+static double time_id_new(char* key)
+{
+    unsigned int len = ZTS_ID_STR_BUF_LEN;
+    double start = now_ms();
+    CHECK(zts_id_new(key, &len) == ZTS_ERR_OK);
+    double elapsed = now_ms() - start;
+    CHECK(zts_id_pair_is_valid(key, len));
+    return elapsed;
+}
+
+static void test_batches()
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int count = cores < 2 ? 4 : cores > 16 ? 32 : 2 * (unsigned int)cores;
+    char* keys = (char*)calloc(count, ZTS_ID_STR_BUF_LEN);
+    int* results = (int*)calloc(count, sizeof(int));
+    zts_id_stats_t before, after;
+    CHECK(zts_id_get_stats(&before) == ZTS_ERR_OK);
+
+    batch(keys, 2, 1);
+    batch(keys, count, 0);
+    CHECK(zts_id_get_stats(&after) == ZTS_ERR_OK);
+    CHECK(after.generated - before.generated == count + 2);
+    CHECK(after.batch_total == 0 && after.batch_done == 0);
+
+    // Every slot holds its own valid identity
+    CHECK(zts_id_pair_is_valid_batch(keys, count, 0, results) == (int)count);
+    for (unsigned int i = 0; i < count; i++) {
+        CHECK(results[i] == 1);
+        CHECK(zts_id_pair_is_valid(key_at(keys, i), strlen(key_at(keys, i))));
+        for (unsigned int j = 0; j < i; j++) {
+            CHECK(strcmp(key_at(keys, i), key_at(keys, j)));
+        }
+    }
+    // A key-pair whose address does not match its keys is found
+    char* broken = key_at(keys, count / 2);
+    broken[0] = broken[0] == 'a' ? 'b' : 'a';
+    CHECK(zts_id_pair_is_valid_batch(keys, count, 0, results) == (int)count - 1);
+    CHECK(results[count / 2] == 0);
+    CHECK(zts_id_get_stats(&before) == ZTS_ERR_OK);
+    CHECK(before.validated - after.validated >= 2 * (uint64_t)count);
+
+    CHECK(zts_id_new_batch(0, 0, keys) == ZTS_ERR_ARG);
+    CHECK(zts_id_new_batch(count, 0, NULL) == ZTS_ERR_ARG);
+    CHECK(zts_id_pair_is_valid_batch(keys, count, 0, NULL) == ZTS_ERR_ARG);
+    free(results);
+    free(keys);
+}
+
+static void test_pool()
+{
+    char key[ZTS_ID_STR_BUF_LEN];
+    zts_id_stats_t stats;
+    double inline_ms = time_id_new(key);
+
+    CHECK(zts_id_pool_start(0, 0) == ZTS_ERR_ARG);
+    CHECK(zts_id_pool_start(POOL_SIZE, 0) == ZTS_ERR_OK);
+    CHECK(zts_id_pool_start(POOL_SIZE, 0) == ZTS_ERR_SERVICE);
+    for (int i = 0; i < WAIT_SECONDS * 10; i++) {
+        CHECK(zts_id_get_stats(&stats) == ZTS_ERR_OK);
+        if (stats.pool_available == POOL_SIZE) {
+            break;
+        }
+        zts_util_delay(100);
+    }
+    CHECK(stats.pool_target == POOL_SIZE);
+    CHECK(stats.pool_available == POOL_SIZE);
+
+    uint64_t hits = stats.pool_hits;
+    double pooled_ms = time_id_new(key);
+    CHECK(zts_id_get_stats(&stats) == ZTS_ERR_OK);
+    CHECK(stats.pool_hits == hits + 1);
+    // A pooled identity can start a node
+    CHECK(zts_init_from_memory(key, strlen(key)) == ZTS_ERR_OK);
+    printf("zts_id_new(): %.1f ms generated inline, %.3f ms from the pool\n", inline_ms, pooled_ms);
+
+    CHECK(zts_id_pool_stop() == ZTS_ERR_OK);
+    CHECK(zts_id_pool_stop() == ZTS_ERR_SERVICE);
+    CHECK(zts_id_get_stats(&stats) == ZTS_ERR_OK);
+    CHECK(stats.pool_target == 0 && stats.pool_available == 0);
+}
+
+int main()
+{
+    test_batches();
+    test_pool();
+    return test_result();
+}
@@ -0,0 +1,176 @@
+/**
+ * TCP throughput on networks with different MTUs
+ *
+ * Ad-hoc networks always have the default MTU of 2800, so this takes two
+ * controller networks, e.g. one left at 2800 and one set to 9000:
+ *
+ *     mtu <storage_dir> <network ID> <network ID>
+ *
+ * Forks a sink node, joins both nodes to both networks and uploads BULK_BYTES
+ * over TCP on each. Prints each network's MTU and the throughput. Identities
+ * are kept under <storage_dir>, so the two nodes only need to be authorized on
+ * private networks once; a node that does not get an address prints its ID.
+ */
+
+#include "node.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TCP_PORT   8000
+#define BULK_BYTES (64 * 1024 * 1024)
+#define CHUNK      (64 * 1024)
+
+static const char* storage_dir;
+static uint64_t net_ids[2];
+
+// What the sink tells the client once it is listening
+struct sink_info {
+    char addr[2][ZTS_IP_MAX_STR_LEN];
+};
+
+static int unauthorized(const char* name, uint64_t net_id)
+{
+    fprintf(
+        stderr,
+        "%s: authorize %llx on %llx\n",
+        name,
+        (unsigned long long)zts_node_get_id(),
+        (unsigned long long)net_id);
+    return SKIPPED;
+}
+
+// Start a node with its identity under storage_dir/name on both networks
+static int start(const char* name)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", storage_dir, name);
+    int err = start_node(path, 0, net_ids[0]);
+    if (err == SKIPPED && zts_node_is_online()) {
+        return unauthorized(name, net_ids[0]);
+    }
+    if (err) {
+        return err;
+    }
+    zts_net_join(net_ids[1]);
+    for (int i = 0; i < WAIT_SECONDS * 10 && ! zts_net_transport_is_ready(net_ids[1]); i++) {
+        zts_util_delay(100);
+    }
+    return zts_net_transport_is_ready(net_ids[1]) ? 0 : unauthorized(name, net_ids[1]);
+}
+
+// Runs in a child: read every connection to the end, acknowledge, until killed
+static int run_sink(int out, void* arg)
+{
+    static char buf[CHUNK];
+    struct sink_info info;
+    (void)arg;
+    int err = start("sink");
+    if (err) {
+        return err;
+    }
+    struct zts_sockaddr_storage ss;
+    zts_socklen_t len = sizeof(ss);
+    zts_util_ipstr_to_saddr("::", TCP_PORT, (struct zts_sockaddr*)&ss, &len);
+    int lfd = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_STREAM, 0);
+    if (zts_bsd_bind(lfd, (struct zts_sockaddr*)&ss, len) < 0 || zts_bsd_listen(lfd, 1) < 0) {
+        return 1;
+    }
+    memset(&info, 0, sizeof(info));
+    for (int i = 0; i < 2; i++) {
+        zts_addr_get_str(net_ids[i], ZTS_AF_INET6, info.addr[i], ZTS_IP_MAX_STR_LEN);
+    }
+    if (write(out, &info, sizeof(info)) != sizeof(info)) {
+        return 1;
+    }
+    for (;;) {
+        char ack = 'a';
+        ssize_t n = 0;
+        int fd = zts_bsd_accept(lfd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        while ((n = zts_bsd_recv(fd, buf, sizeof(buf), 0)) > 0) {}
+        if (n == 0) {
+            zts_bsd_send(fd, &ack, 1, 0);
+        }
+        zts_bsd_close(fd);
+    }
+    return 0;
+}
+
+// Upload BULK_BYTES to `addr` and return MB/s, or a negative value on failure
+static double upload(const char* addr)
+{
+    static char buf[CHUNK];
+    struct zts_sockaddr_storage ss;
+    zts_socklen_t len = sizeof(ss);
+    char ack = 0;
+    zts_util_ipstr_to_saddr(addr, TCP_PORT, (struct zts_sockaddr*)&ss, &len);
+    int fd = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_STREAM, 0);
+    if (fd < 0 || zts_bsd_connect(fd, (struct zts_sockaddr*)&ss, len) < 0) {
+        return -1;
+    }
+    memset(buf, 0xa5, sizeof(buf));
+    double start = now_ms();
+    for (int sent = 0; sent < BULK_BYTES;) {
+        ssize_t n = zts_bsd_send(fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            zts_bsd_close(fd);
+            return -1;
+        }
+        sent += n;
+    }
+    // The sink acknowledges once it has read everything
+    if (zts_bsd_shutdown(fd, ZTS_SHUT_WR) < 0 || zts_bsd_recv(fd, &ack, 1, 0) != 1) {
+        zts_bsd_close(fd);
+        return -1;
+    }
+    double elapsed = now_ms() - start;
+    zts_bsd_close(fd);
+    return BULK_BYTES / elapsed / 1000.0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 4) {
+        fprintf(stderr, "usage: %s <storage_dir> <network ID> <network ID>\n", argv[0]);
+        return 1;
+    }
+    storage_dir = argv[1];
+    net_ids[0] = strtoull(argv[2], NULL, 16);
+    net_ids[1] = strtoull(argv[3], NULL, 16);
+
+    // No node may run in this process, since it forks
+    struct sink_info info;
+    int fd = -1;
+    pid_t sink = fork_peer(run_sink, NULL, &fd);
+    if (sink < 0) {
+        return 1;
+    }
+    if (read(fd, &info, sizeof(info)) != sizeof(info)) {
+        fprintf(stderr, "sink did not come online\n");
+        return 1;
+    }
+    if (start("client") == 0) {
+        for (int i = 0; i < 2; i++) {
+            // The first upload also waits for a direct path
+            CHECK(upload(info.addr[i]) > 0);
+            double rate = upload(info.addr[i]);
+            CHECK(rate > 0);
+            printf(
+                "%llx: MTU %d, upload %.1f MB/s\n",
+                (unsigned long long)net_ids[i],
+                zts_net_get_mtu(net_ids[i]),
+                rate);
+        }
+    }
+    else {
+        failures++;
+    }
+    zts_node_free();
+    kill(sink, SIGTERM);
+    wait_peer(sink);
+    return test_result();
+}
@@ -0,0 +1,132 @@
+/**
+ * Groups joined through zts_add_membership() become ZeroTier multicast
+ * subscriptions of the network, and leave them again on zts_drop_membership()
+ *
+ * Uses an ad-hoc network, which needs no controller and assigns only IPv6
+ * addresses. An IPv4 join on any interface must therefore fail rather than be
+ * applied to the IPv6 netif. Exits with 77 (skipped) if the node cannot come
+ * online, e.g. without Internet access.
+ */
+
+#include "ZeroTierSockets.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SKIPPED      77
+#define WAIT_SECONDS 60
+
+// Multicast MACs derived from the groups below (RFC 2464, RFC 1112)
+#define GROUP6     "ff15::1:2:3"
+#define GROUP6_MAC 0x333300020003ULL
+#define GROUP4     "239.1.2.3"
+#define GROUP4_MAC 0x01005e010203ULL
+
+static int failures = 0;
+
+#define CHECK(cond)                                                                                                    \
+    do {                                                                                                               \
+        if (! (cond)) {                                                                                                \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);                                 \
+            failures++;                                                                                                \
+        }                                                                                                              \
+    } while (0)
+
+static int is_subscribed(uint64_t net_id, uint64_t mac)
+{
+    int found = 0;
+    zts_core_lock_obtain();
+    int count = zts_core_query_mc_count(net_id);
+    for (int i = 0; i < count; i++) {
+        uint64_t m = 0;
+        uint32_t adi = 0;
+        if (zts_core_query_mc(net_id, i, &m, &adi) == ZTS_ERR_OK && m == mac) {
+            found = 1;
+        }
+    }
+    zts_core_lock_release();
+    return found;
+}
+
+// Wait until the subscription is in the expected state
+static int wait_subscribed(uint64_t net_id, uint64_t mac, int expected)
+{
+    for (int i = 0; i < WAIT_SECONDS * 10; i++) {
+        if (is_subscribed(net_id, mac) == expected) {
+            return 1;
+        }
+        zts_util_delay(100);
+    }
+    return 0;
+}
+
+static int wait_for(int (*ready)(uint64_t), uint64_t arg)
+{
+    for (int i = 0; i < WAIT_SECONDS * 10; i++) {
+        if (ready(arg)) {
+            return 1;
+        }
+        zts_util_delay(100);
+    }
+    return 0;
+}
+
+static int node_online(uint64_t unused)
+{
+    (void)unused;
+    return zts_node_is_online();
+}
+
+int main()
+{
+    char path[] = "/tmp/libzt-multicast-XXXXXX";
+    if (! mkdtemp(path)) {
+        return 1;
+    }
+    uint64_t net_id = zts_net_compute_adhoc_id(9000, 9000);
+    zts_init_from_storage(path);
+    if (zts_node_start() != ZTS_ERR_OK) {
+        return 1;
+    }
+    if (! wait_for(node_online, 0)) {
+        printf("node did not come online, skipping\n");
+        zts_node_free();
+        return SKIPPED;
+    }
+    zts_net_join(net_id);
+    if (! wait_for(zts_net_transport_is_ready, net_id)) {
+        printf("network not ready, skipping\n");
+        zts_node_free();
+        return SKIPPED;
+    }
+
+    int fd6 = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_DGRAM, 0);
+    CHECK(fd6 >= 0);
+    CHECK(! is_subscribed(net_id, GROUP6_MAC));
+    CHECK(zts_add_membership(fd6, GROUP6, NULL) == ZTS_ERR_OK);
+    CHECK(wait_subscribed(net_id, GROUP6_MAC, 1));
+    CHECK(zts_drop_membership(fd6, GROUP6, NULL) == ZTS_ERR_OK);
+    CHECK(wait_subscribed(net_id, GROUP6_MAC, 0));
+
+    // Closing a socket leaves its groups
+    CHECK(zts_add_membership(fd6, GROUP6, NULL) == ZTS_ERR_OK);
+    CHECK(wait_subscribed(net_id, GROUP6_MAC, 1));
+    zts_bsd_close(fd6);
+    CHECK(wait_subscribed(net_id, GROUP6_MAC, 0));
+
+    // No netif carries IPv4 here, so there is nothing to join on
+    int fd4 = zts_bsd_socket(ZTS_AF_INET, ZTS_SOCK_DGRAM, 0);
+    CHECK(fd4 >= 0);
+    CHECK(zts_add_membership(fd4, GROUP4, NULL) != ZTS_ERR_OK);
+    zts_util_delay(1000);
+    CHECK(! is_subscribed(net_id, GROUP4_MAC));
+    zts_bsd_close(fd4);
+
+    zts_node_free();
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,108 @@
+/**
+ * Helpers shared by the tests: checks, timing, and nodes on an ad-hoc network
+ *
+ * lwIP has no loopback interface here, so tests that need two endpoints run
+ * the second node in a child process forked with fork_peer().
+ */
+
+#ifndef ZTS_TEST_NODE_H
+#define ZTS_TEST_NODE_H
+
+#include "ZeroTierSockets.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Exit code reported by ctest as skipped, see SKIP_RETURN_CODE in CMakeLists.txt
+#define SKIPPED      77
+#define WAIT_SECONDS 60
+
+static int failures = 0;
+
+#define CHECK(cond)                                                                                                    \
+    do {                                                                                                               \
+        if (! (cond)) {                                                                                                \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);                                 \
+            failures++;                                                                                                \
+        }                                                                                                              \
+    } while (0)
+
+/** Print the result and return the exit code of a test */
+static inline int test_result()
+{
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
+
+static inline double now_ms()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+/**
+ * Start a node with its identity under `path` on `port` (`0` for a random one)
+ * and join it to `net_id`. Returns `0` once the network has an address, `-1`
+ * if the node failed to start and `SKIPPED` if it did not come online in time
+ */
+static inline int start_node(const char* path, unsigned short port, uint64_t net_id)
+{
+    if (zts_init_from_storage(path) != ZTS_ERR_OK || (port && zts_init_set_port(port) != ZTS_ERR_OK)
+        || zts_node_start() != ZTS_ERR_OK) {
+        return -1;
+    }
+    int i;
+    for (i = 0; i < WAIT_SECONDS * 10 && ! zts_node_is_online(); i++) {
+        zts_util_delay(100);
+    }
+    if (! zts_node_is_online()) {
+        return SKIPPED;
+    }
+    zts_net_join(net_id);
+    for (i = 0; i < WAIT_SECONDS * 10 && ! zts_net_transport_is_ready(net_id); i++) {
+        zts_util_delay(100);
+    }
+    return zts_net_transport_is_ready(net_id) ? 0 : SKIPPED;
+}
+
+/**
+ * Run `fn` in a child process. Must be called before this process starts a
+ * node. `fn` gets the write end of a pipe whose read end is stored in `fd`, and
+ * its return value becomes the child's exit code. Returns the child's pid
+ */
+static inline pid_t fork_peer(int (*fn)(int out, void* arg), void* arg, int* fd)
+{
+    int fds[2];
+    if (pipe(fds) < 0) {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        exit(fn(fds[1], arg));
+    }
+    close(fds[1]);
+    *fd = fds[0];
+    return pid;
+}
+
+/** Wait for a child started by `fork_peer()` and return its exit code */
+static inline int wait_peer(pid_t pid)
+{
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0 || ! WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+#endif
@@ -0,0 +1,98 @@
+/**
+ * Smoke test of the Node.js binding without a network
+ *
+ * Starts a node that joins no network and checks that its events reach
+ * JavaScript, that a server can listen and close, and that a connect with no
+ * route fails with an error. The process must then exit by itself, which it
+ * only does once no socket is left on the shared poller. Run it after building
+ * the package:
+ *
+ *     cd pkg/npm && ./build.sh ext <dir with libzt.a> && ./build.sh check
+ */
+
+"use strict";
+
+const assert = require("assert");
+const fs = require("fs");
+const os = require("os");
+const path = require("path");
+
+const zt = require(path.join(__dirname, "../../pkg/npm"));
+
+const WAIT_MS = 60 * 1000;
+const PORT = 9000;
+const UNROUTABLE = "10.255.255.1";
+
+/** Resolve with the arguments of the next `name` event, reject on "error" or after WAIT_MS */
+function next(emitter, name)
+{
+    return new Promise((resolve, reject) => {
+        const timer = setTimeout(() => reject(new Error("timed out waiting for " + name)), WAIT_MS);
+        const onEvent = (...args) => {
+            clearTimeout(timer);
+            emitter.removeListener("error", onError);
+            resolve(args);
+        };
+        const onError = (err) => {
+            clearTimeout(timer);
+            emitter.removeListener(name, onEvent);
+            reject(err);
+        };
+        emitter.once(name, onEvent);
+        if (name !== "error") {
+            emitter.once("error", onError);
+        }
+    });
+}
+
+async function testNodeEvents(node)
+{
+    const up = next(node, "ZTS_EVENT_NODE_UP");
+    const codes = [];
+    node.on("event", (code) => codes.push(code));
+    assert.strictEqual(node.start(), 0);
+    const [id] = await up;
+    assert.strictEqual(id, node.id);
+    assert.ok(/^[0-9a-f]+$/.test(id), "node ID is a hex string: " + id);
+    assert.ok(codes.includes(zt.native.ZTS_EVENT_NODE_UP));
+}
+
+async function testServer()
+{
+    const server = zt.createServer(() => assert.fail("no one can connect"));
+    server.listen(PORT, "0.0.0.0");
+    await next(server, "listening");
+    assert.ok(server.listening);
+    assert.strictEqual(server.address().port, PORT);
+    server.close();
+    await next(server, "close");
+    assert.ok(! server.listening);
+    assert.strictEqual(server.address(), null);
+}
+
+async function testConnectWithoutRoute()
+{
+    // Fails either at once or once the poller reports the socket
+    const socket = zt.connect(80, UNROUTABLE, () => assert.fail("connected without a route"));
+    const [err] = await next(socket, "error");
+    assert.ok(err.errno > 0, "errno set: " + err.message);
+    assert.strictEqual(err.syscall, "connect");
+    assert.ok(socket.destroyed);
+    assert.ok(! socket.connecting);
+}
+
+async function main()
+{
+    const node = new zt.Node();
+    assert.strictEqual(node.initFromStorage(fs.mkdtempSync(path.join(os.tmpdir(), "libzt-nodejs-"))), 0);
+    await testNodeEvents(node);
+    await testServer();
+    await testConnectWithoutRoute();
+    assert.strictEqual(node.free(), 0);
+    console.log("ok");
+}
+
+main().catch((err) => {
+    console.error(err);
+    process.exit(1);
+});
@@ -0,0 +1,127 @@
+/**
+ * Poller readiness and socket errors without a network
+ *
+ * Registers sockets of a node that has started but joined no network with a
+ * poller, and checks what zts_poller_wait() and the poller's OS descriptor
+ * report: a UDP socket is writable at once and stays so, nothing has arrived
+ * to read, and a closed socket is dropped. A non-blocking connect to an
+ * address with no route must fail either at once or through
+ * zts_get_socket_error() once the poller reports the socket.
+ */
+
+#include "node.h"
+
+#include <poll.h>
+#include <string.h>
+
+#define MAX_EVENTS 8
+
+// Whether the poller's OS descriptor is readable, as an external event loop would see it
+static int os_fd_readable(int pfd)
+{
+    struct pollfd p;
+    p.fd = zts_poller_get_os_fd(pfd);
+    p.events = POLLIN;
+    p.revents = 0;
+    return p.fd >= 0 && poll(&p, 1, 0) == 1 && (p.revents & POLLIN);
+}
+
+static void test_udp(int pfd)
+{
+    zts_poller_event_t events[MAX_EVENTS];
+    int fd = zts_bsd_socket(ZTS_AF_INET, ZTS_SOCK_DGRAM, 0);
+    CHECK(fd >= 0);
+
+    CHECK(zts_poller_wait(pfd, events, MAX_EVENTS, 0) == 0);
+    CHECK(zts_poller_set(pfd, fd, ZTS_POLLIN | ZTS_POLLOUT) == ZTS_ERR_OK);
+    CHECK(os_fd_readable(pfd));
+    // Level-triggered: reported on every wait while it stays writable
+    for (int i = 0; i < 2; i++) {
+        CHECK(zts_poller_wait(pfd, events, MAX_EVENTS, 0) == 1);
+        CHECK(events[0].fd == fd);
+        CHECK(events[0].revents == ZTS_POLLOUT);
+    }
+
+    // Nothing to read, so a wait for input alone times out
+    CHECK(zts_poller_set(pfd, fd, ZTS_POLLIN) == ZTS_ERR_OK);
+    double start = now_ms();
+    CHECK(zts_poller_wait(pfd, events, MAX_EVENTS, 100) == 0);
+    CHECK(now_ms() - start >= 90);
+    CHECK(zts_poller_wait(pfd, events, MAX_EVENTS, 0) == 0);
+    CHECK(! os_fd_readable(pfd));
+
+    // Removed and closed sockets are no longer reported
+    CHECK(zts_poller_set(pfd, fd, ZTS_POLLOUT) == ZTS_ERR_OK);
+    CHECK(zts_poller_remove(pfd, fd) == ZTS_ERR_OK);
+    CHECK(zts_poller_wait(pfd, events, MAX_EVENTS, 0) == 0);
+    CHECK(zts_poller_set(pfd, fd, ZTS_POLLOUT) == ZTS_ERR_OK);
+    CHECK(zts_get_socket_error(fd) == 0);
+    CHECK(zts_bsd_close(fd) == ZTS_ERR_OK);
+    CHECK(zts_poller_wait(pfd, events, MAX_EVENTS, 0) == 0);
+}
+
+static void test_connect_error(int pfd)
+{
+    zts_poller_event_t events[MAX_EVENTS];
+    int fd = zts_bsd_socket(ZTS_AF_INET, ZTS_SOCK_STREAM, 0);
+    CHECK(fd >= 0);
+    CHECK(zts_set_blocking(fd, 0) == ZTS_ERR_OK);
+    CHECK(zts_get_socket_error(fd) == 0);
+
+    struct zts_sockaddr_storage ss;
+    zts_socklen_t len = sizeof(ss);
+    CHECK(zts_util_ipstr_to_saddr("10.255.255.1", 80, (struct zts_sockaddr*)&ss, &len) == ZTS_ERR_OK);
+    if (zts_bsd_connect(fd, (struct zts_sockaddr*)&ss, len) == ZTS_ERR_OK) {
+        CHECK(! "connect without a route succeeded");
+    }
+    else if (zts_errno == ZTS_EINPROGRESS) {
+        CHECK(zts_poller_set(pfd, fd, ZTS_POLLOUT) == ZTS_ERR_OK);
+        CHECK(zts_poller_wait(pfd, events, MAX_EVENTS, WAIT_SECONDS * 1000) == 1);
+        CHECK(events[0].fd == fd);
+        CHECK(zts_get_socket_error(fd) > 0);
+    }
+    else {
+        CHECK(zts_errno > 0);
+        CHECK(zts_get_socket_error(fd) >= 0);
+    }
+    // Reading the error clears it
+    CHECK(zts_get_socket_error(fd) == 0);
+    CHECK(zts_bsd_close(fd) == ZTS_ERR_OK);
+}
+
+static void test_wakeup(int pfd)
+{
+    zts_poller_event_t events[MAX_EVENTS];
+    CHECK(zts_poller_wakeup(pfd) == ZTS_ERR_OK);
+    CHECK(os_fd_readable(pfd));
+    // Would block forever if the wakeup were lost
+    CHECK(zts_poller_wait(pfd, events, MAX_EVENTS, -1) == 0);
+    CHECK(! os_fd_readable(pfd));
+}
+
+int main()
+{
+    char path[] = "/tmp/libzt-poller-XXXXXX";
+    if (! mkdtemp(path)) {
+        return 1;
+    }
+    zts_poller_event_t events[MAX_EVENTS];
+    CHECK(zts_poller_new() == ZTS_ERR_SERVICE);
+    CHECK(zts_init_from_storage(path) == ZTS_ERR_OK);
+    CHECK(zts_node_start() == ZTS_ERR_OK);
+
+    int pfd = zts_poller_new();
+    CHECK(pfd >= 0);
+    CHECK(zts_poller_get_os_fd(pfd) >= 0);
+    CHECK(zts_poller_wait(pfd, NULL, MAX_EVENTS, 0) == ZTS_ERR_ARG);
+    CHECK(zts_poller_wait(pfd, events, 0, 0) == ZTS_ERR_ARG);
+    test_udp(pfd);
+    test_connect_error(pfd);
+    test_wakeup(pfd);
+    CHECK(zts_poller_free(pfd) == ZTS_ERR_OK);
+    CHECK(zts_poller_free(pfd) == ZTS_ERR_ARG);
+    CHECK(zts_poller_wait(pfd, events, MAX_EVENTS, 0) == ZTS_ERR_ARG);
+
+    zts_node_free();
+    return test_result();
+}
@@ -0,0 +1,303 @@
+/**
+ * Overhead of libzt-preload.so against calling libzt directly
+ *
+ * Forks an echo and sink server node, then runs the same client twice against
+ * it: once with zts_bsd_* calls on its own node, and once with plain libc
+ * socket calls in a re-executed copy of this program that has libzt-preload.so
+ * preloaded. Each client measures the mean round trip of MSG_LEN byte echoes
+ * and the throughput of a BULK_BYTES upload:
+ *
+ *     preload <storage_dir> <path to libzt-preload.so>
+ *
+ * Every node contacts the roots to come online.
+ */
+
+#include "node.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#define TCP_PORT    8000
+#define WARMUP      100
+#define ROUND_TRIPS 1000
+#define MSG_LEN     64
+#define BULK_BYTES  (64 * 1024 * 1024)
+#define CHUNK       (64 * 1024)
+
+// Sent first on every connection to select what the server does with it
+#define MODE_ECHO 'e'
+#define MODE_SINK 's'
+
+static uint64_t net_id;
+static const char* storage_dir;
+static char server_addr[ZTS_IP_MAX_STR_LEN];
+
+// The socket calls a client is measured with
+struct api {
+    const char* name;
+    int (*connect)(const char* addr);
+    ssize_t (*send)(int fd, const void* buf, size_t len);
+    ssize_t (*recv)(int fd, void* buf, size_t len);
+    int (*shutdown)(int fd);
+    int (*close)(int fd);
+};
+
+static int native_connect(const char* addr)
+{
+    struct zts_sockaddr_storage ss;
+    zts_socklen_t len = sizeof(ss);
+    if (zts_util_ipstr_to_saddr(addr, TCP_PORT, (struct zts_sockaddr*)&ss, &len) != ZTS_ERR_OK) {
+        return -1;
+    }
+    int fd = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_STREAM, 0);
+    if (fd >= 0 && zts_bsd_connect(fd, (struct zts_sockaddr*)&ss, len) < 0) {
+        zts_bsd_close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static ssize_t native_send(int fd, const void* buf, size_t len)
+{
+    return zts_bsd_send(fd, buf, len, 0);
+}
+
+static ssize_t native_recv(int fd, void* buf, size_t len)
+{
+    return zts_bsd_recv(fd, buf, len, 0);
+}
+
+static int native_shutdown(int fd)
+{
+    return zts_bsd_shutdown(fd, ZTS_SHUT_WR);
+}
+
+static const struct api native = { "libzt", native_connect, native_send, native_recv, native_shutdown, zts_bsd_close };
+
+static int posix_connect(const char* addr)
+{
+    struct sockaddr_in6 in6;
+    memset(&in6, 0, sizeof(in6));
+    in6.sin6_family = AF_INET6;
+    in6.sin6_port = htons(TCP_PORT);
+    if (inet_pton(AF_INET6, addr, &in6.sin6_addr) != 1) {
+        return -1;
+    }
+    int fd = socket(AF_INET6, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr*)&in6, sizeof(in6)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static ssize_t posix_send(int fd, const void* buf, size_t len)
+{
+    return send(fd, buf, len, MSG_NOSIGNAL);
+}
+
+static ssize_t posix_recv(int fd, void* buf, size_t len)
+{
+    return recv(fd, buf, len, 0);
+}
+
+static int posix_shutdown(int fd)
+{
+    return shutdown(fd, SHUT_WR);
+}
+
+static const struct api posix = { "preload", posix_connect, posix_send, posix_recv, posix_shutdown, close };
+
+static int send_all(const struct api* a, int fd, const char* buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = a->send(fd, buf, len);
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int recv_all(const struct api* a, int fd, char* buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = a->recv(fd, buf, len);
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int open_mode(const struct api* a, char mode)
+{
+    int fd = a->connect(server_addr);
+    if (fd >= 0 && send_all(a, fd, &mode, 1) < 0) {
+        a->close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int run_client(const struct api* a)
+{
+    static char buf[CHUNK];
+    char out[MSG_LEN], in[MSG_LEN];
+    int fd = open_mode(a, MODE_ECHO);
+    if (fd < 0) {
+        fprintf(stderr, "%s: connect failed\n", a->name);
+        return 1;
+    }
+    // The first round trips also wait for a direct path
+    double start = 0;
+    for (int i = 0; i < WARMUP + ROUND_TRIPS; i++) {
+        if (i == WARMUP) {
+            start = now_ms();
+        }
+        memset(out, i, MSG_LEN);
+        if (send_all(a, fd, out, MSG_LEN) < 0 || recv_all(a, fd, in, MSG_LEN) < 0 || memcmp(in, out, MSG_LEN)) {
+            fprintf(stderr, "%s: echo failed\n", a->name);
+            return 1;
+        }
+    }
+    double round_trip = (now_ms() - start) * 1000.0 / ROUND_TRIPS;
+    a->close(fd);
+
+    // The server acknowledges once it has read everything
+    char ack = 0;
+    memset(buf, 0xa5, sizeof(buf));
+    if ((fd = open_mode(a, MODE_SINK)) < 0) {
+        return 1;
+    }
+    start = now_ms();
+    for (int sent = 0; sent < BULK_BYTES; sent += CHUNK) {
+        if (send_all(a, fd, buf, CHUNK) < 0) {
+            return 1;
+        }
+    }
+    if (a->shutdown(fd) < 0 || recv_all(a, fd, &ack, 1) < 0) {
+        return 1;
+    }
+    double elapsed = now_ms() - start;
+    a->close(fd);
+    printf("%-8s round trip %6.0f us, upload %6.1f MB/s\n", a->name, round_trip, BULK_BYTES / elapsed / 1000.0);
+    return 0;
+}
+
+// Runs in a child: serve one connection at a time until killed
+static int run_server(int out, void* arg)
+{
+    static char buf[CHUNK];
+    char path[512];
+    (void)arg;
+    snprintf(path, sizeof(path), "%s/server", storage_dir);
+    int err = start_node(path, 0, net_id);
+    if (err) {
+        return err;
+    }
+    struct zts_sockaddr_storage ss;
+    zts_socklen_t len = sizeof(ss);
+    zts_util_ipstr_to_saddr("::", TCP_PORT, (struct zts_sockaddr*)&ss, &len);
+    int lfd = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_STREAM, 0);
+    if (zts_bsd_bind(lfd, (struct zts_sockaddr*)&ss, len) < 0 || zts_bsd_listen(lfd, 1) < 0) {
+        return 1;
+    }
+    zts_addr_get_str(net_id, ZTS_AF_INET6, server_addr, ZTS_IP_MAX_STR_LEN);
+    if (write(out, server_addr, sizeof(server_addr)) != sizeof(server_addr)) {
+        return 1;
+    }
+    for (;;) {
+        char mode = 0;
+        ssize_t n = 0;
+        int fd = zts_bsd_accept(lfd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        if (zts_bsd_recv(fd, &mode, 1, 0) == 1) {
+            while ((n = zts_bsd_recv(fd, buf, sizeof(buf), 0)) > 0) {
+                if (mode == MODE_ECHO && send_all(&native, fd, buf, n) < 0) {
+                    break;
+                }
+            }
+            if (mode == MODE_SINK && n == 0) {
+                zts_bsd_send(fd, &mode, 1, 0);
+            }
+        }
+        zts_bsd_close(fd);
+    }
+    return 0;
+}
+
+static int run_native(int out, void* arg)
+{
+    char path[512];
+    (void)out;
+    (void)arg;
+    snprintf(path, sizeof(path), "%s/native", storage_dir);
+    int err = start_node(path, 0, net_id);
+    if (! err) {
+        err = run_client(&native);
+    }
+    zts_node_free();
+    return err;
+}
+
+// Re-execute this program with the shim preloaded and its own identity
+static int run_preloaded(const char* self, const char* shim)
+{
+    char value[512];
+    pid_t pid = fork();
+    if (pid != 0) {
+        return pid < 0 ? -1 : wait_peer(pid);
+    }
+    setenv("LD_PRELOAD", shim, 1);
+    snprintf(value, sizeof(value), "%llx", (unsigned long long)net_id);
+    setenv("ZTS_PRELOAD_NETWORK", value, 1);
+    snprintf(value, sizeof(value), "%s/preload", storage_dir);
+    setenv("ZTS_PRELOAD_STORAGE", value, 1);
+    snprintf(value, sizeof(value), "%d", WAIT_SECONDS);
+    setenv("ZTS_PRELOAD_TIMEOUT", value, 1);
+    execlp(self, self, "--posix", server_addr, (char*)NULL);
+    _exit(1);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 3 && ! strcmp(argv[1], "--posix")) {
+        strncpy(server_addr, argv[2], sizeof(server_addr) - 1);
+        return run_client(&posix);
+    }
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <storage_dir> <path to libzt-preload.so>\n", argv[0]);
+        return 1;
+    }
+    storage_dir = argv[1];
+    net_id = zts_net_compute_adhoc_id(TCP_PORT, TCP_PORT);
+
+    // No node may run in this process, since it forks
+    int fd = -1;
+    pid_t server = fork_peer(run_server, NULL, &fd);
+    if (server < 0) {
+        return 1;
+    }
+    if (read(fd, server_addr, sizeof(server_addr)) != sizeof(server_addr)) {
+        fprintf(stderr, "server did not come online\n");
+        return 1;
+    }
+    int native_fd = -1;
+    pid_t client = fork_peer(run_native, NULL, &native_fd);
+    CHECK(client >= 0 && wait_peer(client) == 0);
+    CHECK(run_preloaded(argv[0], argv[2]) == 0);
+    kill(server, SIGTERM);
+    wait_peer(server);
+    return test_result();
+}
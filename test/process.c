@@ -0,0 +1,117 @@
+/**
+ * Caller-driven mode without a network
+ *
+ * Drives a node with zts_process() and stops it from an event handler that
+ * zts_process() delivers, which must not deadlock. Then drives a second node,
+ * checks that zts_get_pollable_fds() reports its UDP sockets before any
+ * traffic has arrived, and stops it from the driving thread. A hang here
+ * shows up as a ctest timeout.
+ */
+
+#include "node.h"
+
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#define MAX_FDS 64
+
+static int stop_in_handler = 0;
+static int node_up = 0;
+static int handler_stop_result = -1;
+
+static void on_event(void* ptr)
+{
+    zts_event_msg_t* msg = (zts_event_msg_t*)ptr;
+    if (msg->event_code != ZTS_EVENT_NODE_UP) {
+        return;
+    }
+    node_up = 1;
+    if (stop_in_handler) {
+        handler_stop_result = zts_node_stop();
+    }
+}
+
+static int start(const char* path)
+{
+    node_up = 0;
+    CHECK(zts_init_from_storage(path) == ZTS_ERR_OK);
+    CHECK(zts_init_set_caller_driven(1) == ZTS_ERR_OK);
+    CHECK(zts_init_set_event_handler(&on_event) == ZTS_ERR_OK);
+    return zts_node_start();
+}
+
+// Call zts_process() until the node is up or stops, and return the last result
+static int process_until_up()
+{
+    int err = ZTS_ERR_OK;
+    for (int i = 0; i < WAIT_SECONDS * 100 && err == ZTS_ERR_OK && ! node_up; i++) {
+        err = zts_process(10);
+    }
+    return err;
+}
+
+// Whether the host has an address the node can bind, which excludes loopback
+static int has_bindable_address()
+{
+    struct ifaddrs* list = NULL;
+    int found = 0;
+    if (getifaddrs(&list) != 0) {
+        return 0;
+    }
+    for (struct ifaddrs* i = list; i && ! found; i = i->ifa_next) {
+        found = i->ifa_addr && (i->ifa_flags & IFF_UP) && ! (i->ifa_flags & IFF_LOOPBACK)
+                && (i->ifa_addr->sa_family == AF_INET || i->ifa_addr->sa_family == AF_INET6);
+    }
+    freeifaddrs(list);
+    return found;
+}
+
+// The node's sockets are reported as soon as they are bound
+static void test_pollable_fds()
+{
+    int fds[MAX_FDS];
+    int count = zts_get_pollable_fds(fds, MAX_FDS);
+    CHECK(count >= 0);
+    if (has_bindable_address()) {
+        CHECK(count > 0);
+    }
+    for (int i = 0; i < count; i++) {
+        struct sockaddr_storage ss;
+        socklen_t len = sizeof(ss);
+        int type = 0;
+        socklen_t type_len = sizeof(type);
+        CHECK(getsockopt(fds[i], SOL_SOCKET, SO_TYPE, &type, &type_len) == 0 && type == SOCK_DGRAM);
+        CHECK(getsockname(fds[i], (struct sockaddr*)&ss, &len) == 0);
+    }
+    CHECK(zts_get_pollable_fds(NULL, MAX_FDS) == ZTS_ERR_ARG);
+}
+
+int main()
+{
+    char path[] = "/tmp/libzt-process-XXXXXX";
+    if (! mkdtemp(path)) {
+        return 1;
+    }
+
+    // Stopped from a handler: that zts_process() call finishes the node
+    stop_in_handler = 1;
+    CHECK(start(path) == ZTS_ERR_OK);
+    CHECK(process_until_up() == ZTS_ERR_SERVICE);
+    CHECK(node_up);
+    CHECK(handler_stop_result == ZTS_ERR_OK);
+    CHECK(zts_process(0) == ZTS_ERR_SERVICE);
+    CHECK(zts_next_deadline() == ZTS_ERR_SERVICE);
+
+    // Stopped by the driving thread between calls
+    stop_in_handler = 0;
+    CHECK(start(path) == ZTS_ERR_OK);
+    CHECK(process_until_up() == ZTS_ERR_OK);
+    CHECK(node_up);
+    CHECK(zts_next_deadline() >= 0);
+    test_pollable_fds();
+    CHECK(zts_node_free() == ZTS_ERR_OK);
+    CHECK(zts_process(0) == ZTS_ERR_SERVICE);
+    return test_result();
+}
@@ -0,0 +1,107 @@
+"""Smoke test of the Python event queue, poller and asyncio integration.
+
+Needs no network: the node is started but joins nothing, so only what works
+before any peer is reachable is checked. Run it against a built package:
+
+    cd pkg/pypi && ./build.sh ext && ./build.sh check
+"""
+
+import asyncio
+import tempfile
+import threading
+import time
+import unittest
+
+import libzt
+from libzt import aio
+
+WAIT_SECONDS = 60
+UNROUTABLE = "10.255.255.1"
+
+events = None
+
+
+def setUpModule():
+    global events
+    # Must exist before the node starts, and replaces the director callback
+    events = aio.events()
+    assert libzt.zts_init_from_storage(tempfile.mkdtemp(prefix="libzt-python-")) == libzt.ZTS_ERR_OK
+    assert libzt.zts_node_start() == libzt.ZTS_ERR_OK
+
+
+def tearDownModule():
+    libzt.zts_node_free()
+
+
+def run(coro):
+    """Run a coroutine on a new event loop and release that loop's poller afterwards"""
+
+    async def main():
+        try:
+            return await asyncio.wait_for(coro, WAIT_SECONDS)
+        finally:
+            aio.close_loop(asyncio.get_running_loop())
+
+    return asyncio.run(main())
+
+
+class EventQueueTest(unittest.TestCase):
+    def test_node_up(self):
+        self.assertNotEqual(run(events.wait_for(libzt.ZTS_EVENT_NODE_UP)), 0)
+
+
+class PollerTest(unittest.TestCase):
+    def setUp(self):
+        self.fd = libzt.zts_bsd_socket(libzt.ZTS_AF_INET, libzt.ZTS_SOCK_DGRAM, 0)
+        self.assertGreaterEqual(self.fd, 0)
+        self.pfd = libzt.zts_poller_new()
+        self.assertGreaterEqual(self.pfd, 0)
+
+    def tearDown(self):
+        libzt.zts_poller_free(self.pfd)
+        libzt.zts_py_close(self.fd)
+
+    def test_readiness(self):
+        self.assertEqual(libzt.zts_get_socket_error(self.fd), 0)
+        libzt.zts_poller_set(self.pfd, self.fd, libzt.ZTS_POLLIN | libzt.ZTS_POLLOUT)
+        self.assertEqual(libzt.zts_py_poller_wait(self.pfd, 8, 0), [(self.fd, libzt.ZTS_POLLOUT)])
+        libzt.zts_poller_set(self.pfd, self.fd, libzt.ZTS_POLLIN)
+        self.assertEqual(libzt.zts_py_poller_wait(self.pfd, 8, 0), [])
+        self.assertEqual(libzt.zts_py_poller_wait(self.pfd, 0, 0), libzt.ZTS_ERR_ARG)
+
+    def test_wait_releases_gil(self):
+        ticks = []
+        done = threading.Event()
+
+        def tick():
+            while not done.is_set():
+                ticks.append(1)
+                time.sleep(0.001)
+
+        libzt.zts_poller_set(self.pfd, self.fd, libzt.ZTS_POLLIN)
+        ticker = threading.Thread(target=tick)
+        ticker.start()
+        self.assertEqual(libzt.zts_py_poller_wait(self.pfd, 8, 500), [])
+        done.set()
+        ticker.join()
+        self.assertGreater(len(ticks), 10)
+
+
+class AsyncioTest(unittest.TestCase):
+    def test_server(self):
+        async def serve():
+            server = await aio.start_server(lambda reader, writer: None, "0.0.0.0", 9000)
+            self.assertTrue(server.is_serving())
+            server.close()
+            await server.wait_closed()
+            return server.is_serving()
+
+        self.assertFalse(run(serve()))
+
+    def test_connect_without_route(self):
+        with self.assertRaises(OSError):
+            run(aio.open_connection(UNROUTABLE, 80))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,112 @@
+"""Compare receive throughput of recv() with recv_into() over ZeroTier.
+
+Run a sender on one host and the receiver on another, both members of the
+same network:
+
+    python3 throughput.py send <storage_path> <net_id> <port>
+    python3 throughput.py recv <storage_path> <net_id> <sender_ip> <port>
+
+The sender accepts one connection per receive mode and writes TOTAL_BYTES to
+each. The receiver reads them with recv() and then with recv_into() into a
+preallocated bytearray, and prints MB/s for both. A background thread counts
+how often it gets to run during each transfer, which shows whether the
+receiving thread releases the GIL while it waits.
+"""
+
+import sys
+import threading
+import time
+
+import libzt
+
+TOTAL_BYTES = 256 * 1024 * 1024
+CHUNK = 64 * 1024
+MODES = ("recv", "recv_into")
+
+
+def start_node(storage_path, net_id):
+    node = libzt.ZeroTierNode()
+    node.init_set_event_handler(lambda event_code, id: None)
+    node.init_from_storage(storage_path)
+    node.node_start()
+    while not node.node_is_online():
+        libzt.zts_util_delay(50)
+    node.net_join(net_id)
+    while not node.net_transport_is_ready(net_id):
+        libzt.zts_util_delay(50)
+    return node
+
+
+def send(port):
+    server = libzt.socket(libzt.ZTS_AF_INET, libzt.ZTS_SOCK_STREAM, 0)
+    server.bind(("0.0.0.0", port))
+    server.listen(len(MODES))
+    payload = b"\xa5" * CHUNK
+    for _ in MODES:
+        conn, _ = server.accept()
+        remaining = TOTAL_BYTES
+        while remaining > 0:
+            count = min(remaining, CHUNK)
+            conn.sendall(payload[:count])
+            remaining -= count
+        conn.close()
+    server.close()
+
+
+class Ticker(threading.Thread):
+    """Count how often a pure Python thread gets to run"""
+
+    def __init__(self):
+        threading.Thread.__init__(self, daemon=True)
+        self.ticks = 0
+        self.running = True
+
+    def run(self):
+        while self.running:
+            self.ticks += 1
+            time.sleep(0.001)
+
+
+def receive(sender_ip, port, mode):
+    sock = libzt.socket(libzt.ZTS_AF_INET, libzt.ZTS_SOCK_STREAM, 0)
+    sock.connect((sender_ip, port))
+    buf = bytearray(CHUNK)
+    received = 0
+    ticker = Ticker()
+    ticker.start()
+    start = time.perf_counter()
+    while received < TOTAL_BYTES:
+        if mode == "recv":
+            data = sock.recv(CHUNK)
+            n_bytes = len(data) if data else 0
+        else:
+            n_bytes = sock.recv_into(buf)
+        if not n_bytes:
+            break
+        received += n_bytes
+    elapsed = time.perf_counter() - start
+    ticker.running = False
+    sock.close()
+    print(
+        "%-10s %8.1f MB/s  %d bytes in %.2f s, ticker ran %d times"
+        % (mode, received / elapsed / 1e6, received, elapsed, ticker.ticks)
+    )
+
+
+def main(argv):
+    if len(argv) == 5 and argv[1] == "send":
+        node = start_node(argv[2], int(argv[3], 16))
+        send(int(argv[4]))
+    elif len(argv) == 6 and argv[1] == "recv":
+        node = start_node(argv[2], int(argv[3], 16))
+        for mode in MODES:
+            receive(argv[4], int(argv[5]), mode)
+    else:
+        print(__doc__)
+        return 1
+    node.node_stop()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,108 @@
+/**
+ * Stop-to-online latency of a node restarted in-process with a new identity
+ *
+ * Runs CYCLES blue/green rotations. Each one stops the node, alternating
+ * between zts_node_stop() and zts_node_free(), then starts it again right away
+ * with a freshly generated identity. It checks that the start is accepted at
+ * once and that the stack carries sockets again. Prints how long the stop took,
+ * and the time from the start of the stop until the node was online and until
+ * it had an address on an ad-hoc network. Exits with 77 (skipped) if the node
+ * cannot come online, e.g. without Internet access.
+ */
+
+#include "node.h"
+
+#define CYCLES   5
+#define UDP_PORT 9000
+
+static int wait_online()
+{
+    for (int i = 0; i < WAIT_SECONDS * 1000 && ! zts_node_is_online(); i++) {
+        zts_util_delay(1);
+    }
+    return zts_node_is_online() ? 0 : SKIPPED;
+}
+
+static int wait_ready(uint64_t net_id)
+{
+    for (int i = 0; i < WAIT_SECONDS * 1000 && ! zts_net_transport_is_ready(net_id); i++) {
+        zts_util_delay(1);
+    }
+    return zts_net_transport_is_ready(net_id) ? 0 : SKIPPED;
+}
+
+static int start()
+{
+    char key[ZTS_ID_STR_BUF_LEN] = { 0 };
+    unsigned int len = ZTS_ID_STR_BUF_LEN;
+    CHECK(zts_id_new(key, &len) == ZTS_ERR_OK);
+    CHECK(zts_init_from_memory(key, len) == ZTS_ERR_OK);
+    int err = zts_node_start();
+    CHECK(err == ZTS_ERR_OK);
+    return err;
+}
+
+int main()
+{
+    uint64_t net_id = zts_net_compute_adhoc_id(UDP_PORT, UDP_PORT);
+    int err = start() == ZTS_ERR_OK ? wait_online() : -1;
+    if (! err) {
+        zts_net_join(net_id);
+        err = wait_ready(net_id);
+    }
+    if (err == SKIPPED) {
+        printf("node did not come online, skipping\n");
+        zts_node_free();
+        return failures ? 1 : SKIPPED;
+    }
+    if (err) {
+        return test_result();
+    }
+
+    double stop_total = 0, online_total = 0, ready_total = 0;
+    for (int i = 0; i < CYCLES; i++) {
+        // Generate the next identity before the clock starts, as a rotation would
+        char key[ZTS_ID_STR_BUF_LEN] = { 0 };
+        unsigned int len = ZTS_ID_STR_BUF_LEN;
+        CHECK(zts_id_new(key, &len) == ZTS_ERR_OK);
+
+        double t0 = now_ms();
+        CHECK((i % 2 ? zts_node_free() : zts_node_stop()) == ZTS_ERR_OK);
+        double t1 = now_ms();
+        CHECK(zts_init_from_memory(key, len) == ZTS_ERR_OK);
+        CHECK(zts_node_start() == ZTS_ERR_OK);
+        if (wait_online()) {
+            fprintf(stderr, "cycle %d: node did not come back online\n", i);
+            failures++;
+            break;
+        }
+        double t2 = now_ms();
+        CHECK(zts_net_join(net_id) == ZTS_ERR_OK);
+        if (wait_ready(net_id)) {
+            fprintf(stderr, "cycle %d: network did not come back\n", i);
+            failures++;
+            break;
+        }
+        double t3 = now_ms();
+        printf("cycle %d: stop %.1f ms, online after %.0f ms, address after %.0f ms\n", i, t1 - t0, t2 - t0, t3 - t0);
+        stop_total += t1 - t0;
+        online_total += t2 - t0;
+        ready_total += t3 - t0;
+
+        // The stack carries sockets again
+        int fd = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_DGRAM, 0);
+        CHECK(fd >= 0);
+        CHECK(zts_bind(fd, "::", UDP_PORT) == ZTS_ERR_OK);
+        CHECK(zts_bsd_close(fd) == ZTS_ERR_OK);
+    }
+    if (! failures) {
+        printf(
+            "mean of %d: stop %.1f ms, online after %.0f ms, address after %.0f ms\n",
+            CYCLES,
+            stop_total / CYCLES,
+            online_total / CYCLES,
+            ready_total / CYCLES);
+    }
+    zts_node_free();
+    return test_result();
+}
@@ -0,0 +1,114 @@
+/**
+ * Self-test of the C API
+ *
+ * Checks the parts of the API that need no network first: utilities, identity
+ * generation and the errors returned before a node runs. Then starts a node on
+ * an ad-hoc network and checks addresses and a bound socket. Exits with 77
+ * (skipped) if the node cannot come online, e.g. without Internet access.
+ */
+
+#include "node.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define UDP_PORT 9000
+
+static void test_utilities()
+{
+    CHECK(zts_net_compute_adhoc_id(22, 22) == 0xff00160016000000ULL);
+    CHECK(zts_net_compute_adhoc_id(0, 65535) == 0xff0000ffff000000ULL);
+    CHECK(zts_util_get_ip_family("10.1.2.3") == ZTS_AF_INET);
+    CHECK(zts_util_get_ip_family("fd00::1") == ZTS_AF_INET6);
+
+    const char* ips[] = { "10.1.2.3", "fd00::1:2" };
+    for (int i = 0; i < 2; i++) {
+        struct zts_sockaddr_storage ss;
+        zts_socklen_t len = sizeof(ss);
+        char str[ZTS_IP_MAX_STR_LEN] = { 0 };
+        unsigned short port = 0;
+        CHECK(zts_util_ipstr_to_saddr(ips[i], 1234, (struct zts_sockaddr*)&ss, &len) == ZTS_ERR_OK);
+        CHECK(zts_util_ntop((struct zts_sockaddr*)&ss, len, str, ZTS_IP_MAX_STR_LEN, &port) == ZTS_ERR_OK);
+        CHECK(! strcmp(str, ips[i]));
+        CHECK(port == 1234);
+    }
+    struct zts_sockaddr_storage ss;
+    zts_socklen_t len = sizeof(ss);
+    CHECK(zts_util_ipstr_to_saddr("not an address", 1234, (struct zts_sockaddr*)&ss, &len) == ZTS_ERR_ARG);
+}
+
+static void test_identities()
+{
+    char key[ZTS_ID_STR_BUF_LEN] = { 0 };
+    unsigned int len = ZTS_ID_STR_BUF_LEN;
+    CHECK(zts_id_new(key, &len) == ZTS_ERR_OK);
+    CHECK(len > 0 && len < ZTS_ID_STR_BUF_LEN);
+    CHECK(zts_id_pair_is_valid(key, len));
+    // Pairing the public key with another address must fail
+    key[0] = key[0] == 'a' ? 'b' : 'a';
+    CHECK(! zts_id_pair_is_valid(key, len));
+    CHECK(zts_id_new(NULL, &len) == ZTS_ERR_ARG);
+}
+
+static void test_not_running()
+{
+    CHECK(! zts_node_is_online());
+    CHECK(zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_DGRAM, 0) == ZTS_ERR_SERVICE);
+    CHECK(zts_bsd_close(0) == ZTS_ERR_SERVICE);
+    CHECK(zts_node_stop() == ZTS_ERR_SERVICE);
+}
+
+static void test_node(uint64_t net_id)
+{
+    char key[ZTS_ID_STR_BUF_LEN] = { 0 };
+    unsigned int len = ZTS_ID_STR_BUF_LEN;
+    CHECK(zts_node_get_id() != 0);
+    CHECK(zts_node_get_id_pair(key, &len) == ZTS_ERR_OK);
+    CHECK(zts_id_pair_is_valid(key, len));
+    CHECK(strtoull(key, NULL, 16) == zts_node_get_id());
+
+    // Ad-hoc networks only assign IPv6 addresses
+    char addr[ZTS_IP_MAX_STR_LEN] = { 0 };
+    CHECK(zts_addr_get_str(net_id, ZTS_AF_INET6, addr, ZTS_IP_MAX_STR_LEN) == ZTS_ERR_OK);
+    CHECK(zts_util_get_ip_family(addr) == ZTS_AF_INET6);
+    CHECK(zts_addr_get_str(net_id, ZTS_AF_INET, addr, ZTS_IP_MAX_STR_LEN) != ZTS_ERR_OK);
+
+    int fd = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_DGRAM, 0);
+    CHECK(fd >= 0);
+    struct zts_sockaddr_storage ss;
+    zts_socklen_t slen = sizeof(ss);
+    CHECK(zts_util_ipstr_to_saddr("::", UDP_PORT, (struct zts_sockaddr*)&ss, &slen) == ZTS_ERR_OK);
+    CHECK(zts_bsd_bind(fd, (struct zts_sockaddr*)&ss, slen) == ZTS_ERR_OK);
+    slen = sizeof(ss);
+    CHECK(zts_bsd_getsockname(fd, (struct zts_sockaddr*)&ss, &slen) == ZTS_ERR_OK);
+    unsigned short port = 0;
+    CHECK(zts_util_ntop((struct zts_sockaddr*)&ss, slen, addr, ZTS_IP_MAX_STR_LEN, &port) == ZTS_ERR_OK);
+    CHECK(port == UDP_PORT);
+    CHECK(zts_bsd_close(fd) == ZTS_ERR_OK);
+    CHECK(zts_bsd_close(fd) < 0);
+}
+
+int main()
+{
+    test_utilities();
+    test_identities();
+    test_not_running();
+
+    char path[] = "/tmp/libzt-selftest-XXXXXX";
+    if (! mkdtemp(path)) {
+        return 1;
+    }
+    uint64_t net_id = zts_net_compute_adhoc_id(UDP_PORT, UDP_PORT);
+    int err = start_node(path, 0, net_id);
+    if (err == SKIPPED) {
+        printf("node did not come online, skipping\n");
+        zts_node_free();
+        return failures ? 1 : SKIPPED;
+    }
+    CHECK(err == 0);
+    if (err == 0) {
+        test_node(net_id);
+    }
+    zts_node_free();
+    return test_result();
+}
@@ -0,0 +1,168 @@
+/**
+ * Time to first packet after a restart, from storage and from a snapshot
+ *
+ * Forks a UDP echo node, then starts a client node three times and measures
+ * the time from zts_node_start() until its first echo comes back:
+ *
+ *     cold      new identity and empty storage
+ *     storage   restart from the storage the first run left behind
+ *     snapshot  restart from the blob zts_state_export() wrote at the end of
+ *               the second run, without any storage
+ *
+ * Checks that the restart from the snapshot keeps the node ID and address.
+ * Exits with 77 (skipped) if the echo node cannot come online, e.g. without
+ * Internet access.
+ */
+
+#include "node.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UDP_PORT 9000
+#define PROBE_MS 10
+
+static uint64_t net_id;
+static char storage_dir[256];
+static char server_addr[ZTS_IP_MAX_STR_LEN];
+
+// Runs in a child: echo datagrams until killed
+static int run_server(int out, void* arg)
+{
+    char path[512];
+    char buf[64];
+    (void)arg;
+    snprintf(path, sizeof(path), "%s/server", storage_dir);
+    int err = start_node(path, 0, net_id);
+    if (err) {
+        return err;
+    }
+    int fd = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_DGRAM, 0);
+    if (zts_bind(fd, "::", UDP_PORT) != ZTS_ERR_OK) {
+        return 1;
+    }
+    zts_addr_get_str(net_id, ZTS_AF_INET6, server_addr, ZTS_IP_MAX_STR_LEN);
+    if (write(out, server_addr, sizeof(server_addr)) != sizeof(server_addr)) {
+        return 1;
+    }
+    for (;;) {
+        struct zts_sockaddr_storage from;
+        zts_socklen_t len = sizeof(from);
+        ssize_t n = zts_bsd_recvfrom(fd, buf, sizeof(buf), 0, (struct zts_sockaddr*)&from, &len);
+        if (n > 0) {
+            zts_bsd_sendto(fd, buf, n, 0, (struct zts_sockaddr*)&from, len);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Start the node the caller initialized and return the milliseconds until the
+ * first echo arrived, or a negative value if none did
+ */
+static double first_echo(int join)
+{
+    struct zts_sockaddr_storage to;
+    zts_socklen_t to_len = sizeof(to);
+    char probe = 'p', reply = 0;
+    zts_util_ipstr_to_saddr(server_addr, UDP_PORT, (struct zts_sockaddr*)&to, &to_len);
+
+    double start = now_ms();
+    double deadline = start + WAIT_SECONDS * 1000.0;
+    if (zts_node_start() != ZTS_ERR_OK) {
+        return -1;
+    }
+    // Restarted nodes rejoin their networks by themselves
+    if (join) {
+        while (! zts_node_is_online() && now_ms() < deadline) {
+            zts_util_delay(1);
+        }
+        zts_net_join(net_id);
+    }
+    while (! zts_net_transport_is_ready(net_id) && now_ms() < deadline) {
+        zts_util_delay(1);
+    }
+    int fd = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    zts_set_blocking(fd, 0);
+    double sent = 0;
+    while (now_ms() < deadline) {
+        if (now_ms() - sent >= PROBE_MS) {
+            zts_bsd_sendto(fd, &probe, 1, 0, (struct zts_sockaddr*)&to, to_len);
+            sent = now_ms();
+        }
+        if (zts_bsd_recv(fd, &reply, 1, 0) == 1) {
+            zts_bsd_close(fd);
+            return now_ms() - start;
+        }
+        zts_util_delay(1);
+    }
+    zts_bsd_close(fd);
+    return -1;
+}
+
+static void report(const char* mode, double elapsed)
+{
+    if (elapsed < 0) {
+        fprintf(stderr, "%s: no echo within %d s\n", mode, WAIT_SECONDS);
+        failures++;
+        return;
+    }
+    printf("%-9s first echo after %.0f ms\n", mode, elapsed);
+}
+
+int main()
+{
+    strcpy(storage_dir, "/tmp/libzt-snapshot-XXXXXX");
+    if (! mkdtemp(storage_dir)) {
+        return 1;
+    }
+    net_id = zts_net_compute_adhoc_id(UDP_PORT, UDP_PORT);
+    int fd = -1;
+    pid_t server = fork_peer(run_server, NULL, &fd);
+    if (server < 0) {
+        return 1;
+    }
+    if (read(fd, server_addr, sizeof(server_addr)) != sizeof(server_addr)) {
+        int err = wait_peer(server);
+        printf("echo node did not come online, skipping\n");
+        return err == SKIPPED ? SKIPPED : 1;
+    }
+
+    char path[512];
+    char addr[ZTS_IP_MAX_STR_LEN] = { 0 };
+    snprintf(path, sizeof(path), "%s/client", storage_dir);
+    CHECK(zts_init_from_storage(path) == ZTS_ERR_OK);
+    report("cold", first_echo(1));
+    uint64_t id = zts_node_get_id();
+    CHECK(zts_addr_get_str(net_id, ZTS_AF_INET6, addr, ZTS_IP_MAX_STR_LEN) == ZTS_ERR_OK);
+    CHECK(zts_node_free() == ZTS_ERR_OK);
+
+    CHECK(zts_init_from_storage(path) == ZTS_ERR_OK);
+    report("storage", first_echo(0));
+    // A buffer that is too small reports the size needed
+    char small = 0;
+    unsigned int len = 1;
+    CHECK(zts_state_export(&small, &len) == ZTS_ERR_ARG);
+    CHECK(len > 1);
+    void* blob = malloc(len);
+    CHECK(zts_state_export(blob, &len) == ZTS_ERR_OK);
+    CHECK(zts_node_free() == ZTS_ERR_OK);
+
+    char snapshot_addr[ZTS_IP_MAX_STR_LEN] = { 0 };
+    CHECK(zts_init_from_snapshot(blob, len) == ZTS_ERR_OK);
+    report("snapshot", first_echo(0));
+    CHECK(zts_node_get_id() == id);
+    CHECK(zts_addr_get_str(net_id, ZTS_AF_INET6, snapshot_addr, ZTS_IP_MAX_STR_LEN) == ZTS_ERR_OK);
+    CHECK(! strcmp(snapshot_addr, addr));
+    zts_node_free();
+    CHECK(zts_init_from_snapshot(blob, len / 2) == ZTS_ERR_ARG);
+    free(blob);
+
+    kill(server, SIGTERM);
+    wait_peer(server);
+    return test_result();
+}
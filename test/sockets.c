@@ -0,0 +1,116 @@
+/**
+ * Socket lifecycle without a network
+ *
+ * Sockets can be used as soon as a node has started, before it comes online,
+ * so this needs no network. Opens, uses and closes UDP and TCP sockets, then
+ * starts a second node in its own context and checks that a socket stops
+ * working once the node it was created on stops, while the other node's
+ * sockets keep working.
+ */
+
+#include "node.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define UDP_PORT 9000
+#define TCP_PORT 8000
+
+static int bind_any(int fd, unsigned short port)
+{
+    struct zts_sockaddr_storage ss;
+    zts_socklen_t len = sizeof(ss);
+    zts_util_ipstr_to_saddr("::", port, (struct zts_sockaddr*)&ss, &len);
+    return zts_bsd_bind(fd, (struct zts_sockaddr*)&ss, len);
+}
+
+static void test_udp()
+{
+    char buf[16];
+    int fd = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_DGRAM, 0);
+    CHECK(fd >= 0);
+    CHECK(bind_any(fd, UDP_PORT) == ZTS_ERR_OK);
+
+    struct zts_sockaddr_storage ss;
+    zts_socklen_t len = sizeof(ss);
+    char addr[ZTS_IP_MAX_STR_LEN] = { 0 };
+    unsigned short port = 0;
+    CHECK(zts_bsd_getsockname(fd, (struct zts_sockaddr*)&ss, &len) == ZTS_ERR_OK);
+    CHECK(zts_util_ntop((struct zts_sockaddr*)&ss, len, addr, ZTS_IP_MAX_STR_LEN, &port) == ZTS_ERR_OK);
+    CHECK(port == UDP_PORT);
+
+    // Nothing has arrived, so a non-blocking receive fails with EAGAIN
+    CHECK(zts_set_blocking(fd, 0) == ZTS_ERR_OK);
+    CHECK(zts_get_blocking(fd) == 0);
+    CHECK(zts_bsd_recv(fd, buf, sizeof(buf), 0) < 0);
+    CHECK(zts_errno == ZTS_EAGAIN);
+    CHECK(zts_get_socket_error(fd) == 0);
+
+    CHECK(zts_bsd_close(fd) == ZTS_ERR_OK);
+    CHECK(zts_bsd_close(fd) < 0);
+    CHECK(zts_bsd_recv(fd, buf, sizeof(buf), 0) < 0);
+}
+
+static void test_tcp()
+{
+    int fd = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_STREAM, 0);
+    CHECK(fd >= 0);
+    CHECK(zts_set_no_delay(fd, 1) == ZTS_ERR_OK);
+    CHECK(zts_get_no_delay(fd) == 1);
+    CHECK(bind_any(fd, TCP_PORT) == ZTS_ERR_OK);
+    CHECK(zts_bsd_listen(fd, 1) == ZTS_ERR_OK);
+    CHECK(zts_set_blocking(fd, 0) == ZTS_ERR_OK);
+    CHECK(zts_bsd_accept(fd, NULL, NULL) < 0);
+    CHECK(zts_errno == ZTS_EAGAIN);
+    CHECK(zts_bsd_close(fd) == ZTS_ERR_OK);
+
+    // Descriptors are reused once closed
+    for (int i = 0; i < 2 * ZTS_FD_SETSIZE; i++) {
+        fd = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_STREAM, 0);
+        if (fd < 0) {
+            CHECK(fd >= 0);
+            break;
+        }
+        CHECK(zts_bsd_close(fd) == ZTS_ERR_OK);
+    }
+}
+
+// A socket belongs to the node it was created on
+static void test_contexts(const char* dir)
+{
+    char path[512];
+    zts_ctx_t* other = zts_ctx_new();
+    snprintf(path, sizeof(path), "%s/other", dir);
+    CHECK(zts_ctx_init_from_storage(other, path) == ZTS_ERR_OK);
+    CHECK(zts_ctx_node_start(other) == ZTS_ERR_OK);
+
+    int mine = zts_bsd_socket(ZTS_AF_INET6, ZTS_SOCK_DGRAM, 0);
+    int theirs = zts_ctx_bsd_socket(other, ZTS_AF_INET6, ZTS_SOCK_DGRAM, 0);
+    CHECK(mine >= 0 && theirs >= 0 && mine != theirs);
+    CHECK(zts_node_stop() == ZTS_ERR_OK);
+    CHECK(bind_any(mine, UDP_PORT) == ZTS_ERR_SERVICE);
+    CHECK(bind_any(theirs, UDP_PORT) == ZTS_ERR_OK);
+    // Sockets of a stopped node can still be closed
+    CHECK(zts_bsd_close(mine) == ZTS_ERR_OK);
+    CHECK(zts_bsd_close(theirs) == ZTS_ERR_OK);
+
+    CHECK(zts_ctx_node_free(other) == ZTS_ERR_OK);
+    CHECK(zts_ctx_free(other) == ZTS_ERR_OK);
+}
+
+int main()
+{
+    char dir[] = "/tmp/libzt-sockets-XXXXXX";
+    char path[512];
+    if (! mkdtemp(dir)) {
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s/node", dir);
+    CHECK(zts_init_from_storage(path) == ZTS_ERR_OK);
+    CHECK(zts_node_start() == ZTS_ERR_OK);
+    test_udp();
+    test_tcp();
+    test_contexts(dir);
+    zts_node_free();
+    return test_result();
+}
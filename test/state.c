@@ -0,0 +1,116 @@
+/**
+ * State export with network and peer caching allowed and disallowed
+ *
+ * Builds a state blob with an identity, a network config and a peer, starts a
+ * node from it and exports the node's state again. With caching allowed both
+ * records come back. With zts_init_allow_net_cache(0) and
+ * zts_init_allow_peer_cache(0) the node ignores them and the export holds
+ * neither. Needs no network: the records are never used to reach anyone.
+ */
+
+#include "node.h"
+
+#include <string.h>
+
+// Values of ZT_StateObjectType
+#define STATE_IDENTITY_SECRET 2
+#define STATE_PEER            5
+#define STATE_NETWORK_CONFIG  6
+
+#define RECORD_LEN 21
+#define NET_ID     0x1122334455000001ULL
+#define PEER_ID    0x2233445566ULL
+
+static unsigned char blob[4096];
+static unsigned int blob_len;
+
+static void put(unsigned char* p, uint64_t v, unsigned int bytes)
+{
+    for (unsigned int i = 0; i < bytes; i++) {
+        p[i] = (unsigned char)(v >> (8 * (bytes - 1 - i)));
+    }
+}
+
+static uint64_t get(const unsigned char* p, unsigned int bytes)
+{
+    uint64_t v = 0;
+    for (unsigned int i = 0; i < bytes; i++) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static void add_record(unsigned int type, uint64_t id, const void* data, unsigned int len)
+{
+    unsigned char* p = blob + blob_len;
+    p[0] = (unsigned char)type;
+    put(p + 1, id, 8);
+    put(p + 9, 1, 8);
+    put(p + 17, len, 4);
+    memcpy(p + RECORD_LEN, data, len);
+    blob_len += RECORD_LEN + len;
+    put(blob + 4, get(blob + 4, 4) + 1, 4);
+}
+
+// Number of records of `type` for `id` in an exported blob, or -1 if it is malformed
+static int count_records(const unsigned char* b, unsigned int len, unsigned int type, uint64_t id)
+{
+    if (len < 8 || memcmp(b, "ZTS", 3) != 0) {
+        return -1;
+    }
+    unsigned int count = (unsigned int)get(b + 4, 4);
+    unsigned int off = 8;
+    int found = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        if (len - off < RECORD_LEN) {
+            return -1;
+        }
+        unsigned int olen = (unsigned int)get(b + off + 17, 4);
+        if (len - off - RECORD_LEN < olen) {
+            return -1;
+        }
+        if (b[off] == type && get(b + off + 1, 8) == id) {
+            found++;
+        }
+        off += RECORD_LEN + olen;
+    }
+    return found;
+}
+
+// Start from the blob, export, and return how many of its two cached records came back
+static int round_trip(int allow_caching)
+{
+    static unsigned char out[65536];
+    unsigned int len = sizeof(out);
+    CHECK(zts_init_from_snapshot(blob, blob_len) == ZTS_ERR_OK);
+    CHECK(zts_init_allow_net_cache(allow_caching) == ZTS_ERR_OK);
+    CHECK(zts_init_allow_peer_cache(allow_caching) == ZTS_ERR_OK);
+    CHECK(zts_node_start() == ZTS_ERR_OK);
+    CHECK(zts_state_export(out, &len) == ZTS_ERR_OK);
+    CHECK(zts_node_free() == ZTS_ERR_OK);
+    int identities = count_records(out, len, STATE_IDENTITY_SECRET, 0);
+    int networks = count_records(out, len, STATE_NETWORK_CONFIG, NET_ID);
+    int peers = count_records(out, len, STATE_PEER, PEER_ID);
+    CHECK(identities == 1);
+    CHECK(networks == 0 || networks == 1);
+    CHECK(peers == 0 || peers == 1);
+    return networks + peers;
+}
+
+int main()
+{
+    char key[ZTS_ID_STR_BUF_LEN] = { 0 };
+    unsigned int key_len = sizeof(key);
+    CHECK(zts_id_new(key, &key_len) == ZTS_ERR_OK);
+    memcpy(blob, "ZTS\1", 4);
+    blob_len = 8;
+    add_record(STATE_IDENTITY_SECRET, 0, key, strlen(key));
+    add_record(STATE_NETWORK_CONFIG, NET_ID, "config", 6);
+    add_record(STATE_PEER, PEER_ID, "peer", 4);
+
+    CHECK(round_trip(1) == 2);
+    CHECK(round_trip(0) == 0);
+    // Disallowing caching for one run does not keep the next from using the blob
+    CHECK(round_trip(1) == 2);
+    return test_result();
+}
@@ -0,0 +1,307 @@
+/**
+ * Virtual TSO: segment sizes and checksums after splitting at the tap
+ *
+ * Drives zts_lwip_eth_rx() and zts_lwip_eth_tx() of a TSO tap directly, with
+ * netifs that are never added to lwIP, and checks every packet the tap hands to
+ * ZeroTier and that SYNs pass in both directions unchanged.
+ */
+
+#include "VirtualTap.hpp"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace ZeroTier;
+
+#define MTU         2800
+#define ETH_HDR_LEN 14
+
+static int failures = 0;
+
+#define CHECK(cond)                                                                                                    \
+    do {                                                                                                               \
+        if (! (cond)) {                                                                                                \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);                                 \
+            failures++;                                                                                                \
+        }                                                                                                              \
+    } while (0)
+
+static std::vector<std::vector<uint8_t> > sent;
+static std::vector<std::vector<uint8_t> > received;
+
+static void on_send(
+    void*,
+    void*,
+    uint64_t,
+    const MAC&,
+    const MAC&,
+    unsigned int,
+    unsigned int,
+    const void* data,
+    unsigned int len)
+{
+    sent.push_back(std::vector<uint8_t>((const uint8_t*)data, (const uint8_t*)data + len));
+}
+
+static err_t on_input(struct pbuf* p, struct netif*)
+{
+    std::vector<uint8_t> frame(p->tot_len);
+    pbuf_copy_partial(p, &frame[0], p->tot_len, 0);
+    received.push_back(std::vector<uint8_t>(frame.begin() + ETH_HDR_LEN, frame.end()));
+    pbuf_free(p);
+    return ERR_OK;
+}
+
+static uint16_t get16(const uint8_t* b)
+{
+    return (uint16_t)((b[0] << 8) | b[1]);
+}
+
+static void put16(uint8_t* b, unsigned int v)
+{
+    b[0] = (uint8_t)(v >> 8);
+    b[1] = (uint8_t)v;
+}
+
+static uint32_t get32(const uint8_t* b)
+{
+    return ((uint32_t)get16(b) << 16) | get16(b + 2);
+}
+
+static void put32(uint8_t* b, uint32_t v)
+{
+    put16(b, v >> 16);
+    put16(b + 2, v & 0xffff);
+}
+
+static uint32_t sum(uint32_t acc, const uint8_t* b, unsigned int len)
+{
+    for (unsigned int i = 0; i + 1 < len; i += 2) {
+        acc += get16(b + i);
+    }
+    if (len & 1) {
+        acc += (uint32_t)b[len - 1] << 8;
+    }
+    return acc;
+}
+
+static uint16_t fold(uint32_t acc)
+{
+    while (acc >> 16) {
+        acc = (acc & 0xffff) + (acc >> 16);
+    }
+    return (uint16_t)acc;
+}
+
+static bool is_v4(const std::vector<uint8_t>& pkt)
+{
+    return (pkt[0] >> 4) == 4;
+}
+
+static unsigned int ip_len(const std::vector<uint8_t>& pkt)
+{
+    return is_v4(pkt) ? (pkt[0] & 0x0f) * 4 : 40;
+}
+
+// Both checksums of a packet verify to 0xffff when it is intact
+static bool checksums_ok(const std::vector<uint8_t>& pkt)
+{
+    const uint8_t* ip = &pkt[0];
+    unsigned int ihl = ip_len(pkt);
+    unsigned int tcpTotal = pkt.size() - ihl;
+    uint32_t acc;
+    if (is_v4(pkt)) {
+        if (fold(sum(0, ip, ihl)) != 0xffff) {
+            return false;
+        }
+        acc = sum(0, ip + 12, 8);
+    }
+    else {
+        acc = sum(0, ip + 8, 32);
+    }
+    acc += 6 + tcpTotal;
+    return fold(sum(acc, ip + ihl, tcpTotal)) == 0xffff;
+}
+
+static void set_checksums(std::vector<uint8_t>& pkt)
+{
+    uint8_t* ip = &pkt[0];
+    unsigned int ihl = ip_len(pkt);
+    unsigned int tcpTotal = pkt.size() - ihl;
+    uint32_t acc;
+    if (is_v4(pkt)) {
+        put16(ip + 10, 0);
+        put16(ip + 10, (uint16_t)~fold(sum(0, ip, ihl)));
+        acc = sum(0, ip + 12, 8);
+    }
+    else {
+        acc = sum(0, ip + 8, 32);
+    }
+    put16(ip + ihl + 16, 0);
+    put16(ip + ihl + 16, (uint16_t)~fold(sum(acc + 6 + tcpTotal, ip + ihl, tcpTotal)));
+}
+
+/**
+ * Build a TCP packet from port 5000 of the first address to port 6000 of the
+ * second, or the other way round if reply is set
+ */
+static std::vector<uint8_t>
+make_tcp(bool v4, bool reply, uint8_t flags, uint32_t seq, const std::vector<uint8_t>& opts, unsigned int payload)
+{
+    static const uint8_t addr4[2][4] = { { 10, 0, 0, 1 }, { 10, 0, 0, 2 } };
+    static const uint8_t addr6[2][16] = { { 0xfd, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 },
+                                          { 0xfd, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2 } };
+    unsigned int ihl = v4 ? 20 : 40;
+    unsigned int thl = 20 + opts.size();
+    std::vector<uint8_t> pkt(ihl + thl + payload, 0);
+    uint8_t* ip = &pkt[0];
+    int src = reply ? 1 : 0;
+    if (v4) {
+        ip[0] = 0x45;
+        put16(ip + 2, pkt.size());
+        put16(ip + 6, 0x4000);
+        ip[8] = 64;
+        ip[9] = 6;
+        memcpy(ip + 12, addr4[src], 4);
+        memcpy(ip + 16, addr4[1 - src], 4);
+    }
+    else {
+        ip[0] = 0x60;
+        put16(ip + 4, thl + payload);
+        ip[6] = 6;
+        ip[7] = 64;
+        memcpy(ip + 8, addr6[src], 16);
+        memcpy(ip + 24, addr6[1 - src], 16);
+    }
+    uint8_t* th = ip + ihl;
+    put16(th, reply ? 6000 : 5000);
+    put16(th + 2, reply ? 5000 : 6000);
+    put32(th + 4, seq);
+    put32(th + 8, 1);
+    th[12] = (uint8_t)((thl / 4) << 4);
+    th[13] = flags;
+    put16(th + 14, 0xffff);
+    if (! opts.empty()) {
+        memcpy(th + 20, &opts[0], opts.size());
+    }
+    for (unsigned int i = 0; i < payload; i++) {
+        th[thl + i] = (uint8_t)i;
+    }
+    set_checksums(pkt);
+    return pkt;
+}
+
+static std::vector<uint8_t> mss_option(unsigned int mss)
+{
+    std::vector<uint8_t> opts(8, 1);   // MSS, NOP, NOP, SACK permitted
+    opts[0] = 2;
+    opts[1] = 4;
+    put16(&opts[2], mss);
+    opts[6] = 4;
+    opts[7] = 2;
+    return opts;
+}
+
+static std::vector<uint8_t> timestamp_option()
+{
+    std::vector<uint8_t> opts(12, 1);   // NOP, NOP, timestamps
+    opts[2] = 8;
+    opts[3] = 10;
+    return opts;
+}
+
+static void receive(VirtualTap* tap, const std::vector<uint8_t>& pkt)
+{
+    MAC from(0x02aabbccdd02ULL);
+    MAC to(0x02aabbccdd01ULL);
+    zts_lwip_eth_rx(tap, from, to, is_v4(pkt) ? 0x0800 : 0x86dd, &pkt[0], pkt.size());
+}
+
+static void send(struct netif* n, const std::vector<uint8_t>& pkt)
+{
+    struct pbuf* p = pbuf_alloc(PBUF_RAW, (u16_t)(ETH_HDR_LEN + pkt.size()), PBUF_RAM);
+    uint8_t eth[ETH_HDR_LEN] = { 0x02, 0xaa, 0xbb, 0xcc, 0xdd, 0x02, 0x02, 0xaa, 0xbb, 0xcc, 0xdd, 0x01 };
+    put16(eth + 12, is_v4(pkt) ? 0x0800 : 0x86dd);
+    pbuf_take(p, eth, ETH_HDR_LEN);
+    pbuf_take_at(p, &pkt[0], (u16_t)pkt.size(), ETH_HDR_LEN);
+    zts_lwip_eth_tx(n, p);
+    pbuf_free(p);
+}
+
+/**
+ * Send one large segment and check how it was split: no packet above the MTU,
+ * valid checksums, contiguous sequence numbers, intact payload, PSH only on the
+ * last packet
+ */
+static void check_split(struct netif* n, bool v4, unsigned int payload)
+{
+    std::vector<uint8_t> opts = timestamp_option();
+    std::vector<uint8_t> pkt = make_tcp(v4, false, 0x18, 1000, opts, payload);
+    unsigned int hl = pkt.size() - payload;
+    sent.clear();
+    send(n, pkt);
+    unsigned int expected = (payload + (MTU - hl) - 1) / (MTU - hl);
+    CHECK(sent.size() == expected);
+    uint32_t seq = 1000;
+    unsigned int off = 0;
+    for (size_t i = 0; i < sent.size(); i++) {
+        const std::vector<uint8_t>& seg = sent[i];
+        CHECK(seg.size() <= MTU);
+        CHECK(checksums_ok(seg));
+        const uint8_t* th = &seg[ip_len(seg)];
+        CHECK(get32(th + 4) == seq);
+        CHECK(! memcmp(th + 20, &opts[0], opts.size()));
+        CHECK(((th[13] & 0x08) != 0) == (i + 1 == sent.size()));
+        unsigned int chunk = seg.size() - hl;
+        CHECK(! memcmp(th + hl - ip_len(seg), &pkt[hl + off], chunk));
+        seq += chunk;
+        off += chunk;
+    }
+    CHECK(off == payload);
+}
+
+int main()
+{
+    Events::setStackRunning(true);
+    VirtualTap* tap = new VirtualTap("", MAC(0x02aabbccdd01ULL), MTU, 0, 0x1234, on_send, NULL);
+    tap->_tso = true;
+    struct netif n4, n6;
+    memset(&n4, 0, sizeof(n4));
+    memset(&n6, 0, sizeof(n6));
+    n4.state = n6.state = tap;
+    n4.input = n6.input = on_input;
+    tap->netif4 = &n4;
+    tap->netif6 = &n6;
+
+    check_split(&n4, true, 16000);
+    check_split(&n6, false, 16000);
+
+    // The peer's SYN reaches lwIP unchanged, whatever MSS it announces
+    std::vector<std::vector<uint8_t> > syns;
+    syns.push_back(make_tcp(true, true, 0x12, 0, mss_option(1200), 0));
+    syns.push_back(make_tcp(false, true, 0x12, 0, mss_option(1400), 0));
+    syns.push_back(make_tcp(true, true, 0x12, 0, mss_option(TCP_MSS), 0));
+    for (size_t i = 0; i < syns.size(); i++) {
+        receive(tap, syns[i]);
+    }
+    CHECK(received == syns);
+
+    // Our own SYN announces TCP_MSS, which tells a peer with TSO that it may send super-segments
+    sent.clear();
+    std::vector<uint8_t> syn = make_tcp(true, false, 0x02, 0, mss_option(TCP_MSS), 0);
+    send(&n4, syn);
+    CHECK(sent.size() == 1 && sent[0] == syn);
+
+    tap->netif4 = NULL;
+    tap->netif6 = NULL;
+    delete tap;
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}